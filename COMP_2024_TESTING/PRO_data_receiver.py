@@ -2,28 +2,31 @@ import socket
 import threading
 import time
 from datetime import datetime
+import detection_link
 
 HOST = '0.0.0.0'  # Bind to all available interfaces
 PORT = 65432
 
 status = ""
 recent_data = []
+frames = detection_link.Reassembler()
 
-def handle_client(conn, addr):
+def handle_frame(data):
     global status
-    print('Connected by', addr)
-    while True:
-        data = conn.recv(1024)
-        if not data:
-            break
-        message = data.decode()
-        if message == "no face detected":
-            status = "No face detected"
-        else:
-            x, y = map(int, message.split(','))
-            status = determine_status(y)
-        recent_data.append((datetime.now(), message, status))
-        print(f"Received coordinates: {message}, status={status} ")
+    frame = frames.feed(data)
+    if frame is None:
+        return
+    frame_seq, sent_ns, records = frame
+    if not records or records[0]["label"] == detection_link.LABEL_NONE:
+        message = "no face detected"
+        status = "No face detected"
+    else:
+        r = records[0]  # Only consider the first detected face
+        x, y = r["x"] + r["w"] // 2, r["y"] + r["h"] // 2
+        message = f"{x},{y}"
+        status = determine_status(y)
+    recent_data.append((datetime.now(), message, status))
+    print(f"Received coordinates: {message}, status={status} ")
 
 def determine_status(distance_mm):
     if distance_mm > 400:
@@ -42,13 +45,15 @@ def log_data():
             recent_data.clear()
 
 def server_thread():
-    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
+    # Detections arrive as UDP datagrams, one per camera frame or more for a
+    # crowded one (see detection_link.py).
+    # detection_link/detection_receiver.cpp does the same job without Python.
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
         s.bind((HOST, PORT))
-        s.listen()
-        print('Waiting for connection...')
+        print('Waiting for detections...')
         while True:
-            conn, addr = s.accept()
-            threading.Thread(target=handle_client, args=(conn, addr)).start()
+            data = s.recv(2048)
+            handle_frame(data)
 
 def display_status():
     global status
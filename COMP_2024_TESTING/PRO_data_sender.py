@@ -1,32 +1,29 @@
-import socket
 import time
 import depthai as dai
 import cv2
 import numpy as np
+from detection_link import DetectionSender
 
-# Configure socket
+# Configure the detection link (UDP, see detection_link/DetectionLink.h)
 HOST = '10.0.0.198'  # Replace with the server's IP address
 PORT = 65432
 
-# Function to detect faces and send coordinates
-def detect_faces_and_send(frame, face_cascade):
+# Function to detect faces and send them, one datagram per camera frame
+def detect_faces_and_send(frame, face_cascade, link, stamp_ns):
     gray_frame = cv2.cvtColor(frame, cv2.COLOR_BGR2GRAY)
     faces = face_cascade.detectMultiScale(gray_frame, scaleFactor=1.1, minNeighbors=5, minSize=(30, 30))
+    frame_width = frame.shape[1]
     if len(faces) == 0:
-        send_coordinates("no face detected")
+        link.none(stamp_ns)
     else:
         for (x, y, w, h) in faces:
             # Draw a rectangle around the face
             cv2.rectangle(frame, (x, y), (x + w, y + h), (255, 0, 0), 2)
-            # Get the center point of the face
-            center_x, center_y = x + w // 2, y + h // 2
-            send_coordinates(f"{center_x},{center_y}")
-            break  # Only consider the first detected face
-
-def send_coordinates(message):
-    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
-        s.connect((HOST, PORT))
-        s.sendall(message.encode())
+            # Map the center of the face to 0-180 degrees across the image
+            center_x = x + w // 2
+            angle = center_x / frame_width * 180
+            link.add(x, y, w, h, angle_deg=angle, stamp_ns=stamp_ns)
+    link.flush()
 
 def main():
     # Load face detection model
@@ -45,6 +42,9 @@ def main():
 
     cam_rgb.video.link(xout_rgb.input)
 
+    # One socket for the whole run instead of a new connection per message
+    link = DetectionSender(HOST, PORT)
+
     # Connect to device and start pipeline
     with dai.Device(pipeline) as device:
         # Get output queue
@@ -52,20 +52,20 @@ def main():
         
         while True:
             in_rgb = q_rgb.get()
+            stamp_ns = time.time_ns()
 
             # Retrieve 'bgr' frame
             frame_rgb = in_rgb.getCvFrame()
 
-            # Detect faces and send coordinates
-            detect_faces_and_send(frame_rgb, face_cascade)
+            # Detect faces and send them, every frame
+            detect_faces_and_send(frame_rgb, face_cascade, link, stamp_ns)
 
             # Show the frame with the face box
             cv2.imshow("RGB", frame_rgb)
             if cv2.waitKey(1) == ord('q'):
                 break
-            
-            time.sleep(0.5)  # Send coordinates every half second
 
+    link.close()
     cv2.destroyAllWindows()
 
 if __name__ == "__main__":
@@ -0,0 +1,178 @@
+# Python side of detection_link/DetectionLink.h
+#
+# Uses detection_link/libdetectionlink.so when it has been built:
+#     g++ -O2 -shared -fPIC detection_link/DetectionLink.cpp -o detection_link/libdetectionlink.so
+# and falls back to packing the same datagrams with struct otherwise, so the
+# sender works on a machine without a compiler too.
+
+import ctypes
+import os
+import socket
+import struct
+import time
+
+DEFAULT_PORT = 65432
+LABEL_NONE = 0xFFFF
+MAX_RECORDS = 40          # per datagram
+MAX_FRAME_RECORDS = 160   # per camera frame
+
+_MAGIC = 0x4B4E4C44
+_VERSION = 3
+_PART_LAST = 0x0001
+_HEADER = struct.Struct("<IHHIHHIIQ")        # magic, version, count, frame_seq, part, flags, session, reserved, sent_ns
+_RECORD = struct.Struct("<QIHHhhhhHhHH")     # stamp_ns, seq, label, confidence, x, y, w, h, depth_mm, angle_cdeg, track, reserved
+
+_lib = None
+try:
+    _lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), "detection_link", "libdetectionlink.so"))
+    _lib.dl_sender_open.restype = ctypes.c_void_p
+    _lib.dl_sender_open.argtypes = [ctypes.c_char_p, ctypes.c_uint16]
+    _lib.dl_sender_add.restype = ctypes.c_int
+    _lib.dl_sender_add.argtypes = [ctypes.c_void_p, ctypes.c_uint16, ctypes.c_uint16,
+                                   ctypes.c_int16, ctypes.c_int16, ctypes.c_int16, ctypes.c_int16,
+                                   ctypes.c_uint16, ctypes.c_int16, ctypes.c_uint16, ctypes.c_uint64]
+    _lib.dl_sender_flush.restype = ctypes.c_int
+    _lib.dl_sender_flush.argtypes = [ctypes.c_void_p]
+    _lib.dl_sender_close.argtypes = [ctypes.c_void_p]
+except OSError:
+    _lib = None
+
+
+class DetectionSender:
+    """One UDP socket for the whole run, one datagram per camera frame
+    (more if it has over MAX_RECORDS detections).
+
+    Call add() for every detection in a frame (or none() when nothing was
+    found), then flush() once per frame."""
+
+    def __init__(self, host, port=DEFAULT_PORT):
+        self._handle = None
+        if _lib is not None:
+            self._handle = _lib.dl_sender_open(host.encode(), port)
+            if not self._handle:
+                raise OSError(f"cannot open detection link to {host}:{port}")
+        else:
+            self._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            self._sock.connect((host, port))
+            self._sock.setblocking(False)
+            self._pending = []
+            self._seq = 0
+            self._frame_seq = 0
+            self._part = 0
+            self._frame_records = 0
+            self._session = int.from_bytes(os.urandom(4), "little") or 1  # new each run, receivers start over
+
+    def add(self, x, y, w, h, depth_mm=0, angle_deg=0.0, label=0, confidence=1.0, track=0, stamp_ns=0):
+        stamp_ns = stamp_ns or time.time_ns()
+        confidence = max(0, min(10000, int(confidence * 10000)))
+        angle_cdeg = int(round(angle_deg * 100))
+        depth_mm = max(0, min(0xFFFF, int(depth_mm)))
+        if self._handle:
+            _lib.dl_sender_add(self._handle, label, confidence, int(x), int(y), int(w), int(h),
+                               depth_mm, angle_cdeg, track, stamp_ns)
+            return
+        if self._frame_records == MAX_FRAME_RECORDS:
+            return
+        if len(self._pending) == MAX_RECORDS:
+            self._send(False)
+        self._frame_records += 1
+        self._pending.append(_RECORD.pack(stamp_ns, self._seq & 0xFFFFFFFF, label, confidence,
+                                          int(x), int(y), int(w), int(h), depth_mm, angle_cdeg, track, 0))
+        self._seq += 1
+
+    def none(self, stamp_ns=0):
+        self.add(0, 0, 0, 0, label=LABEL_NONE, confidence=0, stamp_ns=stamp_ns)
+
+    def flush(self):
+        if self._handle:
+            return _lib.dl_sender_flush(self._handle)
+        if not self._pending and not self._part:
+            return 0
+        count = self._frame_records
+        return count if self._send(True) else 0
+
+    def _send(self, last):
+        data = _HEADER.pack(_MAGIC, _VERSION, len(self._pending), self._frame_seq & 0xFFFFFFFF, self._part,
+                            _PART_LAST if last else 0, self._session, 0, time.time_ns())
+        data += b"".join(self._pending)
+        self._pending = []
+        self._part += 1
+        if last:
+            self._frame_seq += 1
+            self._part = 0
+            self._frame_records = 0
+        try:
+            self._sock.send(data)
+        except (BlockingIOError, ConnectionRefusedError):
+            return False  # receiver busy or not started, the next frame replaces this one
+        return True
+
+    def close(self):
+        if self._handle:
+            _lib.dl_sender_close(self._handle)
+            self._handle = None
+        elif hasattr(self, "_sock"):
+            self._sock.close()
+
+
+def decode(data):
+    """Datagram -> (session, frame_seq, part, last, sent_ns, [record dicts]), or None if it is not one of ours."""
+    if len(data) < _HEADER.size:
+        return None
+    magic, version, count, frame_seq, part, flags, session, _, sent_ns = _HEADER.unpack_from(data)
+    if magic != _MAGIC or version != _VERSION or len(data) != _HEADER.size + count * _RECORD.size:
+        return None
+    records = []
+    for i in range(count):
+        (stamp_ns, seq, label, confidence, x, y, w, h,
+         depth_mm, angle_cdeg, track, _) = _RECORD.unpack_from(data, _HEADER.size + i * _RECORD.size)
+        records.append({"stamp_ns": stamp_ns, "seq": seq, "label": label, "confidence": confidence / 10000.0,
+                        "x": x, "y": y, "w": w, "h": h, "depth_mm": depth_mm,
+                        "angle_deg": angle_cdeg / 100.0, "track": track})
+    return session, frame_seq, part, bool(flags & _PART_LAST), sent_ns, records
+
+
+class Reassembler:
+    """Puts the datagrams of a camera frame back together, like
+    DetectionReceiver does. feed() returns (frame_seq, sent_ns, [records])
+    once the last part of a frame is in, None otherwise. Frames older than
+    the newest complete one, and frames with a part missing, are dropped.
+    A new sender session starts the sequence over."""
+
+    def __init__(self):
+        self._session = None
+        self._last_seq = None
+        self._seq = None
+        self._next_part = 0
+        self._records = []
+
+    def feed(self, data):
+        part = decode(data)
+        if part is None:
+            return None
+        session, frame_seq, index, last, sent_ns, records = part
+        if session != self._session:  # a restarted sender, whichever of its datagrams arrives first
+            self._session = session
+            self._last_seq = None
+            self._seq = None
+        if self._last_seq is not None:
+            delta = (frame_seq - self._last_seq) & 0xFFFFFFFF
+            if delta == 0 or delta >= 0x80000000:
+                return None  # older or repeated
+        if self._seq != frame_seq or index != self._next_part:
+            if index:
+                self._seq = None
+                return None  # a part went missing, wait for the start of the next frame
+            self._seq = frame_seq
+            self._next_part = 0
+            self._records = []
+        self._records += records
+        self._next_part += 1
+        if len(self._records) > MAX_FRAME_RECORDS:
+            self._seq = None
+            return None
+        if not last:
+            return None
+        self._seq = None
+        self._last_seq = frame_seq
+        return frame_seq, sent_ns, self._records
@@ -0,0 +1,265 @@
+/*
+  DetectionLink.cpp
+  -----------------
+  See DetectionLink.h.
+*/
+
+#include "DetectionLink.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+uint64_t detectionNowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+bool DetectionSender::open(const char *host, uint16_t port) {
+  close();
+  struct addrinfo hints, *res = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if ( getaddrinfo(host, service, &hints, &res) || !res ) return 0;
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  /* connected UDP: the destination is resolved once, send() needs no address */
+  if ( fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) ) {
+    freeaddrinfo(res);
+    close();
+    return 0;
+  }
+  freeaddrinfo(res);
+  count = 0;
+  /* a new session each open(), so receivers start the sequence over */
+  uint64_t now = detectionNowNs();
+  session = (uint32_t)(now ^ (now >> 32) ^ ((uint32_t)getpid() << 16));
+  if ( !session ) session = 1;
+  return 1;
+}
+
+void DetectionSender::close() {
+  if ( fd >= 0 ) ::close(fd);
+  fd = -1;
+  count = 0;
+  part = 0;
+  frameRecords = 0;
+}
+
+bool DetectionSender::add(const Detection_record_t &record) {
+  if ( fd < 0 || frameRecords == DETECTION_MAX_FRAME_RECORDS ) return 0;
+  if ( count == DETECTION_MAX_RECORDS && sendPart(0) < 0 ) return 0;
+  Detection_record_t *r = (Detection_record_t*)(buf + sizeof(Detection_header_t)) + count;
+  memcpy(r, &record, sizeof(Detection_record_t));
+  r->seq = seq++;
+  if ( !r->stamp_ns ) r->stamp_ns = detectionNowNs();
+  count++;
+  frameRecords++;
+  return 1;
+}
+
+int DetectionSender::flush() {
+  if ( fd < 0 ) return -1;
+  if ( !count && !part ) return 0;
+  int sent = frameRecords;
+  int r = sendPart(1);
+  return ( r > 0 ) ? sent : r;
+}
+
+/* 1 sent, 0 dropped, -1 on error */
+int DetectionSender::sendPart(bool last) {
+  Detection_header_t h;
+  h.magic = DETECTION_MAGIC;
+  h.version = DETECTION_VERSION;
+  h.count = count;
+  h.frame_seq = frameSeq;
+  h.part = part++;
+  h.flags = ( last ) ? DETECTION_PART_LAST : 0;
+  h.session = session;
+  h.reserved = 0;
+  h.sent_ns = detectionNowNs();
+  memcpy(buf, &h, sizeof(h));
+  size_t len = sizeof(h) + count * sizeof(Detection_record_t);
+  uint16_t sent = count;
+  count = 0;
+  if ( last ) {
+    frameSeq++;
+    part = 0;
+    frameRecords = 0;
+  }
+  /* never block the camera loop: if the socket buffer is full this part is
+     dropped, the receiver drops the frame and the next one replaces it */
+  ssize_t n = ::send(fd, buf, len, MSG_DONTWAIT);
+  if ( n == (ssize_t)len ) {
+    if ( last ) counters.frames++;
+    counters.records += sent;
+    return 1;
+  }
+  if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) ) {
+    /* ECONNREFUSED: nobody listening yet, reported by the previous send */
+    counters.send_dropped++;
+    return 0;
+  }
+  return -1;
+}
+
+bool DetectionReceiver::open(uint16_t port, const char *bind_addr) {
+  close();
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if ( fd < 0 ) return 0;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if ( inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) ) {
+    close();
+    return 0;
+  }
+  have = 0;
+  assembling = 0;
+  return 1;
+}
+
+void DetectionReceiver::close() {
+  if ( fd >= 0 ) ::close(fd);
+  fd = -1;
+}
+
+bool DetectionReceiver::accept(const uint8_t *data, size_t len, uint64_t now_ns) {
+  Detection_header_t h;
+  if ( len < sizeof(h) ) {
+    counters.malformed++;
+    return 0;
+  }
+  memcpy(&h, data, sizeof(h));
+  if ( h.magic != DETECTION_MAGIC || h.version != DETECTION_VERSION || h.count > DETECTION_MAX_RECORDS ||
+       len != sizeof(h) + h.count * sizeof(Detection_record_t) ) {
+    counters.malformed++;
+    return 0;
+  }
+  if ( have && h.session != frame.session ) {
+    /* a restarted sender: its sequence starts over, whichever part arrives first */
+    have = 0;
+    assembling = 0;
+    counters.restarts++;
+  }
+  if ( have && (int32_t)(h.frame_seq - frame.frame_seq) <= 0 ) {
+    counters.stale++;
+    return 0;
+  }
+  /* parts come in order on one socket, anything else means one went missing:
+     the frame is dropped and shows up as a gap once a later one completes */
+  if ( assembling && (h.session != partial.session || h.frame_seq != partial.frame_seq || h.part != nextPart) ) assembling = 0;
+  if ( !assembling ) {
+    if ( h.part ) return 0;
+    partial.session = h.session;
+    partial.frame_seq = h.frame_seq;
+    partial.count = 0;
+    nextPart = 0;
+    assembling = 1;
+  }
+  if ( partial.count + h.count > DETECTION_MAX_FRAME_RECORDS ) {
+    counters.malformed++;
+    assembling = 0;
+    return 0;
+  }
+  memcpy(partial.records + partial.count, data + sizeof(h), h.count * sizeof(Detection_record_t));
+  partial.count += h.count;
+  nextPart++;
+  if ( !(h.flags & DETECTION_PART_LAST) ) return 0;
+
+  assembling = 0;
+  if ( have ) {
+    int32_t delta = (int32_t)(h.frame_seq - frame.frame_seq);
+    if ( delta > 0 ) counters.lost += delta - 1;
+  }
+  frame.session = h.session;
+  frame.frame_seq = h.frame_seq;
+  frame.sent_ns = h.sent_ns;
+  frame.recv_ns = now_ns;
+  frame.count = partial.count;
+  memcpy(frame.records, partial.records, partial.count * sizeof(Detection_record_t));
+  have = 1;
+  counters.frames++;
+  counters.records += partial.count;
+  counters.last_latency_ns = (int64_t)(now_ns - h.sent_ns);
+  return 1;
+}
+
+int DetectionReceiver::poll(int timeout_ms) {
+  if ( fd < 0 ) return -1;
+  struct pollfd p = { fd, POLLIN, 0 };
+  int r = ::poll(&p, 1, timeout_ms);
+  if ( r <= 0 ) return ( r < 0 && errno != EINTR ) ? -1 : 0;
+
+  struct mmsghdr msgs[DETECTION_RX_BATCH];
+  struct iovec iov[DETECTION_RX_BATCH];
+  int accepted = 0;
+  for (;;) {
+    memset(msgs, 0, sizeof(msgs));
+    for ( int i = 0; i < DETECTION_RX_BATCH; i++ ) {
+      iov[i].iov_base = bufs[i];
+      iov[i].iov_len = sizeof(bufs[i]); /* one spare byte so oversized datagrams fail the length check */
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(fd, msgs, DETECTION_RX_BATCH, MSG_DONTWAIT, nullptr);
+    if ( n <= 0 ) break;
+    uint64_t now = detectionNowNs();
+    for ( int i = 0; i < n; i++ ) {
+      if ( accept(bufs[i], msgs[i].msg_len, now) ) accepted++;
+    }
+    if ( n < DETECTION_RX_BATCH ) break;
+  }
+  /* only the newest complete frame is kept, the others were overwritten in place */
+  if ( accepted > 1 ) counters.superseded += accepted - 1;
+  return accepted ? 1 : 0;
+}
+
+/* C interface */
+
+void* dl_sender_open(const char *host, uint16_t port) {
+  DetectionSender *s = new DetectionSender();
+  if ( !s->open(host, port) ) {
+    delete s;
+    return nullptr;
+  }
+  return s;
+}
+
+int dl_sender_add(void *sender, uint16_t label, uint16_t confidence, int16_t x, int16_t y, int16_t w, int16_t h,
+                  uint16_t depth_mm, int16_t angle_cdeg, uint16_t track, uint64_t stamp_ns) {
+  if ( !sender ) return 0;
+  Detection_record_t r;
+  memset(&r, 0, sizeof(r));
+  r.stamp_ns = stamp_ns;
+  r.label = label;
+  r.confidence = confidence;
+  r.x = x;
+  r.y = y;
+  r.w = w;
+  r.h = h;
+  r.depth_mm = depth_mm;
+  r.angle_cdeg = angle_cdeg;
+  r.track = track;
+  return ((DetectionSender*)sender)->add(r);
+}
+
+int dl_sender_flush(void *sender) {
+  return ( sender ) ? ((DetectionSender*)sender)->flush() : -1;
+}
+
+void dl_sender_close(void *sender) {
+  delete (DetectionSender*)sender;
+}
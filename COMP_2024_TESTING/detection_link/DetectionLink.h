@@ -0,0 +1,147 @@
+/*
+  DetectionLink.h
+  ---------------
+  Binary UDP transport for vision detections, vision node -> controller.
+
+  The sender keeps one connected UDP socket open for its whole run and puts
+  every detection of a camera frame into one datagram: a fixed header and
+  up to DETECTION_MAX_RECORDS fixed 32 byte records. There is no connection
+  setup per detection and nothing to parse on the receiving side. A frame
+  with more detections goes out as several datagrams (parts) with the same
+  frame_seq, numbered from 0, the last one flagged DETECTION_PART_LAST.
+
+  The receiver puts the parts of a frame back together and has
+  latest-value semantics: it drains everything queued on the socket in one
+  recvmmsg() call and keeps only the newest complete frame. Older or
+  duplicate frames are counted and dropped rather than queued behind it, a
+  frame with a part missing is dropped, and gaps in the sequence of
+  complete frames are counted as lost. Every sender open() picks a random
+  session id; a datagram with a different one is a restarted sender and
+  starts the sequence over, even when its frame_seq 0 got lost.
+
+      g++ -O2 -shared -fPIC DetectionLink.cpp -o libdetectionlink.so      (for detection_link.py)
+      g++ -O2 DetectionLink.cpp detection_receiver.cpp -o detection_receiver
+
+  All fields are little-endian, which is native on the x86 and ARM hosts
+  this runs on.
+*/
+
+#if !defined(_DETECTION_LINK_H_)
+#define _DETECTION_LINK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DETECTION_MAGIC 0x4B4E4C44 /* "DLNK" */
+#define DETECTION_VERSION 3
+#define DETECTION_DEFAULT_PORT 65432
+#define DETECTION_MAX_RECORDS 40   /* per datagram, 32 + 40 * 32 = 1312 bytes, one Ethernet frame */
+#define DETECTION_MAX_FRAME_RECORDS 160 /* per camera frame, 4 datagrams */
+#define DETECTION_PART_LAST 0x0001
+#define DETECTION_LABEL_NONE 0xFFFF /* frame processed, nothing found */
+#define DETECTION_RX_BATCH 16      /* datagrams per recvmmsg() */
+
+typedef struct Detection_record_t {
+  uint64_t stamp_ns;     /* capture time, CLOCK_REALTIME on the vision node */
+  uint32_t seq;          /* per detection, increasing */
+  uint16_t label;        /* class id, DETECTION_LABEL_NONE for an empty frame */
+  uint16_t confidence;   /* 0..10000 = 0..100.00 % */
+  int16_t x, y, w, h;    /* bounding box, pixels */
+  uint16_t depth_mm;     /* 0 if unknown */
+  int16_t angle_cdeg;    /* mapped angle, 0.01 degree (0..18000 across the image) */
+  uint16_t track;        /* tracker id, 0 if not tracked */
+  uint16_t reserved;
+} Detection_record_t;
+
+typedef struct Detection_header_t {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;        /* records that follow */
+  uint32_t frame_seq;    /* per camera frame, increasing, the same in all its parts */
+  uint16_t part;         /* datagram within the frame, from 0 */
+  uint16_t flags;        /* DETECTION_PART_LAST on the frame's last datagram */
+  uint32_t session;      /* random per sender open(), never 0 */
+  uint32_t reserved;
+  uint64_t sent_ns;      /* CLOCK_REALTIME at send */
+} Detection_header_t;
+
+static_assert(sizeof(Detection_record_t) == 32, "Detection_record_t must stay 32 bytes");
+static_assert(sizeof(Detection_header_t) == 32, "Detection_header_t must stay 32 bytes");
+
+typedef struct Detection_frame_t {
+  uint32_t session = 0;
+  uint32_t frame_seq = 0;
+  uint64_t sent_ns = 0;
+  uint64_t recv_ns = 0;
+  uint16_t count = 0;
+  Detection_record_t records[DETECTION_MAX_FRAME_RECORDS];
+} Detection_frame_t;
+
+typedef struct DetectionLink_stats_t {
+  uint64_t frames = 0;       /* complete frames sent or accepted */
+  uint64_t records = 0;
+  uint64_t lost = 0;         /* gaps in frame_seq, including frames with a part missing */
+  uint64_t stale = 0;        /* older or repeated frame_seq, dropped */
+  uint64_t restarts = 0;     /* new sender session, sequence started over */
+  uint64_t superseded = 0;   /* accepted but replaced by a newer frame in the same drain */
+  uint64_t malformed = 0;
+  uint64_t send_dropped = 0; /* sender: socket buffer full, datagram dropped */
+  int64_t last_latency_ns = 0; /* recv_ns - sent_ns, needs synced clocks across machines */
+} DetectionLink_stats_t;
+
+uint64_t detectionNowNs();
+
+class DetectionSender {
+  public:
+    ~DetectionSender() { close(); }
+    bool open(const char *host, uint16_t port = DETECTION_DEFAULT_PORT);
+    void close();
+    bool add(const Detection_record_t &record); /* seq is filled in, sends a part when the datagram is full */
+    int flush();                                /* ends the frame: records sent, 0 if none pending, -1 on error */
+    const DetectionLink_stats_t& stats() const { return counters; }
+
+  private:
+    int sendPart(bool last);
+    int fd = -1;
+    uint32_t session = 0;
+    uint32_t seq = 0;
+    uint32_t frameSeq = 0;
+    uint16_t part = 0;                          /* next part of the current frame */
+    uint16_t frameRecords = 0;                  /* records of the current frame so far */
+    uint16_t count = 0;
+    uint8_t buf[sizeof(Detection_header_t) + DETECTION_MAX_RECORDS * sizeof(Detection_record_t)];
+    DetectionLink_stats_t counters;
+};
+
+class DetectionReceiver {
+  public:
+    ~DetectionReceiver() { close(); }
+    bool open(uint16_t port = DETECTION_DEFAULT_PORT, const char *bind_addr = "0.0.0.0");
+    void close();
+    int poll(int timeout_ms);                   /* 1 if a newer complete frame arrived, 0 on timeout, -1 on error */
+    const Detection_frame_t& latest() const { return frame; }
+    bool hasFrame() const { return have; }
+    const DetectionLink_stats_t& stats() const { return counters; }
+
+  private:
+    bool accept(const uint8_t *data, size_t len, uint64_t now_ns);
+    int fd = -1;
+    uint8_t bufs[DETECTION_RX_BATCH][sizeof(Detection_header_t) + DETECTION_MAX_RECORDS * sizeof(Detection_record_t) + 1];
+    bool have = 0;
+    Detection_frame_t frame;
+    bool assembling = 0;                        /* parts of partial.frame_seq arrived, not the last yet */
+    uint16_t nextPart = 0;
+    Detection_frame_t partial;
+    DetectionLink_stats_t counters;
+};
+
+/* C interface for detection_link.py (ctypes) */
+extern "C" {
+  void* dl_sender_open(const char *host, uint16_t port);
+  int dl_sender_add(void *sender, uint16_t label, uint16_t confidence, int16_t x, int16_t y, int16_t w, int16_t h,
+                    uint16_t depth_mm, int16_t angle_cdeg, uint16_t track, uint64_t stamp_ns);
+  int dl_sender_flush(void *sender);
+  void dl_sender_close(void *sender);
+}
+
+#endif
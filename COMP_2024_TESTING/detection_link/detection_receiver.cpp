@@ -0,0 +1,96 @@
+/*
+  detection_receiver.cpp
+  ----------------------
+  Receiving end of DetectionLink, replaces PRO_data_receiver.py.
+
+      g++ -O2 DetectionLink.cpp detection_receiver.cpp -o detection_receiver
+      ./detection_receiver [port] [logfile]
+
+  Prints the status of the newest complete frame every 0.1 s and, with a log file,
+  appends every received frame to it every 5 s, like the Python receiver did.
+  Link statistics go to stderr on every log flush.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "DetectionLink.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int) { running = 0; }
+
+static std::string determineStatus(const Detection_frame_t &frame) {
+  if ( !frame.count || frame.records[0].label == DETECTION_LABEL_NONE ) return "No face detected";
+  const Detection_record_t &r = frame.records[0];
+  int center_y = r.y + r.h / 2;
+  char buf[64];
+  /* same as PRO_data_receiver.py: the face's centre y decides the turn */
+  snprintf(buf, sizeof(buf), "%s %dmm", ( center_y > 400 ) ? "Turning left" : "Turning right", center_y);
+  return buf;
+}
+
+int main(int argc, char **argv) {
+  uint16_t port = ( argc > 1 ) ? (uint16_t)atoi(argv[1]) : DETECTION_DEFAULT_PORT;
+  const char *logPath = ( argc > 2 ) ? argv[2] : nullptr;
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  DetectionReceiver rx;
+  if ( !rx.open(port) ) {
+    perror("bind");
+    return 1;
+  }
+  printf("Listening on UDP %u\n", port);
+
+  std::vector<std::string> recent;
+  std::string status;
+  uint64_t nextDisplay = 0, nextLog = 0;
+  while ( running ) {
+    if ( rx.poll(10) > 0 ) {
+      const Detection_frame_t &f = rx.latest();
+      status = determineStatus(f);
+      if ( logPath ) {
+        char line[160];
+        time_t t = (time_t)(f.recv_ns / 1000000000ULL);
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&t));
+        if ( f.count && f.records[0].label != DETECTION_LABEL_NONE ) {
+          const Detection_record_t &r = f.records[0];
+          snprintf(line, sizeof(line), "%s - frame %u coordinates: %d,%d, status: %s\n", when, f.frame_seq,
+                   r.x + r.w / 2, r.y + r.h / 2, status.c_str());
+        }
+        else snprintf(line, sizeof(line), "%s - frame %u status: %s\n", when, f.frame_seq, status.c_str());
+        recent.push_back(line);
+      }
+    }
+    uint64_t now = detectionNowNs();
+    if ( now >= nextDisplay ) {
+      nextDisplay = now + 100000000ULL;
+      printf("Current status: %s\n", status.c_str());
+      fflush(stdout);
+    }
+    if ( now >= nextLog ) {
+      nextLog = now + 5000000000ULL;
+      if ( logPath && !recent.empty() ) {
+        FILE *log = fopen(logPath, "a");
+        if ( log ) {
+          for ( const std::string &line : recent ) fputs(line.c_str(), log);
+          fclose(log);
+        }
+        recent.clear();
+      }
+      const DetectionLink_stats_t &s = rx.stats();
+      fprintf(stderr, "frames %llu records %llu lost %llu stale %llu restarts %llu superseded %llu malformed %llu latency %.2f ms\n",
+              (unsigned long long)s.frames, (unsigned long long)s.records, (unsigned long long)s.lost,
+              (unsigned long long)s.stale, (unsigned long long)s.restarts, (unsigned long long)s.superseded,
+              (unsigned long long)s.malformed,
+              s.last_latency_ns / 1e6);
+    }
+  }
+  return 0;
+}
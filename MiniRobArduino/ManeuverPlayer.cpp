@@ -0,0 +1,119 @@
+/*
+  ManeuverPlayer.cpp
+  ------------------
+  See ManeuverPlayer.h.
+*/
+
+#include "ManeuverPlayer.h"
+
+/* two full-lock circles in opposite directions at a slow crawl, the last keyframe matches the first so it repeats smoothly */
+static const Maneuver_keyframe_t FIGURE_8_FRAMES[] = {
+  //   ms  steering  throttle  to next
+  {     0,        0,     5000, MANEUVER_LINEAR },
+  {   300,    32767,     5000, MANEUVER_STEP },
+  {  6300,    32767,     5000, MANEUVER_LINEAR },
+  {  6900,   -32767,     5000, MANEUVER_STEP },
+  { 12900,   -32767,     5000, MANEUVER_LINEAR },
+  { 13200,        0,     5000, MANEUVER_STEP },
+};
+
+/* one lane to the left and straighten out */
+static const Maneuver_keyframe_t LANE_CHANGE_FRAMES[] = {
+  {     0,        0,        0, MANEUVER_LINEAR },
+  {   500,        0,     6000, MANEUVER_STEP },
+  {  1500,        0,     6000, MANEUVER_LINEAR },
+  {  2100,   -12000,     6000, MANEUVER_LINEAR },
+  {  2700,    12000,     6000, MANEUVER_LINEAR },
+  {  3300,        0,     6000, MANEUVER_STEP },
+  {  4300,        0,     6000, MANEUVER_LINEAR },
+  {  4800,        0,        0, MANEUVER_STEP },
+};
+
+/* steering end to end and back with the throttle at neutral, for checking endpoints */
+static const Maneuver_keyframe_t CALIBRATION_SWEEP_FRAMES[] = {
+  {     0,        0,        0, MANEUVER_LINEAR },
+  {  2000,   -32767,        0, MANEUVER_STEP },
+  {  3000,   -32767,        0, MANEUVER_LINEAR },
+  {  7000,    32767,        0, MANEUVER_STEP },
+  {  8000,    32767,        0, MANEUVER_LINEAR },
+  { 10000,        0,        0, MANEUVER_STEP },
+};
+
+#define FRAME_COUNT(frames) (uint8_t)(sizeof(frames) / sizeof(frames[0]))
+
+const Maneuver_t MANEUVER_FIGURE_8 = { "figure 8", FIGURE_8_FRAMES, FRAME_COUNT(FIGURE_8_FRAMES), true };
+const Maneuver_t MANEUVER_LANE_CHANGE = { "lane change", LANE_CHANGE_FRAMES, FRAME_COUNT(LANE_CHANGE_FRAMES), false };
+const Maneuver_t MANEUVER_CALIBRATION_SWEEP = { "calibration sweep", CALIBRATION_SWEEP_FRAMES, FRAME_COUNT(CALIBRATION_SWEEP_FRAMES), false };
+
+bool ManeuverPlayer::start(const Maneuver_t &m, uint32_t now_us) {
+  if ( !m.count || !m.frames ) return 0;
+  active = &m;
+  nextTickUs = now_us;
+  tickIndex = 0;
+  frame = 0;
+  cycleMs = 0;
+  lateSum = 0;
+  counters = Maneuver_stats_t();
+  return 1;
+}
+
+bool ManeuverPlayer::update(uint32_t now_us, Maneuver_output_t &out) {
+  if ( !active ) return 0;
+  int32_t late = (int32_t)(now_us - nextTickUs);
+  if ( late < 0 ) return 0;
+
+  uint32_t skipped = (uint32_t)late / periodUs;
+  counters.missed += skipped;
+  tickIndex += skipped;
+  nextTickUs += (skipped + 1) * periodUs;
+  uint32_t lateUs = (uint32_t)late - skipped * periodUs;
+  if ( lateUs > counters.max_late_us ) counters.max_late_us = lateUs;
+  lateSum += lateUs;
+  counters.ticks++;
+  counters.mean_late_us = (uint32_t)(lateSum / counters.ticks);
+
+  sample((uint32_t)(((uint64_t)tickIndex * periodUs) / 1000), out);
+  tickIndex++;
+  return 1;
+}
+
+void ManeuverPlayer::sample(uint32_t t_ms, Maneuver_output_t &out) {
+  const Maneuver_keyframe_t *f = active->frames;
+  uint8_t last = active->count - 1;
+  uint32_t t = t_ms - cycleMs;
+
+  if ( t >= f[last].t_ms ) {
+    if ( !active->repeat || !f[last].t_ms ) {
+      out.steering = f[last].steering;
+      out.throttle = f[last].throttle;
+      out.t_ms = t_ms;
+      active = nullptr; /* finished, the last keyframe is the resting setpoint */
+      return;
+    }
+    /* loop back: the last keyframe doubles as time 0 of the next pass */
+    cycleMs += f[last].t_ms * (t / f[last].t_ms);
+    t = t_ms - cycleMs;
+    frame = 0;
+  }
+  while ( frame < last && t >= f[frame + 1].t_ms ) frame++; /* positions only move forward */
+
+  const Maneuver_keyframe_t &a = f[frame];
+  out.t_ms = t_ms;
+  if ( frame == last || a.interp == MANEUVER_STEP ) {
+    out.steering = a.steering;
+    out.throttle = a.throttle;
+    return;
+  }
+  const Maneuver_keyframe_t &b = f[frame + 1];
+  int32_t span = b.t_ms - a.t_ms;
+  int32_t into = t - a.t_ms;
+  out.steering = a.steering + (int32_t)(b.steering - a.steering) * into / span;
+  out.throttle = a.throttle + (int32_t)(b.throttle - a.throttle) * into / span;
+}
+
+void ManeuverPlayer::printStats(Stream &port) const {
+  port.print("Ticks: "); port.print(counters.ticks);
+  port.print("  Missed: "); port.print(counters.missed);
+  port.print("  Max late us: "); port.print(counters.max_late_us);
+  port.print("  Mean late us: "); port.println(counters.mean_late_us);
+}
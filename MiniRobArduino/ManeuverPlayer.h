@@ -0,0 +1,96 @@
+/*
+  ManeuverPlayer.h
+  ----------------
+  Plays autonomous maneuvers from keyframe tables at a fixed tick.
+
+  A maneuver is a list of keyframes (time, steering, throttle, how to get
+  to the next one). Setpoints are Q15 normalised like ServoOutput::write(),
+  so the same table runs on any calibration:
+
+      static const Maneuver_keyframe_t LANE_CHANGE_FRAMES[] = {
+        //  ms   steering  throttle       to next
+        {    0,        0,    6000,  MANEUVER_LINEAR },
+        {  800,    12000,    6000,  MANEUVER_LINEAR },
+        ...
+      };
+
+      ManeuverPlayer player(100);                      // 100 Hz tick
+      player.start(MANEUVER_LANE_CHANGE, micros());
+      ...
+      Maneuver_output_t out;
+      if ( player.update(micros(), out) ) { servos.write(0, out.steering); servos.write(1, out.throttle); }
+
+  Playback position comes from the tick count, not from the time update()
+  happened to run, so a maneuver produces the same setpoint sequence every
+  time. How late each tick actually ran is kept separately in the stats.
+  stop() takes effect immediately, so a mode switch checked every tick
+  preempts a maneuver within one tick.
+*/
+
+#if !defined(_MANEUVER_PLAYER_H_)
+#define _MANEUVER_PLAYER_H_
+
+#include <Arduino.h>
+
+typedef enum MANEUVER_INTERP {
+  MANEUVER_STEP = 0,     // hold this keyframe until the next one
+  MANEUVER_LINEAR        // ramp to the next keyframe
+} MANEUVER_INTERP;
+
+typedef struct Maneuver_keyframe_t {
+  uint16_t t_ms;         // from the start of the maneuver, increasing
+  int16_t steering;      // Q15, -32767..32767
+  int16_t throttle;      // Q15
+  uint8_t interp;        // MANEUVER_INTERP
+} Maneuver_keyframe_t;
+
+typedef struct Maneuver_t {
+  const char *name;
+  const Maneuver_keyframe_t *frames;
+  uint8_t count;
+  bool repeat;           // start over after the last keyframe
+} Maneuver_t;
+
+typedef struct Maneuver_output_t {
+  int16_t steering = 0;
+  int16_t throttle = 0;
+  uint32_t t_ms = 0;     // playback position of this tick
+} Maneuver_output_t;
+
+typedef struct Maneuver_stats_t {
+  uint32_t ticks = 0;
+  uint32_t missed = 0;         // ticks skipped because update() ran more than a period late
+  uint32_t max_late_us = 0;    // worst delay between a tick's due time and update()
+  uint32_t mean_late_us = 0;
+} Maneuver_stats_t;
+
+class ManeuverPlayer {
+  public:
+    ManeuverPlayer(uint16_t tick_hz = 100) { setRate(tick_hz); }
+    void setRate(uint16_t tick_hz) { periodUs = 1000000UL / (( tick_hz ) ? tick_hz : 1); }
+    bool start(const Maneuver_t &m, uint32_t now_us);
+    void stop() { active = nullptr; }
+    bool running() const { return active; }
+    const Maneuver_t* current() const { return active; }
+    bool update(uint32_t now_us, Maneuver_output_t &out); // 1 when a tick was due and out was filled
+    const Maneuver_stats_t& stats() const { return counters; }
+    void printStats(Stream &port = Serial) const;
+
+  private:
+    void sample(uint32_t t_ms, Maneuver_output_t &out);
+    const Maneuver_t *active = nullptr;
+    uint32_t periodUs = 10000;
+    uint32_t nextTickUs = 0;
+    uint32_t tickIndex = 0;
+    uint8_t frame = 0;            // keyframe at or before the current position
+    uint32_t cycleMs = 0;         // playback time where the current repeat started
+    uint64_t lateSum = 0;
+    Maneuver_stats_t counters;
+};
+
+/* built-in maneuvers, tables in ManeuverPlayer.cpp */
+extern const Maneuver_t MANEUVER_FIGURE_8;
+extern const Maneuver_t MANEUVER_LANE_CHANGE;
+extern const Maneuver_t MANEUVER_CALIBRATION_SWEEP;
+
+#endif
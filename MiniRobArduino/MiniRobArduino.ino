@@ -1,23 +1,170 @@
 // digitalwrite
+// RC passthrough for an ATmega328P (Uno / Nano).
+//
+// The receiver pulses are copied to the outputs inside pin change interrupts
+// with direct port writes, so each output edge follows its input edge by a
+// few microseconds instead of by however long the rest of loop() takes.
+// When the special switch is on, Timer1 generates the output pulses instead
+// (the override layer) and plays the figure 8 from ManeuverPlayer.
+// The time the passthrough interrupt takes, from its first instruction to
+// the port writes, is printed on Serial every 2 seconds.
+
+#include "ManeuverPlayer.h"
+
 // constants won't change. They're used here to set pin numbers:
+const int thIn = 5;    // throttle in pin    (PD5, PCINT21)
+const int thOut = 6;    // throttle out pin   (PD6)
+const int stIn = 7;    // steering in pin    (PD7, PCINT23)
+const int stOut = 8;    // steering out pin   (PB0)
+const int special = 9;    // special function  (PB1)
+
+// port bits for the pins above, used by the interrupts
+#define TH_IN_BIT   _BV(PD5)
+#define TH_OUT_BIT  _BV(PD6)
+#define ST_IN_BIT   _BV(PD7)
+#define ST_OUT_BIT  _BV(PB0)
+
+// Timer1 runs at 0.5 us per tick (16 MHz / 8)
+#define TICKS_PER_US 2
+#define FRAME_TICKS (20000 * TICKS_PER_US)   // 50 Hz override frame
+#define OVERRIDE_MIN_US 1000
+#define OVERRIDE_MAX_US 2000
 
+// override pulse widths in timer ticks, written by loop(), read by the Timer1 interrupts
+volatile uint16_t overrideTh = 1500 * TICKS_PER_US;
+volatile uint16_t overrideSt = 1500 * TICKS_PER_US;
+volatile bool overrideOn = false;
+volatile uint16_t frameStart = 0;
 
-const int thIn = 5;    // throttle in pin
-const int thOut = 6;    // throttle out pin
-const int stIn = 7;    // steering in pin
-const int stOut = 8;    // steering out pin
-const int special = 9;    // special function 
+// passthrough ISR service time, in timer ticks
+volatile uint16_t isrMin = 0xFFFF;
+volatile uint16_t isrMax = 0;
+volatile uint32_t isrSum = 0;
+volatile uint32_t edges = 0;
 
 // variables will change:
 int specialState = 0;  // variable for reading the pushbutton status
 
+ManeuverPlayer player(50);
+
+// Passthrough: runs on every edge of the throttle and steering inputs.
+ISR(PCINT2_vect) {
+  uint16_t start = TCNT1;
+  if (overrideOn) return;
+  // forwarding RC data
+  uint8_t in = PIND;
+  PORTD = (PORTD & ~TH_OUT_BIT) | ((in & TH_IN_BIT) ? TH_OUT_BIT : 0);
+  if (in & ST_IN_BIT) PORTB |= ST_OUT_BIT;
+  else PORTB &= ~ST_OUT_BIT;
+  uint16_t took = TCNT1 - start;
+  if (took < isrMin) isrMin = took;
+  if (took > isrMax) isrMax = took;
+  isrSum += took;
+  edges++;
+}
+
+// Override frame start and throttle pulse end share compare A.
+ISR(TIMER1_COMPA_vect) {
+  static bool pulseHigh = false;
+  if (!pulseHigh) {
+    frameStart = OCR1A;
+    PORTD |= TH_OUT_BIT;
+    PORTB |= ST_OUT_BIT;
+    OCR1B = frameStart + overrideSt;
+    OCR1A = frameStart + overrideTh;
+    pulseHigh = true;
+  } else {
+    PORTD &= ~TH_OUT_BIT;
+    OCR1A = frameStart + FRAME_TICKS;
+    pulseHigh = false;
+  }
+}
+
+// Override steering pulse end.
+ISR(TIMER1_COMPB_vect) {
+  PORTB &= ~ST_OUT_BIT;
+}
+
+// Switches between passthrough and the Timer1 override only between pulses,
+// so neither output ever sees a cut short pulse. Returns false if a pulse is
+// in progress, call again on the next pass.
+bool setOverride(bool on) {
+  if (on == overrideOn) return true;
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t in = PIND;
+  bool outputsLow = !(PORTD & TH_OUT_BIT) && !(PORTB & ST_OUT_BIT);
+  if (on && (in & (TH_IN_BIT | ST_IN_BIT))) {
+    SREG = sreg;
+    return false;
+  }
+  if (!on && !outputsLow) {
+    SREG = sreg;
+    return false;
+  }
+  if (on) {
+    // first override frame starts on the next tick
+    OCR1A = TCNT1 + 2 * TICKS_PER_US;
+    TIFR1 = _BV(OCF1A) | _BV(OCF1B);
+    TIMSK1 = _BV(OCIE1A) | _BV(OCIE1B);
+  } else {
+    TIMSK1 = 0;
+  }
+  overrideOn = on;
+  SREG = sreg;
+  return true;
+}
+
+// Q15 maneuver setpoint to override pulse ticks
+uint16_t overrideTicks(int16_t value) {
+  long us = 1500L + ((long)value * 500L) / 32767L;
+  us = constrain(us, OVERRIDE_MIN_US, OVERRIDE_MAX_US);
+  return (uint16_t)(us * TICKS_PER_US);
+}
+
+void printLatency() {
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t mn = isrMin, mx = isrMax;
+  uint32_t sum = isrSum, n = edges;
+  isrMin = 0xFFFF; isrMax = 0; isrSum = 0; edges = 0;
+  SREG = sreg;
+
+  Serial.print(overrideOn ? "Override" : "Passthrough");
+  Serial.print("  edges: ");
+  Serial.print(n);
+  if (n) {
+    // from the TCNT1 read at ISR entry to the port writes: the interrupt
+    // response and the register saves before it are not included
+    Serial.print("  ISR service time us min/avg/max: ");
+    Serial.print(mn / (float)TICKS_PER_US, 1);
+    Serial.print(" / ");
+    Serial.print((sum / (float)n) / TICKS_PER_US, 1);
+    Serial.print(" / ");
+    Serial.print(mx / (float)TICKS_PER_US, 1);
+  }
+  Serial.println();
+}
+
 void setup() {
+  Serial.begin(115200);
+
   // initialize the pins as an output or input:
   pinMode(thIn, INPUT);
   pinMode(thOut, OUTPUT);
   pinMode(stIn, INPUT);
   pinMode(stOut, OUTPUT);
   pinMode(special, INPUT);
+
+  // Timer1 free running at 0.5 us per tick, used for timestamps and the override pulses
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TIMSK1 = 0;
+
+  // pin change interrupts on the throttle and steering inputs
+  PCMSK2 = _BV(PCINT21) | _BV(PCINT23);
+  PCIFR = _BV(PCIF2);
+  PCICR |= _BV(PCIE2);
 }
 
 void loop() {
@@ -25,15 +172,30 @@ void loop() {
   // read the state of the special value:
   specialState = digitalRead(special);
 
-
   // check if the switch is pressed. If it is, the specialstate is HIGH:
   if (specialState == HIGH) {
-    // figure 8 
-    delay(1000);
-    
-  } else {
-    // forwarding RC data
-    digitalWrite(stOut, digitalRead(stIn));
-    digitalWrite(thOut, digitalRead(thIn));
+    // figure 8
+    if (!overrideOn && setOverride(true)) {
+      player.start(MANEUVER_FIGURE_8, micros());
+    }
+    Maneuver_output_t out;
+    if (player.update(micros(), out)) {
+      uint16_t th = overrideTicks(out.throttle);
+      uint16_t st = overrideTicks(out.steering);
+      uint8_t sreg = SREG;
+      cli();
+      overrideTh = th;
+      overrideSt = st;
+      SREG = sreg;
+    }
+  } else if (overrideOn) {
+    // back to forwarding RC data, the pin change interrupt takes over on the next edge
+    if (setOverride(false)) player.stop();
+  }
+
+  static unsigned long lastReport = 0;
+  if (millis() - lastReport >= 2000) {
+    lastReport = millis();
+    printLatency();
   }
 }
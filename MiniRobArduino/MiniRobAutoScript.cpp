@@ -1,8 +1,13 @@
-#include <ESP32Servo.h>
+#include "RcPwmInput.h"
+#include "ServoOutput.h"
+#include "ManeuverPlayer.h"
 
-// Create servo objects to control the steering and throttle servos
-Servo steeringServo;  
-Servo throttleServo;  
+// Servo outputs are set in microseconds on the LEDC peripheral
+ServoOutput servos;
+const uint8_t steeringServo = 0;
+const uint8_t throttleServo = 1;
+const uint16_t steeringRate = 50;   // Hz, a digital steering servo can run at 100 or 333
+const uint16_t throttleRate = 50;   // Hz, standard ESC input
 
 // Define input pins
 const int thIn = 32;           // Throttle input pin from RC receiver
@@ -11,6 +16,19 @@ const int autoSwitchPin = 34;  // Autonomous mode switch input pin (PWM)
 const int steeringPin = 25;    // Steering servo control pin
 const int throttlePin = 26;    // Throttle servo control pin
 
+// RC inputs are measured in pin interrupts, so reading them never waits for a pulse
+RcPwmInput rc;
+const uint8_t thChannel = 0;
+const uint8_t stChannel = 1;
+const uint8_t autoChannel = 2;
+
+const unsigned long servoPeriod = 1000000UL / steeringRate;  // us, one update per steering servo frame
+const unsigned long printPeriod = 250;  // ms, serial output is slow so keep it out of every frame
+
+// Autonomous mode plays a keyframe maneuver at the steering servo rate
+ManeuverPlayer player(steeringRate);
+const Maneuver_t &autoManeuver = MANEUVER_FIGURE_8;
+
 // Autonomous mode flag
 bool autonomousMode = false;
 
@@ -18,102 +36,75 @@ void setup() {
   // Initialize serial communication for debugging
   Serial.begin(9600);
 
-  // Set input pins
-  pinMode(thIn, INPUT);
-  pinMode(stIn, INPUT);
-  pinMode(autoSwitchPin, INPUT);
+  // Start measuring the RC inputs
+  rc.attach(thChannel, thIn);
+  rc.attach(stChannel, stIn);
+  rc.attach(autoChannel, autoSwitchPin);
 
-  // Attach the servos
-  steeringServo.setPeriodHertz(50);               // Standard 50 Hz servo
-  steeringServo.attach(steeringPin, 1000, 2000);  // Attach the steering servo
-  throttleServo.setPeriodHertz(50);               // Standard 50 Hz servo
-  throttleServo.attach(throttlePin, 1000, 2000);  // Attach the throttle servo
+  // Attach the servos: endpoints 1000-2000 us, centre 1500 us
+  servos.attach(steeringServo, steeringPin, steeringRate);
+  servos.setCalibration(steeringServo, { 1000, 1500, 2000, 0, false });
+  servos.attach(throttleServo, throttlePin, throttleRate);
+  servos.setCalibration(throttleServo, { 1000, 1500, 2000, 10, false });  // small deadband so the ESC sits at neutral
 
   Serial.println("Setup complete. Waiting for RC inputs...");
 }
 
 void loop() {
-  // Read the PWM signal from the autonomous mode switch
-  unsigned long autoSwitchValue = pulseIn(autoSwitchPin, HIGH, 25000);  // Read switch pulse width in microseconds
-
-  // Output the raw switch value to the serial monitor
-  Serial.print("Switch Input Value: ");
-  Serial.println(autoSwitchValue);
+  // Latest switch pulse width in microseconds, manual (1000) if the receiver stopped sending.
+  // Read on every pass so a running maneuver is stopped within one servo frame.
+  unsigned long autoSwitchValue = rc.widthOr(autoChannel, 1000);
 
   // Determine autonomous mode based on the switch value
   // Assuming a threshold of 1500 microseconds to determine high or low state
+  bool wasAutonomous = autonomousMode;
   autonomousMode = (autoSwitchValue > 1500);
+  if (autonomousMode && !wasAutonomous) {
+    Serial.print("Autonomous mode active: ");
+    Serial.println(autoManeuver.name);
+    player.start(autoManeuver, micros());
+  }
+  if (!autonomousMode && wasAutonomous) {
+    player.stop();
+    Serial.println("Switching back to manual mode");
+    player.printStats();
+  }
 
-  if (autonomousMode) {
-    // Autonomous mode
-    Serial.println("Autonomous mode active");
-
-    // Preprogrammed throttle value for autonomous mode (fixed value 0-255)
-    int throttlePos = 128;  // Example: medium speed throttle value (0-255)
-
-    // Preprogrammed steering value for autonomous mode (adjustable)
-    int steeringPos = 90;  // Neutral steering position
-
-    // Continuously check switch to see if we should revert to manual mode
-    while (autonomousMode) {
-      // Check the switch value at every step
-      autoSwitchValue = pulseIn(autoSwitchPin, HIGH, 25000);
-      autonomousMode = (autoSwitchValue > 1500);
-
-      if (!autonomousMode) {
-        Serial.println("Switching back to manual mode");
-        break;
-      }
-
-      // Example: set the steering and throttle positions
-      steeringPos = 0;
-      throttlePos = 35;
-
-      // Write the positions to the servos
-      throttleServo.write(throttlePos);
-      steeringServo.write(steeringPos);
-
-      Serial.print("Autonomous Throttle Position: ");
-      Serial.println(throttlePos);
-      Serial.print("Autonomous Steering Position: ");
-      Serial.println(steeringPos);
+  unsigned long thInValue = 0;
+  unsigned long stInValue = 0;
 
-      delay(100);  // Adjust delay for smoothness
+  if (autonomousMode) {
+    // The player keeps its own fixed tick, when it finishes the servos hold its last keyframe
+    Maneuver_output_t out;
+    if (player.update(micros(), out)) {
+      servos.write(steeringServo, out.steering);
+      servos.write(throttleServo, out.throttle);
     }
   } else {
-    // Manual RC control mode
-    Serial.println("Manual RC control mode");
-
-    // Read the PWM signals from the RC receiver
-    unsigned long thInValue = pulseIn(thIn, HIGH, 25000);  // Read throttle pulse width in microseconds
-    unsigned long stInValue = pulseIn(stIn, HIGH, 25000);  // Read steering pulse width in microseconds
-
-    // Map the throttle input to 0-180 degrees, handling reverse and forward
-    int throttlePos;
-    if (thInValue < 1500) {
-      throttlePos = map(thInValue, 1000, 1500, 0, 90);  // Reverse range
-    } else {
-      throttlePos = map(thInValue, 1500, 2000, 90, 180);  // Forward range
+    static unsigned long lastUpdate = 0;
+    if (micros() - lastUpdate >= servoPeriod) {
+      lastUpdate = micros();
+
+      // Manual RC control mode, centre both if a channel went stale
+      thInValue = rc.widthOr(thChannel, 1500);
+      stInValue = rc.widthOr(stChannel, 1500);
+
+      // Receiver pulses pass straight through, the calibration clamps them to the endpoints,
+      // and the new positions are taken at the start of the next servo period
+      servos.writeMicroseconds(throttleServo, thInValue);
+      servos.writeMicroseconds(steeringServo, stInValue);
     }
+  }
 
-    // Map the steering input from 1000-2000 to 0-180 degrees
-    int steeringPos = map(stInValue, 1000, 2000, 0, 180);
-
-    // Print the raw input values and mapped positions to the serial monitor
-    Serial.print("Throttle Input Value: ");
-    Serial.println(thInValue);
-    Serial.print("Mapped Throttle Position: ");
-    Serial.println(throttlePos);
-    Serial.print("Steering Input Value: ");
-    Serial.println(stInValue);
-    Serial.print("Mapped Steering Position: ");
-    Serial.println(steeringPos);
-
-    // Move the servos to the mapped positions
-    throttleServo.write(throttlePos);
-    steeringServo.write(steeringPos);
-
-    // Small delay to make the output more readable
-    delay(15);  // Adjust delay for smoothness
+  static unsigned long lastPrint = 0;
+  if (millis() - lastPrint >= printPeriod) {
+    lastPrint = millis();
+    Serial.print(autonomousMode ? "Auto" : "Manual");
+    Serial.print("  Switch: ");
+    Serial.print(autoSwitchValue);
+    Serial.print("  Throttle out: ");
+    Serial.print(servos.readMicroseconds(throttleServo));
+    Serial.print("  Steering out: ");
+    Serial.println(servos.readMicroseconds(steeringServo));
   }
 }
@@ -0,0 +1,114 @@
+/*
+  RcInput.h
+  ---------
+  Common channel-read interface for RC receiver inputs on the MiniRob
+  controller. Every decoder (RcPwmInput: one pin per channel, RcPpmInput and
+  RcSbusInput: all channels on one wire) publishes the latest pulse width
+  per channel as it arrives, and the control loop reads any channel in O(1)
+  without waiting for a pulse:
+
+      RC_channel_t th;
+      if ( rc.read(0, th) && th.fresh ) throttleUs = th.width_us;
+
+  width_us is the receiver pulse width in microseconds (about 1000..2000,
+  1500 centre). fresh is cleared once no pulse has arrived for the
+  decoder's timeout, so a dead receiver or a pulled wire shows up within a
+  couple of frames instead of reading as a stuck value.
+*/
+
+#if !defined(_RC_INPUT_H_)
+#define _RC_INPUT_H_
+
+#include <Arduino.h>
+
+#define RC_MAX_CHANNELS 16
+#define RC_MIN_PULSE_US 800     // shorter or longer pulses are counted as glitches
+#define RC_MAX_PULSE_US 2200
+#define RC_DEFAULT_TIMEOUT_US 50000
+
+typedef struct RC_channel_t {
+  uint16_t width_us = 0;      // last accepted pulse, 0 until one has been seen
+  uint32_t age_us = 0;        // time since that pulse
+  bool fresh = 0;             // age_us below the timeout
+  bool failsafe = 0;          // receiver reports failsafe (decoders that can tell)
+} RC_channel_t;
+
+class RcInput {
+  public:
+    virtual ~RcInput() { }
+    virtual uint8_t channels() const = 0;
+    virtual bool read(uint8_t channel, RC_channel_t &out) const = 0; // 0 if the channel does not exist
+    uint8_t readAll(RC_channel_t *out, uint8_t count) const {
+      uint8_t n = ( count < channels() ) ? count : channels();
+      for ( uint8_t i = 0; i < n; i++ ) read(i, out[i]);
+      return n;
+    }
+    // pulse width with a fallback when the channel is stale
+    uint16_t widthOr(uint8_t channel, uint16_t fallback_us) const {
+      RC_channel_t c;
+      return ( read(channel, c) && c.fresh && !c.failsafe ) ? c.width_us : fallback_us;
+    }
+    void setTimeout(uint32_t timeout_us) { timeoutUs = timeout_us; }
+
+  protected:
+    uint32_t timeoutUs = RC_DEFAULT_TIMEOUT_US;
+};
+
+/*
+  Base for decoders that receive every channel in one frame (PPM, SBUS).
+  publish() is called by the decoder (possibly from an interrupt) with a
+  complete frame; readers copy it out under a sequence counter and retry
+  if a new frame landed part way through, so channels from two different
+  frames are never mixed.
+*/
+class RcFrameInput : public RcInput {
+  public:
+    uint8_t channels() const override { return count; }
+    bool read(uint8_t channel, RC_channel_t &out) const override {
+      uint32_t before, after;
+      uint16_t width;
+      uint32_t stamp;
+      bool fs;
+      do {
+        while ( (before = seq) & 1 );
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ( channel >= count ) return 0;
+        width = widths[channel];
+        stamp = stampUs;
+        fs = failsafe;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = seq;
+      } while ( before != after );
+      out.width_us = width;
+      out.age_us = ( width ) ? (micros() - stamp) : UINT32_MAX;
+      out.fresh = width && out.age_us < timeoutUs;
+      out.failsafe = fs;
+      return 1;
+    }
+    uint32_t frames() const { return good; }          // complete frames published
+    uint32_t lostFrames() const { return lost; }      // malformed or receiver-reported lost frames
+
+  protected:
+    void publish(const uint16_t *w, uint8_t n, bool fs, uint32_t now_us) {
+      seq++;
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      memcpy((void*)widths, w, n * sizeof(uint16_t));
+      count = n;
+      failsafe = fs;
+      stampUs = now_us;
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      seq++;
+      good++;
+    }
+    volatile uint32_t lost = 0;
+
+  private:
+    volatile uint32_t seq = 0;
+    volatile uint16_t widths[RC_MAX_CHANNELS] = { 0 };
+    volatile uint8_t count = 0;
+    volatile bool failsafe = 0;
+    volatile uint32_t stampUs = 0;
+    volatile uint32_t good = 0;
+};
+
+#endif
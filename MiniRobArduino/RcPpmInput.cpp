@@ -0,0 +1,72 @@
+/*
+  RcPpmInput.cpp
+  --------------
+  See RcPpmInput.h.
+*/
+
+#include "RcPpmInput.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+void RcPpmInput::begin(uint8_t ppm_pin) {
+  end();
+  pin = ppm_pin;
+  hasEdge = 0;
+  synced = 0;
+  pinMode(pin, INPUT);
+  attachInterruptArg(digitalPinToInterrupt(pin), isr, this, RISING);
+}
+
+void RcPpmInput::end() {
+  if ( pin == 0xFF ) return;
+  detachInterrupt(digitalPinToInterrupt(pin));
+  pin = 0xFF;
+}
+
+void IRAM_ATTR RcPpmInput::isr(void *arg) {
+  ((RcPpmInput*)arg)->edge(micros());
+}
+#endif
+
+void RcPpmInput::edge(uint32_t now_us) {
+  uint32_t interval = now_us - lastEdgeUs;
+  lastEdgeUs = now_us;
+
+  if ( !hasEdge || interval > RC_PPM_MAX_SYNC_US ) {
+    /* nothing measured before this edge, it may be mid-frame: not a sync */
+    if ( hasEdge && synced && !sent && index ) lost++;
+    hasEdge = 1;
+    synced = 0;
+    expected = 0;
+    return;
+  }
+  if ( interval > RC_PPM_SYNC_US ) {
+    if ( synced && !sent && index >= RC_PPM_MIN_CHANNELS ) {
+      publish(pending, index, 0, now_us);
+      expected = index;
+    }
+    else if ( synced && !sent && index ) lost++;
+    synced = 1;
+    sent = 0;
+    index = 0;
+    return;
+  }
+  if ( !synced ) return;
+
+  if ( sent ) {
+    /* more channels than the last frame had: learn the count again */
+    expected = 0;
+    synced = 0;
+    return;
+  }
+  if ( interval < RC_MIN_PULSE_US || interval > RC_MAX_PULSE_US || index >= RC_MAX_CHANNELS ) {
+    /* glitch: drop the frame and wait for the next gap */
+    lost++;
+    synced = 0;
+    return;
+  }
+  pending[index++] = interval;
+  if ( index == expected ) {
+    publish(pending, index, 0, now_us);
+    sent = 1;
+  }
+}
@@ -0,0 +1,57 @@
+/*
+  RcPpmInput.h
+  ------------
+  PPM (CPPM) receiver input: every channel on one wire as the spacing
+  between rising edges, followed by a sync gap longer than any channel.
+
+      RcPpmInput rc;
+      rc.begin(ppmPin);          // ESP32: rising-edge interrupt on ppmPin
+      ...
+      uint16_t th = rc.widthOr(0, 1500);
+
+  edge() is the whole decoder and takes the edge time as an argument, so it
+  can be fed from any interrupt or capture source. A frame is published as
+  soon as its last channel arrives (the channel count is learned from the
+  previous frame) or at the next sync gap at the latest. A frame with an
+  out of range interval or too many channels is dropped and counted in
+  lostFrames().
+
+  Only a measured gap syncs. The first edge after begin(), or after the
+  signal stopped for longer than RC_PPM_MAX_SYNC_US, has nothing before it
+  to measure, so it could be in the middle of a frame. The decoder waits
+  for the next gap there and learns the channel count again from the frame
+  after it.
+*/
+
+#if !defined(_RC_PPM_INPUT_H_)
+#define _RC_PPM_INPUT_H_
+
+#include "RcInput.h"
+
+#define RC_PPM_SYNC_US 2700      // any interval longer than this is the frame gap
+#define RC_PPM_MAX_SYNC_US 30000 // longer than any gap: the signal stopped
+#define RC_PPM_MIN_CHANNELS 4
+
+class RcPpmInput : public RcFrameInput {
+  public:
+#if defined(ARDUINO_ARCH_ESP32)
+    void begin(uint8_t pin);
+    void end();
+#endif
+    void edge(uint32_t now_us);
+
+  private:
+#if defined(ARDUINO_ARCH_ESP32)
+    static void IRAM_ATTR isr(void *arg);
+    uint8_t pin = 0xFF;
+#endif
+    uint16_t pending[RC_MAX_CHANNELS];
+    uint8_t index = 0;
+    uint8_t expected = 0;     // channels in the last complete frame
+    uint32_t lastEdgeUs = 0;
+    bool hasEdge = 0;         // lastEdgeUs is a real edge
+    bool synced = 0;
+    bool sent = 0;            // current frame already published
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+  RcPwmInput.cpp
+  --------------
+  See RcPwmInput.h.
+*/
+
+#include "RcPwmInput.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+bool RcPwmInput::attach(uint8_t channel, uint8_t pin) {
+  if ( channel >= RC_PWM_MAX_CHANNELS ) return 0;
+  detach(channel);
+  channel_t &c = ch[channel];
+  c.owner = this;
+  c.pin = pin;
+  c.riseUs = c.stampUs = 0;
+  c.widthUs = 0;
+  c.pulses = c.glitches = 0;
+  pinMode(pin, INPUT);
+  attachInterruptArg(digitalPinToInterrupt(pin), edge, &c, CHANGE);
+  if ( channel >= count ) count = channel + 1;
+  return 1;
+}
+
+void RcPwmInput::detach(uint8_t channel) {
+  if ( channel >= RC_PWM_MAX_CHANNELS || ch[channel].pin == 0xFF ) return;
+  detachInterrupt(digitalPinToInterrupt(ch[channel].pin));
+  ch[channel].pin = 0xFF;
+}
+
+void IRAM_ATTR RcPwmInput::edge(void *arg) {
+  channel_t &c = *(channel_t*)arg;
+  uint32_t now = micros();
+  if ( digitalRead(c.pin) ) {
+    c.riseUs = now;
+    return;
+  }
+  if ( !c.riseUs ) return; // falling edge before the first rising one
+  uint32_t width = now - c.riseUs;
+  c.riseUs = 0;
+  if ( width < RC_MIN_PULSE_US || width > RC_MAX_PULSE_US ) {
+    c.glitches++;
+    return;
+  }
+  portENTER_CRITICAL_ISR(&c.owner->lock);
+  c.widthUs = width;
+  c.stampUs = now;
+  portEXIT_CRITICAL_ISR(&c.owner->lock);
+  c.pulses++;
+}
+
+bool RcPwmInput::read(uint8_t channel, RC_channel_t &out) const {
+  if ( channel >= count || ch[channel].pin == 0xFF ) return 0;
+  portENTER_CRITICAL(&lock);
+  uint16_t width = ch[channel].widthUs;
+  uint32_t stamp = ch[channel].stampUs;
+  portEXIT_CRITICAL(&lock);
+  out.width_us = width;
+  out.age_us = ( width ) ? (micros() - stamp) : UINT32_MAX;
+  out.fresh = width && out.age_us < timeoutUs;
+  out.failsafe = 0;
+  return 1;
+}
+
+#endif
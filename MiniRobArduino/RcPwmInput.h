@@ -0,0 +1,57 @@
+/*
+  RcPwmInput.h
+  ------------
+  Non-blocking RC PWM capture for the ESP32, one GPIO per channel.
+
+  Both edges of every channel raise a GPIO interrupt. The rising edge is
+  timestamped, the falling edge turns it into a pulse width which is stored
+  with its arrival time, so all channels are measured in parallel and
+  loop() never sits in pulseIn():
+
+      RcPwmInput rc;
+      rc.attach(0, thIn);
+      rc.attach(1, stIn);
+      rc.attach(2, autoSwitchPin);
+      ...
+      bool autonomous = rc.widthOr(2, 1000) > 1500;
+
+  Pulses outside RC_MIN_PULSE_US..RC_MAX_PULSE_US are dropped and counted
+  as glitches rather than published.
+*/
+
+#if !defined(_RC_PWM_INPUT_H_)
+#define _RC_PWM_INPUT_H_
+
+#include "RcInput.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#define RC_PWM_MAX_CHANNELS 8
+
+class RcPwmInput : public RcInput {
+  public:
+    bool attach(uint8_t channel, uint8_t pin);
+    void detach(uint8_t channel);
+    uint8_t channels() const override { return count; }
+    bool read(uint8_t channel, RC_channel_t &out) const override;
+    uint32_t pulses(uint8_t channel) const { return ( channel < count ) ? ch[channel].pulses : 0; }
+    uint32_t glitches(uint8_t channel) const { return ( channel < count ) ? ch[channel].glitches : 0; }
+
+  private:
+    struct channel_t {
+      RcPwmInput *owner = nullptr;
+      uint8_t pin = 0xFF;
+      volatile uint32_t riseUs = 0;
+      volatile uint32_t stampUs = 0;   // micros() of the falling edge of the last good pulse
+      volatile uint16_t widthUs = 0;
+      volatile uint32_t pulses = 0;
+      volatile uint32_t glitches = 0;
+    };
+    static void IRAM_ATTR edge(void *arg);
+    channel_t ch[RC_PWM_MAX_CHANNELS];
+    uint8_t count = 0;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif
+#endif
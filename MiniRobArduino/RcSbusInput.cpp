@@ -0,0 +1,71 @@
+/*
+  RcSbusInput.cpp
+  ---------------
+  See RcSbusInput.h.
+*/
+
+#include "RcSbusInput.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+void RcSbusInput::begin(HardwareSerial &port, int8_t rx_pin) {
+  serial = &port;
+  serial->begin(100000, SERIAL_8E2, rx_pin, -1, true); /* SBUS is inverted */
+  pos = 0;
+}
+
+void RcSbusInput::update() {
+  if ( !serial ) return;
+  uint32_t now = micros();
+  int n = serial->available();
+  while ( n-- > 0 ) feed(serial->read(), now);
+}
+#endif
+
+bool RcSbusInput::feed(uint8_t byte, uint32_t now_us) {
+  if ( !pos && byte != RC_SBUS_HEADER ) {
+    resyncs++;
+    return 0;
+  }
+  frame[pos++] = byte;
+  if ( pos < RC_SBUS_FRAME_SIZE ) return 0;
+  pos = 0;
+
+  /* footer is 0x00, or 0x04/0x14/0x24/0x34 on SBUS2 receivers */
+  uint8_t footer = frame[RC_SBUS_FRAME_SIZE - 1];
+  if ( footer && (footer & 0x0F) != 0x04 ) {
+    lost++;
+    resyncs++;
+    /* the real header may be inside this frame, rescan from the next 0x0F */
+    for ( uint8_t i = 1; i < RC_SBUS_FRAME_SIZE; i++ ) {
+      if ( frame[i] != RC_SBUS_HEADER ) continue;
+      uint8_t n = RC_SBUS_FRAME_SIZE - i;
+      memmove(frame, frame + i, n);
+      pos = n;
+      break;
+    }
+    return 0;
+  }
+  decode(now_us);
+  return 1;
+}
+
+void RcSbusInput::decode(uint32_t now_us) {
+  uint16_t widths[RC_SBUS_CHANNELS];
+  const uint8_t *data = frame + 1;
+  uint32_t bits = 0;
+  uint8_t have = 0;
+  for ( uint8_t ch = 0; ch < RC_SBUS_CHANNELS; ch++ ) {
+    while ( have < 11 ) {
+      bits |= (uint32_t)(*data++) << have;
+      have += 8;
+    }
+    uint16_t raw = bits & 0x7FF;
+    bits >>= 11;
+    have -= 11;
+    widths[ch] = 880 + ((raw * 5) >> 3); /* 0.625 us per count */
+  }
+  uint8_t f = frame[RC_SBUS_FRAME_SIZE - 2];
+  flags = f;
+  if ( f & RC_SBUS_FLAG_FRAME_LOST ) lost++;
+  publish(widths, RC_SBUS_CHANNELS, f & RC_SBUS_FLAG_FAILSAFE, now_us);
+}
@@ -0,0 +1,55 @@
+/*
+  RcSbusInput.h
+  -------------
+  SBUS receiver input: 16 proportional channels, 2 digital channels and
+  frame-lost/failsafe flags in one 25 byte frame, inverted 100000 baud 8E2
+  serial, every 7 ms (fast mode) or 14 ms.
+
+      RcSbusInput rc;
+      rc.begin(Serial2, sbusPin); // ESP32: UART RX with the inverter enabled
+      ...
+      rc.update();                // in loop(), drains whatever bytes arrived
+      uint16_t th = rc.widthOr(0, 1500);
+
+  feed() is the decoder and takes one byte at a time, so it also runs from
+  any other byte source. Channel values are converted to microseconds
+  (172..1811 -> 988..2012 us) so they read the same as the PWM and PPM
+  inputs. Frames without a valid header/footer are dropped and counted in
+  lostFrames() together with the frames the receiver itself marks as lost.
+*/
+
+#if !defined(_RC_SBUS_INPUT_H_)
+#define _RC_SBUS_INPUT_H_
+
+#include "RcInput.h"
+
+#define RC_SBUS_FRAME_SIZE 25
+#define RC_SBUS_HEADER 0x0F
+#define RC_SBUS_CHANNELS 16
+#define RC_SBUS_FLAG_CH17 0x01
+#define RC_SBUS_FLAG_CH18 0x02
+#define RC_SBUS_FLAG_FRAME_LOST 0x04
+#define RC_SBUS_FLAG_FAILSAFE 0x08
+
+class RcSbusInput : public RcFrameInput {
+  public:
+#if defined(ARDUINO_ARCH_ESP32)
+    void begin(HardwareSerial &port, int8_t rx_pin);
+    void update();
+#endif
+    bool feed(uint8_t byte, uint32_t now_us); /* 1 when the byte completed a good frame */
+    bool digital(uint8_t n) const { return flags & (( n ) ? RC_SBUS_FLAG_CH18 : RC_SBUS_FLAG_CH17); }
+    uint32_t syncErrors() const { return resyncs; }
+
+  private:
+    void decode(uint32_t now_us);
+#if defined(ARDUINO_ARCH_ESP32)
+    HardwareSerial *serial = nullptr;
+#endif
+    uint8_t frame[RC_SBUS_FRAME_SIZE];
+    uint8_t pos = 0;
+    volatile uint8_t flags = 0;
+    uint32_t resyncs = 0;
+};
+
+#endif
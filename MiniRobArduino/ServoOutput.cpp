@@ -0,0 +1,73 @@
+/*
+  ServoOutput.cpp
+  ---------------
+  See ServoOutput.h.
+*/
+
+#include "ServoOutput.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+bool ServoOutput::attach(uint8_t channel, uint8_t pin, uint16_t rate_hz) {
+  if ( channel >= SERVO_OUTPUT_MAX_CHANNELS || rate_hz < 40 || rate_hz > 400 ) return 0;
+  detach(channel);
+  channel_t &c = ch[channel];
+  uint8_t ledc = SERVO_LEDC_FIRST_CHANNEL + (channel << 1);
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  if ( !ledcAttachChannel(pin, rate_hz, SERVO_LEDC_BITS, ledc) ) return 0;
+#else
+  if ( !ledcSetup(ledc, rate_hz, SERVO_LEDC_BITS) ) return 0;
+  ledcAttachPin(pin, ledc);
+#endif
+  c.pin = pin;
+  c.rate = rate_hz;
+  c.ticksPerUs = (uint32_t)((((uint64_t)1 << SERVO_LEDC_BITS) * rate_hz * 65536ULL) / 1000000ULL);
+  c.duty = 0xFFFFFFFF;
+  writeMicroseconds(channel, c.cal.center_us);
+  return 1;
+}
+
+void ServoOutput::detach(uint8_t channel) {
+  if ( channel >= SERVO_OUTPUT_MAX_CHANNELS || ch[channel].pin == 0xFF ) return;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcDetach(ch[channel].pin);
+#else
+  ledcDetachPin(ch[channel].pin);
+#endif
+  ch[channel].pin = 0xFF;
+}
+
+void ServoOutput::setCalibration(uint8_t channel, const ServoCal_t &cal) {
+  if ( channel >= SERVO_OUTPUT_MAX_CHANNELS || cal.min_us > cal.center_us || cal.center_us > cal.max_us ) return;
+  ch[channel].cal = cal;
+  if ( ch[channel].pin != 0xFF ) writeMicroseconds(channel, ch[channel].us);
+}
+
+void ServoOutput::writeMicroseconds(uint8_t channel, uint16_t us) {
+  if ( channel >= SERVO_OUTPUT_MAX_CHANNELS ) return;
+  channel_t &c = ch[channel];
+  if ( us < c.cal.min_us ) us = c.cal.min_us;
+  else if ( us > c.cal.max_us ) us = c.cal.max_us;
+  if ( abs((int)us - (int)c.cal.center_us) <= c.cal.deadband_us ) us = c.cal.center_us;
+  c.us = us;
+  if ( c.pin == 0xFF ) return;
+  uint32_t duty = (uint32_t)(((uint64_t)us * c.ticksPerUs) >> 16);
+  if ( duty == c.duty ) return; /* LEDC would latch the same value anyway */
+  c.duty = duty;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcWrite(c.pin, duty);
+#else
+  ledcWrite(SERVO_LEDC_FIRST_CHANNEL + (channel << 1), duty);
+#endif
+}
+
+void ServoOutput::write(uint8_t channel, int16_t value) {
+  if ( channel >= SERVO_OUTPUT_MAX_CHANNELS ) return;
+  const ServoCal_t &cal = ch[channel].cal;
+  int32_t v = ( value < -SERVO_FULL ) ? -SERVO_FULL : value;
+  if ( cal.reversed ) v = -v;
+  int32_t span = ( v >= 0 ) ? (cal.max_us - cal.center_us) : (cal.center_us - cal.min_us);
+  writeMicroseconds(channel, cal.center_us + ((v * span) / SERVO_FULL));
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+  ServoOutput.h
+  -------------
+  Servo / ESC pulse output on the ESP32 LEDC peripheral, set in
+  microseconds instead of degrees.
+
+      ServoOutput servos;
+      servos.attach(0, steeringPin, 333);            // digital servo, 333 Hz
+      servos.attach(1, throttlePin, 50);             // ESC, 50 Hz
+      servos.setCalibration(1, { 1000, 1500, 2000, 20, 0 });
+      ...
+      servos.writeMicroseconds(0, stInUs);           // pass an RC pulse straight through
+      servos.write(1, SERVO_FULL / 4);               // quarter forward, about the calibrated centre
+
+  Each channel gets its own LEDC timer, so rates can differ per channel.
+  With 16-bit duty a count is 0.3 us at 50 Hz and 0.05 us at 333 Hz, well
+  below what a servo resolves, where Servo::write() in degrees stepped by
+  about 5.5 us. LEDC only latches a new duty at the end of the running
+  period, so a write never produces a shortened or doubled pulse.
+
+  Normalised setpoints are Q15 (-SERVO_FULL..SERVO_FULL) and scale
+  separately on each side of the centre, so asymmetric endpoints (an ESC
+  with a short reverse range) need no special casing. Commands within the
+  deadband of the centre output exactly the centre pulse.
+*/
+
+#if !defined(_SERVO_OUTPUT_H_)
+#define _SERVO_OUTPUT_H_
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#define SERVO_OUTPUT_MAX_CHANNELS 4
+#define SERVO_FULL 32767
+#if !defined(SERVO_LEDC_FIRST_CHANNEL)
+#define SERVO_LEDC_FIRST_CHANNEL 0   // servo channel n uses LEDC channel FIRST + 2n, i.e. its own timer
+#endif
+#if !defined(SERVO_LEDC_BITS)
+#define SERVO_LEDC_BITS 16
+#endif
+
+typedef struct ServoCal_t {
+  uint16_t min_us;
+  uint16_t center_us;
+  uint16_t max_us;
+  uint16_t deadband_us;   // commands this close to the centre output the centre
+  bool reversed;          // swap the direction of normalised setpoints
+} ServoCal_t;
+
+class ServoOutput {
+  public:
+    bool attach(uint8_t channel, uint8_t pin, uint16_t rate_hz = 50);
+    void detach(uint8_t channel);
+    void setCalibration(uint8_t channel, const ServoCal_t &cal);
+    const ServoCal_t& getCalibration(uint8_t channel) const { return ch[channel].cal; }
+    void writeMicroseconds(uint8_t channel, uint16_t us);
+    void write(uint8_t channel, int16_t value); // Q15 normalised, SERVO_FULL = max endpoint
+    uint16_t readMicroseconds(uint8_t channel) const { return ( channel < SERVO_OUTPUT_MAX_CHANNELS ) ? ch[channel].us : 0; }
+    uint16_t getRate(uint8_t channel) const { return ( channel < SERVO_OUTPUT_MAX_CHANNELS ) ? ch[channel].rate : 0; }
+
+  private:
+    struct channel_t {
+      uint8_t pin = 0xFF;
+      uint16_t rate = 0;
+      uint32_t ticksPerUs = 0;  // duty counts per microsecond, 16.16 fixed point
+      uint32_t duty = 0xFFFFFFFF;
+      uint16_t us = 0;
+      ServoCal_t cal = { 1000, 1500, 2000, 0, 0 };
+    };
+    channel_t ch[SERVO_OUTPUT_MAX_CHANNELS];
+};
+
+#endif
+#endif
@@ -0,0 +1,71 @@
+// CANBUS_bridge.cpp
+/*
+  Keeps the motor bus (CAN1, VESCs at 250 kbit) apart from the sensor bus
+  (CAN2, 1 Mbit) and forwards only what the other side needs, from inside
+  the receive interrupts (lib/CanBridge):
+    - VESC STATUS and STATUS_4 go from CAN1 to CAN2 for the logger, and
+      are still read() here (CAN_BRIDGE_LOCAL). STATUS_4 is limited to
+      50 frames/s on CAN2.
+    - Sensor frames 0x100-0x1FF stay on CAN2, except 0x180 (e-stop) which
+      goes onto CAN1 as 0x080 so it wins arbitration there.
+    - Anything else is just received locally, nothing from CAN2 ever
+      reaches the VESCs by accident.
+  Prints the bridge counters once a second. Load test: flash
+  CANBUS_load_generator.cpp on a second Teensy and wire CAN1/CAN2 across.
+*/
+
+#include <FlexCAN_T4.h>
+#include <CanBridge.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> motor;
+FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> sensors;
+
+uint32_t lastPrint = 0;
+uint32_t localFrames = 0;
+
+void printBus(const char *name, const CanBridge_bus_stats_t &s, uint8_t bus) {
+  Serial.printf("%s: rx %lu, out %lu direct + %lu queued, %lu ring full (max %lu), %lu no mailbox, latency mean %.1f us max %.1f us, isr max %.2f us\n",
+                name, s.rx, s.direct, s.queued, s.queue_full, s.queue_max, s.no_mailbox, canBridge.latencyMeanUs(bus), s.latency_max_ns / 1000.0f, s.isr_max_ns / 1000.0f);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(400);
+
+  motor.begin();
+  motor.setBaudRate(250000);
+  motor.enableFIFO();
+  motor.enableFIFOInterrupt();
+
+  sensors.begin();
+  sensors.setBaudRate(1000000);
+  sensors.enableFIFO();
+  sensors.enableFIFOInterrupt();
+
+  // after setBaudRate(), takes the two highest free mailboxes of each bus
+  canBridge.addBus(motor);
+  canBridge.addBus(sensors);
+
+  canBridge.addRoute(1, 0x0900, 0x1FFFFF00, 1 << 2, CAN_BRIDGE_EXT | CAN_BRIDGE_LOCAL);              // STATUS, any VESC
+  int8_t status4 = canBridge.addRoute(1, 0x1000, 0x1FFFFF00, 1 << 2, CAN_BRIDGE_EXT | CAN_BRIDGE_LOCAL);
+  canBridge.setRateLimit(status4, 50, 4);
+  int8_t estop = canBridge.addRoute(2, 0x180, 0x7FF, 1 << 1);
+  canBridge.setRewrite(estop, 0x7FF, 0x080);
+  canBridge.addRoute(2, 0x100, 0x700, 0);                                                         // the rest of 0x1xx is blocked
+
+  if ( !canBridge.begin() ) Serial.println("no buses for the bridge");
+}
+
+void loop() {
+  CAN_message_t msg;
+  while ( motor.read(msg) ) localFrames++;   // everything not consumed by a route
+  while ( sensors.read(msg) ) localFrames++;
+
+  if ( millis() - lastPrint > 1000 ) {
+    lastPrint = millis();
+    const CanBridge_stats_t &s = canBridge.stats();
+    printBus("CAN1", s.bus[0], 1);
+    printBus("CAN2", s.bus[1], 2);
+    Serial.printf("STATUS_4 over the limit %lu, blocked 0x1xx %lu, local %lu\n", s.route[1].rate_dropped, s.route[3].matched, localFrames);
+  }
+}
@@ -0,0 +1,86 @@
+// CANBUS_capture.cpp
+/*
+  Logs CAN1 and CAN2 to the Teensy 4.1 SD card as a .ccap capture
+  (lib/CanCapture). Frames are queued in the receive interrupts and written
+  from loop() through events(), 4 KB at a time. A new file per power up:
+  CAP000.CCP, CAP001.CCP, ...
+  Send 's' over USB serial to close the file (index + trailer) before
+  pulling the card; a file that was not closed still reads, the PC tools
+  rebuild the index:
+    ./cancap info CAP000.CCP
+    ./cancap dump CAP000.CCP --from 60 --to 65 --id 901 > part.log
+*/
+
+#include <FlexCAN_T4.h>
+#include <SD.h>
+#include <CanCapture.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> can2;
+
+File logFile;
+CanCapture<File> capture(logFile);
+bool logging = false;
+uint32_t lastFlush = 0;
+
+// run by events() in loop(), not in the interrupt, so writing to SD is fine
+void canRx(const CAN_message_t &msg) {
+  if ( logging ) capture.add(msg);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(400);
+
+  if ( !SD.begin(BUILTIN_SDCARD) ) {
+    Serial.println("no SD card");
+    return;
+  }
+  char name[16];
+  for ( int i = 0; i < 1000; i++ ) {
+    snprintf(name, sizeof(name), "CAP%03d.CCP", i);
+    if ( !SD.exists(name) ) break;
+  }
+  logFile = SD.open(name, FILE_WRITE);
+  if ( !logFile ) {
+    Serial.println("cannot create log file");
+    return;
+  }
+  capture.setBusName(1, "CAN1");
+  capture.setBusName(2, "CAN2");
+  logging = capture.begin();
+  Serial.print("logging to ");
+  Serial.println(name);
+
+  can1.begin();
+  can1.setBaudRate(1000000);
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(canRx);
+
+  can2.begin();
+  can2.setBaudRate(500000);
+  can2.enableFIFO();
+  can2.enableFIFOInterrupt();
+  can2.onReceive(canRx);
+}
+
+void loop() {
+  can1.events();
+  can2.events();
+
+  // at most a second of frames is lost if the power goes
+  if ( logging && millis() - lastFlush > 1000 ) {
+    lastFlush = millis();
+    capture.flush();
+    logFile.flush();
+  }
+
+  if ( Serial.available() && Serial.read() == 's' && logging ) {
+    logging = false;
+    capture.end();
+    logFile.close();
+    const CanCapture_stats_t &s = capture.stats();
+    Serial.printf("closed: %lu frames, %lu blocks, %lu write errors\n", s.frames, s.blocks, s.write_errors);
+  }
+}
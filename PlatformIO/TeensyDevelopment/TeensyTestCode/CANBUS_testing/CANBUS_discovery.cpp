@@ -0,0 +1,50 @@
+// CANBUS_discovery.cpp
+/*
+  Maps the CAN bus instead of brute forcing the transmit ID.
+  200 ms of listen-only fingerprinting, then a CAN_PACKET_PING sweep of
+  VESC controller IDs 0..255. Prints every ID heard (rate, period range,
+  DLCs, likely device) and every VESC that answered, then repeats when
+  'd' is sent over serial.
+*/
+
+#include <FlexCAN_T4.h>
+#include <CanDiscovery.h>
+
+typedef FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBusType;
+CanBusType can1;
+CAN_discovery<CanBusType> discovery(can1);
+
+const uint32_t bitrate = 500000;
+
+// runs in the CAN interrupt
+void canRx(const CAN_message_t &msg) {
+  discovery.process(msg);
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial);
+
+  can1.begin();
+  can1.setBaudRate(bitrate);
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(canRx);
+
+  discovery.begin(bitrate);
+}
+
+void loop() {
+  can1.events();
+
+  static bool printed = false;
+  if (discovery.update() && !printed) {
+    discovery.printMap();
+    printed = true;
+  }
+
+  if (Serial.available() && Serial.read() == 'd') {
+    discovery.begin(bitrate);
+    printed = false;
+  }
+}
@@ -0,0 +1,54 @@
+// CANBUS_gateway.cpp
+/*
+  Teensy 4.1 as a three bus USB CAN adapter (lib/CanGateway).
+  In SavvyCAN add a "Serial connection (GVRET)" on the Teensy's port, all
+  three buses show up as bus 0..2. For can-utils use slcan on CAN1:
+    sudo slcand -o -s8 -c /dev/ttyACM0 can0 && sudo ip link set can0 up
+  Frames are stamped and queued in the receive interrupts and sent to the
+  PC in large batches, so no delay is needed in loop().
+  Load test: flash CANBUS_load_generator.cpp on a second Teensy 4.1, wire
+  CAN1/2/3 to CAN1/2/3 and run host/gateway_rate_test on the PC.
+*/
+
+#include <FlexCAN_T4.h>
+#include <CanGateway.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_64> can1;
+FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_64> can2;
+FlexCAN_T4<CAN3, RX_SIZE_256, TX_SIZE_64> can3;
+
+// until the host sets its own with GVRET SETUP_CANBUS or slcan Sn
+const uint32_t bitrate = 1000000;
+
+// runs in the CAN interrupts of all three buses, msg.bus says which
+void canRx(const CAN_message_t &msg) {
+  canGateway.capture(msg);
+}
+
+void setup() {
+  Serial.begin(115200);  // USB, the baud rate is ignored
+
+  can1.begin();
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(canRx);
+  canGateway.addBus(1, can1, bitrate);
+
+  can2.begin();
+  can2.enableFIFO();
+  can2.enableFIFOInterrupt();
+  can2.onReceive(canRx);
+  canGateway.addBus(2, can2, bitrate);
+
+  can3.begin();
+  can3.enableFIFO();
+  can3.enableFIFOInterrupt();
+  can3.onReceive(canRx);
+  canGateway.addBus(3, can3, bitrate);
+
+  canGateway.begin();
+}
+
+void loop() {
+  canGateway.update();
+}
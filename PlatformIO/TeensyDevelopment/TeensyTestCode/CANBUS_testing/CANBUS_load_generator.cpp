@@ -0,0 +1,77 @@
+// CANBUS_load_generator.cpp
+/*
+  Keeps all three buses of a Teensy 4.1 at 100% load for the gateway
+  test (see CANBUS_gateway.cpp). Every frame is 8 bytes: a 32-bit
+  sequence number, the bus number and three filler bytes, so
+  host/gateway_rate_test can find every missing frame. The TX queues are
+  topped up on every pass, so the mailboxes never run empty and frames go
+  out back to back.
+  Prints frames sent per second on each bus.
+*/
+
+#include <FlexCAN_T4.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_16, TX_SIZE_256> can1;
+FlexCAN_T4<CAN2, RX_SIZE_16, TX_SIZE_256> can2;
+FlexCAN_T4<CAN3, RX_SIZE_16, TX_SIZE_256> can3;
+
+const uint32_t bitrate = 1000000;
+const uint32_t frameId = 0x123;
+
+uint32_t seq[3] = { 0, 0, 0 };
+uint32_t sentLastSecond[3] = { 0, 0, 0 };
+
+void nextFrame(uint8_t bus, CAN_message_t &msg) {
+  msg.id = frameId;
+  msg.len = 8;
+  msg.buf[0] = seq[bus];
+  msg.buf[1] = seq[bus] >> 8;
+  msg.buf[2] = seq[bus] >> 16;
+  msg.buf[3] = seq[bus] >> 24;
+  msg.buf[4] = bus + 1;
+  msg.buf[5] = 0x55;  // 0x55 / 0xAA keep bit stuffing low and the same for every frame
+  msg.buf[6] = 0xAA;
+  msg.buf[7] = 0x55;
+}
+
+template<typename T> void fill(T &can, uint8_t bus) {
+  CAN_message_t msg;
+  nextFrame(bus, msg);
+  while (can.write(msg) > 0) {  // 0 when the TX queue is full, -2 when bus off
+    seq[bus]++;
+    nextFrame(bus, msg);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  can1.begin();
+  can1.setBaudRate(bitrate);
+  can1.enableMBInterrupts();  // the TX interrupt refills the mailboxes from the queue
+  can2.begin();
+  can2.setBaudRate(bitrate);
+  can2.enableMBInterrupts();
+  can3.begin();
+  can3.setBaudRate(bitrate);
+  can3.enableMBInterrupts();
+}
+
+void loop() {
+  fill(can1, 0);
+  fill(can2, 1);
+  fill(can3, 2);
+
+  static uint32_t reportTimer = millis();
+  if (millis() - reportTimer >= 1000) {
+    reportTimer = millis();
+    for (uint8_t i = 0; i < 3; i++) {
+      Serial.print("CAN");
+      Serial.print(i + 1);
+      Serial.print(": ");
+      Serial.print(seq[i] - sentLastSecond[i]);
+      Serial.print(" frames/s   ");
+      sentLastSecond[i] = seq[i];
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,128 @@
+// CANBUS_profiler.cpp
+/*
+  Bus load and per-ID traffic on CAN1 with lib/CanProfiler. Every frame
+  received or sent goes through canProfiler.process() from the CAN
+  interrupt; a 0x700 heartbeat every 100 ms shows our own traffic in the
+  figures as well.
+  hostMode false: the summary (load, worst case load, peak, then rate,
+  period, jitter and DLCs per ID) is printed once a second.
+  hostMode true: Serial carries HostLink instead, and an empty
+  HOSTLINK_BUS_LOAD record from the host is answered with a BUS_LOAD
+  record and one ID_STATS record per ID, a few per loop() pass so no
+  frame gets dropped:
+    ./hostlink_cli /dev/ttyACM0 profile
+*/
+
+#include <FlexCAN_T4.h>
+#include <CanProfiler.h>
+#include <HostLink.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+HostLink hostLink;
+
+const bool hostMode = false;
+const uint8_t bus = 1;         // msg.bus of CAN1
+
+int32_t reportNext = -1;       // next ID to send, -1 = BUS_LOAD record first, -2 = no report running
+
+// runs in the CAN interrupt
+void canFrame(const CAN_message_t &msg) {
+  canProfiler.process(msg);
+}
+
+// runs in the CAN interrupt, once the frame is on the bus
+void canSent(const CAN_message_t &msg) {
+  canProfiler.process(msg, 1);
+}
+
+// runs inside hostLink.update()
+void onHost(uint8_t type, const uint8_t *data, uint8_t len) {
+  if (type == HOSTLINK_BUS_LOAD) reportNext = -1;
+}
+
+void sendReport() {
+  if (reportNext == -1) {
+    CanProfiler_load_t l;
+    canProfiler.load(bus, l);
+    HostLink_bus_load_t out;
+    memset(&out, 0, sizeof(out));
+    out.stamp_us = micros();
+    out.bus = bus;
+    out.load_cpct = l.load_cpct;
+    out.worst_cpct = l.worst_cpct;
+    out.peak_cpct = l.peak_cpct;
+    out.bitrate = l.bitrate;
+    out.frames = l.frames;
+    out.window_us = l.window_us;
+    hostLink.send(HOSTLINK_BUS_LOAD, out);
+    reportNext = 0;
+  }
+  // 10 x 38 bytes fits one frame with the BUS_LOAD record
+  for (uint8_t i = 0; i < 10 && reportNext >= 0; i++) {
+    CanProfiler_id_t n;
+    if (!canProfiler.id(reportNext, n)) {
+      reportNext = -2;
+      break;
+    }
+    HostLink_id_stats_t out;
+    out.id = n.id;
+    out.bus = n.bus;
+    out.flags = (n.extended ? HOSTLINK_CAN_EXTENDED : 0) | (n.tx ? HOSTLINK_ID_TX : 0);
+    out.dlc_mask = n.dlc_mask;
+    out.frames = n.frames;
+    out.rate_mhz = CanProfiler::rateMilliHz(n);
+    out.period_us = n.period_us;
+    out.jitter_us = n.jitter_us;
+    out.min_period_us = n.min_period_us;
+    out.max_period_us = n.max_period_us;
+    out.bits = n.bits;
+    hostLink.send(HOSTLINK_ID_STATS, out);
+    reportNext++;
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  if (hostMode) {
+    hostLink.begin();
+    hostLink.onMessage(onHost);
+  }
+  else while (!Serial);
+
+  can1.begin();
+  can1.setBaudRate(250000);
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(canFrame);
+  can1.onTransmit(canSent);
+
+  canProfiler.begin();
+  canProfiler.setBitrate(bus, can1.getBaudRate());
+  reportNext = -2;
+}
+
+void loop() {
+  static uint32_t heartbeatTimer = millis();
+  if (millis() - heartbeatTimer >= 100) {
+    heartbeatTimer += 100;
+    CAN_message_t msg;
+    msg.id = 0x700;
+    msg.len = 1;
+    msg.buf[0] = 0x05;  // operational
+    can1.write(msg);
+  }
+
+  if (hostMode) {
+    hostLink.update();
+    if (reportNext != -2) sendReport();
+    hostLink.flush();
+    return;
+  }
+
+  static uint32_t printTimer = millis();
+  if (millis() - printTimer >= 1000) {
+    printTimer = millis();
+    canProfiler.printSummary();
+    Serial.println();
+  }
+}
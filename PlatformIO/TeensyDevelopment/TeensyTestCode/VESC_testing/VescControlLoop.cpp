@@ -0,0 +1,57 @@
+// VescControlLoop.cpp
+/*
+  1 kHz VESC duty ramp and hold on a timer instead of delay().
+  The ramp runs in the ControlLoop step (timer interrupt) and releases the
+  command through a reserved mailbox burst, so loop() only services CAN
+  and prints the timing statistics once a second.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+#include <VescBurst.h>
+#include <ControlLoop.h>
+
+typedef FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBusType;
+CanBusType CanBus;
+
+VESC_controller vesc(1);
+VESC_burst<CanBusType, 1> burst(CanBus, MB8);
+ControlLoop control;
+
+const uint32_t controlRate = 1000;                      // Hz
+const float targetDuty = 0.18;
+const float dutyStep = 0.025 / controlRate;             // same 2.5 %/s ramp as CAN_VESC_CONTROL
+float currentDuty = 0.0;
+
+// runs in the timer interrupt every 1 ms
+void controlStep() {
+  if (currentDuty < targetDuty) {
+    currentDuty += dutyStep;
+    if (currentDuty > targetDuty) currentDuty = targetDuty;
+  }
+  burst.set(0, vesc.setDuty(currentDuty));
+  burst.release();
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {}
+
+  CanBus.begin();
+  CanBus.setBaudRate(250000);
+  burst.begin();
+
+  control.begin(controlStep, controlRate);
+}
+
+void loop() {
+  CanBus.events();
+
+  static uint32_t printTimer = millis();
+  if (millis() - printTimer >= 1000) {
+    printTimer = millis();
+    Serial.print("Duty: ");
+    Serial.println(currentDuty * 100.0, 2);
+    control.printStats();
+  }
+}
@@ -0,0 +1,86 @@
+// VescDeadline.cpp
+/*
+  Stops a motor when its VESC goes quiet, instead of the commented-out
+  "No message received" print in CAN_VESC.ino. Both VESCs get a duty
+  command every 10 ms from lib/CanScheduler, and each one's STATUS
+  broadcast (set to 50 Hz in VESC Tool) is watched by lib/CanDeadline:
+  50 ms without one is a miss. loop() checks canDeadline.fresh() before
+  every setpoint update and drops a stale motor to duty 0 until its
+  status is back. Unplug a VESC's CAN lead to try it. Per VESC, once a
+  second: misses, the longest gap between status frames, and whether it
+  is stale right now.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+#include <CanScheduler.h>
+#include <CanDeadline.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBus;
+
+struct Motor {
+  VESC_controller vesc;
+  int16_t dutyEntry = -1;
+  CanDeadline_t status;
+  volatile uint32_t lastMissMs = 0;
+};
+
+Motor motors[2];
+const float duty = 0.05;
+
+// runs in the scheduler interrupt, once per silent period
+void statusMissed(CanDeadline_t &d) {
+  ((Motor*)d.arg)->lastMissMs = millis();
+}
+
+// runs in the CAN interrupt
+void canRx(const CAN_message_t &msg) {
+  canDeadline.process(msg);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {}
+
+  CanBus.begin();
+  CanBus.setBaudRate(250000);
+  CanBus.enableFIFO();
+  CanBus.enableFIFOInterrupt();
+  CanBus.onReceive(canRx);
+
+  canScheduler.addBus(CanBus);
+  for (uint8_t i = 0; i < 2; i++) {
+    Motor &m = motors[i];
+    m.vesc.setControllerID(i + 1);
+    m.dutyEntry = canScheduler.add(1, m.vesc.setDuty(0), 10000);
+    m.status.callback = statusMissed;
+    m.status.arg = &m;
+    canDeadline.watch(m.status, VESC_CAN_ID(CAN_PACKET_STATUS, i + 1), 20000, 30000);
+  }
+  canScheduler.begin(1000);
+}
+
+void loop() {
+  static uint32_t updateTimer = millis();
+  if (millis() - updateTimer >= 10) {
+    updateTimer = millis();
+    for (uint8_t i = 0; i < 2; i++) {
+      Motor &m = motors[i];
+      canScheduler.update(m.dutyEntry, m.vesc.setDuty(canDeadline.fresh(m.status) ? duty : 0));
+    }
+  }
+
+  static uint32_t printTimer = millis();
+  if (millis() - printTimer >= 1000) {
+    printTimer = millis();
+    for (uint8_t i = 0; i < 2; i++) {
+      const CanDeadline_t &d = motors[i].status;
+      Serial.printf("VESC %u: %lu status frames, %lu misses, max gap %lu us, %s", i + 1, d.frames, d.misses, d.max_gap_us,
+                    d.stale ? "STALE, duty 0" : "ok");
+      if (d.misses) Serial.printf(", last miss %lu ms ago", millis() - motors[i].lastMissMs);
+      Serial.println();
+    }
+    const CanDeadline_stats_t &s = canDeadline.stats();
+    Serial.printf("watched %lu, checks %lu, misses %lu, recoveries %lu\n", s.watched, s.checks, s.misses, s.recoveries);
+  }
+}
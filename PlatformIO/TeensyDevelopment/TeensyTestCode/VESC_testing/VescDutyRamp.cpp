@@ -0,0 +1,71 @@
+// VescDutyRamp.cpp
+/*
+  Duty cycle ramp for a VESC using the VescCAN library.
+  Same behaviour as MiniRobTeensy/CANBUS_testing/CAN_VESC_CONTROL, but the
+  frames are built with the real VESC layout: extended ID
+  (CAN_PACKET_SET_DUTY << 8) | controller_id and a big-endian duty * 100000
+  payload. STATUS broadcasts are decoded in the receive interrupt into a
+  VESC_telemetry cache, so loop() only copies out the latest values.
+  Nothing is printed as text: events go into the TraceLog ring and are
+  drained as binary, decode them on the PC with host/trace_decode.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+#include <VescTelemetry.h>
+#include <TraceLog.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBus;
+
+// VESC controller ID as set in VESC Tool (App Settings -> General -> VESC ID)
+VESC_controller vesc(1);
+VESC_telemetry<4> telemetry;
+
+float currentDuty = 0.0;
+const float targetDuty = 0.18;
+const float dutyStep = 0.005;
+const unsigned long rampDelay = 200;
+
+// runs in the CAN interrupt
+void canRx(const CAN_message_t &msg) {
+  telemetry.process(msg);
+  TRACE(TRACE_CAN_RX, 1, msg.id, vesc_get_int32(msg.buf));
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {}
+  traceLog.begin();
+
+  CanBus.begin();
+  CanBus.setBaudRate(250000);
+  CanBus.enableFIFO();
+  CanBus.enableFIFOInterrupt();
+  CanBus.onReceive(canRx);
+  telemetry.add(vesc.getControllerID());
+}
+
+void loop() {
+  // binary trace out to USB, only as much as fits without blocking
+  traceLog.drain();
+
+  static uint32_t rampTimer = millis();
+  if (millis() - rampTimer < rampDelay) return;
+  rampTimer = millis();
+
+  if (currentDuty < targetDuty) {
+    currentDuty += dutyStep;
+    if (currentDuty > targetDuty) currentDuty = targetDuty;
+  }
+
+  // VESCs time out without a steady command stream, so resend every pass
+  const CAN_message_t &cmd = vesc.setDuty(currentDuty);
+  int result = CanBus.write(cmd);
+  if (result > 0) TRACE(TRACE_CAN_TX, 1, cmd.id, vesc_get_int32(cmd.buf));
+  else TRACE(TRACE_CAN_TX_FAIL, 1, cmd.id, result);
+
+  VESC_telemetry_t t;
+  if (telemetry.read(vesc.getControllerID(), t) && telemetry.age(t, STATUS_1) < 100000) {
+    TRACE(TRACE_VESC_STATUS, t.status.controller_id, t.status.erpm, (int32_t)(t.status.current * 10.0f));
+  }
+}
@@ -0,0 +1,121 @@
+// VescHostLink.cpp
+/*
+  VESCs driven from the companion computer over the binary HostLink
+  protocol (lib/HostLink) instead of Serial.print text.
+  SETPOINT records from the host become VESC commands on CAN1 right away,
+  CAN_FRAME records are written to the bus as they are. Every status
+  broadcast that arrives is sent back as a TELEMETRY record, other frames
+  as CAN_FRAME records, all batched into one USB frame per loop() pass.
+  Test from the PC with host/hostlink_cli:
+    ./hostlink_cli /dev/ttyACM0 ping
+    ./hostlink_cli /dev/ttyACM0 duty 1 0.10
+  If no setpoint arrives for 100 ms every VESC seen so far gets duty 0.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+#include <VescTelemetry.h>
+#include <HostLink.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBus;
+VESC_controller vesc;
+VESC_telemetry<8> telemetry;
+HostLink hostLink;
+
+const uint32_t setpointTimeout = 100000;  // us
+uint32_t lastSetpoint = 0;
+bool stopped = true;
+
+void toHostTelemetry(const VESC_telemetry_t &t, HostLink_telemetry_t &out) {
+  memset(&out, 0, sizeof(out));
+  out.stamp_us = t.stamp_us[STATUS_1];
+  out.controller = t.status.controller_id;
+  out.erpm = t.status.erpm;
+  out.tachometer = t.status.tachometer;
+  out.current_da = (int16_t)lroundf(t.status.current * 10.0f);
+  out.duty_permille = (int16_t)lroundf(t.status.duty * 1000.0f);
+  out.current_in_da = (int16_t)lroundf(t.status.current_in * 10.0f);
+  out.v_in_dv = (int16_t)lroundf(t.status.v_in * 10.0f);
+  out.temp_fet_dc = (int16_t)lroundf(t.status.temp_fet * 10.0f);
+  out.temp_motor_dc = (int16_t)lroundf(t.status.temp_motor * 10.0f);
+}
+
+// runs inside hostLink.update()
+void onHost(uint8_t type, const uint8_t *data, uint8_t len) {
+  if (type == HOSTLINK_SETPOINT && len >= sizeof(HostLink_setpoint_t)) {
+    HostLink_setpoint_t sp;
+    memcpy(&sp, data, sizeof(sp));
+    if (sp.command >= VESC_CMD_COUNT) return;
+    vesc.setControllerID(sp.controller);
+    CanBus.write(vesc.encode((VESC_COMMAND)sp.command, sp.value));
+    lastSetpoint = micros();
+    stopped = false;
+  }
+  else if (type == HOSTLINK_CAN_FRAME && len >= sizeof(HostLink_can_t)) {
+    HostLink_can_t c;
+    memcpy(&c, data, sizeof(c));
+    CAN_message_t msg;
+    msg.id = c.id;
+    msg.flags.extended = (c.flags & HOSTLINK_CAN_EXTENDED) ? 1 : 0;
+    msg.flags.remote = (c.flags & HOSTLINK_CAN_REMOTE) ? 1 : 0;
+    msg.len = (c.len > 8) ? 8 : c.len;
+    memcpy(msg.buf, c.buf, msg.len);
+    CanBus.write(msg);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);  // USB, the baud rate is ignored
+  hostLink.begin();
+  hostLink.onMessage(onHost);
+
+  CanBus.begin();
+  CanBus.setBaudRate(250000);
+  CanBus.enableFIFO();
+}
+
+void loop() {
+  hostLink.update();
+
+  // polled, not in an interrupt: HostLink is only safe from loop()
+  CAN_message_t msg;
+  while (CanBus.read(msg)) {
+    if (telemetry.process(msg)) {
+      if (VESC_CAN_PACKET(msg.id) != CAN_PACKET_STATUS) continue;
+      VESC_telemetry_t t;
+      HostLink_telemetry_t out;
+      telemetry.read(VESC_CAN_CONTROLLER(msg.id), t);
+      toHostTelemetry(t, out);
+      hostLink.send(HOSTLINK_TELEMETRY, out);
+      continue;
+    }
+    HostLink_can_t c;
+    memset(&c, 0, sizeof(c));
+    c.stamp_us = micros();
+    c.id = msg.id;
+    c.bus = 1;
+    c.flags = (msg.flags.extended ? HOSTLINK_CAN_EXTENDED : 0) | (msg.flags.remote ? HOSTLINK_CAN_REMOTE : 0);
+    c.len = msg.len;
+    memcpy(c.buf, msg.buf, 8);
+    hostLink.send(HOSTLINK_CAN_FRAME, c);
+  }
+
+  // host went quiet: stop the motors once
+  if (!stopped && micros() - lastSetpoint > setpointTimeout) {
+    VESC_telemetry_t all[8];
+    uint8_t n = telemetry.snapshot(all, 8);
+    for (uint8_t i = 0; i < n; i++) {
+      vesc.setControllerID(all[i].status.controller_id);
+      CanBus.write(vesc.setDuty(0));
+    }
+    stopped = true;
+  }
+
+  static uint32_t statusTimer = millis();
+  if (millis() - statusTimer >= 1000) {
+    statusTimer = millis();
+    hostLink.sendStatus();
+  }
+
+  hostLink.flush();
+}
@@ -0,0 +1,71 @@
+// VescPeriodic.cpp
+/*
+  Same duty ramp as VescDutyRamp.cpp, but the duty command is not sent
+  from loop(): lib/CanScheduler resends it every 10 ms from its timer
+  interrupt, loop() only changes the setpoint. A heartbeat frame (0x700,
+  counter in byte 0) goes out every 100 ms from a generator. Stopping
+  loop() (a long Serial print, a blocking read) no longer lets the VESC
+  time out. Send 'x' to stop commanding the VESC, the scheduler counters
+  are printed once a second.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+#include <CanScheduler.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBus;
+
+// VESC controller ID as set in VESC Tool (App Settings -> General -> VESC ID)
+VESC_controller vesc(1);
+int16_t dutyEntry = -1;
+
+float currentDuty = 0.0;
+const float targetDuty = 0.18;
+const float dutyStep = 0.005;
+const unsigned long rampDelay = 200;
+
+// runs in the scheduler interrupt when the heartbeat is due
+bool heartbeat(CAN_message_t &msg, void *arg) {
+  static uint8_t counter = 0;
+  msg.id = 0x700;
+  msg.len = 1;
+  msg.buf[0] = counter++;
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {}
+
+  CanBus.begin();
+  CanBus.setBaudRate(250000);
+  CanBus.enableFIFO();
+
+  canScheduler.addBus(CanBus);
+  dutyEntry = canScheduler.add(1, vesc.setDuty(0), 10000);   // 10 ms, well inside the VESC timeout
+  canScheduler.add(1, heartbeat, nullptr, 100000);
+  canScheduler.begin(1000);
+}
+
+void loop() {
+  static uint32_t rampTimer = millis();
+  if (millis() - rampTimer >= rampDelay) {
+    rampTimer = millis();
+    if (currentDuty < targetDuty) {
+      currentDuty += dutyStep;
+      if (currentDuty > targetDuty) currentDuty = targetDuty;
+    }
+    canScheduler.update(dutyEntry, vesc.setDuty(currentDuty));
+  }
+
+  if (Serial.available() && Serial.read() == 'x') canScheduler.disable(dutyEntry);
+
+  static uint32_t printTimer = millis();
+  if (millis() - printTimer >= 1000) {
+    printTimer = millis();
+    const CanScheduler_stats_t &s = canScheduler.stats();
+    const CanScheduler_entry_stats_t &d = canScheduler.entryStats(dutyEntry);
+    Serial.printf("sent %lu, late %lu (max %lu us), missed %lu, tick max %lu us; duty sent %lu missed %lu\n",
+                  s.sent, s.late, s.max_late_us, s.missed, s.max_tick_us, d.sent, d.missed);
+  }
+}
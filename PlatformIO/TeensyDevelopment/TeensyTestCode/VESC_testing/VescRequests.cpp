@@ -0,0 +1,82 @@
+// VescRequests.cpp
+/*
+  Asks every VESC at once instead of one at a time. Every 200 ms each
+  controller in vescIds gets a CAN_PACKET_PING, and a second request waits
+  for its next STATUS_4 (FET temperature). All of them are outstanding
+  together through lib/CanRequest, so four VESCs take as long as the
+  slowest one, not four timeouts in a row. Pongs all come back on our own
+  ID, pongFrom() tells them apart by the sender in the payload.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+#include <CanScheduler.h>
+#include <CanRequest.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+
+const uint8_t ownId = 254;
+const uint8_t vescIds[] = { 1, 2, 3, 4 };
+const uint8_t vescCount = sizeof(vescIds);
+
+CanRequest_t ping[vescCount];
+CanRequest_t temp[vescCount];
+
+bool pongFrom(const CanRequest_t &req, const CAN_message_t &msg) {
+  return msg.len && msg.buf[0] == *(const uint8_t*)req.arg;
+}
+
+// runs in the CAN interrupt
+void canRx(const CAN_message_t &msg) {
+  canRequest.process(msg);
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial);
+
+  can1.begin();
+  can1.setBaudRate(250000);
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(canRx);
+
+  for (uint8_t i = 0; i < vescCount; i++) {
+    ping[i].match = pongFrom;
+    ping[i].arg = (void*)&vescIds[i];
+  }
+  canScheduler.begin();
+}
+
+void loop() {
+  static uint32_t askTimer = millis();
+  if (millis() - askTimer < 200) return;
+  askTimer = millis();
+
+  // results of the last round, everything has timed out or answered by now
+  for (uint8_t i = 0; i < vescCount; i++) {
+    Serial.print("VESC "); Serial.print(vescIds[i]);
+    if (ping[i].state == CAN_REQUEST_DONE) { Serial.print("  ping "); Serial.print(ping[i].rtt_us); Serial.print(" us"); }
+    else if (ping[i].state == CAN_REQUEST_TIMEOUT) Serial.print("  no pong");
+    if (temp[i].state == CAN_REQUEST_DONE) {
+      VESC_status_t status;
+      vescDecodeStatus(temp[i].response, status);
+      Serial.print("  FET "); Serial.print(status.temp_fet); Serial.print(" C");
+    }
+    else if (temp[i].state == CAN_REQUEST_TIMEOUT) Serial.print("  no status");
+    Serial.println();
+  }
+
+  CAN_message_t msg;
+  msg.flags.extended = 1;
+  msg.len = 1;
+  msg.buf[0] = ownId;
+  for (uint8_t i = 0; i < vescCount; i++) {
+    msg.id = VESC_CAN_ID(CAN_PACKET_PING, vescIds[i]);
+    canRequest.send(can1, msg, ping[i], VESC_CAN_ID(CAN_PACKET_PONG, ownId), 20000);
+    canRequest.expect(temp[i], VESC_CAN_ID(CAN_PACKET_STATUS_4, vescIds[i]), 150000);
+  }
+
+  const CanRequest_stats_t &s = canRequest.stats();
+  Serial.printf("requests %lu, answered %lu, timeouts %lu, max rtt %lu us\n", s.sent, s.answered, s.timeouts, s.max_rtt_us);
+}
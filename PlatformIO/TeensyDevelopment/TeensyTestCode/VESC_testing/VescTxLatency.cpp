@@ -0,0 +1,86 @@
+// VescTxLatency.cpp
+/*
+  Command-to-wire latency per motor. Two VESCs get a duty command every
+  10 ms through write(msg, confirm); the transmit interrupt fills in the
+  confirmation with the hardware timestamp, and motorSent() adds it to
+  that motor's figures. Once a second loop() prints, per motor: time in the
+  TX queue, write() to the frame going on the bus (min/avg/max), and
+  roughly how many frames went ahead of it while it sat in its mailbox
+  (only those this node's interrupt saw, see CAN_tx_confirm_t). Run
+  CANBUS_load_generator on another node to see them grow.
+*/
+
+#include <FlexCAN_T4.h>
+#include <VescCAN.h>
+
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBus;
+
+struct Latency {
+  uint32_t frames = 0;
+  uint32_t queueMax = 0, latencyMin = UINT32_MAX, latencyMax = 0, latencySum = 0;
+  uint32_t framesAhead = 0;
+};
+
+struct Motor {
+  VESC_controller vesc;
+  CAN_tx_confirm_t confirm;
+  Latency latency;
+  uint32_t refused = 0;
+};
+
+Motor motors[2];
+
+// runs in the CAN interrupt when a duty frame is out
+void motorSent(const CAN_tx_confirm_t &confirm) {
+  Latency &l = ((Motor*)confirm.arg)->latency;
+  uint32_t latency = confirm.latencyUs();
+  l.frames++;
+  l.latencySum += latency;
+  if (latency < l.latencyMin) l.latencyMin = latency;
+  if (latency > l.latencyMax) l.latencyMax = latency;
+  if (confirm.queueUs() > l.queueMax) l.queueMax = confirm.queueUs();
+  l.framesAhead += confirm.frames_ahead;
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {}
+
+  CanBus.begin();
+  CanBus.setBaudRate(250000);
+  CanBus.enableFIFO();
+
+  for (uint8_t i = 0; i < 2; i++) {
+    motors[i].vesc.setControllerID(i + 1);
+    motors[i].confirm.callback = motorSent;
+    motors[i].confirm.arg = &motors[i];
+  }
+}
+
+void loop() {
+  static uint32_t sendTimer = micros();
+  if (micros() - sendTimer >= 10000) {
+    sendTimer += 10000;
+    for (uint8_t i = 0; i < 2; i++) {
+      // refused while the previous duty frame is still waiting for the bus, or bus off
+      if (CanBus.write(motors[i].vesc.setDuty(0.05), motors[i].confirm) <= 0) motors[i].refused++;
+    }
+  }
+
+  static uint32_t printTimer = millis();
+  if (millis() - printTimer >= 1000) {
+    printTimer = millis();
+    for (uint8_t i = 0; i < 2; i++) {
+      __disable_irq();
+      Latency l = motors[i].latency;
+      motors[i].latency = Latency();
+      __enable_irq();
+      if (!l.frames) {
+        Serial.printf("VESC %u: nothing sent, %lu writes refused\n", i + 1, motors[i].refused);
+        continue;
+      }
+      Serial.printf("VESC %u: %lu frames, queue max %lu us, write->wire %lu/%lu/%lu us, %lu frames ahead, %lu writes refused\n",
+                    i + 1, l.frames, l.queueMax, l.latencyMin, l.latencySum / l.frames, l.latencyMax, l.framesAhead, motors[i].refused);
+    }
+  }
+}
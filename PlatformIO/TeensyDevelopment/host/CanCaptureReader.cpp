@@ -0,0 +1,255 @@
+/*
+  CanCaptureReader.cpp
+  --------------------
+  See CanCaptureReader.h.
+*/
+
+#include "CanCaptureReader.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+bool CanCaptureReader::fail(const std::string &what) {
+  why = path + ": " + what;
+  close();
+  return 0;
+}
+
+bool CanCaptureReader::open(const char *file) {
+  close();
+  path = file;
+  int fd = ::open(file, O_RDONLY);
+  if ( fd < 0 ) return fail(strerror(errno));
+  struct stat st;
+  if ( fstat(fd, &st) < 0 ) {
+    ::close(fd);
+    return fail(strerror(errno));
+  }
+  length = st.st_size;
+  if ( length < sizeof(CanCapture_header_t) ) {
+    ::close(fd);
+    return fail("too short for a capture header");
+  }
+  void *m = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if ( m == MAP_FAILED ) return fail(strerror(errno));
+  map = (const uint8_t*)m;
+  head = (const CanCapture_header_t*)map;
+  if ( head->magic != CAN_CAPTURE_MAGIC ) return fail("not a CAN capture");
+  if ( head->version != CAN_CAPTURE_VERSION || head->header_size != sizeof(CanCapture_header_t) ) return fail("unsupported capture version");
+
+  fromTrailer = loadTrailer();
+  if ( !fromTrailer ) rebuild();
+
+  /* index order is write order; timestamps from several buses or a clock
+     step need not be monotonic across blocks, so search on running bounds */
+  size_t n = index.size();
+  maxLast.resize(n);
+  minFirst.resize(n);
+  total = 0;
+  for ( size_t i = 0; i < n; i++ ) {
+    maxLast[i] = ( i ) ? std::max(maxLast[i - 1], index[i].last_ns) : index[i].last_ns;
+    total += index[i].count;
+  }
+  for ( size_t i = n; i-- > 0; ) minFirst[i] = ( i + 1 < n ) ? std::min(minFirst[i + 1], index[i].first_ns) : index[i].first_ns;
+  madvise((void*)map, length, MADV_RANDOM); /* scan() jumps between blocks, no point reading ahead past them */
+  return 1;
+}
+
+void CanCaptureReader::close() {
+  if ( map ) munmap((void*)map, length);
+  map = nullptr;
+  head = nullptr;
+  index.clear();
+  maxLast.clear();
+  minFirst.clear();
+  total = 0;
+}
+
+bool CanCaptureReader::loadTrailer() {
+  if ( length < sizeof(CanCapture_header_t) + sizeof(CanCapture_trailer_t) ) return 0;
+  const CanCapture_trailer_t *t = (const CanCapture_trailer_t*)(map + length - sizeof(CanCapture_trailer_t));
+  if ( t->magic != CAN_CAPTURE_INDEX_MAGIC ) return 0;
+  uint64_t bytes = (uint64_t)t->count * sizeof(CanCapture_index_t);
+  if ( t->index_offset < sizeof(CanCapture_header_t) || t->index_offset + bytes + sizeof(CanCapture_trailer_t) != length ) return 0;
+  const CanCapture_index_t *e = (const CanCapture_index_t*)(map + t->index_offset);
+  for ( uint32_t i = 0; i < t->count; i++ ) {
+    if ( e[i].offset < sizeof(CanCapture_header_t) || e[i].offset + sizeof(CanCapture_block_t) > t->index_offset ) return 0;
+    if ( i && i + 1 < t->count ) continue; /* block headers are checked when scan() gets to them */
+    const CanCapture_block_t *b = (const CanCapture_block_t*)(map + e[i].offset);
+    if ( b->magic != CAN_CAPTURE_BLOCK_MAGIC || e[i].offset + b->size > t->index_offset ) return 0;
+  }
+  index.assign(e, e + t->count);
+  return 1;
+}
+
+/* a whole block header at at, with a sane size, and records matching its CRC if asked */
+bool CanCaptureReader::blockAt(uint64_t at, bool crc) const {
+  if ( at + sizeof(CanCapture_block_t) > length ) return 0;
+  const CanCapture_block_t *b = (const CanCapture_block_t*)(map + at);
+  if ( b->magic != CAN_CAPTURE_BLOCK_MAGIC || b->size < sizeof(CanCapture_block_t) || (b->size & 7) || at + b->size > length ) return 0;
+  return !crc || canCaptureCrc32(0, (const uint8_t*)(b + 1), b->size - sizeof(CanCapture_block_t)) == b->crc;
+}
+
+/* next good block at or after from, 0 if none; the writer goes on right after a short write, so not 8 byte aligned */
+uint64_t CanCaptureReader::findBlock(uint64_t from) const {
+  const uint8_t magic[4] = { (uint8_t)CAN_CAPTURE_BLOCK_MAGIC, (uint8_t)(CAN_CAPTURE_BLOCK_MAGIC >> 8),
+                             (uint8_t)(CAN_CAPTURE_BLOCK_MAGIC >> 16), (uint8_t)(CAN_CAPTURE_BLOCK_MAGIC >> 24) };
+  for ( uint64_t at = from; at + sizeof(CanCapture_block_t) <= length; at++ ) {
+    const uint8_t *p = (const uint8_t*)memchr(map + at, magic[0], length - at);
+    if ( !p ) break;
+    at = p - map;
+    if ( !memcmp(p, magic, sizeof(magic)) && blockAt(at, 1) ) return at;
+  }
+  return 0;
+}
+
+void CanCaptureReader::rebuild() {
+  /* hop header to header; each hop touches one page, not the records */
+  index.clear();
+  uint64_t at = sizeof(CanCapture_header_t);
+  while ( 1 ) {
+    if ( !blockAt(at, 0) ) {
+      /* no block where the last one said the next would be (or the end of
+         the file): the last one is torn if it fails its CRC, as a power loss
+         leaves the final block, and the next good block is somewhere after
+         its start; otherwise there is junk after it */
+      uint64_t from = at;
+      if ( !index.empty() && !blockAt(index.back().offset, 1) ) {
+        from = index.back().offset + 1;
+        index.pop_back();
+        counters.torn_blocks++;
+      }
+      else if ( at + sizeof(CanCapture_block_t) > length ) break;
+      at = findBlock(from);
+      if ( !at ) break;
+      continue;
+    }
+    const CanCapture_block_t *b = (const CanCapture_block_t*)(map + at);
+    CanCapture_index_t e;
+    memset(&e, 0, sizeof(e));
+    e.offset = at;
+    e.first_ns = b->first_ns;
+    e.last_ns = b->last_ns;
+    e.count = b->count;
+    e.bus_mask = b->bus_mask;
+    memcpy(e.id_bloom, b->id_bloom, sizeof(e.id_bloom));
+    index.push_back(e);
+    at += b->size;
+  }
+}
+
+uint64_t CanCaptureReader::firstNs() const {
+  return ( minFirst.empty() ) ? 0 : minFirst[0];
+}
+
+uint64_t CanCaptureReader::lastNs() const {
+  return ( maxLast.empty() ) ? 0 : maxLast.back();
+}
+
+void CanCaptureReader::seek(CanCaptureCursor &c, const CanCapture_query_t &q) const {
+  c.query = q;
+  c.ids.assign(q.ids, q.ids + q.id_count);
+  c.query.ids = nullptr; /* the caller's array need not outlive the cursor, next() uses c.ids */
+  c.keys.clear();
+  for ( uint32_t id : c.ids ) {
+    c.keys.push_back(canCaptureKey(id, 0));
+    c.keys.push_back(canCaptureKey(id, 1));
+  }
+  c.block = std::lower_bound(maxLast.begin(), maxLast.end(), q.from_ns) - maxLast.begin();
+  c.p = c.end = nullptr;
+  c.left = 0;
+}
+
+bool CanCaptureReader::next(CanCaptureCursor &c, const CanCapture_record_t *&record, const uint8_t *&data) {
+  if ( !map ) return 0;
+  const CanCapture_query_t &q = c.query;
+  while ( 1 ) {
+    while ( c.left && c.p + sizeof(CanCapture_record_t) <= c.end ) {
+      const CanCapture_record_t *r = (const CanCapture_record_t*)c.p;
+      c.p += canCaptureRecordSize(r->len);
+      c.left--;
+      if ( c.p > c.end ) break;
+      if ( r->stamp_ns < q.from_ns || r->stamp_ns > q.to_ns ) continue;
+      if ( r->bus < 8 && !(q.bus_mask & (1U << r->bus)) ) continue;
+      if ( c.ids.size() && std::find(c.ids.begin(), c.ids.end(), r->id) == c.ids.end() ) continue;
+      record = r;
+      data = (const uint8_t*)(r + 1);
+      return 1;
+    }
+    c.left = 0;
+
+    /* next block that can hold a match */
+    while ( 1 ) {
+      if ( c.block >= index.size() || minFirst[c.block] > q.to_ns ) return 0; /* nothing from here on is early enough */
+      const CanCapture_index_t &e = index[c.block++];
+      if ( e.last_ns < q.from_ns || e.first_ns > q.to_ns ) continue;
+      if ( !(e.bus_mask & q.bus_mask) ) {
+        counters.blocks_skipped++;
+        continue;
+      }
+      if ( c.keys.size() ) {
+        bool maybe = 0;
+        for ( uint32_t key : c.keys ) if ( canCaptureBloomHas(e.id_bloom, key) ) { maybe = 1; break; }
+        if ( !maybe ) {
+          counters.blocks_skipped++;
+          continue;
+        }
+      }
+      const CanCapture_block_t *b = (const CanCapture_block_t*)(map + e.offset);
+      if ( b->magic != CAN_CAPTURE_BLOCK_MAGIC || b->size < sizeof(CanCapture_block_t) || e.offset + b->size > length ) {
+        counters.bad_blocks++;
+        continue;
+      }
+      const uint8_t *p = (const uint8_t*)(b + 1), *end = map + e.offset + b->size;
+      if ( canCaptureCrc32(0, p, end - p) != b->crc ) {
+        counters.bad_blocks++;
+        continue;
+      }
+      counters.blocks_read++;
+      c.p = p;
+      c.end = end;
+      c.left = b->count;
+      break;
+    }
+  }
+}
+
+size_t CanCaptureReader::scan(const CanCapture_query_t &q, const CanCaptureHandler &handler) {
+  CanCaptureCursor c;
+  seek(c, q);
+  const CanCapture_record_t *r;
+  const uint8_t *data;
+  size_t passed = 0;
+  while ( next(c, r, data) ) {
+    passed++;
+    if ( !handler(*r, data) ) break;
+  }
+  return passed;
+}
+
+bool CanCaptureReader::writeIndex() {
+  if ( !map ) return 0;
+  if ( fromTrailer ) return 1;
+  /* anything after the last good block (a torn block) stays in the file, the index skips it */
+  int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+  if ( fd < 0 ) {
+    why = path + ": " + strerror(errno);
+    return 0;
+  }
+  CanCapture_trailer_t t;
+  memset(&t, 0, sizeof(t));
+  t.magic = CAN_CAPTURE_INDEX_MAGIC;
+  t.count = index.size();
+  t.index_offset = length;
+  t.frames = total;
+  size_t bytes = index.size() * sizeof(CanCapture_index_t);
+  bool ok = ( write(fd, index.data(), bytes) == (ssize_t)bytes ) && ( write(fd, &t, sizeof(t)) == (ssize_t)sizeof(t) );
+  if ( !ok ) why = path + ": " + strerror(errno);
+  ::close(fd);
+  return ok;
+}
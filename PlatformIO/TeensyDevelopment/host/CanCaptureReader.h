@@ -0,0 +1,99 @@
+/*
+  CanCaptureReader.h
+  ------------------
+  mmap reader for the .ccap files written by lib/CanCapture.
+
+      g++ -O2 -std=c++17 -I lib/CanCapture -c host/CanCaptureReader.cpp
+
+      CanCaptureReader cap;
+      cap.open("run.ccap");
+      CanCapture_query_t q;
+      q.from_ns = cap.firstNs() + 60000000000ULL;          // one minute in
+      q.to_ns = q.from_ns + 5000000000ULL;                 // five seconds of it
+      uint32_t ids[] = { 0x901, 0x902 };
+      q.ids = ids; q.id_count = 2;
+      cap.scan(q, [](const CanCapture_record_t &r, const uint8_t *data) { ...; return true; });
+
+  open() maps the file and loads the block index from the trailer, or
+  rebuilds it from the block headers if the capture was never closed,
+  skipping torn blocks left by short writes.
+  scan() narrows the blocks down by time with a binary search over the
+  index, drops the ones whose bus mask or ID bloom filter rules them out,
+  and only then touches records. The handler returns false to stop early.
+  seek()/next() do the same a record at a time, for merging several
+  captures (host/CanReplay).
+*/
+
+#if !defined(_CAN_CAPTURE_READER_H_)
+#define _CAN_CAPTURE_READER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "CanCaptureFormat.h"
+
+typedef struct CanCapture_query_t {
+  uint64_t from_ns = 0;          /* inclusive, record timestamps */
+  uint64_t to_ns = UINT64_MAX;   /* inclusive */
+  uint8_t bus_mask = 0xFF;       /* bit n: bus n */
+  const uint32_t *ids = nullptr; /* match STD or EXT frames with these IDs, all IDs if id_count is 0 */
+  size_t id_count = 0;
+} CanCapture_query_t;
+
+typedef struct CanCaptureReader_stats_t {
+  uint64_t blocks_read = 0;      /* blocks whose records were walked */
+  uint64_t blocks_skipped = 0;   /* in the time range but ruled out by bus mask or bloom filter */
+  uint64_t bad_blocks = 0;       /* CRC mismatch, skipped */
+  uint64_t torn_blocks = 0;      /* dropped while rebuilding the index, the rest of the file was resynced */
+} CanCaptureReader_stats_t;
+
+typedef std::function<bool(const CanCapture_record_t &record, const uint8_t *data)> CanCaptureHandler;
+
+/* position of a pull style scan, seek() then next() until it returns false */
+typedef struct CanCaptureCursor {
+  CanCapture_query_t query;
+  std::vector<uint32_t> ids;     /* copy of query.ids */
+  std::vector<uint32_t> keys;    /* bloom keys of ids, STD and EXT */
+  size_t block = 0;              /* next index entry to look at */
+  const uint8_t *p = nullptr, *end = nullptr;
+  uint32_t left = 0;             /* records not yet walked in the current block */
+} CanCaptureCursor;
+
+class CanCaptureReader {
+  public:
+    ~CanCaptureReader() { close(); }
+    bool open(const char *path);
+    void close();
+    const std::string& error() const { return why; }
+    const CanCapture_header_t& header() const { return *head; }
+    size_t blocks() const { return index.size(); }
+    uint64_t frames() const { return total; }
+    uint64_t firstNs() const;
+    uint64_t lastNs() const;
+    bool indexed() const { return fromTrailer; } /* 0: index rebuilt from block headers */
+    uint64_t size() const { return length; }
+    size_t scan(const CanCapture_query_t &q, const CanCaptureHandler &handler); /* records passed to the handler */
+    void seek(CanCaptureCursor &c, const CanCapture_query_t &q) const;
+    bool next(CanCaptureCursor &c, const CanCapture_record_t *&record, const uint8_t *&data); /* false at the end */
+    bool writeIndex(); /* append the rebuilt index and a trailer to an unclosed capture */
+    const CanCaptureReader_stats_t& stats() const { return counters; }
+
+  private:
+    bool fail(const std::string &what);
+    bool loadTrailer();
+    void rebuild();
+    bool blockAt(uint64_t at, bool crc) const;
+    uint64_t findBlock(uint64_t from) const;
+    std::string path, why;
+    const uint8_t *map = nullptr;
+    uint64_t length = 0;
+    const CanCapture_header_t *head = nullptr;
+    std::vector<CanCapture_index_t> index;
+    std::vector<uint64_t> maxLast;  /* largest last_ns of blocks 0..i, for the binary search */
+    std::vector<uint64_t> minFirst; /* smallest first_ns of blocks i..end */
+    uint64_t total = 0;
+    bool fromTrailer = 0;
+    CanCaptureReader_stats_t counters;
+};
+
+#endif
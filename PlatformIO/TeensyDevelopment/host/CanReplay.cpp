@@ -0,0 +1,406 @@
+/*
+  CanReplay.cpp
+  -------------
+  See CanReplay.h.
+*/
+
+#include "CanReplay.h"
+#include "CanCapture.h"
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+
+struct CanReplay::source_t {
+  CanCaptureReader reader;
+  CanCaptureCursor cursor;
+  uint8_t busMap[CAN_CAPTURE_BUSES];
+  int64_t shift = 0;             /* timeline = stamp + shift */
+  uint64_t last = 0;             /* timeline of the last record pulled */
+  uint64_t seq = 0;              /* records pulled, ties in the merge */
+  uint32_t number = 0;           /* order of addCapture() */
+  bool done = 0;
+};
+
+struct CanReplay::pending_t {
+  uint64_t t;
+  uint32_t source;
+  uint64_t seq;
+  bool expect;                   /* golden output, not sent */
+  CanReplay_frame_t frame;
+  bool operator>(const pending_t &o) const {
+    if ( t != o.t ) return t > o.t;
+    if ( source != o.source ) return source > o.source;
+    return seq > o.seq;
+  }
+};
+
+CanReplay::CanReplay() { ; }
+CanReplay::~CanReplay() { ; }
+
+bool CanReplay::fail(const std::string &what) {
+  why = what;
+  return 0;
+}
+
+uint64_t CanReplay::monotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t CanReplay::realtimeNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool CanReplay::inList(const std::vector<uint32_t> &list, uint32_t id) {
+  return std::find(list.begin(), list.end(), id) != list.end();
+}
+
+bool CanReplay::same(const CanReplay_frame_t &expected, const CanReplay_frame_t &observed, const CanReplay_options_t &opt) {
+  if ( expected.len != observed.len ) return 0;
+  if ( (expected.flags & CAN_CAPTURE_REMOTE) || inList(opt.ignore_data, expected.id) ) return 1;
+  return !memcmp(expected.data, observed.data, expected.len);
+}
+
+bool CanReplay::addCapture(const char *path, const uint8_t *bus_map) {
+  std::unique_ptr<source_t> s(new source_t);
+  if ( !s->reader.open(path) ) return fail(s->reader.error());
+  for ( uint8_t b = 0; b < CAN_CAPTURE_BUSES; b++ ) s->busMap[b] = ( bus_map ) ? bus_map[b] : b;
+  s->number = sources.size();
+  sources.push_back(std::move(s));
+  return 1;
+}
+
+bool CanReplay::setGolden(const char *path) {
+  CanCaptureReader check;
+  if ( !check.open(path) ) return fail(check.error());
+  goldenPath = path;
+  return 1;
+}
+
+bool CanReplay::loadGolden(const CanReplay_options_t &opt) {
+  CanCaptureReader cap;
+  if ( !cap.open(goldenPath.c_str()) ) return fail(cap.error());
+  CanCapture_query_t q;
+  q.from_ns = opt.from_ns;
+  q.to_ns = ( opt.to_ns < UINT64_MAX - opt.settle_ns ) ? opt.to_ns + opt.settle_ns : UINT64_MAX;
+  cap.scan(q, [&](const CanCapture_record_t &r, const uint8_t *data) {
+    if ( r.flags & CAN_CAPTURE_FD ) return true;
+    CanReplay_frame_t f;
+    f.t = r.stamp_ns;
+    f.bus = r.bus;
+    f.flags = r.flags & (CAN_CAPTURE_EXTENDED | CAN_CAPTURE_REMOTE);
+    f.id = r.id;
+    f.len = ( r.len > 8 ) ? 8 : r.len;
+    memset(f.data, 0, sizeof(f.data));
+    memcpy(f.data, data, f.len);
+    golden.push_back(f);
+    return true;
+  });
+  std::stable_sort(golden.begin(), golden.end(), [](const CanReplay_frame_t &a, const CanReplay_frame_t &b) { return a.t < b.t; });
+  return 1;
+}
+
+bool CanReplay::pull(source_t &s, const CanReplay_options_t &opt, std::vector<pending_t> &heap) {
+  const CanCapture_record_t *r;
+  const uint8_t *data;
+  while ( s.reader.next(s.cursor, r, data) ) {
+    uint64_t t = (uint64_t)((int64_t)r->stamp_ns + s.shift);
+    s.last = std::max(s.last, t);
+    uint8_t bus = ( r->bus < CAN_CAPTURE_BUSES ) ? s.busMap[r->bus] : 0xFF;
+    if ( bus == 0xFF ) continue;
+    bool expect = ( (r->flags & CAN_CAPTURE_TX) && !opt.replay_tx ) || inList(opt.dut_ids, r->id);
+    if ( !expect && opt.ids.size() && !inList(opt.ids, r->id) ) continue; /* the cursor also lets dut_ids through */
+    if ( !expect && t > opt.to_ns ) break; /* answers before the first frame past the window are still expected */
+    if ( r->flags & CAN_CAPTURE_FD ) {
+      counters.skipped_fd++;
+      continue;
+    }
+    pending_t p;
+    p.t = t;
+    p.source = s.number;
+    p.seq = s.seq++;
+    p.expect = expect;
+    p.frame.t = t;
+    p.frame.bus = bus;
+    p.frame.flags = r->flags & (CAN_CAPTURE_EXTENDED | CAN_CAPTURE_REMOTE);
+    p.frame.id = r->id;
+    p.frame.len = ( r->len > 8 ) ? 8 : r->len;
+    memset(p.frame.data, 0, sizeof(p.frame.data));
+    memcpy(p.frame.data, data, p.frame.len);
+    heap.push_back(p);
+    std::push_heap(heap.begin(), heap.end(), std::greater<pending_t>());
+    return 1;
+  }
+  s.done = 1;
+  return 0;
+}
+
+void CanReplay::drain(CanReplayPort &port) {
+  CAN_message_t msg;
+  uint64_t ns;
+  while ( port.receive(msg, ns) ) {
+    if ( !ns ) ns = realtimeNs();
+    CanReplay_frame_t f;
+    /* back onto the timeline, stretched by the replay speed */
+    double since = ( ns > startRealtime ) ? (double)(ns - startRealtime) : 0;
+    f.t = baseT + (uint64_t)(since * (( speedUsed > 0 ) ? speedUsed : 1));
+    f.bus = msg.bus;
+    f.flags = (( msg.flags.extended ) ? CAN_CAPTURE_EXTENDED : 0) | (( msg.flags.remote ) ? CAN_CAPTURE_REMOTE : 0);
+    f.id = msg.id;
+    f.len = ( msg.len > 8 ) ? 8 : msg.len;
+    memcpy(f.data, msg.buf, sizeof(f.data));
+    observed.push_back(f);
+    counters.received++;
+  }
+}
+
+bool CanReplay::run(CanReplayPort &port, const CanReplay_options_t &opt) {
+  counters = CanReplay_stats_t();
+  golden.clear();
+  observed.clear();
+  speedUsed = opt.speed;
+  if ( sources.empty() ) return fail("no captures to replay");
+  if ( goldenPath.size() && !loadGolden(opt) ) return 0;
+
+  /* timeline origin: wall clock if every capture has one, else each starts at its own first frame */
+  bool wall = 1;
+  for ( auto &s : sources ) if ( !s->reader.header().start_ns ) wall = 0;
+  uint64_t origin = UINT64_MAX;
+  if ( wall ) for ( auto &s : sources ) origin = std::min(origin, s->reader.header().start_ns + s->reader.firstNs());
+  std::vector<uint32_t> cursorIds = opt.ids;
+  if ( cursorIds.size() ) cursorIds.insert(cursorIds.end(), opt.dut_ids.begin(), opt.dut_ids.end());
+  std::vector<pending_t> heap;
+  for ( auto &s : sources ) {
+    s->shift = ( wall ) ? (int64_t)(s->reader.header().start_ns - origin) : -(int64_t)s->reader.firstNs();
+    CanCapture_query_t q;
+    q.from_ns = ( (int64_t)opt.from_ns - s->shift > 0 ) ? (uint64_t)((int64_t)opt.from_ns - s->shift) : 0;
+    /* answers to the last frames of a window come after it, read on for those (see pull()) */
+    uint64_t to = ( opt.to_ns < UINT64_MAX - opt.settle_ns ) ? opt.to_ns + opt.settle_ns : UINT64_MAX;
+    if ( to != UINT64_MAX ) q.to_ns = ( (int64_t)to - s->shift > 0 ) ? (uint64_t)((int64_t)to - s->shift) : 0;
+    q.bus_mask = opt.bus_mask;
+    q.ids = cursorIds.data();
+    q.id_count = cursorIds.size();
+    s->reader.seek(s->cursor, q);
+    s->last = 0;
+    s->seq = 0;
+    s->done = 0;
+    pull(*s, opt, heap);
+  }
+
+  bool started = 0;
+  uint64_t startMono = 0, lastT = 0;
+  while ( 1 ) {
+    /* pop only once every capture is reorder_ns past the earliest pending frame */
+    while ( 1 ) {
+      source_t *behind = nullptr;
+      for ( auto &s : sources ) if ( !s->done && (!behind || s->last < behind->last) ) behind = s.get();
+      if ( !behind || (heap.size() && behind->last > heap.front().t + opt.reorder_ns) ) break;
+      pull(*behind, opt, heap);
+    }
+    if ( heap.empty() ) break;
+    std::pop_heap(heap.begin(), heap.end(), std::greater<pending_t>());
+    pending_t p = heap.back();
+    heap.pop_back();
+    if ( p.expect ) {
+      if ( goldenPath.empty() ) golden.push_back(p.frame);
+      counters.expected++;
+      continue;
+    }
+
+    if ( !started ) {
+      started = 1;
+      baseT = p.t;
+      startMono = monotonicNs();
+      startRealtime = realtimeNs();
+    }
+    lastT = p.t;
+    uint64_t due = startMono;
+    if ( opt.speed > 0 ) {
+      due += (uint64_t)((p.t - baseT) / opt.speed);
+      for ( uint64_t now = monotonicNs(); now < due; now = monotonicNs() ) {
+        drain(port);
+        port.service();
+        if ( due - now > 300000 ) {
+          /* sleep to 200 us before, at most 1 ms at a time to keep receiving */
+          uint64_t wake = std::min(due - 200000, now + 1000000);
+          struct timespec ts = { (time_t)(wake / 1000000000ULL), (long)(wake % 1000000000ULL) };
+          clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+        }
+      }
+    }
+
+    CAN_message_t msg;
+    msg.id = p.frame.id;
+    msg.flags.extended = ( p.frame.flags & CAN_CAPTURE_EXTENDED ) ? 1 : 0;
+    msg.flags.remote = ( p.frame.flags & CAN_CAPTURE_REMOTE ) ? 1 : 0;
+    msg.len = p.frame.len;
+    msg.bus = p.frame.bus;
+    memcpy(msg.buf, p.frame.data, 8);
+    bool sent = 1;
+    uint64_t refused = 0;
+    while ( !port.send(p.frame.bus, msg) ) {
+      uint64_t now = monotonicNs();
+      if ( !refused ) {
+        refused = now;
+        counters.port_full++;
+      }
+      else if ( now - refused > 1000000000ULL ) {
+        counters.dropped++;
+        sent = 0;
+        break;
+      }
+      port.service();
+      drain(port);
+    }
+    if ( !sent ) continue;
+    counters.frames++;
+    if ( opt.speed > 0 ) {
+      uint64_t now = monotonicNs();
+      uint64_t late = ( now > due ) ? now - due : 0;
+      counters.sum_late_ns += late;
+      counters.max_late_ns = std::max(counters.max_late_ns, late);
+      if ( late > opt.late_ns ) counters.late++;
+      uint8_t bucket = 0;
+      for ( uint64_t us = late / 1000; us && bucket < 23; us >>= 1 ) bucket++;
+      counters.late_hist[bucket]++;
+    }
+  }
+
+  /* let the device under test answer the last frames */
+  if ( started ) {
+    uint64_t until = monotonicNs() + opt.settle_ns;
+    while ( monotonicNs() < until ) {
+      port.service();
+      drain(port);
+      struct timespec ts = { 0, 1000000 };
+      nanosleep(&ts, nullptr);
+    }
+    counters.duration_ns = monotonicNs() - startMono;
+    counters.timeline_ns = lastT - baseT;
+  }
+  if ( recordPath.size() && !writeRecord() ) return 0;
+  return 1;
+}
+
+bool CanReplay::writeRecord() {
+  FILE *f = fopen(recordPath.c_str(), "wb");
+  if ( !f ) return fail(recordPath + ": " + strerror(errno));
+  CanCaptureFile sink(f);
+  std::unique_ptr<CanCapture<CanCaptureFile>> out(new CanCapture<CanCaptureFile>(sink));
+  out->begin(0);
+  for ( const CanReplay_frame_t &o : observed ) out->add(o.bus, o.id, o.flags, o.data, o.len, o.t);
+  bool ok = out->end();
+  if ( fclose(f) || !ok ) return fail(recordPath + ": write failed");
+  return 1;
+}
+
+CanReplay_compare_t CanReplay::compare(const CanReplay_options_t &opt) const {
+  CanReplay_compare_t c;
+  bool timed = ( speedUsed > 0 );
+  auto key = [](const CanReplay_frame_t &f) {
+    return ((uint64_t)f.bus << 40) | ((uint64_t)(f.flags & (CAN_CAPTURE_EXTENDED | CAN_CAPTURE_REMOTE)) << 32) | f.id;
+  };
+  std::vector<CanReplay_mismatch_t> notes;
+  auto note = [&](uint8_t kind, const CanReplay_frame_t *e, const CanReplay_frame_t *o) {
+    CanReplay_mismatch_t m;
+    memset(&m, 0, sizeof(m));
+    m.kind = kind;
+    if ( e ) m.expected = *e;
+    if ( o ) m.observed = *o;
+    notes.push_back(m);
+  };
+  /* each bus/ID/type on its own: the firmware's order between IDs is not fixed */
+  std::map<uint64_t, std::pair<std::vector<const CanReplay_frame_t*>, std::vector<const CanReplay_frame_t*>>> streams;
+  for ( const CanReplay_frame_t &g : golden ) streams[key(g)].first.push_back(&g);
+  for ( const CanReplay_frame_t &o : observed ) streams[key(o)].second.push_back(&o);
+  c.expected = golden.size();
+  double sum = 0;
+  /* within tolerance of each other, or any two frames when not timed */
+  auto inTime = [&](const CanReplay_frame_t *e, const CanReplay_frame_t *o) {
+    return !timed || (e->t <= o->t + opt.tolerance_ns && o->t <= e->t + opt.tolerance_ns);
+  };
+  for ( auto &kv : streams ) {
+    std::vector<const CanReplay_frame_t*> &exp = kv.second.first, &obs = kv.second.second;
+    size_t i = 0, j = 0;
+    while ( i < exp.size() && j < obs.size() ) {
+      const CanReplay_frame_t *e = exp[i], *o = obs[j];
+      if ( timed && e->t + opt.tolerance_ns < o->t ) {
+        c.missing++;
+        note(CAN_REPLAY_MISSING, e, nullptr);
+        i++;
+        continue;
+      }
+      if ( timed && o->t + opt.tolerance_ns < e->t ) {
+        c.unexpected++;
+        note(CAN_REPLAY_UNEXPECTED, nullptr, o);
+        j++;
+        continue;
+      }
+      if ( !same(*e, *o, opt) ) {
+        /* a skipped or an extra frame would shift every later pair onto the
+           wrong payload: look a few frames ahead on both sides for this one */
+        size_t skip = 0, extra = 0;
+        for ( size_t k = 1; k <= 16 && i + k < exp.size() && inTime(exp[i + k], o); k++ ) if ( same(*exp[i + k], *o, opt) ) { skip = k; break; }
+        for ( size_t k = 1; !skip && k <= 16 && j + k < obs.size() && inTime(e, obs[j + k]); k++ ) if ( same(*e, *obs[j + k], opt) ) { extra = k; break; }
+        if ( skip ) {
+          for ( ; skip; skip--, i++ ) {
+            c.missing++;
+            note(CAN_REPLAY_MISSING, exp[i], nullptr);
+          }
+          continue;
+        }
+        if ( extra ) {
+          for ( ; extra; extra--, j++ ) {
+            c.unexpected++;
+            note(CAN_REPLAY_UNEXPECTED, nullptr, obs[j]);
+          }
+          continue;
+        }
+        c.data_mismatch++;
+        note(CAN_REPLAY_DATA, e, o);
+      }
+      else c.matched++;
+      if ( timed ) {
+        int64_t offset = (int64_t)o->t - (int64_t)e->t;
+        if ( c.matched + c.data_mismatch == 1 ) c.min_offset_ns = c.max_offset_ns = offset;
+        c.min_offset_ns = std::min(c.min_offset_ns, offset);
+        c.max_offset_ns = std::max(c.max_offset_ns, offset);
+        sum += offset;
+      }
+      i++;
+      j++;
+    }
+    for ( ; i < exp.size(); i++ ) {
+      c.missing++;
+      note(CAN_REPLAY_MISSING, exp[i], nullptr);
+    }
+    for ( ; j < obs.size(); j++ ) {
+      c.unexpected++;
+      note(CAN_REPLAY_UNEXPECTED, nullptr, obs[j]);
+    }
+  }
+  if ( timed && c.matched + c.data_mismatch ) c.mean_offset_ns = sum / (c.matched + c.data_mismatch);
+  /* the earliest ones are the interesting ones */
+  auto when = [](const CanReplay_mismatch_t &m) { return ( m.kind == CAN_REPLAY_UNEXPECTED ) ? m.observed.t : m.expected.t; };
+  std::stable_sort(notes.begin(), notes.end(), [&](const CanReplay_mismatch_t &a, const CanReplay_mismatch_t &b) { return when(a) < when(b); });
+  if ( notes.size() > 32 ) notes.resize(32);
+  c.first = notes;
+  return c;
+}
+
+uint64_t CanReplay::latePercentileNs(double p) const {
+  uint64_t total = 0;
+  for ( uint64_t n : counters.late_hist ) total += n;
+  if ( !total ) return 0;
+  uint64_t want = (uint64_t)(p / 100.0 * total + 0.5), seen = 0;
+  for ( uint8_t b = 0; b < 24; b++ ) {
+    seen += counters.late_hist[b];
+    if ( seen >= want && seen ) return (1ULL << b) * 1000ULL;
+  }
+  return counters.max_late_ns;
+}
@@ -0,0 +1,158 @@
+/*
+  CanReplay.h
+  -----------
+  Plays .ccap captures (lib/CanCapture) back onto CAN buses, so a recorded
+  driving session can be rerun against the firmware without VESCs on the
+  bench. Frames go out through a CanReplayPort: host/canreplay.cpp uses
+  the SocketCAN FlexCAN_T4 (vcan, or a USB adapter wired to a Teensy), a
+  test that links firmware code on the PC implements the port itself and
+  hands the frames to the firmware's onReceive() handlers.
+
+      g++ -O2 -std=c++17 -I lib/CanCapture -I host/include -c host/CanReplay.cpp host/CanCaptureReader.cpp
+
+      CanReplay replay;
+      replay.addCapture("run.ccap");
+      CanReplay_options_t opt;
+      opt.speed = 1;                        // 0: as fast as the port takes them
+      opt.dut_ids = { 0x901, 0x902 };       // what the firmware sends, expected not replayed
+      replay.run(port, opt);
+      replay.compare(opt);                  // firmware output against the capture
+
+  Timeline: every frame gets a time in ns from the start of the replay.
+  Captures with a wall clock (header.start_ns) are merged on it, others
+  start at their own first frame. Frames from all captures and buses are
+  merged in time order (ties by capture, then file order), with
+  reorder_ns of look ahead for loggers that wrote buses slightly out of
+  order, so the same captures and options always give the same frame
+  sequence.
+
+  Timing: speed 1 sends each frame at its recorded time on CLOCK_MONOTONIC
+  (sleep, then spin the last 200 us) and records how late it went out,
+  speed 0 sends back to back. A port that refuses a frame (queue full) is
+  serviced and retried, frames are never reordered or dropped unless the
+  port stays full for a second.
+
+  Golden output: frames the logging node sent (CAN_CAPTURE_TX), frames with
+  dut_ids, or a separate capture given to setGolden() (stamps are timeline
+  ns, which is what record() writes) are the expected output. compare()
+  matches what the port received against them per bus and ID in order,
+  within tolerance_ns of the expected time when replaying at original
+  speed.
+*/
+
+#if !defined(_CAN_REPLAY_H_)
+#define _CAN_REPLAY_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "FlexCAN_T4.h"
+#include "CanCaptureReader.h"
+
+class CanReplayPort {
+  public:
+    virtual ~CanReplayPort() { ; }
+    virtual bool send(uint8_t bus, const CAN_message_t &msg) = 0; /* false: no room, retried after service() */
+    virtual bool receive(CAN_message_t &msg, uint64_t &ns) = 0;   /* a frame from the bus, msg.bus set, ns on CLOCK_REALTIME or 0 for now */
+    virtual void service() { ; }                                  /* called while waiting, events() etc. */
+};
+
+typedef struct CanReplay_options_t {
+  double speed = 1.0;            /* 1 original timing, 2 twice as fast, 0 as fast as possible */
+  uint64_t from_ns = 0;          /* window on the timeline */
+  uint64_t to_ns = UINT64_MAX;   /* expected output is taken up to settle_ns past it */
+  uint8_t bus_mask = 0xFF;       /* capture buses to replay, bit n: bus n */
+  std::vector<uint32_t> ids;     /* replay only these IDs (STD or EXT), all if empty; also limits the expected frames to ids + dut_ids */
+  std::vector<uint32_t> dut_ids; /* sent by the device under test: not replayed, expected back */
+  bool replay_tx = 0;            /* also send CAN_CAPTURE_TX frames instead of expecting them */
+  uint64_t reorder_ns = 50000000;   /* merge look ahead */
+  uint64_t late_ns = 1000000;       /* a frame sent later than this counts as late */
+  uint64_t settle_ns = 200000000;   /* keep receiving after the last frame */
+  uint64_t tolerance_ns = 50000000; /* compare(): expected time window at speed > 0 */
+  std::vector<uint32_t> ignore_data; /* compare(): IDs checked for presence and length only */
+} CanReplay_options_t;
+
+typedef struct CanReplay_stats_t {
+  uint64_t frames = 0;           /* sent */
+  uint64_t expected = 0;         /* taken out of the replay as golden output */
+  uint64_t received = 0;         /* from the port */
+  uint64_t port_full = 0;        /* frames the port refused at least once */
+  uint64_t dropped = 0;          /* refused for a second, given up */
+  uint64_t skipped_fd = 0;       /* CAN FD frames, the port is classic CAN */
+  uint64_t late = 0;             /* sent more than late_ns after their time */
+  uint64_t max_late_ns = 0;
+  uint64_t sum_late_ns = 0;
+  uint64_t late_hist[24] = { 0 }; /* bucket n: lateness below 2^n us */
+  uint64_t duration_ns = 0;      /* wall time of run() */
+  uint64_t timeline_ns = 0;      /* timeline span replayed */
+} CanReplay_stats_t;
+
+typedef struct CanReplay_frame_t {
+  uint64_t t;                    /* timeline ns */
+  uint8_t bus;
+  uint8_t flags;                 /* CAN_CAPTURE_* */
+  uint8_t len;
+  uint32_t id;
+  uint8_t data[8];
+} CanReplay_frame_t;
+
+typedef struct CanReplay_mismatch_t {
+  uint8_t kind;                  /* CAN_REPLAY_* */
+  CanReplay_frame_t expected;    /* unused for CAN_REPLAY_UNEXPECTED */
+  CanReplay_frame_t observed;    /* unused for CAN_REPLAY_MISSING */
+} CanReplay_mismatch_t;
+
+#define CAN_REPLAY_MISSING 0
+#define CAN_REPLAY_UNEXPECTED 1
+#define CAN_REPLAY_DATA 2
+
+typedef struct CanReplay_compare_t {
+  uint64_t expected = 0;
+  uint64_t matched = 0;          /* same bus, ID, type and payload */
+  uint64_t data_mismatch = 0;    /* matched by bus and ID, payload or length differs */
+  uint64_t missing = 0;          /* expected, never seen (in time) */
+  uint64_t unexpected = 0;       /* seen, not expected */
+  int64_t min_offset_ns = 0;     /* observed minus expected time of matched frames, speed > 0 */
+  int64_t max_offset_ns = 0;
+  double mean_offset_ns = 0;
+  std::vector<CanReplay_mismatch_t> first; /* the first mismatches, up to 32 */
+} CanReplay_compare_t;
+
+class CanReplay {
+  public:
+    CanReplay();
+    ~CanReplay();
+    bool addCapture(const char *path, const uint8_t *bus_map = nullptr); /* bus_map[capture bus] = port bus, 0xFF drops it */
+    bool setGolden(const char *path);
+    void record(const char *path) { recordPath = path; } /* write the received frames as a capture (timeline ns) after run() */
+    const std::string& error() const { return why; }
+    bool run(CanReplayPort &port, const CanReplay_options_t &opt);
+    CanReplay_compare_t compare(const CanReplay_options_t &opt) const;
+    const CanReplay_stats_t& stats() const { return counters; }
+    uint64_t latePercentileNs(double p) const; /* from late_hist, upper bucket bound */
+    const std::vector<CanReplay_frame_t>& received() const { return observed; }
+
+  private:
+    struct source_t;
+    struct pending_t;
+    bool fail(const std::string &what);
+    bool pull(source_t &s, const CanReplay_options_t &opt, std::vector<pending_t> &heap);
+    bool loadGolden(const CanReplay_options_t &opt);
+    bool writeRecord();
+    void drain(CanReplayPort &port);
+    static uint64_t monotonicNs();
+    static uint64_t realtimeNs();
+    static bool inList(const std::vector<uint32_t> &list, uint32_t id);
+    static bool same(const CanReplay_frame_t &expected, const CanReplay_frame_t &observed, const CanReplay_options_t &opt);
+
+    std::vector<std::unique_ptr<source_t>> sources;
+    std::string goldenPath, recordPath, why;
+    std::vector<CanReplay_frame_t> golden;   /* expected output, timeline order */
+    std::vector<CanReplay_frame_t> observed; /* what the port received */
+    double speedUsed = 0;
+    uint64_t baseT = 0;            /* timeline ns of the first frame sent */
+    uint64_t startRealtime = 0;    /* CLOCK_REALTIME when it was sent */
+    CanReplay_stats_t counters;
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*
+  HostLinkPort.cpp
+  ----------------
+  See HostLinkPort.h.
+*/
+
+#include "HostLinkPort.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+
+#define HOSTLINK_CRC_SIZE 2
+
+bool HostLinkPort::open(const char *path) {
+  int f = ::open(path, O_RDWR | O_NOCTTY);
+  if ( f < 0 ) return 0;
+  struct termios tio;
+  if ( !tcgetattr(f, &tio) ) {
+    cfmakeraw(&tio); /* USB CDC ignores the baud rate, raw mode keeps the tty from eating 0x00, ^C, \r */
+    tcsetattr(f, TCSANOW, &tio);
+    tcflush(f, TCIFLUSH);
+  }
+  return attach(f);
+}
+
+bool HostLinkPort::attach(int f) {
+  close();
+  fd = f;
+  txLen = 0;
+  rxLen = 0;
+  rxOverflow = 0;
+  rxSynced = 0;
+  return fd >= 0;
+}
+
+void HostLinkPort::close() {
+  if ( fd >= 0 ) ::close(fd);
+  fd = -1;
+}
+
+bool HostLinkPort::send(uint8_t type, const void *data, uint8_t len) {
+  if ( sizeof(HostLink_header_t) + 2 + len + HOSTLINK_CRC_SIZE > HOSTLINK_MAX_PAYLOAD ) return 0;
+  if ( txLen && txLen + 2 + len + HOSTLINK_CRC_SIZE > HOSTLINK_MAX_PAYLOAD && !flush() ) return 0;
+  if ( !txLen ) {
+    HostLink_header_t h = { HOSTLINK_VERSION, 0, txSeq++ };
+    memcpy(txPayload, &h, sizeof(h));
+    txLen = sizeof(h);
+  }
+  txPayload[txLen++] = type;
+  txPayload[txLen++] = len;
+  memcpy(txPayload + txLen, data, len);
+  txLen += len;
+  return 1;
+}
+
+bool HostLinkPort::flush() {
+  if ( fd < 0 ) return 0;
+  if ( !txLen ) return 1;
+  uint16_t crc = hostLinkCrc16(txPayload, txLen);
+  txPayload[txLen++] = (uint8_t)crc;
+  txPayload[txLen++] = (uint8_t)(crc >> 8);
+  uint8_t frame[HOSTLINK_FRAME_SIZE];
+  size_t len = hostLinkCobsEncode(txPayload, txLen, frame);
+  frame[len++] = 0;
+  txLen = 0;
+  const uint8_t *p = frame;
+  while ( len ) {
+    ssize_t n = write(fd, p, len);
+    if ( n < 0 && errno == EINTR ) continue;
+    if ( n <= 0 ) return 0;
+    p += n;
+    len -= n;
+  }
+  counters.tx_frames++;
+  return 1;
+}
+
+int HostLinkPort::poll(int timeout_ms, const HostLinkHandler &handler) {
+  if ( fd < 0 ) return -1;
+  struct pollfd p = { fd, POLLIN, 0 };
+  int r = ::poll(&p, 1, timeout_ms);
+  if ( r < 0 ) return ( errno == EINTR ) ? 0 : -1;
+  if ( !r ) return 0;
+  uint8_t buf[4096];
+  ssize_t n = read(fd, buf, sizeof(buf));
+  if ( n <= 0 ) return ( n < 0 && (errno == EINTR || errno == EAGAIN) ) ? 0 : -1;
+  rxRecords = 0;
+  for ( ssize_t i = 0; i < n; i++ ) {
+    uint8_t c = buf[i];
+    if ( !c ) {
+      if ( rxOverflow ) counters.framing_errors++;
+      else if ( rxLen ) handleFrame(handler);
+      rxLen = 0;
+      rxOverflow = 0;
+    }
+    else if ( rxOverflow ) continue;
+    else if ( rxLen >= sizeof(rxFrame) ) rxOverflow = 1;
+    else rxFrame[rxLen++] = c;
+  }
+  return rxRecords;
+}
+
+void HostLinkPort::handleFrame(const HostLinkHandler &handler) {
+  uint8_t payload[HOSTLINK_FRAME_SIZE];
+  size_t len = hostLinkCobsDecode(rxFrame, rxLen, payload);
+  if ( len < sizeof(HostLink_header_t) + HOSTLINK_CRC_SIZE || len > HOSTLINK_MAX_PAYLOAD ) {
+    counters.framing_errors++;
+    return;
+  }
+  len -= HOSTLINK_CRC_SIZE;
+  uint16_t crc = payload[len] | ((uint16_t)payload[len + 1] << 8);
+  if ( crc != hostLinkCrc16(payload, len) ) {
+    counters.crc_errors++;
+    return;
+  }
+  HostLink_header_t h;
+  memcpy(&h, payload, sizeof(h));
+  if ( h.version != HOSTLINK_VERSION ) {
+    counters.framing_errors++;
+    return;
+  }
+  if ( rxSynced ) counters.rx_lost += (uint16_t)(h.seq - rxSeq - 1);
+  rxSeq = h.seq;
+  rxSynced = 1;
+  counters.rx_frames++;
+
+  size_t i = sizeof(h);
+  while ( i + 2 <= len ) {
+    uint8_t type = payload[i], size = payload[i + 1];
+    i += 2;
+    if ( i + size > len ) {
+      counters.framing_errors++;
+      return;
+    }
+    counters.rx_records++;
+    rxRecords++;
+    if ( handler ) handler(type, payload + i, size);
+    i += size;
+  }
+}
@@ -0,0 +1,70 @@
+/*
+  HostLinkPort.h
+  --------------
+  PC side of lib/HostLink: the Teensy's binary USB serial link.
+
+      g++ -O2 -std=c++17 -I lib/HostLink -c host/HostLinkPort.cpp
+
+  Example (VESC_CMD_DUTY from lib/VescCAN/VescCAN.h):
+
+      HostLinkPort link;
+      link.open("/dev/ttyACM0");
+      HostLink_setpoint_t sp = { 1, VESC_CMD_DUTY, 0, 18000 };   // 18 % duty on VESC 1
+      link.send(HOSTLINK_SETPOINT, sp);
+      link.flush();                                            // one frame, one USB packet
+      link.poll(1, [](uint8_t type, const uint8_t *data, uint8_t len) { ... });
+
+  send() batches records like the firmware side does; flush() writes the
+  frame and only blocks if the kernel's tty buffer is full. poll() waits up
+  to timeout_ms for data, then decodes every complete frame that has
+  arrived and calls the handler once per record.
+*/
+
+#if !defined(_HOST_LINK_PORT_H_)
+#define _HOST_LINK_PORT_H_
+
+#include <functional>
+#include "HostLinkFormat.h"
+
+typedef std::function<void(uint8_t type, const uint8_t *data, uint8_t len)> HostLinkHandler;
+
+typedef struct HostLinkPort_stats_t {
+  uint64_t rx_frames = 0;
+  uint64_t rx_records = 0;
+  uint64_t rx_lost = 0;        /* gaps in the Teensy's frame seq */
+  uint64_t crc_errors = 0;
+  uint64_t framing_errors = 0;
+  uint64_t tx_frames = 0;
+} HostLinkPort_stats_t;
+
+class HostLinkPort {
+  public:
+    ~HostLinkPort() { close(); }
+    bool open(const char *path);   /* tty in raw mode, or any readable/writable fd path */
+    bool attach(int fd);           /* already open fd (pipe, socket, pty) */
+    void close();
+    bool send(uint8_t type, const void *data, uint8_t len);
+    template<typename T> bool send(uint8_t type, const T &record) {
+      static_assert(sizeof(T) <= 255, "HostLink records are at most 255 bytes");
+      return send(type, &record, sizeof(T));
+    }
+    bool flush();
+    int poll(int timeout_ms, const HostLinkHandler &handler); /* records handled, -1 on error or EOF */
+    const HostLinkPort_stats_t& stats() const { return counters; }
+
+  private:
+    void handleFrame(const HostLinkHandler &handler);
+    int fd = -1;
+    uint8_t txPayload[HOSTLINK_MAX_PAYLOAD];
+    uint16_t txLen = 0;
+    uint16_t txSeq = 0;
+    uint8_t rxFrame[HOSTLINK_FRAME_SIZE];
+    uint16_t rxLen = 0;
+    bool rxOverflow = 0;
+    uint16_t rxSeq = 0;
+    bool rxSynced = 0;
+    int rxRecords = 0;
+    HostLinkPort_stats_t counters;
+};
+
+#endif
@@ -0,0 +1,406 @@
+/*
+  cancap.cpp
+  ----------
+  Command line tool for .ccap CAN captures (lib/CanCapture).
+
+      g++ -O2 -std=c++17 -I lib/CanCapture -I host/include host/cancap.cpp host/CanCaptureReader.cpp -o cancap
+
+      ./cancap info run.ccap
+      ./cancap dump run.ccap [--from s] [--to s] [--id 901,902] [--bus 1]   candump -L log on stdout
+      ./cancap asc run.ccap [same filters] > run.asc                        Vector ASC on stdout
+      ./cancap import candump-2026-10-19.log run.ccap                       candump -L or .asc in
+      ./cancap reindex run.ccap                                             add the index to an unclosed capture
+
+  --from/--to are seconds from the first frame, --id takes hex IDs and
+  matches STD and EXT frames, --bus is the FlexCAN bus number (1..3).
+  Time and ID filters use the block index, so a few seconds out of an hour
+  long capture only reads the blocks that hold them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include "CanCapture.h"
+#include "CanCaptureReader.h"
+
+static const uint8_t fdLengths[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+static uint8_t dlcOf(uint8_t len) {
+  for ( uint8_t dlc = 0; dlc < 16; dlc++ ) if ( fdLengths[dlc] >= len ) return dlc;
+  return 15;
+}
+
+static std::string busName(const CanCapture_header_t &h, uint8_t bus) {
+  if ( bus < CAN_CAPTURE_BUSES && h.bus_name[bus][0] ) return std::string(h.bus_name[bus], strnlen(h.bus_name[bus], sizeof(h.bus_name[bus])));
+  return "can" + std::to_string(( bus ) ? bus - 1 : 0); /* FlexCAN CAN1 is can0 on the host */
+}
+
+static bool parseQuery(int argc, char **argv, const CanCaptureReader &cap, CanCapture_query_t &q, std::vector<uint32_t> &ids) {
+  for ( int i = 3; i < argc; i++ ) {
+    std::string opt = argv[i];
+    if ( i + 1 >= argc ) return 0;
+    const char *value = argv[++i];
+    if ( opt == "--from" ) q.from_ns = cap.firstNs() + (uint64_t)(atof(value) * 1e9);
+    else if ( opt == "--to" ) q.to_ns = cap.firstNs() + (uint64_t)(atof(value) * 1e9);
+    else if ( opt == "--bus" ) q.bus_mask = (uint8_t)(1U << (atoi(value) & 7));
+    else if ( opt == "--id" ) {
+      std::stringstream list(value);
+      for ( std::string id; std::getline(list, id, ','); ) ids.push_back(strtoul(id.c_str(), nullptr, 16));
+    }
+    else return 0;
+  }
+  q.ids = ids.data();
+  q.id_count = ids.size();
+  return 1;
+}
+
+static void printScanStats(const CanCaptureReader &cap, size_t frames) {
+  const CanCaptureReader_stats_t &s = cap.stats();
+  fprintf(stderr, "%zu frames, %llu of %zu blocks read, %llu skipped by bus/ID, %llu bad\n", frames,
+          (unsigned long long)s.blocks_read, cap.blocks(), (unsigned long long)s.blocks_skipped, (unsigned long long)s.bad_blocks);
+}
+
+static int info(CanCaptureReader &cap) {
+  const CanCapture_header_t &h = cap.header();
+  double span = (cap.lastNs() - cap.firstNs()) / 1e9;
+  printf("%llu frames in %zu blocks, %.3f s, %llu bytes (%s)\n", (unsigned long long)cap.frames(), cap.blocks(), span,
+         (unsigned long long)cap.size(), ( cap.indexed() ) ? "indexed" : "no index, rebuilt from block headers");
+  if ( h.start_ns ) {
+    time_t t = (time_t)((h.start_ns + cap.firstNs()) / 1000000000ULL);
+    printf("first frame %s", ctime(&t));
+  }
+  /* per bus counts, one pass over the records */
+  uint64_t perBus[CAN_CAPTURE_BUSES] = { 0 }, remote = 0, fd = 0, tx = 0;
+  CanCapture_query_t q;
+  cap.scan(q, [&](const CanCapture_record_t &r, const uint8_t*) {
+    if ( r.bus < CAN_CAPTURE_BUSES ) perBus[r.bus]++;
+    remote += ( r.flags & CAN_CAPTURE_REMOTE ) ? 1 : 0;
+    fd += ( r.flags & CAN_CAPTURE_FD ) ? 1 : 0;
+    tx += ( r.flags & CAN_CAPTURE_TX ) ? 1 : 0;
+    return true;
+  });
+  for ( uint8_t b = 0; b < CAN_CAPTURE_BUSES; b++ ) {
+    if ( perBus[b] ) printf("  bus %u (%s): %llu frames, %.1f fps\n", b, busName(h, b).c_str(), (unsigned long long)perBus[b], ( span > 0 ) ? perBus[b] / span : 0.0);
+  }
+  printf("  %llu remote, %llu CAN FD, %llu sent by the logger\n", (unsigned long long)remote, (unsigned long long)fd, (unsigned long long)tx);
+  if ( cap.stats().bad_blocks ) printf("  %llu blocks failed their CRC\n", (unsigned long long)cap.stats().bad_blocks);
+  if ( cap.stats().torn_blocks ) printf("  %llu torn blocks skipped (short writes)\n", (unsigned long long)cap.stats().torn_blocks);
+  return 0;
+}
+
+static int dump(CanCaptureReader &cap, const CanCapture_query_t &q) {
+  const CanCapture_header_t &h = cap.header();
+  std::vector<std::string> names;
+  for ( uint8_t b = 0; b < CAN_CAPTURE_BUSES; b++ ) names.push_back(busName(h, b));
+  size_t n = cap.scan(q, [&](const CanCapture_record_t &r, const uint8_t *data) {
+    uint64_t ns = h.start_ns + r.stamp_ns;
+    char line[256];
+    int at = snprintf(line, sizeof(line), "(%010llu.%06llu) %s ", (unsigned long long)(ns / 1000000000ULL),
+                      (unsigned long long)(ns % 1000000000ULL / 1000), names[r.bus & 7].c_str());
+    at += snprintf(line + at, sizeof(line) - at, ( r.flags & CAN_CAPTURE_EXTENDED ) ? "%08X#" : "%03X#", (unsigned)r.id);
+    if ( r.flags & CAN_CAPTURE_FD ) at += snprintf(line + at, sizeof(line) - at, "#%X", (( r.flags & CAN_CAPTURE_BRS ) ? 1 : 0) | (( r.flags & CAN_CAPTURE_ESI ) ? 2 : 0));
+    if ( r.flags & CAN_CAPTURE_REMOTE ) at += snprintf(line + at, sizeof(line) - at, "R");
+    else for ( uint8_t i = 0; i < r.len; i++ ) at += snprintf(line + at, sizeof(line) - at, "%02X", data[i]);
+    puts(line);
+    return true;
+  });
+  printScanStats(cap, n);
+  return 0;
+}
+
+static int asc(CanCaptureReader &cap, const CanCapture_query_t &q) {
+  const CanCapture_header_t &h = cap.header();
+  /* the date line only has milliseconds: the time base is the first frame
+     rounded down to one, and the rest stays in the frame times, so an
+     import gets the absolute times back to the microsecond */
+  uint64_t first = h.start_ns + cap.firstNs();
+  uint64_t base = first - first % 1000000ULL;
+  time_t wall = (time_t)(base / 1000000000ULL);
+  char clock[32], year[16], date[64];
+  strftime(clock, sizeof(clock), "%a %b %d %I:%M:%S", localtime(&wall));
+  strftime(year, sizeof(year), "%p %Y", localtime(&wall));
+  snprintf(date, sizeof(date), "%s.%03u %s", clock, (unsigned)(base / 1000000ULL % 1000), year);
+  printf("date %s\nbase hex  timestamps absolute\ninternal events logged\n// version 9.0.0\n", date);
+  printf("Begin Triggerblock %s\n   0.000000 Start of measurement\n", date);
+  size_t n = cap.scan(q, [&](const CanCapture_record_t &r, const uint8_t *data) {
+    uint64_t ns = h.start_ns + r.stamp_ns;
+    double t = ( ns >= base ) ? (ns - base) / 1e9 : 0;
+    char id[16];
+    snprintf(id, sizeof(id), ( r.flags & CAN_CAPTURE_EXTENDED ) ? "%Xx" : "%X", (unsigned)r.id);
+    const char *dir = ( r.flags & CAN_CAPTURE_TX ) ? "Tx" : "Rx";
+    if ( r.flags & CAN_CAPTURE_FD ) {
+      printf("%11.6f CANFD %3u %s %8s %32s %u %u %x %2u", t, r.bus, dir, id, "", ( r.flags & CAN_CAPTURE_BRS ) ? 1 : 0,
+             ( r.flags & CAN_CAPTURE_ESI ) ? 1 : 0, dlcOf(r.len), r.len);
+      for ( uint8_t i = 0; i < r.len; i++ ) printf(" %02X", data[i]);
+      printf(" %8u %4u %8X %8u %8u %8u %8u %8u\n", 0, 0, 0x1000 | (( r.flags & CAN_CAPTURE_BRS ) ? 0x2000 : 0), 0, 0, 0, 0, 0);
+    }
+    else if ( r.flags & CAN_CAPTURE_REMOTE ) printf("%11.6f %-2u %-15s %s   r %x\n", t, r.bus, id, dir, r.len);
+    else {
+      printf("%11.6f %-2u %-15s %s   d %x", t, r.bus, id, dir, r.len);
+      for ( uint8_t i = 0; i < r.len; i++ ) printf(" %02X", data[i]);
+      printf("\n");
+    }
+    return true;
+  });
+  printf("End TriggerBlock\n");
+  printScanStats(cap, n);
+  return 0;
+}
+
+static bool hexBytes(const std::string &s, uint8_t *out, uint8_t &len, uint8_t max) {
+  if ( s.size() & 1 || s.size() / 2 > max ) return 0;
+  len = s.size() / 2;
+  for ( uint8_t i = 0; i < len; i++ ) {
+    char *end;
+    std::string byte = s.substr(i * 2, 2);
+    out[i] = (uint8_t)strtoul(byte.c_str(), &end, 16);
+    if ( *end ) return 0;
+  }
+  return 1;
+}
+
+typedef CanCapture<CanCaptureFile> host_capture_t;
+
+/* "(1760868000.123456) can0 123#DEADBEEF", also R, ## (CAN FD) and an optional trailing direction */
+static bool importCandumpLine(const std::string &line, host_capture_t &out, std::vector<std::string> &names) {
+  std::istringstream words(line);
+  std::string stamp, iface, frame;
+  if ( !(words >> stamp >> iface >> frame) || stamp.size() < 3 || stamp[0] != '(' ) return 0;
+  size_t dot = stamp.find('.');
+  if ( dot == std::string::npos ) return 0;
+  uint64_t sec = strtoull(stamp.c_str() + 1, nullptr, 10);
+  std::string frac = stamp.substr(dot + 1, stamp.size() - dot - 2);
+  frac.resize(9, '0');
+  uint64_t ns = sec * 1000000000ULL + strtoull(frac.c_str(), nullptr, 10);
+
+  size_t hash = frame.find('#');
+  if ( hash == std::string::npos || (hash != 3 && hash != 8) ) return 0;
+  uint8_t flags = ( hash == 8 ) ? CAN_CAPTURE_EXTENDED : 0;
+  uint32_t id = strtoul(frame.substr(0, hash).c_str(), nullptr, 16);
+  std::string rest = frame.substr(hash + 1);
+  uint8_t data[64], len = 0;
+  if ( rest.size() && rest[0] == '#' ) {
+    if ( rest.size() < 2 ) return 0;
+    uint8_t fdFlags = (uint8_t)strtoul(rest.substr(1, 1).c_str(), nullptr, 16);
+    flags |= CAN_CAPTURE_FD | (( fdFlags & 1 ) ? CAN_CAPTURE_BRS : 0) | (( fdFlags & 2 ) ? CAN_CAPTURE_ESI : 0);
+    if ( !hexBytes(rest.substr(2), data, len, 64) ) return 0;
+  }
+  else if ( rest.size() && rest[0] == 'R' ) {
+    flags |= CAN_CAPTURE_REMOTE;
+    len = ( rest.size() > 1 ) ? (uint8_t)atoi(rest.c_str() + 1) : 0;
+  }
+  else {
+    size_t underscore = rest.find('_'); /* raw DLC > 8 suffix, not kept */
+    if ( !hexBytes(rest.substr(0, underscore), data, len, 8) ) return 0;
+  }
+  std::string dir;
+  if ( (words >> dir) && dir == "T" ) flags |= CAN_CAPTURE_TX;
+
+  size_t bus = 0;
+  while ( bus < names.size() && names[bus] != iface ) bus++;
+  if ( bus == names.size() ) names.push_back(iface);
+  return out.add((uint8_t)(bus + 1), id, flags, data, len, ns); /* buses numbered like FlexCAN CAN1.. */
+}
+
+static bool parseAscDate(const std::string &line, uint64_t &ns) {
+  /* "date Mon Oct 19 10:00:00.000 am 2026" */
+  std::istringstream words(line);
+  std::string word, wday, mon, day, clock, ampm, year;
+  words >> word >> wday >> mon >> day >> clock >> ampm >> year;
+  if ( year.empty() ) { year = ampm; ampm.clear(); } /* 24 hour form */
+  static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_mon = -1;
+  for ( int i = 0; i < 12; i++ ) if ( mon == months[i] ) tm.tm_mon = i;
+  int ms = 0;
+  if ( tm.tm_mon < 0 || sscanf(clock.c_str(), "%d:%d:%d.%d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &ms) < 3 ) return 0;
+  if ( (ampm == "pm" || ampm == "PM") && tm.tm_hour < 12 ) tm.tm_hour += 12;
+  if ( (ampm == "am" || ampm == "AM") && tm.tm_hour == 12 ) tm.tm_hour = 0;
+  tm.tm_mday = atoi(day.c_str());
+  tm.tm_year = atoi(year.c_str()) - 1900;
+  tm.tm_isdst = -1;
+  time_t t = mktime(&tm);
+  if ( t < 0 ) return 0;
+  ns = (uint64_t)t * 1000000000ULL + (uint64_t)ms * 1000000ULL;
+  return 1;
+}
+
+/* classic "t ch id Rx d dlc bytes" / "t ch id Rx r" and "t CANFD ch dir id [name] brs esi dlc len bytes ..." */
+static bool importAscLine(const std::string &line, host_capture_t &out, uint64_t start_ns, bool hex, bool relative, double &last) {
+  std::istringstream words(line);
+  std::vector<std::string> w;
+  for ( std::string word; words >> word; ) w.push_back(word);
+  if ( w.size() < 4 ) return 0;
+  char *end;
+  double t = strtod(w[0].c_str(), &end);
+  if ( *end ) return 0;
+  if ( relative ) t += last;
+  last = t;
+  uint64_t ns = start_ns + (uint64_t)(t * 1e9 + 0.5);
+  int base = ( hex ) ? 16 : 10;
+  uint8_t flags = 0, data[64], len = 0;
+  size_t at;
+  unsigned channel;
+  std::string id;
+  if ( w[1] == "CANFD" ) {
+    if ( w.size() < 9 ) return 0;
+    channel = atoi(w[2].c_str());
+    if ( w[3] == "Tx" ) flags |= CAN_CAPTURE_TX;
+    id = w[4];
+    at = 5;
+    if ( w[at] != "0" && w[at] != "1" ) at++; /* symbolic name */
+    if ( at + 4 > w.size() ) return 0;
+    flags |= CAN_CAPTURE_FD | (( w[at] == "1" ) ? CAN_CAPTURE_BRS : 0) | (( w[at + 1] == "1" ) ? CAN_CAPTURE_ESI : 0);
+    len = (uint8_t)strtoul(w[at + 3].c_str(), nullptr, 10);
+    at += 4;
+  }
+  else {
+    channel = strtoul(w[1].c_str(), &end, 10);
+    if ( *end || w.size() < 5 || (w[3] != "Rx" && w[3] != "Tx") ) return 0; /* error frames, statistics, events */
+    id = w[2];
+    if ( w[3] == "Tx" ) flags |= CAN_CAPTURE_TX;
+    if ( w[4] == "r" ) {
+      flags |= CAN_CAPTURE_REMOTE;
+      len = ( w.size() > 5 ) ? (uint8_t)strtoul(w[5].c_str(), nullptr, 16) : 0;
+      at = w.size();
+    }
+    else if ( w[4] == "d" && w.size() > 5 ) {
+      len = (uint8_t)strtoul(w[5].c_str(), nullptr, 16);
+      if ( len > 8 ) len = 8;
+      at = 6;
+    }
+    else return 0;
+  }
+  if ( id.size() && (id.back() == 'x' || id.back() == 'X') ) {
+    flags |= CAN_CAPTURE_EXTENDED;
+    id.pop_back();
+  }
+  if ( len > 64 ) return 0;
+  if ( !(flags & CAN_CAPTURE_REMOTE) ) {
+    if ( at + len > w.size() ) return 0;
+    for ( uint8_t i = 0; i < len; i++ ) data[i] = (uint8_t)strtoul(w[at + i].c_str(), nullptr, base);
+  }
+  return out.add((uint8_t)channel, strtoul(id.c_str(), nullptr, base), flags, data, len, ns);
+}
+
+static int import(const char *in, const char *outPath) {
+  std::ifstream file(in);
+  if ( !file ) {
+    perror(in);
+    return 1;
+  }
+  std::string tmp = std::string(outPath) + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "wb");
+  if ( !f ) {
+    perror(tmp.c_str());
+    return 1;
+  }
+  CanCaptureFile sink(f);
+  host_capture_t *out = new host_capture_t(sink);
+  std::vector<std::string> names;
+  std::string line;
+  uint64_t skipped = 0, lineNo = 0;
+  bool isAsc = 0, hex = 1, relative = 0, started = 0;
+  uint64_t ascStart = 0;
+  double last = 0;
+  while ( std::getline(file, line) ) {
+    lineNo++;
+    if ( !line.empty() && line.back() == '\r' ) line.pop_back();
+    if ( !started ) {
+      /* candump lines start with '(', ASC files with a "date" header */
+      if ( line.compare(0, 5, "date ") == 0 ) {
+        isAsc = 1;
+        parseAscDate(line, ascStart);
+        out->begin(0);
+        started = 1;
+        continue;
+      }
+      if ( line.empty() ) continue;
+      out->begin(0); /* candump stamps are unix time already */
+      started = 1;
+    }
+    if ( isAsc ) {
+      if ( line.compare(0, 5, "base ") == 0 ) {
+        hex = ( line.find("hex") != std::string::npos );
+        relative = ( line.find("relative") != std::string::npos );
+        continue;
+      }
+      if ( !importAscLine(line, *out, ascStart, hex, relative, last) ) skipped++;
+    }
+    else if ( !importCandumpLine(line, *out, names) ) skipped++;
+  }
+  if ( !started ) out->begin(0);
+  bool ok = out->end();
+  uint32_t frames = out->stats().frames, blocks = out->stats().blocks;
+  delete out;
+  if ( fclose(f) || !ok ) {
+    perror(tmp.c_str());
+    remove(tmp.c_str());
+    return 1;
+  }
+  /* candump interface names go into the header, which was written before they were known */
+  if ( names.size() ) {
+    FILE *patch = fopen(tmp.c_str(), "r+b");
+    CanCapture_header_t h;
+    if ( patch && fread(&h, sizeof(h), 1, patch) == 1 ) {
+      for ( size_t i = 0; i < names.size() && i + 1 < CAN_CAPTURE_BUSES; i++ ) strncpy(h.bus_name[i + 1], names[i].c_str(), sizeof(h.bus_name[i + 1]) - 1);
+      fseek(patch, 0, SEEK_SET);
+      fwrite(&h, sizeof(h), 1, patch);
+    }
+    if ( patch ) fclose(patch);
+    if ( names.size() + 1 > CAN_CAPTURE_BUSES ) fprintf(stderr, "more than %d interfaces, the rest share bus numbers\n", CAN_CAPTURE_BUSES - 1);
+  }
+  if ( rename(tmp.c_str(), outPath) ) {
+    perror(outPath);
+    return 1;
+  }
+  fprintf(stderr, "%u frames in %u blocks from %llu lines (%llu not frames)\n", frames, blocks, (unsigned long long)lineNo, (unsigned long long)skipped);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if ( argc < 3 ) {
+    fprintf(stderr, "usage: %s info|dump|asc|reindex <capture.ccap> [--from s] [--to s] [--id hex,...] [--bus n]\n"
+                    "       %s import <candump.log|file.asc> <capture.ccap>\n", argv[0], argv[0]);
+    return 2;
+  }
+  std::string cmd = argv[1];
+  if ( cmd == "import" ) {
+    if ( argc != 4 ) return 2;
+    return import(argv[2], argv[3]);
+  }
+  CanCaptureReader cap;
+  if ( !cap.open(argv[2]) ) {
+    fprintf(stderr, "%s\n", cap.error().c_str());
+    return 1;
+  }
+  CanCapture_query_t q;
+  std::vector<uint32_t> ids;
+  if ( !parseQuery(argc, argv, cap, q, ids) ) {
+    fprintf(stderr, "bad option\n");
+    return 2;
+  }
+  if ( cmd == "info" ) return info(cap);
+  if ( cmd == "dump" ) return dump(cap, q);
+  if ( cmd == "asc" ) return asc(cap, q);
+  if ( cmd == "reindex" ) {
+    if ( cap.indexed() ) {
+      fprintf(stderr, "%s already has an index\n", argv[2]);
+      return 0;
+    }
+    if ( !cap.writeIndex() ) {
+      fprintf(stderr, "%s\n", cap.error().c_str());
+      return 1;
+    }
+    fprintf(stderr, "index of %zu blocks written\n", cap.blocks());
+    return 0;
+  }
+  fprintf(stderr, "unknown command %s\n", argv[1]);
+  return 2;
+}
@@ -0,0 +1,230 @@
+/*
+  candb_gen.cpp
+  -------------
+  Turns a .candb message database into a header of constexpr message and
+  signal definitions for lib/CanDB/CanDB.h.
+
+      g++ -O2 host/candb_gen.cpp -o candb_gen
+      ./candb_gen lib/CanDB/minirob.candb lib/CanDB/MiniRobDB.h
+
+  The format is described at the top of lib/CanDB/minirob.candb. Errors are
+  reported as file:line and nothing is written, so a bad edit cannot leave
+  a half generated header behind.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+
+struct Signal {
+  std::string name, unit;
+  unsigned start = 0, length = 0;
+  bool big = 0, isSigned = 0;
+  double scale = 1, offset = 0;
+};
+
+struct Message {
+  std::string name;
+  uint32_t id = 0;
+  bool extended = 0, rx = 0;
+  unsigned dlc = 0, nodeBits = 0;
+  std::vector<Signal> signals;
+};
+
+static std::string path;
+static unsigned lineNo = 0;
+
+static void fail(const char *what, const std::string &detail = "") {
+  fprintf(stderr, "%s:%u: %s%s%s\n", path.c_str(), lineNo, what, detail.empty() ? "" : ": ", detail.c_str());
+  exit(1);
+}
+
+static bool validName(const std::string &s) {
+  if ( s.empty() || isdigit((unsigned char)s[0]) ) return 0;
+  for ( char c : s ) if ( !isalnum((unsigned char)c) && c != '_' ) return 0;
+  return 1;
+}
+
+static unsigned parseUnsigned(const std::string &s, const char *what) {
+  char *end;
+  unsigned long v = strtoul(s.c_str(), &end, 0);
+  if ( s.empty() || *end ) fail(what, s);
+  return (unsigned)v;
+}
+
+static double parseDouble(const std::string &s, const char *what) {
+  char *end;
+  double v = strtod(s.c_str(), &end);
+  if ( s.empty() || *end ) fail(what, s);
+  return v;
+}
+
+/* shortest literal that reads back as the same float */
+static std::string floatLiteral(double v) {
+  char buf[32];
+  for ( int precision = 1; precision < 10; precision++ ) {
+    snprintf(buf, sizeof(buf), "%.*g", precision, v);
+    if ( (float)strtod(buf, nullptr) == (float)v ) break;
+  }
+  std::string s = buf;
+  if ( s.find_first_of(".e") == std::string::npos ) s += ".0";
+  return s + "f";
+}
+
+static void checkSignal(const Message &m, const Signal &s) {
+  static const char *reserved[] = { "ID", "NODE_MASK", "EXTENDED", "DLC", "id", "node", "match", "init" };
+  if ( !validName(s.name) ) fail("bad signal name", s.name);
+  for ( const char *r : reserved ) if ( s.name == r ) fail("signal name is used by the message struct", s.name);
+  for ( const Signal &o : m.signals ) if ( o.name == s.name ) fail("duplicate signal", s.name);
+  if ( s.length < 1 || s.length > 32 ) fail("signal length must be 1..32", s.name);
+  unsigned first = s.start >> 3, last = (s.start + s.length - 1) >> 3;
+  if ( last >= m.dlc ) fail("signal does not fit in the message DLC", s.name);
+  if ( ((s.start & 7) + s.length > 64) || (last - first) > 7 ) fail("signal spans more than 8 bytes", s.name);
+  if ( s.scale == 0 ) fail("scale cannot be 0", s.name);
+}
+
+static std::vector<Message> parse(std::istream &in, std::string &database) {
+  std::vector<Message> messages;
+  std::string line;
+  while ( std::getline(in, line) ) {
+    lineNo++;
+    size_t hash = line.find('#');
+    if ( hash != std::string::npos ) line.erase(hash);
+    std::istringstream words(line);
+    std::vector<std::string> w;
+    for ( std::string word; words >> word; ) w.push_back(word);
+    if ( w.empty() ) continue;
+
+    if ( w[0] == "database" ) {
+      if ( w.size() != 2 || !validName(w[1]) ) fail("expected: database <NAME>");
+      database = w[1];
+    }
+    else if ( w[0] == "message" ) {
+      if ( w.size() != 6 && !(w.size() == 8 && w[6] == "node") ) fail("expected: message <NAME> <id> <std|ext> <dlc> <rx|tx> [node <bits>]");
+      Message m;
+      m.name = w[1];
+      if ( !validName(m.name) ) fail("bad message name", m.name);
+      for ( const Message &o : messages ) if ( o.name == m.name ) fail("duplicate message", m.name);
+      m.id = parseUnsigned(w[2], "bad id");
+      if ( w[3] != "std" && w[3] != "ext" ) fail("frame type must be std or ext", w[3]);
+      m.extended = ( w[3] == "ext" );
+      if ( m.id > (m.extended ? 0x1FFFFFFFu : 0x7FFu) ) fail("id out of range", w[2]);
+      m.dlc = parseUnsigned(w[4], "bad dlc");
+      if ( m.dlc > 8 ) fail("dlc must be 0..8", w[4]);
+      if ( w[5] != "rx" && w[5] != "tx" ) fail("direction must be rx or tx", w[5]);
+      m.rx = ( w[5] == "rx" );
+      if ( w.size() == 8 ) {
+        m.nodeBits = parseUnsigned(w[7], "bad node bits");
+        if ( m.nodeBits < 1 || m.nodeBits > 8 ) fail("node bits must be 1..8", w[7]);
+        if ( m.id & ((1u << m.nodeBits) - 1) ) fail("node bits of the id must be 0", w[2]);
+      }
+      messages.push_back(m);
+    }
+    else if ( w[0] == "signal" ) {
+      if ( messages.empty() ) fail("signal before any message");
+      if ( w.size() != 8 && w.size() != 9 ) fail("expected: signal <name> <start> <length> <big|little> <signed|unsigned> <scale> <offset> [unit]");
+      Signal s;
+      s.name = w[1];
+      s.start = parseUnsigned(w[2], "bad start bit");
+      s.length = parseUnsigned(w[3], "bad length");
+      if ( w[4] != "big" && w[4] != "little" ) fail("byte order must be big or little", w[4]);
+      s.big = ( w[4] == "big" );
+      if ( w[5] != "signed" && w[5] != "unsigned" ) fail("sign must be signed or unsigned", w[5]);
+      s.isSigned = ( w[5] == "signed" );
+      s.scale = parseDouble(w[6], "bad scale");
+      s.offset = parseDouble(w[7], "bad offset");
+      if ( w.size() == 9 ) s.unit = w[8];
+      checkSignal(messages.back(), s);
+      messages.back().signals.push_back(s);
+    }
+    else fail("unknown keyword", w[0]);
+  }
+  if ( database.empty() ) fail("missing database line");
+  return messages;
+}
+
+static void emit(FILE *out, const std::string &database, const std::vector<Message> &messages, const std::string &source) {
+  std::string guard = "_" + database + "_DB_H_";
+  fprintf(out, "/*\n  Generated by host/candb_gen.cpp from %s, do not edit.\n*/\n\n", source.c_str());
+  fprintf(out, "#if !defined(%s)\n#define %s\n\n#include \"CanDB.h\"\n", guard.c_str(), guard.c_str());
+
+  for ( const Message &m : messages ) {
+    uint32_t nodeMask = ( m.nodeBits ) ? ((1u << m.nodeBits) - 1) : 0;
+    fprintf(out, "\nstruct %s {\n", m.name.c_str());
+    fprintf(out, "  static constexpr uint32_t ID = 0x%lX;\n", (unsigned long)m.id);
+    fprintf(out, "  static constexpr uint32_t NODE_MASK = 0x%lX;\n", (unsigned long)nodeMask);
+    fprintf(out, "  static constexpr bool EXTENDED = %d;\n", m.extended);
+    fprintf(out, "  static constexpr uint8_t DLC = %u;\n", m.dlc);
+    fprintf(out, "  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }\n");
+    fprintf(out, "  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }\n");
+    fprintf(out, "  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }\n");
+    fprintf(out, "  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }\n");
+    fprintf(out, "  static inline void init(CAN_message_t &msg, uint8_t node = 0) {\n");
+    fprintf(out, "    msg = CAN_message_t();\n    msg.id = id(node);\n    msg.flags.extended = EXTENDED;\n    msg.len = DLC;\n  }\n");
+    for ( const Signal &s : m.signals ) {
+      fprintf(out, "  struct %s : CANDB_signal<%u, %u, %s, %s> {", s.name.c_str(), s.start, s.length,
+              s.big ? "CANDB_BIG" : "CANDB_LITTLE", s.isSigned ? "CANDB_SIGNED" : "CANDB_UNSIGNED");
+      if ( !s.unit.empty() ) fprintf(out, " /* %s */", s.unit.c_str());
+      fprintf(out, "\n");
+      std::string scale = floatLiteral(s.scale), inverse = floatLiteral(1.0 / s.scale);
+      if ( s.offset == 0 ) {
+        fprintf(out, "    static constexpr float decode(const uint8_t *buf) { return get(buf) * %s; }\n", scale.c_str());
+        fprintf(out, "    static constexpr raw_t raw(float value) { return (raw_t)(value * %s); }\n", inverse.c_str());
+      }
+      else {
+        std::string offset = floatLiteral(s.offset);
+        fprintf(out, "    static constexpr float decode(const uint8_t *buf) { return get(buf) * %s + %s; }\n", scale.c_str(), offset.c_str());
+        fprintf(out, "    static constexpr raw_t raw(float value) { return (raw_t)((value - %s) * %s); }\n", offset.c_str(), inverse.c_str());
+      }
+      fprintf(out, "    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }\n");
+      fprintf(out, "  };\n");
+    }
+    fprintf(out, "};\n");
+  }
+
+  unsigned rxCount = 0;
+  for ( const Message &m : messages ) rxCount += m.rx;
+  fprintf(out, "\n/* receive filters, node bits masked out */\n");
+  fprintf(out, "#define %s_RX_FILTER_COUNT %u\n", database.c_str(), rxCount);
+  fprintf(out, "static const CANDB_filter_t %s_RX_FILTERS[%s_RX_FILTER_COUNT] = {\n", database.c_str(), database.c_str());
+  for ( const Message &m : messages ) {
+    if ( !m.rx ) continue;
+    uint32_t full = ( m.extended ) ? 0x1FFFFFFFu : 0x7FFu;
+    uint32_t nodeMask = ( m.nodeBits ) ? ((1u << m.nodeBits) - 1) : 0;
+    fprintf(out, "  { 0x%lX, 0x%lX, %d }, /* %s */\n", (unsigned long)m.id, (unsigned long)(full & ~nodeMask), m.extended, m.name.c_str());
+  }
+  fprintf(out, "};\n\n#endif\n");
+}
+
+int main(int argc, char **argv) {
+  if ( argc != 3 ) {
+    fprintf(stderr, "usage: %s <database.candb> <output.h>\n", argv[0]);
+    return 2;
+  }
+  path = argv[1];
+  std::ifstream in(path);
+  if ( !in ) {
+    perror(argv[1]);
+    return 1;
+  }
+  std::string database;
+  std::vector<Message> messages = parse(in, database);
+
+  std::string source = path.substr(path.find_last_of('/') + 1);
+  std::string tmp = std::string(argv[2]) + ".tmp";
+  FILE *out = fopen(tmp.c_str(), "w");
+  if ( !out ) {
+    perror(tmp.c_str());
+    return 1;
+  }
+  emit(out, database, messages, source);
+  if ( fclose(out) || rename(tmp.c_str(), argv[2]) ) {
+    perror(argv[2]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,188 @@
+/*
+  canreplay.cpp
+  -------------
+  Replays .ccap captures (lib/CanCapture, host/cancap import) onto CAN1..3
+  through the SocketCAN FlexCAN_T4 and checks what the firmware sends back
+  (host/CanReplay). Against the firmware built for the PC on vcan:
+
+      sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+      g++ -O2 -std=c++17 -I lib/CanCapture -I host/include host/canreplay.cpp host/CanReplay.cpp host/CanCaptureReader.cpp -o canreplay
+      FLEXCAN_CAN1=vcan0 ./canreplay --dut 901,902 run.ccap
+
+  or against a Teensy on a USB CAN adapter (FLEXCAN_CAN1=can0). Options:
+
+      --speed x          1 recorded timing (default), 2 twice as fast, 0 as fast as possible
+      --from s --to s    window, seconds from the first frame
+      --id hex,...       replay only these IDs
+      --bus n,...        only these capture buses
+      --dut hex,...      IDs the firmware sends: not replayed, compared with what comes back
+      --replay-tx        also replay frames the logger itself sent (CAN_CAPTURE_TX)
+      --golden g.ccap    expected output, e.g. an earlier --record of a known good build
+      --record out.ccap  write the frames that came back
+      --ignore-data hex,...  compare these IDs by length only (counters, timestamps)
+      --tolerance ms     how far from its expected time a frame may come (50)
+
+  Several captures are merged on their timestamps, a capture name can
+  carry a bus map: run.ccap:2=1 puts capture bus 2 on CAN1, bus 0 is
+  dropped unless mapped. Exit status 1 if the output did not match.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sstream>
+#include "FlexCAN_T4.h"
+#include "CanReplay.h"
+
+FlexCAN_T4<CAN1, RX_SIZE_1024, TX_SIZE_256> can1;
+FlexCAN_T4<CAN2, RX_SIZE_1024, TX_SIZE_256> can2;
+FlexCAN_T4<CAN3, RX_SIZE_1024, TX_SIZE_256> can3;
+
+class SocketCANPort : public CanReplayPort {
+  public:
+    uint64_t unrouted = 0;         /* frames for a bus that is not open */
+    bool send(uint8_t bus, const CAN_message_t &msg) {
+      switch ( bus ) {
+        case 1: return ( can1.isOpen() ) ? can1.write(msg) : route();
+        case 2: return ( can2.isOpen() ) ? can2.write(msg) : route();
+        case 3: return ( can3.isOpen() ) ? can3.write(msg) : route();
+      }
+      return route();
+    }
+    bool receive(CAN_message_t &msg, uint64_t &ns) {
+      if ( can1.isOpen() && can1.read(msg) ) { msg.bus = 1; ns = can1.timestampNs(); return 1; }
+      if ( can2.isOpen() && can2.read(msg) ) { msg.bus = 2; ns = can2.timestampNs(); return 1; }
+      if ( can3.isOpen() && can3.read(msg) ) { msg.bus = 3; ns = can3.timestampNs(); return 1; }
+      return 0;
+    }
+    void service() {
+      if ( can1.isOpen() ) can1.events();
+      if ( can2.isOpen() ) can2.events();
+      if ( can3.isOpen() ) can3.events();
+    }
+  private:
+    bool route() {
+      unrouted++;
+      return 1;
+    }
+};
+
+static std::vector<uint32_t> hexList(const char *s) {
+  std::vector<uint32_t> out;
+  std::stringstream list(s);
+  for ( std::string id; std::getline(list, id, ','); ) out.push_back(strtoul(id.c_str(), nullptr, 16));
+  return out;
+}
+
+static void printFrame(const char *what, const CanReplay_frame_t &f) {
+  printf("    %-9s %8.3f ms CAN%u %s%X [%u]", what, f.t / 1e6, f.bus, ( f.flags & CAN_CAPTURE_EXTENDED ) ? "x" : "", (unsigned)f.id, f.len);
+  if ( f.flags & CAN_CAPTURE_REMOTE ) printf(" remote");
+  else for ( uint8_t i = 0; i < f.len; i++ ) printf(" %02X", f.data[i]);
+  printf("\n");
+}
+
+template<typename T> static void openBus(T &can) {
+  can.begin();
+  can.setBaudRate(1000000);
+  can.enableFIFO(); /* accept everything, read() gets it */
+  can.setTxBatching(); /* one sendmmsg per service() when running fast */
+}
+
+int main(int argc, char **argv) {
+  CanReplay replay;
+  CanReplay_options_t opt;
+  bool any = 0;
+  for ( int i = 1; i < argc; i++ ) {
+    std::string a = argv[i];
+    bool hasValue = ( i + 1 < argc );
+    if ( a == "--speed" && hasValue ) opt.speed = atof(argv[++i]);
+    else if ( a == "--from" && hasValue ) opt.from_ns = (uint64_t)(atof(argv[++i]) * 1e9);
+    else if ( a == "--to" && hasValue ) opt.to_ns = (uint64_t)(atof(argv[++i]) * 1e9);
+    else if ( a == "--id" && hasValue ) opt.ids = hexList(argv[++i]);
+    else if ( a == "--dut" && hasValue ) opt.dut_ids = hexList(argv[++i]);
+    else if ( a == "--ignore-data" && hasValue ) opt.ignore_data = hexList(argv[++i]);
+    else if ( a == "--tolerance" && hasValue ) opt.tolerance_ns = (uint64_t)(atof(argv[++i]) * 1e6);
+    else if ( a == "--replay-tx" ) opt.replay_tx = 1;
+    else if ( a == "--record" && hasValue ) replay.record(argv[++i]);
+    else if ( a == "--bus" && hasValue ) {
+      opt.bus_mask = 0;
+      std::stringstream list(argv[++i]);
+      for ( std::string n; std::getline(list, n, ','); ) opt.bus_mask |= (uint8_t)(1U << (atoi(n.c_str()) & 7));
+    }
+    else if ( a == "--golden" && hasValue ) {
+      if ( !replay.setGolden(argv[++i]) ) {
+        fprintf(stderr, "%s\n", replay.error().c_str());
+        return 2;
+      }
+    }
+    else if ( a.size() > 2 && a.compare(0, 2, "--") == 0 ) {
+      fprintf(stderr, "unknown option %s, the options are at the top of canreplay.cpp\n", a.c_str());
+      return 2;
+    }
+    else {
+      /* run.ccap or run.ccap:2=1,3=2 */
+      uint8_t map[CAN_CAPTURE_BUSES] = { 0xFF, 1, 2, 3, 0xFF, 0xFF, 0xFF, 0xFF };
+      size_t colon = a.rfind(':');
+      if ( colon != std::string::npos && a.find('=', colon) != std::string::npos ) {
+        std::stringstream list(a.substr(colon + 1));
+        for ( std::string pair; std::getline(list, pair, ','); ) {
+          size_t eq = pair.find('=');
+          unsigned from = atoi(pair.c_str()), to = ( eq != std::string::npos ) ? atoi(pair.c_str() + eq + 1) : 0;
+          if ( from < CAN_CAPTURE_BUSES ) map[from] = ( to >= 1 && to <= 3 ) ? to : 0xFF;
+        }
+        a.resize(colon);
+      }
+      if ( !replay.addCapture(a.c_str(), map) ) {
+        fprintf(stderr, "%s\n", replay.error().c_str());
+        return 2;
+      }
+      any = 1;
+    }
+  }
+  if ( !any ) {
+    fprintf(stderr, "usage: %s [options] capture.ccap[:cap=bus,...] ...\n", argv[0]);
+    return 2;
+  }
+
+  openBus(can1);
+  openBus(can2);
+  openBus(can3);
+  if ( !can1.isOpen() && !can2.isOpen() && !can3.isOpen() ) {
+    fprintf(stderr, "no CAN interface open, set FLEXCAN_CAN1..3\n");
+    return 2;
+  }
+  SocketCANPort port;
+  if ( !replay.run(port, opt) ) {
+    fprintf(stderr, "%s\n", replay.error().c_str());
+    return 2;
+  }
+
+  const CanReplay_stats_t &s = replay.stats();
+  double seconds = s.duration_ns / 1e9;
+  printf("replayed %llu frames in %.3f s (%.3f s of capture), %.0f frames/s\n", (unsigned long long)s.frames, seconds,
+         s.timeline_ns / 1e9, ( seconds > 0 ) ? s.frames / seconds : 0.0);
+  if ( opt.speed > 0 && s.frames ) {
+    printf("late: mean %.1f us, p50 < %llu us, p99 < %llu us, max %.1f us, %llu over %.1f ms\n", s.sum_late_ns / 1e3 / s.frames,
+           (unsigned long long)replay.latePercentileNs(50) / 1000, (unsigned long long)replay.latePercentileNs(99) / 1000,
+           s.max_late_ns / 1e3, (unsigned long long)s.late, opt.late_ns / 1e6);
+  }
+  if ( s.port_full || s.dropped ) printf("interface queue full for %llu frames, %llu dropped\n", (unsigned long long)s.port_full, (unsigned long long)s.dropped);
+  if ( port.unrouted ) printf("%llu frames for a bus with no interface open\n", (unsigned long long)port.unrouted);
+  if ( s.skipped_fd ) printf("%llu CAN FD frames skipped\n", (unsigned long long)s.skipped_fd);
+  printf("received %llu frames\n", (unsigned long long)s.received);
+
+  CanReplay_compare_t c = replay.compare(opt);
+  if ( !c.expected && opt.dut_ids.empty() ) return 0; /* nothing to compare with */
+  printf("output: %llu expected, %llu matched, %llu payload differs, %llu missing, %llu unexpected\n", (unsigned long long)c.expected,
+         (unsigned long long)c.matched, (unsigned long long)c.data_mismatch, (unsigned long long)c.missing, (unsigned long long)c.unexpected);
+  if ( opt.speed > 0 && c.matched + c.data_mismatch ) {
+    printf("timing against the capture: %+.3f .. %+.3f ms, mean %+.3f ms\n", c.min_offset_ns / 1e6, c.max_offset_ns / 1e6, c.mean_offset_ns / 1e6);
+  }
+  static const char *kinds[] = { "missing", "unexpected", "differs" };
+  for ( const CanReplay_mismatch_t &m : c.first ) {
+    printf("  %s\n", kinds[m.kind]);
+    if ( m.kind != CAN_REPLAY_UNEXPECTED ) printFrame("expected", m.expected);
+    if ( m.kind != CAN_REPLAY_MISSING ) printFrame("got", m.observed);
+  }
+  return ( c.data_mismatch || c.missing || c.unexpected ) ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+/*
+  gateway_rate_test.cpp
+  ---------------------
+  Sustained rate test for the USB CAN gateway (lib/CanGateway).
+
+      g++ -O2 -std=c++17 -I lib/CanGateway -I lib/CanProfiler host/gateway_rate_test.cpp -o gateway_rate_test
+      ./gateway_rate_test /dev/ttyACM0 [seconds] [bitrate]
+
+  Bench setup: the gateway runs TeensyTestCode/CANBUS_testing/CANBUS_gateway.cpp,
+  a second Teensy 4.1 runs CANBUS_load_generator.cpp with CAN1/2/3 wired
+  to the gateway's CAN1/2/3. The generator numbers every frame, so each
+  missing sequence number is a frame the gateway lost somewhere between
+  the bus and this program.
+
+  The test talks GVRET: it switches binary mode on, sets all three buses
+  to the bitrate (default 1 Mbit/s), reads the stream for the given time
+  (default 30 s) and then asks for the gateway's own counters. Bus load
+  is worked out from the exact length of every frame on the wire, stuff
+  bits and interframe space included, over the gateway's timestamps.
+  Exits 0 when no frame was lost on any bus.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include "CanGatewayFormat.h"
+#include "CanFrameBits.h"
+
+struct BusResult {
+  uint64_t frames = 0;
+  uint64_t bits = 0;
+  uint32_t firstStamp = 0, lastStamp = 0;
+  uint64_t elapsedUs = 0;       /* unwrapped from 32-bit micros() */
+  uint32_t minSeq = 0, maxSeq = 0;
+  bool seen = 0;
+};
+
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool writeAll(int fd, const uint8_t *p, size_t len) {
+  while ( len ) {
+    ssize_t n = write(fd, p, len);
+    if ( n <= 0 ) return 0;
+    p += n;
+    len -= n;
+  }
+  return 1;
+}
+
+static void putLE32(uint8_t *p, uint32_t v) { for ( int i = 0; i < 4; i++ ) p[i] = (uint8_t)(v >> (8 * i)); }
+static uint32_t getLE32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+int main(int argc, char **argv) {
+  if ( argc < 2 ) {
+    fprintf(stderr, "usage: %s <tty> [seconds] [bitrate]\n", argv[0]);
+    return 2;
+  }
+  unsigned seconds = ( argc > 2 ) ? atoi(argv[2]) : 30;
+  uint32_t bitrate = ( argc > 3 ) ? strtoul(argv[3], nullptr, 0) : 1000000;
+  int fd = open(argv[1], O_RDWR | O_NOCTTY);
+  if ( fd < 0 ) {
+    perror(argv[1]);
+    return 1;
+  }
+  struct termios tio;
+  if ( !tcgetattr(fd, &tio) ) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+
+  uint32_t setting = 0x80000000UL | 0x40000000UL | (bitrate & 0xFFFFF);
+  uint8_t setup[2 + 2 + 10 + 2 + 14] = { 0xE7, 0xE7, 0xF1, GVRET_SETUP_CANBUS };
+  putLE32(setup + 4, setting);
+  putLE32(setup + 8, setting);
+  setup[12] = 0xF1;
+  setup[13] = GVRET_SET_EXT_BUSES;
+  putLE32(setup + 14, setting);
+  if ( !writeAll(fd, setup, 26) ) {
+    perror("write");
+    return 1;
+  }
+  tcflush(fd, TCIFLUSH);
+
+  BusResult bus[CAN_GATEWAY_BUSES];
+  CanGateway_stats_t gw;
+  bool haveStats = 0;
+  uint64_t bytes = 0, start = nowMs();
+  bool asked = 0;
+  static uint8_t buf[1 << 16];
+  size_t have = 0;
+
+  while ( nowMs() - start < seconds * 1000ULL + 1000 ) {
+    if ( !asked && nowMs() - start >= seconds * 1000ULL ) {
+      uint8_t ask[2] = { 0xF1, GVRET_GATEWAY_STATS };
+      writeAll(fd, ask, 2);
+      asked = 1;
+    }
+    struct pollfd p = { fd, POLLIN, 0 };
+    if ( poll(&p, 1, 100) <= 0 ) continue;
+    ssize_t n = read(fd, buf + have, sizeof(buf) - have);
+    if ( n <= 0 ) break;
+    bytes += n;
+    have += n;
+    size_t i = 0;
+    while ( i < have ) {
+      if ( buf[i] != 0xF1 ) {
+        i++;                                   /* resync */
+        continue;
+      }
+      if ( i + 2 > have ) break;
+      uint8_t cmd = buf[i + 1];
+      size_t need;
+      if ( cmd == GVRET_BUILD_CAN_FRAME ) {
+        if ( i + 11 > have ) break;
+        need = 12 + (buf[i + 10] & 0x0F);
+      }
+      else if ( cmd == GVRET_GATEWAY_STATS ) need = 2 + sizeof(CanGateway_stats_t);
+      else {
+        i++;                                   /* not a frame start, resync */
+        continue;
+      }
+      if ( i + need > have ) break;
+      /* joined mid-stream, 0xF1 can also be a data byte: check the frame's shape before trusting it */
+      if ( cmd == GVRET_BUILD_CAN_FRAME && ((buf[i + 10] & 0x0F) > 8 || (buf[i + 10] >> 4) >= CAN_GATEWAY_BUSES ||
+           buf[i + need - 1] != 0 || (i + need < have && buf[i + need] != 0xF1)) ) {
+        i++;
+        continue;
+      }
+      const uint8_t *f = buf + i;
+      if ( cmd == GVRET_GATEWAY_STATS ) {
+        memcpy(&gw, f + 2, sizeof(gw));
+        haveStats = 1;
+      }
+      else {
+        uint32_t stamp = getLE32(f + 2), rawId = getLE32(f + 6);
+        uint8_t len = f[10] & 0x0F, b = f[10] >> 4;
+        if ( b < CAN_GATEWAY_BUSES && len <= 8 ) {
+          BusResult &r = bus[b];
+          uint32_t seq = ( len >= 4 ) ? getLE32(f + 11) : 0;
+          if ( !r.seen ) {
+            r.seen = 1;
+            r.firstStamp = r.lastStamp = stamp;
+            r.minSeq = r.maxSeq = seq;
+          }
+          r.elapsedUs += (uint32_t)(stamp - r.lastStamp);
+          r.lastStamp = stamp;
+          if ( seq < r.minSeq ) r.minSeq = seq;
+          if ( seq > r.maxSeq ) r.maxSeq = seq;
+          r.frames++;
+          r.bits += canFrameBits(rawId & 0x1FFFFFFF, rawId >> 31, 0, len, f + 11);
+        }
+      }
+      i += need;
+    }
+    memmove(buf, buf + i, have - i);
+    have -= i;
+  }
+
+  bool pass = 1;
+  printf("%.1f MB/s from USB over %u s\n", bytes / (seconds * 1e6), seconds);
+  for ( uint8_t b = 0; b < CAN_GATEWAY_BUSES; b++ ) {
+    BusResult &r = bus[b];
+    if ( !r.frames ) {
+      printf("CAN%u: no frames\n", b + 1);
+      pass = 0;
+      continue;
+    }
+    uint64_t expected = (uint64_t)r.maxSeq - r.minSeq + 1;
+    uint64_t lost = ( expected > r.frames ) ? expected - r.frames : 0;
+    /* bits of the first frame went by before its stamp */
+    double load = ( r.elapsedUs ) ? 100.0 * (r.bits - r.bits / r.frames) / (r.elapsedUs * (bitrate / 1e6)) : 0;
+    printf("CAN%u: %llu frames  %.0f frames/s  load %.1f %%  lost %llu\n", b + 1, (unsigned long long)r.frames,
+           r.elapsedUs ? r.frames * 1e6 / r.elapsedUs : 0.0, load, (unsigned long long)lost);
+    if ( lost ) pass = 0;
+  }
+  if ( haveStats ) {
+    printf("gateway: rx %lu/%lu/%lu  ring dropped %lu  ring peak %lu  usb writes %lu  bytes %lu\n",
+           (unsigned long)gw.rx_frames[0], (unsigned long)gw.rx_frames[1], (unsigned long)gw.rx_frames[2],
+           (unsigned long)gw.ring_dropped, (unsigned long)gw.ring_peak, (unsigned long)gw.usb_writes,
+           (unsigned long)gw.usb_bytes);
+    if ( gw.ring_dropped ) pass = 0;
+  }
+  else printf("gateway: no stats reply\n");
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/*
+  hostlink_cli.cpp
+  ----------------
+  Command line end of lib/HostLink, for bench tests of the binary link.
+
+      g++ -O2 -std=c++17 -I lib/HostLink -I lib/VescCAN -I lib/CanDB -I host/include host/hostlink_cli.cpp host/HostLinkPort.cpp -o hostlink_cli
+      ./hostlink_cli /dev/ttyACM0                          # print telemetry, CAN frames and link status
+      ./hostlink_cli /dev/ttyACM0 ping [count]             # round trip times
+      ./hostlink_cli /dev/ttyACM0 duty <vesc> <duty> [seconds] [rate_hz]
+      ./hostlink_cli /dev/ttyACM0 profile                  # bus load and per-ID table from lib/CanProfiler
+
+  duty streams one SETPOINT per period (default 1000 Hz for 5 s, duty as a
+  fraction, 0.18 = 18 %), then sends duty 0, and prints the telemetry that
+  comes back once a second. profile asks for one report
+  (TeensyTestCode/CANBUS_testing/CANBUS_profiler.cpp in hostMode) and
+  prints it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "HostLinkPort.h"
+#include "VescCAN.h"
+
+static uint64_t nowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void print(uint8_t type, const uint8_t *data, uint8_t len) {
+  if ( type == HOSTLINK_TELEMETRY && len >= sizeof(HostLink_telemetry_t) ) {
+    HostLink_telemetry_t t;
+    memcpy(&t, data, sizeof(t));
+    printf("vesc %u  erpm %ld  current %.1f A  duty %.3f  in %.1f V %.1f A  fet %.1f C  motor %.1f C  tacho %ld\n",
+           t.controller, (long)t.erpm, t.current_da * 0.1, t.duty_permille * 0.001, t.v_in_dv * 0.1,
+           t.current_in_da * 0.1, t.temp_fet_dc * 0.1, t.temp_motor_dc * 0.1, (long)t.tachometer);
+  }
+  else if ( type == HOSTLINK_CAN_FRAME && len >= sizeof(HostLink_can_t) ) {
+    HostLink_can_t c;
+    memcpy(&c, data, sizeof(c));
+    printf("%10lu us  can%u  %*lX  [%u]", (unsigned long)c.stamp_us, c.bus, ( c.flags & HOSTLINK_CAN_EXTENDED ) ? 8 : 3,
+           (unsigned long)c.id, c.len);
+    for ( uint8_t i = 0; i < c.len && i < 8; i++ ) printf(" %02X", c.buf[i]);
+    printf("\n");
+  }
+  else if ( type == HOSTLINK_STATUS && len >= sizeof(HostLink_status_t) ) {
+    HostLink_status_t s;
+    memcpy(&s, data, sizeof(s));
+    printf("teensy: rx %lu lost %lu crc %lu framing %lu  tx %lu dropped %lu\n", (unsigned long)s.rx_frames,
+           (unsigned long)s.rx_lost, (unsigned long)s.crc_errors, (unsigned long)s.framing_errors,
+           (unsigned long)s.tx_frames, (unsigned long)s.tx_dropped);
+  }
+  else if ( type == HOSTLINK_BUS_LOAD && len >= sizeof(HostLink_bus_load_t) ) {
+    HostLink_bus_load_t l;
+    memcpy(&l, data, sizeof(l));
+    printf("can%u  %lu bit/s  load %.2f %%  worst case %.2f %%  peak %.2f %%  %lu frames in %lu ms\n", l.bus,
+           (unsigned long)l.bitrate, l.load_cpct * 0.01, l.worst_cpct * 0.01, l.peak_cpct * 0.01,
+           (unsigned long)l.frames, (unsigned long)(l.window_us / 1000));
+  }
+  else if ( type == HOSTLINK_ID_STATS && len >= sizeof(HostLink_id_stats_t) ) {
+    HostLink_id_stats_t n;
+    memcpy(&n, data, sizeof(n));
+    printf("  can%u  %*lX  frames %lu  %.3f Hz  period %lu +-%lu us (%lu..%lu)  bits %lu  DLC", n.bus,
+           ( n.flags & HOSTLINK_CAN_EXTENDED ) ? 8 : 3, (unsigned long)n.id, (unsigned long)n.frames, n.rate_mhz * 0.001,
+           (unsigned long)n.period_us, (unsigned long)n.jitter_us, (unsigned long)n.min_period_us,
+           (unsigned long)n.max_period_us, (unsigned long)n.bits);
+    for ( uint8_t i = 0; i < 16; i++ ) if ( n.dlc_mask & (1U << i) ) printf(" %u", i);
+    printf("%s\n", ( n.flags & HOSTLINK_ID_TX ) ? "  sent by teensy" : "");
+  }
+}
+
+static int ping(HostLinkPort &link, unsigned count) {
+  std::vector<uint32_t> rtt;
+  for ( uint32_t token = 1; token <= count; token++ ) {
+    HostLink_ping_t p = { token, 0 };
+    uint64_t start = nowUs();
+    link.send(HOSTLINK_PING, p);
+    if ( !link.flush() ) return 1;
+    bool done = 0;
+    while ( !done && nowUs() - start < 100000 ) {
+      link.poll(10, [&](uint8_t type, const uint8_t *data, uint8_t len) {
+        HostLink_ping_t pong;
+        if ( type != HOSTLINK_PONG || len < sizeof(pong) ) return;
+        memcpy(&pong, data, sizeof(pong));
+        if ( pong.token == token ) done = 1;
+      });
+    }
+    if ( done ) rtt.push_back((uint32_t)(nowUs() - start));
+  }
+  if ( rtt.empty() ) {
+    printf("no replies\n");
+    return 1;
+  }
+  std::sort(rtt.begin(), rtt.end());
+  uint64_t sum = 0;
+  for ( uint32_t r : rtt ) sum += r;
+  printf("%zu/%u replies  rtt us min %u  avg %lu  p50 %u  p99 %u  max %u\n", rtt.size(), count, rtt.front(),
+         (unsigned long)(sum / rtt.size()), rtt[rtt.size() / 2], rtt[rtt.size() * 99 / 100], rtt.back());
+  return 0;
+}
+
+static int duty(HostLinkPort &link, uint8_t vesc, float value, float seconds, unsigned rate) {
+  HostLink_setpoint_t sp = { vesc, VESC_CMD_DUTY, 0, VESC_SET_DUTY::duty::raw(value) };
+  uint64_t period = 1000000 / ( rate ? rate : 1 ), start = nowUs(), next = start, lastPrint = 0;
+  HostLink_telemetry_t latest;
+  bool have = 0;
+  uint64_t sent = 0;
+  while ( nowUs() - start < (uint64_t)(seconds * 1e6f) ) {
+    if ( nowUs() >= next ) {
+      next += period;
+      link.send(HOSTLINK_SETPOINT, sp);
+      if ( !link.flush() ) return 1;
+      sent++;
+    }
+    int64_t wait = (int64_t)(next - nowUs()) / 1000;
+    link.poll(( wait > 0 ) ? (int)wait : 0, [&](uint8_t type, const uint8_t *data, uint8_t len) {
+      HostLink_telemetry_t t;
+      if ( type != HOSTLINK_TELEMETRY || len < sizeof(t) ) return;
+      memcpy(&t, data, sizeof(t));
+      if ( t.controller != vesc ) return;
+      latest = t;
+      have = 1;
+    });
+    if ( have && nowUs() - lastPrint >= 1000000 ) {
+      lastPrint = nowUs();
+      print(HOSTLINK_TELEMETRY, (const uint8_t*)&latest, sizeof(latest));
+    }
+  }
+  sp.value = 0;
+  link.send(HOSTLINK_SETPOINT, sp);
+  link.flush();
+  printf("%lu setpoints in %.1f s, %lu telemetry frames received, %lu lost\n", (unsigned long)sent, seconds,
+         (unsigned long)link.stats().rx_frames, (unsigned long)link.stats().rx_lost);
+  return 0;
+}
+
+static int profile(HostLinkPort &link) {
+  link.send(HOSTLINK_BUS_LOAD, "", 0);
+  if ( !link.flush() ) return 1;
+  bool any = 0;
+  uint64_t start = nowUs();
+  while ( nowUs() - start < 500000 ) {
+    link.poll(50, [&](uint8_t type, const uint8_t *data, uint8_t len) {
+      if ( type != HOSTLINK_BUS_LOAD && type != HOSTLINK_ID_STATS ) return;
+      print(type, data, len);
+      any = 1;
+    });
+  }
+  if ( !any ) printf("no report\n");
+  return !any;
+}
+
+int main(int argc, char **argv) {
+  if ( argc < 2 ) {
+    fprintf(stderr, "usage: %s <tty> [ping [count] | duty <vesc> <duty> [seconds] [rate_hz] | profile]\n", argv[0]);
+    return 2;
+  }
+  HostLinkPort link;
+  if ( !link.open(argv[1]) ) {
+    perror(argv[1]);
+    return 1;
+  }
+  if ( argc > 2 && !strcmp(argv[2], "ping") ) return ping(link, ( argc > 3 ) ? atoi(argv[3]) : 1000);
+  if ( argc > 2 && !strcmp(argv[2], "profile") ) return profile(link);
+  if ( argc > 4 && !strcmp(argv[2], "duty") ) {
+    return duty(link, (uint8_t)atoi(argv[3]), atof(argv[4]), ( argc > 5 ) ? atof(argv[5]) : 5.0f,
+                ( argc > 6 ) ? atoi(argv[6]) : 1000);
+  }
+  while ( link.poll(1000, print) >= 0 );
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+  Host build stand-in for Arduino.h
+  ---------------------------------
+  Just enough of the Teensy core for the header-only libraries in lib/
+  (CanDiscovery, VescTelemetry, VescBurst, ...) to build on Linux next to
+  the SocketCAN FlexCAN_T4: micros()/millis() from CLOCK_MONOTONIC,
+  delay(), and a Serial that prints to stdout.
+*/
+
+#if !defined(_HOST_ARDUINO_H_)
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+static inline uint64_t hostMonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint32_t micros() { return (uint32_t)(hostMonotonicNs() / 1000); }
+static inline uint32_t millis() { return (uint32_t)(hostMonotonicNs() / 1000000); }
+
+static inline void delayMicroseconds(uint32_t us) {
+  struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+  nanosleep(&ts, nullptr);
+}
+
+static inline void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+
+static inline void noInterrupts() { ; } /* no interrupts on the host, handlers run from events() */
+static inline void interrupts() { ; }
+
+class Print {
+  public:
+    virtual ~Print() { ; }
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t n = 0;
+      while ( size-- && write(*buffer++) ) n++;
+      return n;
+    }
+    size_t write(const char *str) { return write((const uint8_t*)str, strlen(str)); }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned long long n, int base = DEC) {
+      char buf[65], *p = buf + sizeof(buf) - 1;
+      *p = 0;
+      if ( base < 2 ) base = DEC;
+      do { uint8_t d = n % base; *--p = (char)(( d < 10 ) ? '0' + d : 'A' + d - 10); n /= base; } while ( n );
+      return write(p);
+    }
+    size_t print(long long n, int base = DEC) {
+      if ( base != DEC || n >= 0 ) return print((unsigned long long)n, base);
+      return print('-') + print((unsigned long long)(-n), base);
+    }
+    size_t print(unsigned long n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(long n, int base = DEC) { return print((long long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long long)n, base); }
+    size_t print(double n, int digits = 2) {
+      char buf[48];
+      snprintf(buf, sizeof(buf), "%.*f", digits, n);
+      return write(buf);
+    }
+
+    size_t println() { return write("\r\n"); }
+    template<typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+    template<typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+    virtual void flush() { ; }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+class HostSerial : public Stream {
+  public:
+    void begin(uint32_t baud = 0) { (void)baud; }
+    size_t write(uint8_t c) { return ( fputc(c, stdout) == EOF ) ? 0 : 1; }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+    using Print::write;
+    void flush() { fflush(stdout); }
+    int availableForWrite() { return 4096; }
+    operator bool() { return 1; }
+};
+
+inline HostSerial Serial;
+
+#endif
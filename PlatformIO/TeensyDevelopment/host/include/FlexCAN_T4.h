@@ -0,0 +1,61 @@
+/*
+  Host build stand-in for FlexCAN_T4.h
+  ------------------------------------
+  Lets the CAN libraries in lib/ (VescCAN, ...) compile on a PC with
+  g++ -std=c++17 -I host/include -I lib/<Library>. The message structures must stay
+  byte-for-byte identical to lib/FlexCAN_T4-master/FlexCAN_T4.h.
+
+  On Linux the FlexCAN_T4 class itself comes from FlexCAN_T4_SocketCAN.h,
+  so the same code can also talk to a real bus or a vcan interface.
+*/
+
+#if !defined(_FLEXCAN_T4_H_)
+#define _FLEXCAN_T4_H_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct CAN_message_t {
+  uint32_t id = 0;          // can identifier
+  uint16_t timestamp = 0;   // FlexCAN time when message arrived
+  uint8_t idhit = 0; // filter that id came from
+  struct {
+    bool extended = 0; // identifier is extended (29-bit)
+    bool remote = 0;  // remote transmission request packet type
+    bool overrun = 0; // message overrun
+    bool reserved = 0;
+  } flags;
+  uint8_t len = 8;      // length of data
+  uint8_t buf[8] = { 0 };       // data
+  int8_t mb = 0;       // used to identify mailbox reception
+  uint8_t bus = 0;      // used to identify where the message came from when events() is used.
+  bool seq = 0;         // sequential frames
+} CAN_message_t;
+
+typedef struct CANFD_message_t {
+  uint32_t id = 0;          // can identifier
+  uint16_t timestamp = 0;   // FlexCAN time when message arrived
+  uint8_t idhit = 0; // filter that id came from
+  bool brs = 1;        // baud rate switching for data
+  bool esi = 0;        // error status indicator
+  bool edl = 1;        // extended data length (for RX, 0 == CAN2.0, 1 == FD)
+  struct {
+    bool extended = 0; // identifier is extended (29-bit)
+    bool overrun = 0; // message overrun
+    bool reserved = 0;
+  } flags;
+  uint8_t len = 8;      // length of data
+  uint8_t buf[64] = { 0 };       // data
+  int8_t mb = 0;       // used to identify mailbox reception
+  uint8_t bus = 0;      // used to identify where the message came from when events() is used.
+  bool seq = 0;         // sequential frames
+} CANFD_message_t;
+
+typedef void (*_MB_ptr)(const CAN_message_t &msg); /* mailbox / global callbacks */
+typedef void (*_MBFD_ptr)(const CANFD_message_t &msg); /* mailbox / global callbacks */
+
+#if defined(__linux__)
+#include "FlexCAN_T4_SocketCAN.h"
+#endif
+
+#endif
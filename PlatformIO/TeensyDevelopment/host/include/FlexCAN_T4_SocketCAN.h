@@ -0,0 +1,923 @@
+/*
+  FlexCAN_T4_SocketCAN.h
+  ----------------------
+  FlexCAN_T4 on Linux SocketCAN, so code written against the Teensy library
+  (VescCAN, CanDiscovery, the test sketches) runs unchanged on a PC or SBC
+  with a CAN adapter, and against vcan without any hardware:
+
+      sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+      FLEXCAN_CAN1=vcan0 ./my_test
+
+  Included by host/include/FlexCAN_T4.h on Linux. CAN1, CAN2 and CAN3 open
+  can0, can1 and can2 unless $FLEXCAN_CAN1..3 or setInterface() names
+  another interface.
+
+  How the Teensy behaviour maps onto a CAN_RAW socket:
+    mailboxes, FIFO: the RX mailbox and FIFO filters are kept as on the
+      FlexCAN (same first match order, msg.mb and msg.idhit), and their
+      union is handed to the kernel with CAN_RAW_FILTER so frames nobody
+      listens for never reach user space. Ranges go to the kernel as the
+      smallest mask covering them and are checked exactly here.
+    interrupts: there are none. events() drains the socket with recvmmsg()
+      and runs the onReceive() handlers of the mailboxes/FIFO that have
+      interrupts enabled, frames for the others wait for read(). Call
+      events() from loop() as on the Teensy.
+    write(): frames go into the _txSize queue and out with sendmmsg(). If
+      the interface queue is full (ENOBUFS) they stay queued and events()
+      retries, write() returns 0 once the queue itself is full.
+      setTxBatching(1) holds frames until events() or flushTx(), one system
+      call per loop instead of one per frame.
+    timestamps: SO_TIMESTAMPING, the adapter's hardware stamp when it has
+      one, the kernel receive stamp otherwise. msg.timestamp is that stamp
+      in bit times modulo 2^16 like the FlexCAN timer, timestampNs() has
+      the full value of the frame last returned by read() or passed to a
+      handler.
+    setBaudRate(): only records the bitrate (timestamp scale, getBaudRate())
+      and LISTEN_ONLY, which makes write() return 0. The interface bitrate
+      is set outside the program:
+          sudo ip link set can0 type can bitrate 500000 && sudo ip link set up can0
+    reserveTxMB()/stageTxMB()/releaseTxMB(): the released frames go out in
+      one sendmmsg(), isTxMBIdle() and getMBTimestamp() report the send.
+
+  Not covered: CAN FD (FlexCAN_T4FD) and isotp.h, which needs the Teensy
+  core. On Linux use the kernel's CAN_ISOTP sockets instead.
+*/
+
+#if !defined(_FLEXCAN_T4_SOCKETCAN_H_)
+#define _FLEXCAN_T4_SOCKETCAN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+typedef enum CAN_DEV_TABLE {
+  CAN0 = 0,
+  CAN1 = 1,
+  CAN2 = 2,
+  CAN3 = 3
+} CAN_DEV_TABLE;
+
+typedef enum FLEXCAN_MAILBOX {
+  MB0 = 0, MB1 = 1, MB2 = 2, MB3 = 3, MB4 = 4, MB5 = 5, MB6 = 6, MB7 = 7,
+  MB8 = 8, MB9 = 9, MB10 = 10, MB11 = 11, MB12 = 12, MB13 = 13, MB14 = 14, MB15 = 15,
+  MB16 = 16, MB17 = 17, MB18 = 18, MB19 = 19, MB20 = 20, MB21 = 21, MB22 = 22, MB23 = 23,
+  MB24 = 24, MB25 = 25, MB26 = 26, MB27 = 27, MB28 = 28, MB29 = 29, MB30 = 30, MB31 = 31,
+  MB32 = 32, MB33 = 33, MB34 = 34, MB35 = 35, MB36 = 36, MB37 = 37, MB38 = 38, MB39 = 39,
+  MB40 = 40, MB41 = 41, MB42 = 42, MB43 = 43, MB44 = 44, MB45 = 45, MB46 = 46, MB47 = 47,
+  MB48 = 48, MB49 = 49, MB50 = 50, MB51 = 51, MB52 = 52, MB53 = 53, MB54 = 54, MB55 = 55,
+  MB56 = 56, MB57 = 57, MB58 = 58, MB59 = 59, MB60 = 60, MB61 = 61, MB62 = 62, MB63 = 63,
+  FIFO = 99
+} FLEXCAN_MAILBOX;
+
+typedef enum FLEXCAN_RXTX {
+  TX,
+  RX,
+  LISTEN_ONLY
+} FLEXCAN_RXTX;
+
+typedef enum FLEXCAN_IDE {
+  NONE = 0,
+  EXT = 1,
+  RTR = 2,
+  STD = 3,
+  INACTIVE
+} FLEXCAN_IDE;
+
+typedef enum FLEXCAN_FLTEN {
+  ACCEPT_ALL = 0,
+  REJECT_ALL = 1
+} FLEXCAN_FLTEN;
+
+typedef enum FLEXCAN_FILTER_TABLE {
+  FLEXCAN_MULTI = 1,
+  FLEXCAN_RANGE = 2,
+  FLEXCAN_TABLE_B_MULTI = 3,
+  FLEXCAN_TABLE_B_RANGE = 4,
+  FLEXCAN_USERMASK = 5
+} FLEXCAN_FILTER_TABLE;
+
+typedef enum FLEXCAN_RFFN_TABLE {
+  RFFN_8 = (uint8_t)0,
+  RFFN_16 = (uint8_t)1,
+  RFFN_24 = (uint8_t)2,
+  RFFN_32 = (uint8_t)3,
+  RFFN_40 = (uint8_t)4,
+  RFFN_48 = (uint8_t)5,
+  RFFN_56 = (uint8_t)6,
+  RFFN_64 = (uint8_t)7,
+  RFFN_72 = (uint8_t)8,
+  RFFN_80 = (uint8_t)9,
+  RFFN_88 = (uint8_t)10,
+  RFFN_96 = (uint8_t)11,
+  RFFN_104 = (uint8_t)12,
+  RFFN_112 = (uint8_t)13,
+  RFFN_120 = (uint8_t)14,
+  RFFN_128 = (uint8_t)15
+} FLEXCAN_RFFN_TABLE;
+
+typedef enum FLEXCAN_RXQUEUE_TABLE {
+  RX_SIZE_2 = (uint16_t)2,
+  RX_SIZE_4 = (uint16_t)4,
+  RX_SIZE_8 = (uint16_t)8,
+  RX_SIZE_16 = (uint16_t)16,
+  RX_SIZE_32 = (uint16_t)32,
+  RX_SIZE_64 = (uint16_t)64,
+  RX_SIZE_128 = (uint16_t)128,
+  RX_SIZE_256 = (uint16_t)256,
+  RX_SIZE_512 = (uint16_t)512,
+  RX_SIZE_1024 = (uint16_t)1024
+} FLEXCAN_RXQUEUE_TABLE;
+
+typedef enum FLEXCAN_TXQUEUE_TABLE {
+  TX_SIZE_2 = (uint16_t)2,
+  TX_SIZE_4 = (uint16_t)4,
+  TX_SIZE_8 = (uint16_t)8,
+  TX_SIZE_16 = (uint16_t)16,
+  TX_SIZE_32 = (uint16_t)32,
+  TX_SIZE_64 = (uint16_t)64,
+  TX_SIZE_128 = (uint16_t)128,
+  TX_SIZE_256 = (uint16_t)256,
+  TX_SIZE_512 = (uint16_t)512,
+  TX_SIZE_1024 = (uint16_t)1024
+} FLEXCAN_TXQUEUE_TABLE;
+
+#define FCTP_CLASS template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize = RX_SIZE_16, FLEXCAN_TXQUEUE_TABLE _txSize = TX_SIZE_16>
+#define FCTP_FUNC template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize, FLEXCAN_TXQUEUE_TABLE _txSize>
+#define FCTP_OPT FlexCAN_T4<_bus, _rxSize, _txSize>
+
+#define FLEXCAN_SOCKETCAN_BATCH 64       /* frames per recvmmsg()/sendmmsg() */
+#define FLEXCAN_SOCKETCAN_REJECT 0       /* filter types next to FLEXCAN_FILTER_TABLE */
+#define FLEXCAN_SOCKETCAN_ACCEPT 0xFF
+
+class FlexCAN_T4_Base {
+  public:
+    virtual ~FlexCAN_T4_Base() { ; }
+    virtual void setBaudRate(uint32_t baud = 1000000, FLEXCAN_RXTX listen_only = TX) = 0;
+    virtual uint64_t events() = 0;
+    virtual int write(const CANFD_message_t &msg) = 0;
+    virtual int write(const CAN_message_t &msg) = 0;
+    virtual bool isFD() = 0;
+};
+
+typedef struct FlexCAN_socketcan_stats_t {
+  uint32_t rx_frames = 0;        /* frames read from the socket */
+  uint32_t rx_unmatched = 0;     /* passed the kernel filter but no mailbox/FIFO filter (range approximations) */
+  uint32_t rx_queue_full = 0;    /* dropped, read() or events() queue full */
+  uint32_t rx_kernel_drops = 0;  /* dropped by the kernel, socket buffer full (SO_RXQ_OVFL) */
+  uint32_t tx_frames = 0;        /* accepted by the interface */
+  uint32_t tx_queue_full = 0;    /* write() returned 0 */
+  uint32_t tx_busy = 0;          /* sendmmsg() stopped on a full interface queue, retried later */
+  uint32_t tx_errors = 0;        /* other send errors, interface down, bus off, ... */
+  uint32_t hw_timestamps = 0;    /* received frames carrying an adapter timestamp */
+} FlexCAN_socketcan_stats_t;
+
+typedef struct FlexCAN_socketcan_filter_t {
+  uint8_t type = FLEXCAN_SOCKETCAN_ACCEPT;   /* FLEXCAN_SOCKETCAN_ACCEPT/REJECT, FLEXCAN_MULTI, FLEXCAN_RANGE or FLEXCAN_USERMASK */
+  uint8_t count = 0;                         /* ids used by FLEXCAN_MULTI and FLEXCAN_USERMASK */
+  uint8_t ide = NONE;                        /* FIFO filters: STD or EXT, mailboxes use the mailbox IDE */
+  uint8_t remote = NONE;                     /* FIFO filters: RTR matches remote frames only, NONE data frames only */
+  uint32_t ids[5] = { 0 };                   /* FLEXCAN_RANGE: ids[0]..ids[1] */
+  uint32_t mask = 0;                         /* FLEXCAN_USERMASK */
+} FlexCAN_socketcan_filter_t;
+
+FCTP_CLASS class FlexCAN_T4 : public FlexCAN_T4_Base {
+  public:
+    FlexCAN_T4();
+    ~FlexCAN_T4() { end(); }
+    bool isFD() { return 0; }
+    void setInterface(const char *name); /* before begin(), instead of can0..can2 */
+    const char* getInterface() const { return ifname; }
+    void begin();
+    void end();
+    bool isOpen() const { return fd >= 0; }
+    int socket() const { return fd; } /* for poll()/epoll on the RX side */
+    uint32_t getBaudRate() { return currentBitrate; }
+    void setBaudRate(uint32_t baud = 1000000, FLEXCAN_RXTX listen_only = TX);
+    void setMaxMB(uint8_t last);
+    void enableLoopBack(bool yes = 1);
+    void enableFIFO(bool status = 1);
+    void disableFIFO() { enableFIFO(0); }
+    void enableFIFOInterrupt(bool status = 1) { fifoInterrupt = status; }
+    void disableFIFOInterrupt() { enableFIFOInterrupt(0); }
+    uint8_t setRFFN(FLEXCAN_RFFN_TABLE rffn = RFFN_8);
+    void mailboxStatus();
+    int read(CAN_message_t &msg);
+    int readMB(CAN_message_t &msg) { return readFrom(msg, 0); }
+    int readFIFO(CAN_message_t &msg) { return readFrom(msg, 1); }
+    bool setMB(const FLEXCAN_MAILBOX &mb_num, const FLEXCAN_RXTX &mb_rx_tx, const FLEXCAN_IDE &ide = STD);
+    void enableMBInterrupt(const FLEXCAN_MAILBOX &mb_num, bool status = 1);
+    void disableMBInterrupt(const FLEXCAN_MAILBOX &mb_num) { enableMBInterrupt(mb_num, 0); }
+    void enableMBInterrupts(bool status = 1);
+    void disableMBInterrupts() { enableMBInterrupts(0); }
+    void onReceive(const FLEXCAN_MAILBOX &mb_num, _MB_ptr handler);
+    void onReceive(_MB_ptr handler) { _mainHandler = handler; }
+    void onTransmit(const FLEXCAN_MAILBOX &mb_num, _MB_ptr handler);
+    void onTransmit(_MB_ptr handler) { _mainTxHandler = handler; }
+    bool setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t mask);
+    bool setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t mask);
+    bool setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t mask);
+    bool setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t id4, uint32_t mask);
+    bool setMBManualFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t mask) { return setMBUserFilter(mb_num, id1, mask); }
+    void setMBFilter(FLEXCAN_FLTEN input);
+    void setMBFilter(FLEXCAN_MAILBOX mb_num, FLEXCAN_FLTEN input);
+    bool setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1);
+    bool setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2);
+    bool setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3);
+    bool setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t id4);
+    bool setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t id4, uint32_t id5);
+    bool setMBFilterRange(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2);
+    void setFIFOFilter(const FLEXCAN_FLTEN &input);
+    bool setFIFOFilter(uint8_t filter, uint32_t id1, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote = NONE);
+    bool setFIFOFilter(uint8_t filter, uint32_t id1, uint32_t id2, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote = NONE);
+    bool setFIFOFilterRange(uint8_t filter, uint32_t id1, uint32_t id2, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote = NONE);
+    bool setFIFOUserFilter(uint8_t filter, uint32_t id1, uint32_t mask, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote = NONE);
+    bool setFIFOUserFilter(uint8_t filter, uint32_t id1, uint32_t id2, uint32_t mask, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote = NONE);
+    bool setFIFOManualFilter(uint8_t filter, uint32_t id1, uint32_t mask, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote = NONE) { return setFIFOUserFilter(filter, id1, mask, ide, remote); }
+    int write(const CAN_message_t &msg); /* use any available mailbox for transmitting */
+    int write(const CANFD_message_t &) { return 0; } /* to satisfy base class for external pointers */
+    int write(FLEXCAN_MAILBOX mb_num, const CAN_message_t &msg); /* use a single mailbox for transmitting */
+    uint64_t events();
+    uint32_t getRXQueueCount() { return rxHead - rxTail; }
+    uint32_t getTXQueueCount() { return txHead - txTail; }
+    void reserveTxMB(const FLEXCAN_MAILBOX &mb_num, bool state = 1);
+    bool stageTxMB(const FLEXCAN_MAILBOX &mb_num, const CAN_message_t &msg);
+    void releaseTxMB(uint64_t mask);
+    bool isTxMBIdle(const FLEXCAN_MAILBOX &mb_num) { return ( mb_num < 64 ) ? !(releasedTxMB & (1ULL << mb_num)) : 1; }
+    uint16_t getMBTimestamp(const FLEXCAN_MAILBOX &mb_num) { return ( mb_num < 64 ) ? mbStamp[mb_num] : 0; }
+
+    /* SocketCAN only */
+    void setTxBatching(bool state = 1) { txBatching = state; }
+    int flushTx(); /* send what write() queued, returns frames accepted by the interface */
+    uint64_t timestampNs() const { return lastNs; } /* CLOCK_REALTIME, or the adapter clock if timestampIsHardware() */
+    bool timestampIsHardware() const { return lastHw; }
+    const FlexCAN_socketcan_stats_t& socketStats() const { return counters; }
+
+  private:
+    typedef struct rx_entry_t {
+      CAN_message_t msg;
+      uint64_t ns;
+      bool hw;
+    } rx_entry_t;
+    typedef struct mailbox_t {
+      uint8_t rxtx = TX;            /* RX, TX, or LISTEN_ONLY for an inactive mailbox */
+      uint8_t ide = STD;
+      bool interrupt = 0;
+      _MB_ptr rxHandler = nullptr;
+      _MB_ptr txHandler = nullptr;
+      FlexCAN_socketcan_filter_t filter;
+      CAN_message_t staged;
+    } mailbox_t;
+
+    int readFrom(CAN_message_t &msg, int fifo);
+    uint32_t pull();
+    void deliver(const CAN_message_t &msg, uint64_t ns, bool hw);
+    bool match(const FlexCAN_socketcan_filter_t &f, const CAN_message_t &msg, bool fifo);
+    bool setFilter(FLEXCAN_MAILBOX mb_num, uint8_t type, uint8_t count, const uint32_t *ids, uint32_t mask);
+    bool setFIFOFilter(uint8_t filter, uint8_t type, uint8_t count, const uint32_t *ids, uint32_t mask, uint8_t ide, uint8_t remote);
+    void applyKernelFilter();
+    int getFirstTxBox();
+    uint8_t mailboxOffset() const { return ( fifoEnabled ) ? (6 + fifoFilterSlots / 4) : 0; }
+    uint16_t bitTime(uint64_t ns) const { return (uint16_t)(((unsigned __int128)ns * (( currentBitrate ) ? currentBitrate : 1000000)) / 1000000000ULL); } /* epoch ns * bitrate needs 81 bits */
+    void stampTx(uint8_t mb_num, uint64_t ns, const CAN_message_t &msg);
+    static uint64_t realtimeNs();
+    static void toFrame(const CAN_message_t &msg, struct can_frame &frame);
+
+    char ifname[IF_NAMESIZE] = { 0 };
+    int fd = -1;
+    uint32_t currentBitrate = 0;
+    bool listenOnly = 0;
+    bool loopBack = 0;
+    bool txBatching = 0;
+    bool filterDirty = 1;
+    uint32_t kernelDrops = 0;      /* last SO_RXQ_OVFL value */
+    uint8_t maxMB = 16;
+    bool fifoEnabled = 0;
+    bool fifoInterrupt = 0;
+    uint8_t fifoFilterSlots = 8;
+    mailbox_t mb[64];
+    FlexCAN_socketcan_filter_t fifoFilter[128];
+    uint64_t reservedTxMB = 0;     /* mailboxes owned by stageTxMB()/releaseTxMB() */
+    uint64_t releasedTxMB = 0;     /* released, not yet accepted by the interface */
+    uint16_t mbStamp[64] = { 0 };
+    _MB_ptr _fifoHandler = nullptr;
+    _MB_ptr _mainHandler = nullptr;
+    _MB_ptr _mainTxHandler = nullptr;
+    uint64_t lastNs = 0;
+    bool lastHw = 0;
+    FlexCAN_socketcan_stats_t counters;
+
+    rx_entry_t rxQueue[_rxSize];   /* frames for read(), mailboxes/FIFO without interrupts */
+    uint32_t rxHead = 0, rxTail = 0;
+    rx_entry_t cbQueue[_rxSize];   /* frames for the onReceive() handlers, run by events() */
+    uint32_t cbHead = 0, cbTail = 0;
+    CAN_message_t txQueue[_txSize];
+    uint32_t txHead = 0, txTail = 0;
+
+    struct can_frame ioFrame[FLEXCAN_SOCKETCAN_BATCH];
+    struct iovec ioVec[FLEXCAN_SOCKETCAN_BATCH];
+    struct mmsghdr ioMsg[FLEXCAN_SOCKETCAN_BATCH];
+    char ioControl[FLEXCAN_SOCKETCAN_BATCH][CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t))];
+};
+
+FCTP_FUNC FCTP_OPT::FlexCAN_T4() {
+  static_assert((_rxSize & (_rxSize - 1)) == 0 && (_txSize & (_txSize - 1)) == 0, "queue sizes are powers of two");
+  const char *fallback[4] = { "can0", "can0", "can1", "can2" };
+  char var[16];
+  snprintf(var, sizeof(var), "FLEXCAN_CAN%d", (int)_bus);
+  const char *name = getenv(var);
+  setInterface(( name && *name ) ? name : fallback[_bus]);
+  setMaxMB(16);
+}
+
+FCTP_FUNC void FCTP_OPT::setInterface(const char *name) {
+  strncpy(ifname, name, sizeof(ifname) - 1);
+  ifname[sizeof(ifname) - 1] = 0;
+}
+
+FCTP_FUNC uint64_t FCTP_OPT::realtimeNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts); /* same clock as the kernel software RX stamps */
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+FCTP_FUNC void FCTP_OPT::begin() {
+  end();
+  fd = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+  if ( fd < 0 ) {
+    fprintf(stderr, "FlexCAN_T4: %s: socket: %s\n", ifname, strerror(errno));
+    return;
+  }
+  struct sockaddr_can addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = if_nametoindex(ifname);
+  if ( !addr.can_ifindex || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ) {
+    fprintf(stderr, "FlexCAN_T4: %s: %s\n", ifname, ( addr.can_ifindex ) ? strerror(errno) : "no such interface");
+    end();
+    return;
+  }
+  int on = 1;
+  int stamping = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  if ( setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &stamping, sizeof(stamping)) < 0 ) {
+    fprintf(stderr, "FlexCAN_T4: %s: no SO_TIMESTAMPING, using receive time\n", ifname);
+  }
+  setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+  int own = loopBack;
+  setsockopt(fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &own, sizeof(own));
+  kernelDrops = 0;
+  filterDirty = 1;
+  applyKernelFilter();
+}
+
+FCTP_FUNC void FCTP_OPT::end() {
+  if ( fd >= 0 ) close(fd);
+  fd = -1;
+}
+
+FCTP_FUNC void FCTP_OPT::setBaudRate(uint32_t baud, FLEXCAN_RXTX listen_only) {
+  currentBitrate = baud;
+  listenOnly = ( listen_only == LISTEN_ONLY );
+}
+
+FCTP_FUNC void FCTP_OPT::enableLoopBack(bool yes) {
+  loopBack = yes;
+  int own = yes;
+  if ( fd >= 0 ) setsockopt(fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &own, sizeof(own));
+}
+
+FCTP_FUNC void FCTP_OPT::setMaxMB(uint8_t last) {
+  maxMB = ( last < 1 ) ? 1 : ( last > 64 ) ? 64 : last;
+  enableFIFO(fifoEnabled);
+}
+
+FCTP_FUNC void FCTP_OPT::enableFIFO(bool status) {
+  /* same layout as the FlexCAN: without the FIFO the first half of the
+     mailboxes receive (first quarter STD, second quarter EXT), with it every
+     mailbox after the FIFO area transmits */
+  fifoEnabled = status;
+  for ( uint8_t i = 0; i < 64; i++ ) {
+    mailbox_t &m = mb[i];
+    m.filter = FlexCAN_socketcan_filter_t();
+    m.interrupt = 0;
+    if ( i >= maxMB ) m.rxtx = LISTEN_ONLY;
+    else if ( fifoEnabled ) m.rxtx = ( i < mailboxOffset() ) ? LISTEN_ONLY : TX;
+    else {
+      m.rxtx = ( i < maxMB / 2 ) ? RX : TX;
+      m.ide = ( i < maxMB / 4 ) ? STD : EXT;
+    }
+  }
+  for ( uint8_t i = 0; i < 128; i++ ) fifoFilter[i] = FlexCAN_socketcan_filter_t();
+  filterDirty = 1;
+}
+
+FCTP_FUNC uint8_t FCTP_OPT::setRFFN(FLEXCAN_RFFN_TABLE rffn) {
+  fifoFilterSlots = (rffn + 1) * 8;
+  if ( fifoEnabled ) enableFIFO(1);
+  return fifoFilterSlots;
+}
+
+FCTP_FUNC bool FCTP_OPT::setMB(const FLEXCAN_MAILBOX &mb_num, const FLEXCAN_RXTX &mb_rx_tx, const FLEXCAN_IDE &ide) {
+  if ( mb_num < mailboxOffset() || mb_num >= maxMB ) return 0;
+  mailbox_t &m = mb[mb_num];
+  m.rxtx = ( ide == INACTIVE ) ? LISTEN_ONLY : mb_rx_tx;
+  if ( m.rxtx == RX ) m.ide = ( ide == EXT ) ? EXT : STD;
+  m.filter = FlexCAN_socketcan_filter_t();
+  filterDirty = 1;
+  return 1;
+}
+
+FCTP_FUNC void FCTP_OPT::enableMBInterrupt(const FLEXCAN_MAILBOX &mb_num, bool status) {
+  if ( mb_num == FIFO ) enableFIFOInterrupt(status);
+  else if ( mb_num < 64 ) mb[mb_num].interrupt = status;
+}
+
+FCTP_FUNC void FCTP_OPT::enableMBInterrupts(bool status) {
+  for ( uint8_t i = mailboxOffset(); i < maxMB; i++ ) mb[i].interrupt = status;
+}
+
+FCTP_FUNC void FCTP_OPT::onReceive(const FLEXCAN_MAILBOX &mb_num, _MB_ptr handler) {
+  if ( mb_num < 64 ) mb[mb_num].rxHandler = handler;
+  else if ( mb_num == FIFO ) _fifoHandler = handler;
+}
+
+FCTP_FUNC void FCTP_OPT::onTransmit(const FLEXCAN_MAILBOX &mb_num, _MB_ptr handler) {
+  if ( mb_num < 64 ) mb[mb_num].txHandler = handler;
+}
+
+FCTP_FUNC bool FCTP_OPT::setFilter(FLEXCAN_MAILBOX mb_num, uint8_t type, uint8_t count, const uint32_t *ids, uint32_t mask) {
+  if ( mb_num < mailboxOffset() || mb_num >= maxMB || mb[mb_num].rxtx != RX ) return 0; /* not an RX mailbox */
+  FlexCAN_socketcan_filter_t &f = mb[mb_num].filter;
+  f = FlexCAN_socketcan_filter_t();
+  f.type = type;
+  f.count = count;
+  for ( uint8_t i = 0; i < count; i++ ) f.ids[i] = ids[i];
+  f.mask = mask;
+  filterDirty = 1;
+  return 1;
+}
+
+FCTP_FUNC void FCTP_OPT::setMBFilter(FLEXCAN_FLTEN input) {
+  for ( uint8_t i = mailboxOffset(); i < maxMB; i++ ) setMBFilter((FLEXCAN_MAILBOX)i, input);
+}
+
+FCTP_FUNC void FCTP_OPT::setMBFilter(FLEXCAN_MAILBOX mb_num, FLEXCAN_FLTEN input) {
+  setFilter(mb_num, ( input == ACCEPT_ALL ) ? FLEXCAN_SOCKETCAN_ACCEPT : FLEXCAN_SOCKETCAN_REJECT, 0, nullptr, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1) {
+  uint32_t ids[] = { id1 };
+  return setFilter(mb_num, FLEXCAN_MULTI, 1, ids, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2) {
+  uint32_t ids[] = { id1, id2 };
+  return setFilter(mb_num, FLEXCAN_MULTI, 2, ids, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3) {
+  uint32_t ids[] = { id1, id2, id3 };
+  return setFilter(mb_num, FLEXCAN_MULTI, 3, ids, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t id4) {
+  uint32_t ids[] = { id1, id2, id3, id4 };
+  return setFilter(mb_num, FLEXCAN_MULTI, 4, ids, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t id4, uint32_t id5) {
+  uint32_t ids[] = { id1, id2, id3, id4, id5 };
+  return setFilter(mb_num, FLEXCAN_MULTI, 5, ids, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBFilterRange(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2) {
+  if ( id1 > id2 ) return 0;
+  uint32_t ids[] = { id1, id2 };
+  return setFilter(mb_num, FLEXCAN_RANGE, 2, ids, 0);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t mask) {
+  uint32_t ids[] = { id1 };
+  return setFilter(mb_num, FLEXCAN_USERMASK, 1, ids, mask);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t mask) {
+  uint32_t ids[] = { id1, id2 };
+  return setFilter(mb_num, FLEXCAN_USERMASK, 2, ids, mask);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t mask) {
+  uint32_t ids[] = { id1, id2, id3 };
+  return setFilter(mb_num, FLEXCAN_USERMASK, 3, ids, mask);
+}
+
+FCTP_FUNC bool FCTP_OPT::setMBUserFilter(FLEXCAN_MAILBOX mb_num, uint32_t id1, uint32_t id2, uint32_t id3, uint32_t id4, uint32_t mask) {
+  uint32_t ids[] = { id1, id2, id3, id4 };
+  return setFilter(mb_num, FLEXCAN_USERMASK, 4, ids, mask);
+}
+
+FCTP_FUNC bool FCTP_OPT::setFIFOFilter(uint8_t filter, uint8_t type, uint8_t count, const uint32_t *ids, uint32_t mask, uint8_t ide, uint8_t remote) {
+  if ( !fifoEnabled || filter >= fifoFilterSlots ) return 0;
+  FlexCAN_socketcan_filter_t &f = fifoFilter[filter];
+  f = FlexCAN_socketcan_filter_t();
+  f.type = type;
+  f.count = count;
+  for ( uint8_t i = 0; i < count; i++ ) f.ids[i] = ids[i];
+  f.mask = mask;
+  f.ide = ( ide == EXT ) ? EXT : STD;
+  f.remote = ( remote == RTR ) ? RTR : NONE;
+  filterDirty = 1;
+  return 1;
+}
+
+FCTP_FUNC void FCTP_OPT::setFIFOFilter(const FLEXCAN_FLTEN &input) {
+  if ( !fifoEnabled ) return;
+  for ( uint8_t i = 0; i < fifoFilterSlots; i++ ) {
+    fifoFilter[i] = FlexCAN_socketcan_filter_t();
+    fifoFilter[i].type = ( input == ACCEPT_ALL ) ? FLEXCAN_SOCKETCAN_ACCEPT : FLEXCAN_SOCKETCAN_REJECT;
+  }
+  filterDirty = 1;
+}
+
+FCTP_FUNC bool FCTP_OPT::setFIFOFilter(uint8_t filter, uint32_t id1, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote) {
+  uint32_t ids[] = { id1 };
+  return setFIFOFilter(filter, FLEXCAN_MULTI, 1, ids, 0, ide, remote);
+}
+
+FCTP_FUNC bool FCTP_OPT::setFIFOFilter(uint8_t filter, uint32_t id1, uint32_t id2, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote) {
+  uint32_t ids[] = { id1, id2 };
+  return setFIFOFilter(filter, FLEXCAN_MULTI, 2, ids, 0, ide, remote);
+}
+
+FCTP_FUNC bool FCTP_OPT::setFIFOFilterRange(uint8_t filter, uint32_t id1, uint32_t id2, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote) {
+  if ( id1 > id2 ) return 0;
+  uint32_t ids[] = { id1, id2 };
+  return setFIFOFilter(filter, FLEXCAN_RANGE, 2, ids, 0, ide, remote);
+}
+
+FCTP_FUNC bool FCTP_OPT::setFIFOUserFilter(uint8_t filter, uint32_t id1, uint32_t mask, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote) {
+  uint32_t ids[] = { id1 };
+  return setFIFOFilter(filter, FLEXCAN_USERMASK, 1, ids, mask, ide, remote);
+}
+
+FCTP_FUNC bool FCTP_OPT::setFIFOUserFilter(uint8_t filter, uint32_t id1, uint32_t id2, uint32_t mask, const FLEXCAN_IDE &ide, const FLEXCAN_IDE &remote) {
+  uint32_t ids[] = { id1, id2 };
+  return setFIFOFilter(filter, FLEXCAN_USERMASK, 2, ids, mask, ide, remote);
+}
+
+FCTP_FUNC bool FCTP_OPT::match(const FlexCAN_socketcan_filter_t &f, const CAN_message_t &msg, bool fifo) {
+  if ( f.type == FLEXCAN_SOCKETCAN_REJECT ) return 0;
+  if ( f.type == FLEXCAN_SOCKETCAN_ACCEPT ) return 1;
+  if ( fifo ) {
+    if ( msg.flags.extended != ( f.ide == EXT ) ) return 0;
+    if ( msg.flags.remote != ( f.remote == RTR ) ) return 0;
+  }
+  switch ( f.type ) {
+    case FLEXCAN_MULTI:
+      for ( uint8_t i = 0; i < f.count; i++ ) if ( msg.id == f.ids[i] ) return 1;
+      return 0;
+    case FLEXCAN_RANGE:
+      return ( msg.id >= f.ids[0] && msg.id <= f.ids[1] );
+    case FLEXCAN_USERMASK:
+      for ( uint8_t i = 0; i < f.count; i++ ) if ( !((msg.id ^ f.ids[i]) & f.mask) ) return 1;
+      return 0;
+  }
+  return 0;
+}
+
+FCTP_FUNC void FCTP_OPT::applyKernelFilter() {
+  if ( fd < 0 || !filterDirty ) return;
+  filterDirty = 0;
+  static struct can_filter list[CAN_RAW_FILTER_MAX];
+  uint32_t count = 0;
+  bool everything = 0;
+  auto add = [&](const FlexCAN_socketcan_filter_t &f, uint8_t ide) {
+    if ( f.type == FLEXCAN_SOCKETCAN_REJECT ) return;
+    uint32_t full = ( ide == EXT ) ? CAN_EFF_MASK : CAN_SFF_MASK;
+    uint32_t flag = ( ide == EXT ) ? CAN_EFF_FLAG : 0;
+    if ( f.type == FLEXCAN_SOCKETCAN_ACCEPT ) {
+      if ( ide == NONE ) everything = 1;
+      else if ( count < CAN_RAW_FILTER_MAX ) list[count++] = { flag, CAN_EFF_FLAG };
+      return;
+    }
+    if ( f.type == FLEXCAN_RANGE ) {
+      uint32_t diff = f.ids[0] ^ f.ids[1];
+      uint32_t mask = ( diff ) ? (full & ~((2UL << (31 - __builtin_clz(diff))) - 1)) : full; /* smallest covering mask */
+      if ( count < CAN_RAW_FILTER_MAX ) list[count++] = { (f.ids[0] & mask) | flag, mask | CAN_EFF_FLAG };
+      else everything = 1;
+      return;
+    }
+    for ( uint8_t i = 0; i < f.count; i++ ) {
+      uint32_t mask = ( f.type == FLEXCAN_USERMASK ) ? (f.mask & full) : full;
+      if ( count < CAN_RAW_FILTER_MAX ) list[count++] = { (f.ids[i] & mask) | flag, mask | CAN_EFF_FLAG };
+      else everything = 1;
+    }
+  };
+  if ( fifoEnabled ) for ( uint8_t i = 0; i < fifoFilterSlots; i++ ) add(fifoFilter[i], ( fifoFilter[i].type == FLEXCAN_SOCKETCAN_ACCEPT ) ? (uint8_t)NONE : fifoFilter[i].ide);
+  for ( uint8_t i = mailboxOffset(); i < maxMB; i++ ) if ( mb[i].rxtx == RX ) add(mb[i].filter, mb[i].ide);
+  if ( everything ) {
+    list[0] = { 0, 0 };
+    count = 1;
+  }
+  if ( setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, ( count ) ? list : nullptr, count * sizeof(struct can_filter)) < 0 ) {
+    fprintf(stderr, "FlexCAN_T4: %s: CAN_RAW_FILTER: %s\n", ifname, strerror(errno));
+  }
+}
+
+FCTP_FUNC void FCTP_OPT::deliver(const CAN_message_t &frame, uint64_t ns, bool hw) {
+  /* same order as the FlexCAN: FIFO first, then the RX mailboxes from the lowest */
+  CAN_message_t msg = frame;
+  bool found = 0, interrupt = 0;
+  if ( fifoEnabled ) {
+    for ( uint8_t i = 0; i < fifoFilterSlots && !found; i++ ) {
+      if ( !match(fifoFilter[i], msg, 1) ) continue;
+      msg.mb = FIFO;
+      msg.idhit = i;
+      interrupt = fifoInterrupt;
+      found = 1;
+    }
+  }
+  for ( uint8_t i = mailboxOffset(); i < maxMB && !found; i++ ) {
+    const mailbox_t &m = mb[i];
+    if ( m.rxtx != RX || msg.flags.extended != ( m.ide == EXT ) || !match(m.filter, msg, 0) ) continue;
+    msg.mb = i;
+    interrupt = m.interrupt;
+    found = 1;
+  }
+  if ( !found ) {
+    counters.rx_unmatched++;
+    return;
+  }
+  rx_entry_t *queue = ( interrupt ) ? cbQueue : rxQueue;
+  uint32_t &head = ( interrupt ) ? cbHead : rxHead;
+  uint32_t &tail = ( interrupt ) ? cbTail : rxTail;
+  if ( head - tail >= _rxSize ) {
+    counters.rx_queue_full++;
+    return;
+  }
+  rx_entry_t &e = queue[head++ & (_rxSize - 1)];
+  e.msg = msg;
+  e.ns = ns;
+  e.hw = hw;
+}
+
+FCTP_FUNC uint32_t FCTP_OPT::pull() {
+  if ( fd < 0 ) return 0;
+  applyKernelFilter();
+  uint32_t total = 0;
+  for ( ;; ) {
+    for ( uint8_t i = 0; i < FLEXCAN_SOCKETCAN_BATCH; i++ ) {
+      ioVec[i].iov_base = &ioFrame[i];
+      ioVec[i].iov_len = sizeof(struct can_frame);
+      memset(&ioMsg[i], 0, sizeof(ioMsg[i]));
+      ioMsg[i].msg_hdr.msg_iov = &ioVec[i];
+      ioMsg[i].msg_hdr.msg_iovlen = 1;
+      ioMsg[i].msg_hdr.msg_control = ioControl[i];
+      ioMsg[i].msg_hdr.msg_controllen = sizeof(ioControl[i]);
+    }
+    int n = recvmmsg(fd, ioMsg, FLEXCAN_SOCKETCAN_BATCH, MSG_DONTWAIT, nullptr);
+    if ( n <= 0 ) break;
+    uint64_t now = 0;
+    for ( int i = 0; i < n; i++ ) {
+      const struct can_frame &frame = ioFrame[i];
+      if ( ioMsg[i].msg_len < sizeof(struct can_frame) || (frame.can_id & CAN_ERR_FLAG) ) continue;
+      uint64_t ns = 0;
+      bool hw = 0;
+      for ( struct cmsghdr *c = CMSG_FIRSTHDR(&ioMsg[i].msg_hdr); c; c = CMSG_NXTHDR(&ioMsg[i].msg_hdr, c) ) {
+        if ( c->cmsg_level != SOL_SOCKET ) continue;
+        if ( c->cmsg_type == SCM_TIMESTAMPING ) {
+          struct scm_timestamping ts;
+          memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+          hw = ( ts.ts[2].tv_sec || ts.ts[2].tv_nsec );
+          const struct timespec &t = ts.ts[( hw ) ? 2 : 0];
+          ns = (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+        }
+        else if ( c->cmsg_type == SO_RXQ_OVFL ) {
+          uint32_t drops;
+          memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+          counters.rx_kernel_drops += drops - kernelDrops;
+          kernelDrops = drops;
+        }
+      }
+      if ( !ns ) ns = ( now ) ? now : (now = realtimeNs());
+      counters.hw_timestamps += hw;
+      CAN_message_t msg;
+      msg.flags.extended = ( frame.can_id & CAN_EFF_FLAG ) ? 1 : 0;
+      msg.flags.remote = ( frame.can_id & CAN_RTR_FLAG ) ? 1 : 0;
+      msg.id = frame.can_id & (( msg.flags.extended ) ? CAN_EFF_MASK : CAN_SFF_MASK);
+      msg.len = ( frame.can_dlc > 8 ) ? 8 : frame.can_dlc;
+      memcpy(msg.buf, frame.data, msg.len);
+      msg.timestamp = bitTime(ns);
+      msg.bus = _bus;
+      deliver(msg, ns, hw);
+    }
+    counters.rx_frames += n;
+    total += n;
+    if ( n < FLEXCAN_SOCKETCAN_BATCH ) break;
+  }
+  return total;
+}
+
+FCTP_FUNC int FCTP_OPT::readFrom(CAN_message_t &msg, int fifo) {
+  if ( rxHead == rxTail ) pull();
+  for ( uint32_t i = rxTail; i != rxHead; i++ ) {
+    rx_entry_t &e = rxQueue[i & (_rxSize - 1)];
+    if ( fifo >= 0 && (e.msg.mb == FIFO) != (bool)fifo ) continue;
+    msg = e.msg;
+    lastNs = e.ns;
+    lastHw = e.hw;
+    /* keep the others in order, the one taken is usually the oldest */
+    for ( uint32_t j = i; j != rxTail; j-- ) rxQueue[j & (_rxSize - 1)] = rxQueue[(j - 1) & (_rxSize - 1)];
+    rxTail++;
+    return 1;
+  }
+  return 0;
+}
+
+FCTP_FUNC int FCTP_OPT::read(CAN_message_t &msg) {
+  return readFrom(msg, -1);
+}
+
+FCTP_FUNC int FCTP_OPT::getFirstTxBox() {
+  for ( uint8_t i = mailboxOffset(); i < maxMB; i++ ) {
+    if ( reservedTxMB & (1ULL << i) ) continue;
+    if ( mb[i].rxtx == TX ) return i;
+  }
+  return -1;
+}
+
+FCTP_FUNC void FCTP_OPT::toFrame(const CAN_message_t &msg, struct can_frame &frame) {
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id = ( msg.flags.extended ) ? ((msg.id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (msg.id & CAN_SFF_MASK);
+  if ( msg.flags.remote ) frame.can_id |= CAN_RTR_FLAG;
+  frame.can_dlc = ( msg.len > 8 ) ? 8 : msg.len;
+  memcpy(frame.data, msg.buf, frame.can_dlc);
+}
+
+FCTP_FUNC void FCTP_OPT::stampTx(uint8_t mb_num, uint64_t ns, const CAN_message_t &msg) {
+  if ( mb_num < 64 ) mbStamp[mb_num] = bitTime(ns);
+  counters.tx_frames++;
+  if ( mb_num < 64 && mb[mb_num].txHandler ) mb[mb_num].txHandler(msg);
+  if ( _mainTxHandler ) _mainTxHandler(msg);
+}
+
+FCTP_FUNC int FCTP_OPT::write(FLEXCAN_MAILBOX mb_num, const CAN_message_t &msg) {
+  if ( fd < 0 || listenOnly ) return 0;
+  if ( mb_num < mailboxOffset() || mb_num >= maxMB || mb[mb_num].rxtx != TX ) return 0; /* not a transmit mailbox */
+  if ( txHead - txTail >= _txSize ) flushTx();
+  if ( txHead - txTail >= _txSize ) {
+    counters.tx_queue_full++;
+    return 0;
+  }
+  CAN_message_t &e = txQueue[txHead++ & (_txSize - 1)];
+  e = msg;
+  e.mb = mb_num;
+  e.bus = _bus;
+  if ( !txBatching ) flushTx();
+  return 1;
+}
+
+FCTP_FUNC int FCTP_OPT::write(const CAN_message_t &msg) {
+  int first = getFirstTxBox();
+  if ( first < 0 ) return 0;
+  return write((FLEXCAN_MAILBOX)first, msg);
+}
+
+FCTP_FUNC int FCTP_OPT::flushTx() {
+  if ( fd < 0 ) return 0;
+  if ( releasedTxMB ) releaseTxMB(releasedTxMB); /* retry mailboxes the interface did not take last time */
+  int sent = 0;
+  while ( txHead != txTail ) {
+    uint32_t n = txHead - txTail;
+    if ( n > FLEXCAN_SOCKETCAN_BATCH ) n = FLEXCAN_SOCKETCAN_BATCH;
+    for ( uint32_t i = 0; i < n; i++ ) {
+      toFrame(txQueue[(txTail + i) & (_txSize - 1)], ioFrame[i]);
+      ioVec[i].iov_base = &ioFrame[i];
+      ioVec[i].iov_len = sizeof(struct can_frame);
+      memset(&ioMsg[i], 0, sizeof(ioMsg[i]));
+      ioMsg[i].msg_hdr.msg_iov = &ioVec[i];
+      ioMsg[i].msg_hdr.msg_iovlen = 1;
+    }
+    int done = sendmmsg(fd, ioMsg, n, MSG_DONTWAIT);
+    if ( done < 0 ) {
+      if ( errno == ENOBUFS || errno == EAGAIN ) counters.tx_busy++;
+      else counters.tx_errors++;
+      break; /* frames stay queued, events() tries again */
+    }
+    uint64_t now = realtimeNs();
+    for ( int i = 0; i < done; i++ ) {
+      CAN_message_t msg = txQueue[txTail++ & (_txSize - 1)];
+      stampTx(msg.mb, now, msg);
+    }
+    sent += done;
+    if ( (uint32_t)done < n ) {
+      counters.tx_busy++;
+      break;
+    }
+  }
+  return sent;
+}
+
+FCTP_FUNC void FCTP_OPT::reserveTxMB(const FLEXCAN_MAILBOX &mb_num, bool state) {
+  if ( mb_num < mailboxOffset() || mb_num >= maxMB ) return; /* FIFO doesn't transmit */
+  if ( state ) {
+    setMB(mb_num, TX);
+    reservedTxMB |= (1ULL << mb_num);
+  }
+  else reservedTxMB &= ~(1ULL << mb_num);
+}
+
+FCTP_FUNC bool FCTP_OPT::stageTxMB(const FLEXCAN_MAILBOX &mb_num, const CAN_message_t &msg) {
+  if ( mb_num >= 64 || !(reservedTxMB & (1ULL << mb_num)) ) return 0; /* only reserved mailboxes can be staged */
+  if ( releasedTxMB & (1ULL << mb_num) ) return 0; /* previous frame still pending */
+  mb[mb_num].staged = msg;
+  mb[mb_num].staged.mb = mb_num;
+  mb[mb_num].staged.bus = _bus;
+  return 1;
+}
+
+FCTP_FUNC void FCTP_OPT::releaseTxMB(uint64_t mask) {
+  mask &= reservedTxMB;
+  if ( fd < 0 || listenOnly || !mask ) return;
+  releasedTxMB |= mask;
+  uint8_t order[FLEXCAN_SOCKETCAN_BATCH];
+  uint32_t n = 0;
+  for ( uint64_t m = mask; m && n < FLEXCAN_SOCKETCAN_BATCH; m &= m - 1 ) {
+    uint8_t mb_num = __builtin_ctzll(m);
+    order[n] = mb_num;
+    toFrame(mb[mb_num].staged, ioFrame[n]);
+    ioVec[n].iov_base = &ioFrame[n];
+    ioVec[n].iov_len = sizeof(struct can_frame);
+    memset(&ioMsg[n], 0, sizeof(ioMsg[n]));
+    ioMsg[n].msg_hdr.msg_iov = &ioVec[n];
+    ioMsg[n].msg_hdr.msg_iovlen = 1;
+    n++;
+  }
+  int done = sendmmsg(fd, ioMsg, n, MSG_DONTWAIT); /* one call, back to back in the interface queue */
+  if ( done < 0 ) {
+    if ( errno == ENOBUFS || errno == EAGAIN ) counters.tx_busy++;
+    else counters.tx_errors++;
+    return; /* stay released, flushTx() retries */
+  }
+  uint64_t now = realtimeNs();
+  for ( int i = 0; i < done; i++ ) {
+    releasedTxMB &= ~(1ULL << order[i]);
+    stampTx(order[i], now, mb[order[i]].staged);
+  }
+  if ( (uint32_t)done < n ) counters.tx_busy++;
+}
+
+FCTP_FUNC uint64_t FCTP_OPT::events() {
+  pull();
+  while ( cbHead != cbTail ) {
+    rx_entry_t e = cbQueue[cbTail++ & (_rxSize - 1)];
+    lastNs = e.ns;
+    lastHw = e.hw;
+    _MB_ptr handler = ( e.msg.mb == FIFO ) ? _fifoHandler : mb[e.msg.mb].rxHandler;
+    if ( handler ) handler(e.msg);
+    if ( _mainHandler ) _mainHandler(e.msg);
+  }
+  if ( txHead != txTail || releasedTxMB ) flushTx();
+  return (uint64_t)((rxHead - rxTail) << 12) | (txHead - txTail);
+}
+
+FCTP_FUNC void FCTP_OPT::mailboxStatus() {
+  static const char *types[] = { "REJECT", "MULTI", "RANGE", "TABLE_B_MULTI", "TABLE_B_RANGE", "USERMASK" };
+  auto describe = [](const FlexCAN_socketcan_filter_t &f) {
+    if ( f.type == FLEXCAN_SOCKETCAN_ACCEPT ) { printf("ACCEPT_ALL"); return; }
+    printf("%s", types[( f.type <= FLEXCAN_USERMASK ) ? f.type : 0]);
+    for ( uint8_t i = 0; i < f.count; i++ ) printf(" 0x%lX", (unsigned long)f.ids[i]);
+    if ( f.type == FLEXCAN_USERMASK ) printf(" mask 0x%lX", (unsigned long)f.mask);
+  };
+  printf("%s (%s), %lu bit/s%s\n", ifname, ( fd >= 0 ) ? "open" : "closed", (unsigned long)currentBitrate, ( listenOnly ) ? ", listen only" : "");
+  if ( fifoEnabled ) {
+    printf("FIFO Enabled --> Interrupt %s\n", ( fifoInterrupt ) ? "Enabled" : "Disabled");
+    for ( uint8_t i = 0; i < fifoFilterSlots; i++ ) {
+      if ( fifoFilter[i].type == FLEXCAN_SOCKETCAN_REJECT ) continue;
+      printf("\tFIFO filter %u: ", i);
+      if ( fifoFilter[i].type != FLEXCAN_SOCKETCAN_ACCEPT ) printf("%s%s ", ( fifoFilter[i].ide == EXT ) ? "EXT" : "STD", ( fifoFilter[i].remote == RTR ) ? " RTR" : "");
+      describe(fifoFilter[i]);
+      printf("\n");
+    }
+  }
+  else printf("FIFO Disabled\n");
+  for ( uint8_t i = mailboxOffset(); i < maxMB; i++ ) {
+    const mailbox_t &m = mb[i];
+    if ( m.rxtx == LISTEN_ONLY ) printf("\tMB%u code: INACTIVE\n", i);
+    else if ( m.rxtx == TX ) printf("\tMB%u code: TX%s%s\n", i, ( reservedTxMB & (1ULL << i) ) ? " (reserved)" : "", ( releasedTxMB & (1ULL << i) ) ? " pending" : "");
+    else {
+      printf("\tMB%u code: RX %s%s ", i, ( m.ide == EXT ) ? "EXT" : "STD", ( m.interrupt ) ? " interrupt" : "");
+      describe(m.filter);
+      printf("\n");
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,233 @@
+/*
+  rcinput_test.cpp
+  ----------------
+  Checks the MiniRob PPM and SBUS receiver decoders
+  (MiniRobArduino/RcPpmInput.cpp, RcSbusInput.cpp) against synthetic edge
+  timings and byte streams, no receiver needed:
+
+      g++ -O2 -std=c++17 -Wall -Wextra -I host/include -I ../../MiniRobArduino host/rcinput_test.cpp ../../MiniRobArduino/RcPpmInput.cpp ../../MiniRobArduino/RcSbusInput.cpp -o rcinput_test
+      ./rcinput_test
+
+  PPM: rising edge times for 8 channel frames are fed to edge(), starting
+  in the middle of a frame, with the sync gap, a glitch in the middle of a
+  frame, a frame with a pulse out of range and the signal stopping and
+  coming back mid-frame. SBUS: 25 byte frames are packed the way a receiver sends them
+  and fed to feed() one byte at a time, with the frame-lost and failsafe
+  flags, noise before the header, a dropped byte and an SBUS2 footer. The
+  decoded channels, flags and counters are compared each time. Exits 0
+  when everything matches.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RcPpmInput.h"
+#include "RcSbusInput.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if ( !(cond) ) { printf("FAIL %s:%d  %s\n", __FILE__, __LINE__, #cond); failures++; } } while ( 0 )
+
+static void checkWidths(const RcInput &rc, const uint16_t *expected, uint8_t n) {
+  CHECK(rc.channels() == n);
+  for ( uint8_t i = 0; i < n; i++ ) {
+    RC_channel_t c;
+    CHECK(rc.read(i, c));
+    if ( c.width_us != expected[i] ) {
+      printf("FAIL channel %u: %u us, expected %u\n", i, c.width_us, expected[i]);
+      failures++;
+    }
+  }
+}
+
+/* the edges after each channel, then the one that ends the sync gap */
+static void ppmFrame(RcPpmInput &rc, uint32_t &t, const uint16_t *w, uint8_t n, uint32_t frame_us = 20000) {
+  uint32_t start = t;
+  for ( uint8_t i = 0; i < n; i++ ) rc.edge(t += w[i]);
+  rc.edge(t = start + frame_us);
+}
+
+static void testPpm() {
+  RcPpmInput rc;
+  const uint16_t a[8] = { 1500, 1000, 2000, 1250, 1750, 1100, 1900, 1500 };
+  const uint16_t b[8] = { 1520, 1010, 1990, 1260, 1740, 1110, 1890, 1480 };
+  uint32_t t = micros() - 500000;      /* edges in the past, so read() sees them as fresh */
+  rc.setTimeout(1000000);
+
+  /* decoding starts in channel 4: the first edge is not a sync, the rest of
+     that frame must not come out as channels 0..3 */
+  uint32_t start = t - 7000;
+  rc.edge(t);
+  for ( uint8_t i = 4; i < 8; i++ ) rc.edge(t += a[i]);
+  rc.edge(t = start + 20000);
+  CHECK(rc.frames() == 0);
+  CHECK(rc.channels() == 0);
+  CHECK(rc.lostFrames() == 0);
+
+  /* first frame after a measured gap: channel count not known yet,
+     published at the next sync gap */
+  start = t;
+  for ( uint8_t i = 0; i < 8; i++ ) rc.edge(t += a[i]);
+  CHECK(rc.frames() == 0);
+  rc.edge(t = start + 20000);
+  CHECK(rc.frames() == 1);
+  checkWidths(rc, a, 8);
+  CHECK(rc.widthOr(2, 0) == 2000);
+
+  /* second frame: published on its 8th channel, before the gap */
+  for ( uint8_t i = 0; i < 8; i++ ) rc.edge(t += b[i]);
+  CHECK(rc.frames() == 2);
+  checkWidths(rc, b, 8);
+  rc.edge(t += 6000);
+  CHECK(rc.frames() == 2);
+
+  /* glitch: a spurious edge 300 us into channel 4 drops the frame */
+  start = t;
+  for ( uint8_t i = 0; i < 3; i++ ) rc.edge(t += a[i]);
+  rc.edge(t += 300);
+  rc.edge(t += a[3] - 300);
+  for ( uint8_t i = 4; i < 8; i++ ) rc.edge(t += a[i]);
+  rc.edge(t = start + 20000);
+  CHECK(rc.frames() == 2);
+  CHECK(rc.lostFrames() == 1);
+  checkWidths(rc, b, 8);               /* the last good frame stays */
+
+  /* a pulse over RC_MAX_PULSE_US but under the sync gap drops the frame too */
+  uint16_t wide[8];
+  memcpy(wide, a, sizeof(wide));
+  wide[5] = 2500;
+  ppmFrame(rc, t, wide, 8);
+  CHECK(rc.frames() == 2);
+  CHECK(rc.lostFrames() == 2);
+
+  /* back in sync after the gap */
+  ppmFrame(rc, t, a, 8);
+  CHECK(rc.frames() == 3);
+  CHECK(rc.lostFrames() == 2);
+  checkWidths(rc, a, 8);
+
+  /* a receiver switched to 6 channels: the short frame is published at the gap */
+  ppmFrame(rc, t, b, 6);
+  CHECK(rc.frames() == 4);
+  checkWidths(rc, b, 6);
+
+  /* the signal stops in the middle of a frame and comes back in the middle
+     of another: neither partial frame is published, the channel count is
+     learned again from the first whole frame */
+  for ( uint8_t i = 0; i < 3; i++ ) rc.edge(t += b[i]);
+  t += 100000;
+  rc.edge(t);
+  CHECK(rc.lostFrames() == 3);
+  start = t - 5000;
+  for ( uint8_t i = 3; i < 6; i++ ) rc.edge(t += b[i]);
+  rc.edge(t = start + 20000);
+  CHECK(rc.frames() == 4);
+  checkWidths(rc, b, 6);
+  ppmFrame(rc, t, a, 8);
+  CHECK(rc.frames() == 5);
+  checkWidths(rc, a, 8);
+}
+
+/* 16 x 11 bit channels, LSB first, then flags and footer */
+static void sbusFrame(uint8_t *frame, const uint16_t *raw, uint8_t flags, uint8_t footer = 0x00) {
+  memset(frame, 0, RC_SBUS_FRAME_SIZE);
+  frame[0] = RC_SBUS_HEADER;
+  for ( uint16_t bit = 0; bit < RC_SBUS_CHANNELS * 11; bit++ ) {
+    if ( raw[bit / 11] & (1 << (bit % 11)) ) frame[1 + (bit >> 3)] |= 1 << (bit & 7);
+  }
+  frame[RC_SBUS_FRAME_SIZE - 2] = flags;
+  frame[RC_SBUS_FRAME_SIZE - 1] = footer;
+}
+
+/* number of bytes that completed a good frame */
+static uint8_t feed(RcSbusInput &rc, const uint8_t *bytes, uint8_t n, uint32_t now) {
+  uint8_t good = 0;
+  for ( uint8_t i = 0; i < n; i++ ) good += rc.feed(bytes[i], now);
+  return good;
+}
+
+static void testSbus() {
+  RcSbusInput rc;
+  uint16_t raw[RC_SBUS_CHANNELS], us[RC_SBUS_CHANNELS];
+  for ( uint8_t i = 0; i < RC_SBUS_CHANNELS; i++ ) {
+    raw[i] = 192 + 100 * i;            /* 192 .. 1692 */
+    us[i] = 880 + (raw[i] * 5 >> 3);   /* 0.625 us per count */
+  }
+  raw[0] = 172;  us[0] = 987;          /* the usual endpoints and centre */
+  raw[1] = 992;  us[1] = 1500;
+  raw[2] = 1811; us[2] = 2011;
+  uint8_t frame[RC_SBUS_FRAME_SIZE];
+  uint32_t now = micros();
+
+  /* plain frame, CH17 on */
+  sbusFrame(frame, raw, RC_SBUS_FLAG_CH17);
+  for ( uint8_t i = 1; i < RC_SBUS_FRAME_SIZE - 1; i++ ) CHECK(frame[i] != RC_SBUS_HEADER); /* the resync case below needs that */
+  CHECK(feed(rc, frame, RC_SBUS_FRAME_SIZE - 1, now) == 0);
+  CHECK(rc.feed(frame[RC_SBUS_FRAME_SIZE - 1], now));
+  CHECK(rc.frames() == 1);
+  CHECK(rc.lostFrames() == 0);
+  checkWidths(rc, us, RC_SBUS_CHANNELS);
+  CHECK(rc.digital(0) && !rc.digital(1));
+  RC_channel_t c;
+  CHECK(rc.read(1, c) && c.fresh && !c.failsafe);
+
+  /* receiver reports a lost frame: still published, counted as lost */
+  sbusFrame(frame, raw, RC_SBUS_FLAG_CH18 | RC_SBUS_FLAG_FRAME_LOST);
+  CHECK(feed(rc, frame, RC_SBUS_FRAME_SIZE, now) == 1);
+  CHECK(rc.frames() == 2);
+  CHECK(rc.lostFrames() == 1);
+  CHECK(!rc.digital(0) && rc.digital(1));
+
+  /* failsafe: channels read as failsafe, widthOr() falls back */
+  sbusFrame(frame, raw, RC_SBUS_FLAG_FRAME_LOST | RC_SBUS_FLAG_FAILSAFE);
+  CHECK(feed(rc, frame, RC_SBUS_FRAME_SIZE, now) == 1);
+  CHECK(rc.read(1, c) && c.failsafe && c.width_us == 1500);
+  CHECK(rc.widthOr(1, 1234) == 1234);
+  CHECK(rc.lostFrames() == 2);
+
+  /* noise before the header is skipped byte by byte */
+  const uint8_t noise[] = { 0xAA, 0x55, 0x00 };
+  sbusFrame(frame, raw, 0);
+  uint32_t resyncs = rc.syncErrors();
+  CHECK(feed(rc, noise, sizeof(noise), now) == 0);
+  CHECK(rc.syncErrors() == resyncs + 3);
+  CHECK(feed(rc, frame, RC_SBUS_FRAME_SIZE, now) == 1);
+  CHECK(rc.widthOr(1, 1234) == 1500);
+  CHECK(rc.frames() == 4);
+
+  /* a dropped byte: the short frame runs into the next header, is thrown
+     away, and the decoder picks the next frame up from that header */
+  uint16_t raw2[RC_SBUS_CHANNELS], us2[RC_SBUS_CHANNELS];
+  for ( uint8_t i = 0; i < RC_SBUS_CHANNELS; i++ ) {
+    raw2[i] = 1692 - 100 * i;
+    us2[i] = 880 + (raw2[i] * 5 >> 3);
+  }
+  uint8_t next[RC_SBUS_FRAME_SIZE];
+  sbusFrame(next, raw2, 0);
+  CHECK(feed(rc, frame, 10, now) == 0);
+  CHECK(feed(rc, frame + 11, RC_SBUS_FRAME_SIZE - 11, now) == 0);
+  uint32_t lost = rc.lostFrames();
+  CHECK(feed(rc, next, RC_SBUS_FRAME_SIZE, now) == 1);
+  CHECK(rc.lostFrames() == lost + 1);
+  CHECK(rc.frames() == 5);
+  checkWidths(rc, us2, RC_SBUS_CHANNELS);
+
+  /* a bad footer drops the frame, the last good channels stay */
+  sbusFrame(frame, raw, 0, 0xFF);
+  CHECK(feed(rc, frame, RC_SBUS_FRAME_SIZE, now) == 0);
+  CHECK(rc.frames() == 5);
+  checkWidths(rc, us2, RC_SBUS_CHANNELS);
+
+  /* SBUS2 footer */
+  sbusFrame(frame, raw, 0, 0x14);
+  CHECK(feed(rc, frame, RC_SBUS_FRAME_SIZE, now) == 1);
+  CHECK(rc.frames() == 6);
+  checkWidths(rc, us, RC_SBUS_CHANNELS);
+}
+
+int main() {
+  testPpm();
+  testSbus();
+  printf("%s, %d failure(s)\n", failures ? "FAILED" : "ok", failures);
+  return failures ? 1 : 0;
+}
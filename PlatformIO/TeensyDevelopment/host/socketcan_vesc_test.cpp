@@ -0,0 +1,159 @@
+/*
+  socketcan_vesc_test.cpp
+  -----------------------
+  Runs lib/CanDiscovery and lib/VescCAN unchanged on Linux through the
+  SocketCAN FlexCAN_T4 (host/include/FlexCAN_T4_SocketCAN.h). CAN1 is the
+  Teensy side, CAN2 plays three VESCs (IDs 1..3) that send STATUS_1 at
+  50 Hz and answer pings, so a vcan interface is all that is needed:
+
+      sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+      g++ -O2 -std=c++17 -I host/include -I lib/VescCAN -I lib/CanDB -I lib/CanDiscovery host/socketcan_vesc_test.cpp -o socketcan_vesc_test
+      FLEXCAN_CAN1=vcan0 FLEXCAN_CAN2=vcan0 ./socketcan_vesc_test
+
+  After discovery the simulated VESCs switch to full rate: STATUS_1, 2, 4
+  and 5 every millisecond each, the fastest VESC Tool sets, 12000 frames/s
+  for 2 s, and every one of them has to reach the receive callback.
+
+  Exits 0 when discovery found the three simulated VESCs and no status
+  frame was lost at full rate. With a real bus, point CAN2 at an unused
+  interface and the map shows whatever answers on can0 (the exit code then
+  only says whether three or more VESCs did, the full rate run is skipped).
+*/
+
+#include "Arduino.h"
+#include "FlexCAN_T4.h"
+#include "VescCAN.h"
+#include "VescBurst.h"
+#include "VescTelemetry.h"
+#include "CanDiscovery.h"
+
+typedef FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_64> master_t;
+master_t can1;
+FlexCAN_T4<CAN2, RX_SIZE_64, TX_SIZE_64> sim;
+CAN_discovery<master_t> discovery(can1);
+VESC_telemetry<4> telemetry;
+uint32_t statusFrames = 0;
+
+void canRx(const CAN_message_t &msg) {
+  discovery.process(msg);
+  if ( telemetry.process(msg, micros()) ) statusFrames++;
+}
+
+/* the simulated VESCs, pings come in on an EXT mailbox filtered to CAN_PACKET_PING */
+void simPing(const CAN_message_t &msg) {
+  uint8_t target = VESC_CAN_CONTROLLER(msg.id);
+  if ( target < 1 || target > 3 || !msg.len ) return;
+  CAN_message_t pong;
+  pong.id = VESC_CAN_ID(CAN_PACKET_PONG, msg.buf[0]);
+  pong.flags.extended = 1;
+  pong.len = 2;
+  pong.buf[0] = target;
+  pong.buf[1] = 10 + target;
+  sim.write(pong);
+}
+
+void simStatus(uint8_t controller, uint32_t now) {
+  CAN_message_t status;
+  VESC_STATUS_1::init(status, controller);
+  VESC_STATUS_1::erpm::set(status.buf, 1000 * controller + (int32_t)(now / 1000 % 1000));
+  sim.write(status);
+}
+
+/* every status packet VescTelemetry keeps, as a VESC at full rate sends them */
+uint8_t simStatusAll(uint8_t controller, uint32_t now) {
+  simStatus(controller, now);
+  CAN_message_t msg;
+  VESC_STATUS_2::init(msg, controller);
+  VESC_STATUS_2::amp_hours::encode(msg.buf, 1.5f);
+  sim.write(msg);
+  VESC_STATUS_4::init(msg, controller);
+  VESC_STATUS_4::temp_fet::encode(msg.buf, 30.0f + controller);
+  sim.write(msg);
+  VESC_STATUS_5::init(msg, controller);
+  VESC_STATUS_5::tachometer::set(msg.buf, (int32_t)(now / 100));
+  VESC_STATUS_5::v_in::encode(msg.buf, 48.0f);
+  sim.write(msg);
+  return 4;
+}
+
+int main() {
+  sim.begin();
+  sim.setMBFilter(REJECT_ALL);
+  sim.setMBUserFilter(MB4, VESC_CAN_ID(CAN_PACKET_PING, 0), 0x1FFFFF00); /* any target */
+  sim.enableMBInterrupt(MB4);
+  sim.onReceive(MB4, simPing);
+  sim.setTxBatching();
+  sim.setBaudRate(500000);
+
+  can1.begin();
+  can1.setBaudRate(500000);
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(FIFO, canRx);
+  if ( !can1.isOpen() || !sim.isOpen() ) return 1;
+  can1.mailboxStatus();
+
+  discovery.begin(500000, 200, 20);
+  uint32_t lastStatus = 0;
+  while ( 1 ) {
+    uint32_t now = micros();
+    if ( now - lastStatus >= 20000 ) {
+      lastStatus = now;
+      for ( uint8_t i = 1; i <= 3; i++ ) simStatus(i, now);
+    }
+    sim.events();
+    can1.events();
+    if ( discovery.update() ) break;
+    delayMicroseconds(100);
+  }
+  discovery.printMap();
+
+  /* one burst per tick to all three, then the spread as seen by getMBTimestamp() */
+  VESC_controller vesc[3] = { VESC_controller(1), VESC_controller(2), VESC_controller(3) };
+  VESC_burst<master_t, 3> burst(can1, MB12);
+  burst.begin();
+  for ( int tick = 0; tick < 100; tick++ ) {
+    for ( uint8_t i = 0; i < 3; i++ ) burst.set(i, vesc[i].setCurrent(1.0f + i));
+    burst.release();
+    can1.events();
+    sim.events();
+    delay(1);
+  }
+  VESC_burst_stats_t b = burst.stats();
+  printf("burst: %lu ticks, %lu frames, %lu overruns, max spread %lu us\n",
+         (unsigned long)b.ticks, (unsigned long)b.frames, (unsigned long)b.overruns, (unsigned long)b.max_spread_us);
+
+  VESC_telemetry_t t;
+  for ( uint8_t i = 1; i <= 3; i++ ) {
+    if ( telemetry.read(i, t) ) printf("VESC %u erpm %ld\n", i, (long)t.status.erpm);
+  }
+  const FlexCAN_socketcan_stats_t &s = can1.socketStats();
+  printf("CAN1 %s: rx %lu (unmatched %lu, queue full %lu, kernel drops %lu, hw stamps %lu), tx %lu (busy %lu, errors %lu)\n",
+         can1.getInterface(), (unsigned long)s.rx_frames, (unsigned long)s.rx_unmatched, (unsigned long)s.rx_queue_full,
+         (unsigned long)s.rx_kernel_drops, (unsigned long)s.hw_timestamps, (unsigned long)s.tx_frames,
+         (unsigned long)s.tx_busy, (unsigned long)s.tx_errors);
+  CAN_vesc_node_t found[4];
+  if ( discovery.vescs(found, 4) < 3 ) return 1;
+  if ( strncmp(can1.getInterface(), "vcan", 4) ) return 0;
+
+  /* full rate, paced by micros() with no sleep, then 100 ms to drain */
+  uint32_t sent = 0, before = statusFrames, start = micros(), next = start;
+  while ( micros() - start < 2000000 ) {
+    uint32_t now = micros();
+    if ( (int32_t)(now - next) >= 0 ) {
+      next += 1000;
+      for ( uint8_t i = 1; i <= 3; i++ ) sent += simStatusAll(i, now);
+    }
+    sim.events();
+    can1.events();
+  }
+  for ( uint32_t drain = micros(); micros() - drain < 100000; ) {
+    sim.events();
+    can1.events();
+  }
+  uint32_t received = statusFrames - before;
+  printf("full rate: %lu status frames sent, %lu received (%lu frames/s), kernel drops %lu, queue full %lu\n",
+         (unsigned long)sent, (unsigned long)received, (unsigned long)(received / 2), (unsigned long)s.rx_kernel_drops,
+         (unsigned long)s.rx_queue_full);
+  return ( received == sent ) ? 0 : 1;
+}
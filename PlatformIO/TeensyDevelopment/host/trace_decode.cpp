@@ -0,0 +1,124 @@
+/*
+  trace_decode.cpp
+  ----------------
+  Turns the binary TraceLog stream (lib/TraceLog) back into text.
+
+      g++ -O2 -std=c++17 -I lib/TraceLog host/trace_decode.cpp -o trace_decode
+      ./trace_decode /dev/ttyACM0        # live, puts the port in raw mode
+      ./trace_decode capture.bin         # or a saved stream, or stdin
+
+  Each line is the time since the first record in microseconds followed by
+  the event formatted with its string from TraceEvents.h. The 32-bit cycle
+  stamps are unwrapped here, so there must be at least one event every
+  2^32 cycles (about 7 s at 600 MHz) for the times to stay continuous.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "TraceFormat.h"
+#include "TraceEvents.h"
+
+#define TRACE_EVENT(name, format) { #name, format },
+static const struct { const char *name; const char *format; } events[] = { TRACE_EVENT_LIST };
+#undef TRACE_EVENT
+
+static bool readFull(int fd, void *buf, size_t len) {
+  uint8_t *p = (uint8_t*)buf;
+  while ( len ) {
+    ssize_t n = read(fd, p, len);
+    if ( n <= 0 ) return 0;
+    p += n;
+    len -= n;
+  }
+  return 1;
+}
+
+/* formats one conversion at a time so %ld gets a sign extended slot and %lu/%lx do not */
+static void formatEvent(char *out, size_t size, const char *format, const TraceLog_record_t &r) {
+  const uint32_t args[3] = { r.arg16, r.arg0, r.arg1 };
+  uint8_t arg = 0;
+  size_t used = 0;
+  char piece[64];
+  while ( *format && used < size - 1 ) {
+    const char *next = strchr(format + (*format == '%'), '%');
+    size_t len = ( next ) ? (size_t)(next - format) : strlen(format);
+    if ( len >= sizeof(piece) ) len = sizeof(piece) - 1;
+    memcpy(piece, format, len);
+    piece[len] = 0;
+    format += len;
+    int n;
+    if ( piece[0] != '%' || arg >= 3 ) n = snprintf(out + used, size - used, "%s", piece);
+    else {
+      const char *conv = piece + 1 + strspn(piece + 1, "l0123456789");
+      if ( *conv == 'd' || *conv == 'i' ) n = snprintf(out + used, size - used, piece, (long)(int32_t)args[arg]);
+      else if ( conv[-1] == 'l' ) n = snprintf(out + used, size - used, piece, (unsigned long)args[arg]);
+      else n = snprintf(out + used, size - used, piece, (unsigned)args[arg]);
+      arg++;
+    }
+    if ( n < 0 ) break;
+    used += n;
+  }
+  out[( used < size ) ? used : size - 1] = 0;
+}
+
+int main(int argc, char **argv) {
+  int fd = 0;
+  if ( argc > 1 ) {
+    fd = open(argv[1], O_RDONLY | O_NOCTTY);
+    if ( fd < 0 ) {
+      perror(argv[1]);
+      return 1;
+    }
+    struct termios tio;
+    if ( !tcgetattr(fd, &tio) ) {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+
+  uint64_t cycles = 0, first = 0;
+  uint32_t lastStamp = 0, lastDropped = 0;
+  bool started = 0;
+  uint8_t window[2] = { 0, 0 };
+  TraceLog_record_t r;
+  char text[256];
+
+  while ( 1 ) {
+    /* resynchronise on the batch magic, the stream may be joined mid-batch */
+    window[0] = window[1];
+    if ( !readFull(fd, &window[1], 1) ) break;
+    if ( (uint16_t)(window[0] | (window[1] << 8)) != TRACE_MAGIC ) continue;
+
+    TraceLog_batch_t batch;
+    batch.magic = TRACE_MAGIC;
+    if ( !readFull(fd, (uint8_t*)&batch + 2, sizeof(batch) - 2) ) break;
+    window[1] = 0;
+    if ( !batch.cycles_per_us || batch.count > 4096 ) continue; /* false magic inside a record */
+    if ( batch.dropped != lastDropped ) {
+      printf("# %lu records dropped on the target\n", (unsigned long)(batch.dropped - lastDropped));
+      lastDropped = batch.dropped;
+    }
+
+    for ( uint16_t i = 0; i < batch.count; i++ ) {
+      if ( !readFull(fd, &r, sizeof(r)) ) return 0;
+      if ( !started ) {
+        first = cycles = r.stamp;
+        started = 1;
+      }
+      else cycles += (uint32_t)(r.stamp - lastStamp);
+      lastStamp = r.stamp;
+      double us = (double)(cycles - first) / batch.cycles_per_us;
+      if ( r.event < TRACE_EVENT_COUNT ) {
+        formatEvent(text, sizeof(text), events[r.event].format, r);
+        printf("%14.3f  %-22s %s\n", us, events[r.event].name, text);
+      }
+      else printf("%14.3f  event %u  %u %lu %lu\n", us, r.event, r.arg16, (unsigned long)r.arg0, (unsigned long)r.arg1);
+    }
+    fflush(stdout);
+  }
+  return 0;
+}
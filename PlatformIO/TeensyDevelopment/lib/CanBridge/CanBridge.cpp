@@ -0,0 +1,250 @@
+/*
+  CanBridge.cpp
+  -------------
+  See CanBridge.h.
+*/
+
+#include "CanBridge.h"
+
+CanBridge canBridge;
+
+#define BRIDGE_CS_KEEP (FLEXCAN_MB_CS_DLC_MASK | FLEXCAN_MB_CS_RTR | FLEXCAN_MB_CS_IDE) /* FIFO output has IDHIT above these */
+
+int8_t CanBridge::addRoute(uint8_t src, uint32_t id, uint32_t mask, uint8_t dst_mask, uint8_t flags) {
+  if ( running || routeCount >= CAN_BRIDGE_ROUTES || src < 1 || src > CAN_BRIDGE_BUSES ) return -1;
+  route_t &r = routes[routeCount];
+  uint32_t width = ( flags & CAN_BRIDGE_EXT ) ? 0x1FFFFFFF : 0x7FF;
+  r.mask = mask & width;
+  r.id = id & r.mask;
+  r.src = src;
+  r.dst = dst_mask & 0x0E; /* CAN1..CAN3 */
+  r.flags = flags;
+  return routeCount++;
+}
+
+void CanBridge::setRewrite(int8_t route, uint32_t mask, uint32_t value) {
+  if ( running || route < 0 || route >= routeCount ) return;
+  uint32_t width = ( routes[route].flags & CAN_BRIDGE_EXT ) ? 0x1FFFFFFF : 0x7FF;
+  routes[route].rewriteMask = mask & width;
+  routes[route].rewriteValue = value & mask & width;
+}
+
+void CanBridge::setRateLimit(int8_t route, uint32_t frames_per_s, uint16_t burst) {
+  if ( running || route < 0 || route >= routeCount ) return;
+  route_t &r = routes[route];
+  if ( !frames_per_s ) {
+    r.periodUs = 0;
+    return;
+  }
+  r.periodUs = ( frames_per_s > 1000000 ) ? 1 : 1000000 / frames_per_s;
+  r.burstUs = r.periodUs * ( ( burst ) ? burst : 1 );
+  r.creditUs = r.burstUs; /* start with a full bucket */
+  r.lastUs = micros();
+}
+
+void CanBridge::compile() {
+  for ( uint8_t bus = 0; bus < CAN_BRIDGE_BUSES; bus++ ) {
+    for ( uint16_t id = 0; id < 2048; id++ ) {
+      stdTable[bus][id] = CAN_BRIDGE_NONE;
+      for ( uint8_t i = 0; i < routeCount; i++ ) {
+        const route_t &r = routes[i];
+        if ( r.src != bus + 1 || (r.flags & CAN_BRIDGE_EXT) || ((id ^ r.id) & r.mask) ) continue;
+        stdTable[bus][id] = i;
+        break;
+      }
+    }
+    for ( uint16_t low = 0; low < 256; low++ ) {
+      extBucket[bus][low] = 0;
+      for ( uint8_t i = 0; i < routeCount; i++ ) {
+        const route_t &r = routes[i];
+        if ( r.src != bus + 1 || !(r.flags & CAN_BRIDGE_EXT) || ((low ^ r.id) & r.mask & 0xFF) ) continue;
+        extBucket[bus][low] |= (1UL << i);
+      }
+    }
+  }
+}
+
+bool CanBridge::begin() {
+  if ( running ) return 1;
+  bool any = 0;
+  for ( uint8_t i = 0; i < CAN_BRIDGE_BUSES; i++ ) if ( buses[i].can ) any = 1;
+  if ( !any ) return 0;
+  compile();
+  nsPerCycleQ16 = (uint32_t)((1000000000ULL << 16) / F_CPU_ACTUAL);
+  for ( uint8_t i = 0; i < CAN_BRIDGE_BUSES; i++ ) {
+    bus_t &b = buses[i];
+    if ( !b.can ) continue;
+    uint32_t bitrate = b.bitrate(b.can);
+    b.cyclesPerBit = ( bitrate ) ? F_CPU_ACTUAL / bitrate : 0;
+    b.head = b.tail = 0;
+    b.busy = 0;
+    for ( uint8_t s = 0; s < b.mbCount; s++ ) { /* still going out from before end() */
+      if ( FLEXCAN_get_code(FLEXCANb_MBn_CS(b.base, b.mb[s])) != FLEXCAN_MB_CODE_TX_INACTIVE ) b.busy |= (1U << s);
+    }
+  }
+  running = 1;
+  for ( uint8_t i = 0; i < CAN_BRIDGE_BUSES; i++ ) if ( buses[i].can ) buses[i].attach(buses[i].can, this);
+  return 1;
+}
+
+void CanBridge::end() {
+  if ( !running ) return;
+  for ( uint8_t i = 0; i < CAN_BRIDGE_BUSES; i++ ) if ( buses[i].can ) buses[i].attach(buses[i].can, nullptr);
+  running = 0;
+}
+
+uint32_t CanBridge::pending(uint8_t bus) const {
+  if ( bus < 1 || bus > CAN_BRIDGE_BUSES ) return 0;
+  return buses[bus - 1].head - buses[bus - 1].tail;
+}
+
+float CanBridge::latencyMeanUs(uint8_t bus) const {
+  if ( bus < 1 || bus > CAN_BRIDGE_BUSES || !counters.bus[bus - 1].sent ) return 0;
+  return counters.bus[bus - 1].latency_sum_ns / 1000.0f / counters.bus[bus - 1].sent;
+}
+
+void CanBridge::resetStats() {
+  __disable_irq();
+  counters = CanBridge_stats_t();
+  __enable_irq();
+}
+
+uint8_t CanBridge::lookup(uint8_t bus, uint32_t cs, uint32_t id) const {
+  if ( !(cs & FLEXCAN_MB_CS_IDE) ) return stdTable[bus][id];
+  uint32_t candidates = extBucket[bus][id & 0xFF];
+  while ( candidates ) {
+    uint8_t i = __builtin_ctz(candidates); /* lowest route first */
+    if ( !((id ^ routes[i].id) & routes[i].mask) ) return i;
+    candidates &= candidates - 1;
+  }
+  return CAN_BRIDGE_NONE;
+}
+
+/* token bucket in microseconds of credit */
+bool CanBridge::allowed(route_t &r) {
+  if ( !r.periodUs ) return 1;
+  uint32_t now = micros();
+  uint32_t credit = r.creditUs + (now - r.lastUs);
+  r.lastUs = now;
+  if ( credit > r.burstUs ) credit = r.burstUs;
+  if ( credit < r.periodUs ) {
+    r.creditUs = credit;
+    return 0;
+  }
+  r.creditUs = credit - r.periodUs;
+  return 1;
+}
+
+bool CanBridge::rxMailbox(uint8_t bus, volatile uint32_t *mbxAddr) {
+  uint32_t start = ARM_DWT_CYCCNT;
+  if ( !running || bus < 1 || bus > CAN_BRIDGE_BUSES ) return 0;
+  bus_t &src = buses[bus - 1];
+  uint32_t cs = mbxAddr[0];
+  uint32_t word = mbxAddr[1] & 0x1FFFFFFF;
+  bool ext = cs & FLEXCAN_MB_CS_IDE;
+  uint32_t id = ( ext ) ? word : word >> 18;
+  uint8_t i = lookup(bus - 1, cs, id);
+  if ( i == CAN_BRIDGE_NONE ) return 0;
+  route_t &r = routes[i];
+  counters.route[i].matched++;
+  counters.bus[bus - 1].rx++;
+
+  if ( !allowed(r) ) counters.route[i].rate_dropped++;
+  else if ( r.dst ) {
+    frame_t f;
+    id = (id & ~r.rewriteMask) | r.rewriteValue;
+    f.id = ( ext ) ? id : id << 18;
+    f.cs = (cs & BRIDGE_CS_KEEP) | (( ext ) ? FLEXCAN_MB_CS_SRR : 0);
+    f.data[0] = mbxAddr[2];
+    f.data[1] = mbxAddr[3];
+    /* the frame ended (cs timestamp) some bit times before this interrupt got to it */
+    uint16_t waited = (uint16_t)(FLEXCANb_TIMER(src.base) - cs);
+    f.t0 = start - waited * src.cyclesPerBit;
+    for ( uint8_t dst = 1; dst <= CAN_BRIDGE_BUSES; dst++ ) {
+      if ( !(r.dst & (1U << dst)) ) continue;
+      if ( !buses[dst - 1].mbCount ) { /* not added, or added with 0 mailboxes */
+        counters.bus[dst - 1].no_mailbox++;
+        continue;
+      }
+      forward(dst, f);
+      counters.route[i].forwarded++;
+    }
+  }
+
+  uint32_t spent = toNs(ARM_DWT_CYCCNT - start);
+  if ( spent > counters.bus[bus - 1].isr_max_ns ) counters.bus[bus - 1].isr_max_ns = spent;
+  return !(r.flags & CAN_BRIDGE_LOCAL);
+}
+
+/* a free slot for a frame with this ID word, -1 if none or if one of the
+   same ID is still pending: two mailboxes with equal IDs may go out in
+   either order */
+int8_t CanBridge::freeSlot(const bus_t &b, uint32_t id) const {
+  int8_t free = -1;
+  for ( uint8_t s = 0; s < b.mbCount; s++ ) {
+    if ( !(b.busy & (1U << s)) ) {
+      if ( free < 0 ) free = s;
+    }
+    else if ( b.slotId[s] == id ) return -1;
+  }
+  return free;
+}
+
+void CanBridge::load(bus_t &b, uint8_t slot, const frame_t &f) {
+  volatile uint32_t *mbxAddr = &(*(volatile uint32_t*)(b.base + 0x80 + (b.mb[slot] * 0x10)));
+  mbxAddr[1] = f.id;
+  mbxAddr[2] = f.data[0];
+  mbxAddr[3] = f.data[1];
+  mbxAddr[0] = f.cs | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_ONCE);
+  b.busy |= (1U << slot);
+  b.slotId[slot] = f.id;
+  b.slotT0[slot] = f.t0;
+}
+
+void CanBridge::forward(uint8_t bus, const frame_t &f) {
+  bus_t &b = buses[bus - 1];
+  CanBridge_bus_stats_t &s = counters.bus[bus - 1];
+  if ( b.head == b.tail ) { /* nothing ahead of it */
+    int8_t slot = freeSlot(b, f.id);
+    if ( slot >= 0 ) {
+      load(b, slot, f);
+      s.direct++;
+      return;
+    }
+  }
+  uint32_t depth = b.head - b.tail;
+  if ( depth >= CAN_BRIDGE_QUEUE ) {
+    s.queue_full++;
+    return;
+  }
+  b.ring[b.head & (CAN_BRIDGE_QUEUE - 1)] = f;
+  b.head++;
+  s.queued++;
+  if ( depth + 1 > s.queue_max ) s.queue_max = depth + 1;
+}
+
+void CanBridge::txMailboxDone(uint8_t bus, uint8_t mb_num) {
+  if ( !running || bus < 1 || bus > CAN_BRIDGE_BUSES ) return;
+  bus_t &b = buses[bus - 1];
+  uint8_t slot = 0;
+  while ( slot < b.mbCount && b.mb[slot] != mb_num ) slot++;
+  if ( slot == b.mbCount || !(b.busy & (1U << slot)) ) return; /* someone else's reserved mailbox */
+  b.busy &= ~(1U << slot);
+
+  CanBridge_bus_stats_t &s = counters.bus[bus - 1];
+  uint32_t ns = toNs(ARM_DWT_CYCCNT - b.slotT0[slot]);
+  s.sent++;
+  s.latency_sum_ns += ns;
+  if ( ns > s.latency_max_ns ) s.latency_max_ns = ns;
+  uint32_t us = ns / 1000;
+  uint8_t bucket = ( us ) ? 32 - __builtin_clz(us) : 0;
+  s.latency_hist[( bucket > 15 ) ? 15 : bucket]++;
+
+  while ( b.head != b.tail ) {
+    const frame_t &f = b.ring[b.tail & (CAN_BRIDGE_QUEUE - 1)];
+    int8_t next = freeSlot(b, f.id);
+    if ( next < 0 ) break; /* the same ID is still on its way, wait for it */
+    load(b, next, f);
+    b.tail++;
+  }
+}
@@ -0,0 +1,183 @@
+/*
+  CanBridge.h
+  -----------
+  Forwards frames between the Teensy 4.x FlexCAN buses from inside the
+  receive interrupt, so the motor bus can be kept apart from the sensor bus
+  without the round trip through read(), a callback and write() that the
+  BiDirectionalForward example takes (queue, callback, mailbox scan, and
+  whatever loop() happens to be doing in between).
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> motor;
+      FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> sensors;
+      void setup() {
+        motor.begin(); motor.setBaudRate(250000); motor.enableFIFO(); motor.enableFIFOInterrupt();
+        sensors.begin(); sensors.setBaudRate(1000000); sensors.enableFIFO(); sensors.enableFIFOInterrupt();
+        canBridge.addBus(motor);                  // after setBaudRate()
+        canBridge.addBus(sensors);
+        int8_t r = canBridge.addRoute(2, 0x100, 0x700, 1 << 1);              // sensors 0x100-0x1FF onto the motor bus
+        canBridge.addRoute(1, 0x0900, 0x1FFFFF00, 1 << 2, CAN_BRIDGE_EXT | CAN_BRIDGE_LOCAL); // VESC status 9, also read() locally
+        canBridge.setRateLimit(r, 200, 4);        // at most 200 frames/s, bursts of 4
+        canBridge.begin();
+      }
+
+  Routes: a frame matches a route when (id & mask) == (route id & mask)
+  on its source bus and the ID type matches (CAN_BRIDGE_EXT). The first
+  route added that matches wins. It goes to every bus in dst_mask (bit n:
+  CANn), optionally with bits of the ID replaced (setRewrite()), and is
+  consumed: read() and the receive callbacks on the source bus never see it
+  unless the route has CAN_BRIDGE_LOCAL. A route with dst_mask 0 just
+  blocks. Frames no route matches are received as usual. begin() compiles
+  the routes into a direct table for 11 bit IDs and per low byte buckets
+  for 29 bit IDs (VESC puts its node ID there), so a lookup costs the same
+  with 1 or 32 routes. Routes are fixed once begin() ran.
+
+  Forwarding: the source bus interrupt hands the locked mailbox (or FIFO
+  output) to rxMailbox(), which copies the four raw words straight into a
+  TX mailbox of the destination that addBus() reserved for the bridge, no
+  CAN_message_t and no queue on the way. When all of them are busy the
+  frame waits in a small ring per destination that the destination's TX
+  complete interrupt drains, in order. Frames of one ID never overtake each
+  other; when the ring is full the frame is dropped and counted.
+
+  Latency is measured per destination from the end of the received frame
+  (its RX timestamp) to the end of the forwarded one (TX complete), in ns
+  on the cycle counter, so it includes arbitration on the destination.
+
+  Classic CAN only (FlexCAN_T4, not FlexCAN_T4FD). The bridged buses must
+  share one interrupt priority (the default): the ring and the mailboxes
+  are touched from all of their interrupts without locking.
+*/
+
+#if !defined(_CAN_BRIDGE_H_)
+#define _CAN_BRIDGE_H_
+
+#include "Arduino.h"
+#include "FlexCAN_T4.h"
+
+#define CAN_BRIDGE_BUSES 3
+#if !defined(CAN_BRIDGE_ROUTES)
+#define CAN_BRIDGE_ROUTES 32        /* at most 32, a bucket is a bit per route */
+#endif
+#if !defined(CAN_BRIDGE_QUEUE)
+#define CAN_BRIDGE_QUEUE 64         /* fallback frames per destination bus, power of two */
+#endif
+#define CAN_BRIDGE_TX_MB_MAX 4      /* TX mailboxes a destination can lend the bridge */
+#define CAN_BRIDGE_NONE 0xFF
+
+static_assert(CAN_BRIDGE_ROUTES <= 32, "CAN_BRIDGE_ROUTES must be 32 or less");
+static_assert((CAN_BRIDGE_QUEUE & (CAN_BRIDGE_QUEUE - 1)) == 0, "CAN_BRIDGE_QUEUE must be a power of two");
+
+/* route flags */
+#define CAN_BRIDGE_EXT 0x01         /* match 29 bit IDs, 11 bit otherwise */
+#define CAN_BRIDGE_LOCAL 0x02       /* forward and still receive it on the source bus */
+
+typedef struct CanBridge_route_stats_t {
+  uint32_t matched = 0;
+  uint32_t forwarded = 0;           /* copies handed to destination buses */
+  uint32_t rate_dropped = 0;        /* over setRateLimit() */
+} CanBridge_route_stats_t;
+
+typedef struct CanBridge_bus_stats_t {
+  uint32_t rx = 0;                  /* frames from this bus that matched a route */
+  uint32_t direct = 0;              /* forwarded onto this bus straight into a TX mailbox */
+  uint32_t queued = 0;              /* forwarded onto this bus through the fallback ring */
+  uint32_t queue_full = 0;          /* dropped, fallback ring full */
+  uint32_t queue_max = 0;           /* deepest the ring got */
+  uint32_t no_mailbox = 0;          /* dropped, routed here but addBus() reserved no TX mailbox */
+  uint32_t sent = 0;                /* transmitted, counted in the latency */
+  uint32_t latency_max_ns = 0;      /* end of the source frame to end of the forwarded frame */
+  uint64_t latency_sum_ns = 0;
+  uint32_t latency_hist[16] = { 0 }; /* bucket n: below 2^n us, the last one takes the rest */
+  uint32_t isr_max_ns = 0;          /* longest rxMailbox() for a frame from this bus */
+} CanBridge_bus_stats_t;
+
+typedef struct CanBridge_stats_t {
+  CanBridge_bus_stats_t bus[CAN_BRIDGE_BUSES]; /* [0] = CAN1 */
+  CanBridge_route_stats_t route[CAN_BRIDGE_ROUTES];
+} CanBridge_stats_t;
+
+typedef void (*_bridge_attach_ptr)(void *bus, CANBridgeHook *hook);
+typedef uint32_t (*_bridge_bitrate_ptr)(void *bus);
+
+class CanBridge : public CANBridgeHook {
+  public:
+    template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize, FLEXCAN_TXQUEUE_TABLE _txSize>
+    void addBus(FlexCAN_T4<_bus, _rxSize, _txSize> &can, uint8_t tx_mailboxes = 2); /* reserves the highest free mailboxes, 0: source only */
+    int8_t addRoute(uint8_t src, uint32_t id, uint32_t mask, uint8_t dst_mask, uint8_t flags = 0); /* route number, -1 if full or after begin() */
+    void setRewrite(int8_t route, uint32_t mask, uint32_t value); /* forwarded ID = (id & ~mask) | (value & mask) */
+    void setRateLimit(int8_t route, uint32_t frames_per_s, uint16_t burst = 1); /* 0: unlimited */
+    bool begin();
+    void end();
+    uint32_t pending(uint8_t bus) const; /* frames waiting in the ring for bus */
+    float latencyMeanUs(uint8_t bus) const;
+    const CanBridge_stats_t& stats() const { return counters; }
+    void resetStats();
+
+    bool rxMailbox(uint8_t bus, volatile uint32_t *mbxAddr);
+    void txMailboxDone(uint8_t bus, uint8_t mb_num);
+
+  private:
+    struct frame_t {
+      uint32_t cs;                  /* DLC, RTR, IDE, SRR; the code is added when loaded */
+      uint32_t id;                  /* mailbox ID word */
+      uint32_t data[2];
+      uint32_t t0;                  /* cycle count at the end of the source frame */
+    };
+    struct bus_t {
+      void *can = nullptr;
+      _bridge_attach_ptr attach = nullptr;
+      _bridge_bitrate_ptr bitrate = nullptr;
+      uint32_t base = 0;            /* FlexCAN registers */
+      uint32_t cyclesPerBit = 0;
+      uint8_t mbCount = 0;
+      uint8_t mb[CAN_BRIDGE_TX_MB_MAX];
+      uint8_t busy = 0;             /* slots loaded and not yet through txMailboxDone() */
+      uint32_t slotId[CAN_BRIDGE_TX_MB_MAX];
+      uint32_t slotT0[CAN_BRIDGE_TX_MB_MAX];
+      frame_t ring[CAN_BRIDGE_QUEUE];
+      uint32_t head = 0, tail = 0;
+    };
+    struct route_t {
+      uint32_t id, mask;
+      uint32_t rewriteMask = 0, rewriteValue = 0;
+      uint32_t periodUs = 0, burstUs = 0, creditUs = 0, lastUs = 0;
+      uint8_t src, dst, flags;
+    };
+    template<typename _busType> static void attachThunk(void *can, CANBridgeHook *hook) { ((_busType*)can)->attachBridge(hook); }
+    template<typename _busType> static uint32_t bitrateThunk(void *can) { return ((_busType*)can)->getBaudRate(); }
+    void compile();
+    uint8_t lookup(uint8_t bus, uint32_t cs, uint32_t id) const;
+    bool allowed(route_t &r);
+    void forward(uint8_t bus, const frame_t &f);
+    int8_t freeSlot(const bus_t &b, uint32_t id) const;
+    void load(bus_t &b, uint8_t slot, const frame_t &f);
+    uint32_t toNs(uint32_t cycles) const { return (uint32_t)(((uint64_t)cycles * nsPerCycleQ16) >> 16); }
+
+    bus_t buses[CAN_BRIDGE_BUSES];
+    route_t routes[CAN_BRIDGE_ROUTES];
+    uint8_t routeCount = 0;
+    uint8_t stdTable[CAN_BRIDGE_BUSES][2048];  /* first route for each 11 bit ID, CAN_BRIDGE_NONE if none */
+    uint32_t extBucket[CAN_BRIDGE_BUSES][256]; /* 29 bit routes that can match an ID ending in this byte */
+    uint32_t nsPerCycleQ16 = 0;
+    bool running = 0;
+    CanBridge_stats_t counters;
+};
+
+extern CanBridge canBridge;
+
+template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize, FLEXCAN_TXQUEUE_TABLE _txSize>
+void CanBridge::addBus(FlexCAN_T4<_bus, _rxSize, _txSize> &can, uint8_t tx_mailboxes) {
+  static_assert(_bus == CAN1 || _bus == CAN2 || _bus == CAN3, "CanBridge runs on the Teensy 4.x buses");
+  typedef FlexCAN_T4<_bus, _rxSize, _txSize> _busType;
+  if ( running ) return;
+  bus_t &b = buses[( _bus == CAN1 ) ? 0 : ( _bus == CAN2 ) ? 1 : 2];
+  b.can = &can;
+  b.attach = attachThunk<_busType>;
+  b.bitrate = bitrateThunk<_busType>;
+  b.base = (uint32_t)_bus;
+  for ( uint8_t i = 0; i < b.mbCount; i++ ) can.reserveTxMB((FLEXCAN_MAILBOX)b.mb[i], 0);
+  if ( tx_mailboxes > CAN_BRIDGE_TX_MB_MAX ) tx_mailboxes = CAN_BRIDGE_TX_MB_MAX;
+  b.mbCount = can.reserveTxMBs(b.mb, tx_mailboxes); /* out of write(), TX interrupt on */
+}
+
+#endif
@@ -0,0 +1,235 @@
+/*
+  CanCapture.h
+  ------------
+  Streaming writer for the binary CAN capture format in CanCaptureFormat.h.
+  Frames are packed into a RAM block that goes to the file in one write
+  when it is full (or on flush()), so an SD card sees whole 4 KB writes
+  instead of a short write per frame. On the Teensy:
+
+      File log = SD.open("run.ccap", FILE_WRITE);
+      CanCapture<File> capture(log);
+      capture.setBusName(1, "CAN1");
+      capture.begin();
+      void canRx(const CAN_message_t &msg) { capture.add(msg); }   // onReceive() with events()
+      ...
+      if ( millis() - lastFlush > 1000 ) { capture.flush(); log.flush(); }
+      ...
+      capture.end(); log.close();     // index + trailer, optional
+
+  and on the host with CanCaptureFile (a FILE*) and timestamps from the
+  SocketCAN FlexCAN_T4 or the clock of the data being converted.
+
+  add() is not interrupt safe: call it from loop() or from onReceive()
+  handlers run by events(), which is where FlexCAN_T4 runs them.
+
+  The block index is kept in RAM for end(). On the Teensy that is
+  _indexEntries entries (64 bytes each); past that the capture carries on
+  without an index and readers rebuild it from the block headers.
+*/
+
+#if !defined(_CAN_CAPTURE_H_)
+#define _CAN_CAPTURE_H_
+
+#if defined(ARDUINO)
+#include "Arduino.h"
+#else
+#include <stdio.h>
+#include <vector>
+#endif
+#include <string.h>
+#include "FlexCAN_T4.h"
+#include "CanCaptureFormat.h"
+
+typedef struct CanCapture_stats_t {
+  uint32_t frames = 0;
+  uint32_t blocks = 0;
+  uint64_t bytes = 0;            /* written to the file */
+  uint32_t write_errors = 0;     /* short writes, the block was lost (readers resync past it) */
+  uint32_t index_full = 0;       /* blocks past the RAM index, the file gets no index */
+} CanCapture_stats_t;
+
+#if !defined(ARDUINO)
+/* host sink: a stdio FILE opened for writing */
+class CanCaptureFile {
+  public:
+    CanCaptureFile(FILE *f) : file(f) { ; }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, file); }
+    void flush() { fflush(file); }
+  private:
+    FILE *file;
+};
+#endif
+
+#define CAN_CAPTURE_CLASS template<typename _fileType, uint16_t _blockSize = 4096, uint16_t _indexEntries = 256>
+#define CAN_CAPTURE_FUNC template<typename _fileType, uint16_t _blockSize, uint16_t _indexEntries>
+#define CAN_CAPTURE_OPT CanCapture<_fileType, _blockSize, _indexEntries>
+
+CAN_CAPTURE_CLASS class CanCapture {
+  public:
+    CanCapture(_fileType &f) : file(f) { memset(&header, 0, sizeof(header)); }
+    void setBusName(uint8_t bus, const char *name); /* before begin() */
+    bool begin(uint64_t start_ns = 0);
+    bool add(const CAN_message_t &msg, uint64_t stamp_ns, bool tx = 0);
+    bool add(const CANFD_message_t &msg, uint64_t stamp_ns, bool tx = 0);
+    bool add(uint8_t bus, uint32_t id, uint8_t flags, const uint8_t *data, uint8_t len, uint64_t stamp_ns);
+#if defined(ARDUINO)
+    bool add(const CAN_message_t &msg, bool tx = 0) { return add(msg, nowNs(), tx); }
+    bool add(const CANFD_message_t &msg, bool tx = 0) { return add(msg, nowNs(), tx); }
+    uint64_t nowNs(); /* micros() extended to 64 bits, in ns */
+#endif
+    bool flush(); /* write the current block, even if not full */
+    bool end();   /* flush, then the index and trailer */
+    const CanCapture_stats_t& stats() const { return counters; }
+
+  private:
+    static_assert(_blockSize >= 256 && (_blockSize & 7) == 0, "block size is a multiple of 8, at least 256");
+    bool writeAll(const void *data, size_t len);
+    _fileType &file;
+    CanCapture_header_t header;
+    uint8_t block[_blockSize] __attribute__((aligned(8)));
+    uint32_t used = 0;             /* bytes in block, 0 when no block is open */
+    uint64_t offset = 0;           /* file position of the next write */
+    bool started = 0;
+#if defined(ARDUINO)
+    CanCapture_index_t index[_indexEntries];
+    uint32_t lastMicros = 0;
+    uint64_t microsHigh = 0;
+#else
+    std::vector<CanCapture_index_t> index;
+#endif
+    uint32_t indexCount = 0;
+    CanCapture_stats_t counters;
+};
+
+CAN_CAPTURE_FUNC void CAN_CAPTURE_OPT::setBusName(uint8_t bus, const char *name) {
+  if ( bus >= CAN_CAPTURE_BUSES ) return;
+  strncpy(header.bus_name[bus], name, sizeof(header.bus_name[bus]) - 1);
+}
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::writeAll(const void *data, size_t len) {
+  size_t done = file.write((const uint8_t*)data, len);
+  offset += done;
+  counters.bytes += done;
+  return ( done == len );
+}
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::begin(uint64_t start_ns) {
+  header.magic = CAN_CAPTURE_MAGIC;
+  header.version = CAN_CAPTURE_VERSION;
+  header.header_size = sizeof(CanCapture_header_t);
+  header.start_ns = start_ns;
+  header.block_size = _blockSize;
+  used = 0;
+  offset = 0;
+  indexCount = 0;
+#if !defined(ARDUINO)
+  index.clear();
+#endif
+  counters = CanCapture_stats_t();
+  started = writeAll(&header, sizeof(header));
+  return started;
+}
+
+#if defined(ARDUINO)
+CAN_CAPTURE_FUNC uint64_t CAN_CAPTURE_OPT::nowNs() {
+  uint32_t now = micros();
+  if ( now < lastMicros ) microsHigh += (1ULL << 32);
+  lastMicros = now;
+  return (microsHigh | now) * 1000ULL;
+}
+#endif
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::add(const CAN_message_t &msg, uint64_t stamp_ns, bool tx) {
+  uint8_t flags = (( msg.flags.extended ) ? CAN_CAPTURE_EXTENDED : 0) | (( msg.flags.remote ) ? CAN_CAPTURE_REMOTE : 0) |
+                  (( msg.flags.overrun ) ? CAN_CAPTURE_OVERRUN : 0) | (( tx ) ? CAN_CAPTURE_TX : 0);
+  return add(msg.bus, msg.id, flags, msg.buf, ( msg.len > 8 ) ? 8 : msg.len, stamp_ns);
+}
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::add(const CANFD_message_t &msg, uint64_t stamp_ns, bool tx) {
+  uint8_t flags = (( msg.flags.extended ) ? CAN_CAPTURE_EXTENDED : 0) | (( msg.flags.overrun ) ? CAN_CAPTURE_OVERRUN : 0) |
+                  (( msg.edl ) ? CAN_CAPTURE_FD : 0) | (( msg.brs && msg.edl ) ? CAN_CAPTURE_BRS : 0) |
+                  (( msg.esi ) ? CAN_CAPTURE_ESI : 0) | (( tx ) ? CAN_CAPTURE_TX : 0);
+  return add(msg.bus, msg.id, flags, msg.buf, ( msg.len > 64 ) ? 64 : msg.len, stamp_ns);
+}
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::add(uint8_t bus, uint32_t id, uint8_t flags, const uint8_t *data, uint8_t len, uint64_t stamp_ns) {
+  if ( !started ) return 0;
+  uint32_t size = canCaptureRecordSize(len);
+  if ( len > 64 || size > _blockSize - sizeof(CanCapture_block_t) ) return 0; /* not a CAN frame, or would not fit even an empty block */
+  if ( used + size > _blockSize && !flush() ) return 0;
+  CanCapture_block_t *b = (CanCapture_block_t*)block;
+  if ( !used ) {
+    memset(b, 0, sizeof(*b));
+    b->magic = CAN_CAPTURE_BLOCK_MAGIC;
+    b->seq = counters.blocks;
+    b->first_ns = b->last_ns = stamp_ns;
+    used = sizeof(CanCapture_block_t);
+  }
+  CanCapture_record_t *r = (CanCapture_record_t*)(block + used);
+  r->stamp_ns = stamp_ns;
+  r->id = id;
+  r->bus = bus;
+  r->len = len;
+  r->flags = flags;
+  r->reserved = 0;
+  uint8_t *payload = block + used + sizeof(CanCapture_record_t);
+  memcpy(payload, data, len);
+  memset(payload + len, 0, size - sizeof(CanCapture_record_t) - len);
+  used += size;
+  b->count++;
+  if ( stamp_ns < b->first_ns ) b->first_ns = stamp_ns;
+  if ( stamp_ns > b->last_ns ) b->last_ns = stamp_ns;
+  if ( bus < CAN_CAPTURE_BUSES ) b->bus_mask |= (uint8_t)(1U << bus);
+  canCaptureBloomAdd(b->id_bloom, canCaptureKey(id, flags & CAN_CAPTURE_EXTENDED));
+  counters.frames++;
+  return 1;
+}
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::flush() {
+  if ( !used ) return started;
+  CanCapture_block_t *b = (CanCapture_block_t*)block;
+  b->size = used;
+  b->crc = canCaptureCrc32(0, block + sizeof(CanCapture_block_t), used - sizeof(CanCapture_block_t));
+  CanCapture_index_t e;
+  e.offset = offset;
+  e.first_ns = b->first_ns;
+  e.last_ns = b->last_ns;
+  e.count = b->count;
+  e.bus_mask = b->bus_mask;
+  memset(e.reserved, 0, sizeof(e.reserved));
+  memcpy(e.id_bloom, b->id_bloom, sizeof(e.id_bloom));
+  bool ok = writeAll(block, used);
+  used = 0;
+  counters.blocks++;
+  if ( !ok ) {
+    counters.write_errors++;
+    return 0;
+  }
+#if defined(ARDUINO)
+  if ( indexCount < _indexEntries ) index[indexCount++] = e;
+  else counters.index_full++;
+#else
+  index.push_back(e);
+  indexCount++;
+#endif
+  return 1;
+}
+
+CAN_CAPTURE_FUNC bool CAN_CAPTURE_OPT::end() {
+  if ( !started ) return 0;
+  bool ok = flush();
+  started = 0;
+  if ( !ok || counters.index_full || counters.write_errors ) return 0; /* a partial index would hide blocks, readers rebuild it */
+  CanCapture_trailer_t t;
+  memset(&t, 0, sizeof(t));
+  t.magic = CAN_CAPTURE_INDEX_MAGIC;
+  t.count = indexCount;
+  t.index_offset = offset;
+  t.frames = counters.frames;
+  for ( uint32_t i = 0; i < indexCount && ok; i++ ) ok = writeAll(&index[i], sizeof(CanCapture_index_t));
+  if ( ok ) ok = writeAll(&t, sizeof(t));
+  file.flush();
+  return ok;
+}
+
+#endif
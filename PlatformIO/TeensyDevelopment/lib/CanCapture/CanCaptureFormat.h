@@ -0,0 +1,157 @@
+/*
+  CanCaptureFormat.h
+  ------------------
+  On-disk format of CAN captures (.ccap), shared by the streaming writer in
+  lib/CanCapture (Teensy SD card or host) and the mmap reader in
+  host/CanCaptureReader.
+
+      CanCapture_header_t                       128 bytes
+      block | block | ...                       at most the writer's block size each
+      CanCapture_index_t[count]                 written by end(), optional
+      CanCapture_trailer_t                      last 32 bytes of the file, optional
+
+      block  = CanCapture_block_t | record | record | ...
+      record = CanCapture_record_t | len bytes of payload, padded to 8 bytes
+
+  Every block header carries the time span, the buses and a 256-bit bloom
+  filter of the IDs in it, so a reader picks the blocks for a time range or
+  an ID set from the index and never walks the records of the others. The
+  index and trailer are only written when the capture is closed; a file cut
+  short by a power loss still reads, the reader then rebuilds the index by
+  hopping from block header to block header (size field). Blocks carry a
+  CRC-32 of their records, a torn block is dropped rather than returned as
+  garbage. A short write can also leave a torn block in the middle of the
+  file, with the writer carrying on after it; the reader then looks for
+  the next block magic whose block passes its CRC and goes on from there.
+
+  Timestamps are 64-bit nanoseconds on whatever clock the writer was given
+  (CLOCK_REALTIME on the host, micros() * 1000 since boot on the Teensy);
+  header.start_ns says where that clock was in wall time if known. All
+  fields are little-endian.
+*/
+
+#if !defined(_CAN_CAPTURE_FORMAT_H_)
+#define _CAN_CAPTURE_FORMAT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CAN_CAPTURE_MAGIC 0x50414343UL          /* "CCAP" */
+#define CAN_CAPTURE_BLOCK_MAGIC 0x4B4C4243UL    /* "CBLK" */
+#define CAN_CAPTURE_INDEX_MAGIC 0x58444943UL    /* "CIDX" */
+#define CAN_CAPTURE_VERSION 1
+#define CAN_CAPTURE_BUSES 8                     /* bus numbers 0..7, msg.bus on the Teensy is 1..3 */
+
+/* CanCapture_record_t.flags */
+#define CAN_CAPTURE_EXTENDED 0x01
+#define CAN_CAPTURE_REMOTE 0x02
+#define CAN_CAPTURE_FD 0x04
+#define CAN_CAPTURE_BRS 0x08
+#define CAN_CAPTURE_ESI 0x10
+#define CAN_CAPTURE_TX 0x20                     /* sent by the logging node, not received */
+#define CAN_CAPTURE_OVERRUN 0x40
+
+typedef struct CanCapture_header_t {
+  uint32_t magic;                /* CAN_CAPTURE_MAGIC */
+  uint16_t version;
+  uint16_t header_size;          /* sizeof(CanCapture_header_t) */
+  uint64_t start_ns;             /* wall clock (unix ns) at timestamp 0 of the records, 0 if unknown */
+  uint32_t block_size;           /* largest block in the file */
+  uint32_t flags;                /* reserved, 0 */
+  char bus_name[CAN_CAPTURE_BUSES][8]; /* "can0", "vcan1", ... empty if unnamed */
+  uint8_t reserved[40];
+} CanCapture_header_t;
+
+typedef struct CanCapture_block_t {
+  uint32_t magic;                /* CAN_CAPTURE_BLOCK_MAGIC */
+  uint32_t size;                 /* bytes including this header, multiple of 8 */
+  uint32_t seq;                  /* 0, 1, 2, ... */
+  uint32_t count;                /* records */
+  uint64_t first_ns;             /* smallest timestamp in the block */
+  uint64_t last_ns;              /* largest */
+  uint32_t crc;                  /* CRC-32 of the size - sizeof(CanCapture_block_t) record bytes */
+  uint8_t bus_mask;              /* bit n set if a record from bus n is in the block */
+  uint8_t reserved[3];
+  uint8_t id_bloom[32];          /* canCaptureBloomAdd() of every record's key */
+} CanCapture_block_t;
+
+typedef struct CanCapture_record_t {
+  uint64_t stamp_ns;
+  uint32_t id;                   /* 11 or 29 bits, CAN_CAPTURE_EXTENDED tells which */
+  uint8_t bus;
+  uint8_t len;                   /* payload bytes, 0..8, 0..64 for CAN_CAPTURE_FD */
+  uint8_t flags;
+  uint8_t reserved;
+} CanCapture_record_t;
+
+typedef struct CanCapture_index_t {
+  uint64_t offset;               /* of the block header from the start of the file */
+  uint64_t first_ns;
+  uint64_t last_ns;
+  uint32_t count;
+  uint8_t bus_mask;
+  uint8_t reserved[3];
+  uint8_t id_bloom[32];
+} CanCapture_index_t;
+
+typedef struct CanCapture_trailer_t {
+  uint32_t magic;                /* CAN_CAPTURE_INDEX_MAGIC */
+  uint32_t count;                /* index entries */
+  uint64_t index_offset;
+  uint64_t frames;               /* records in the whole file */
+  uint64_t reserved;
+} CanCapture_trailer_t;
+
+static_assert(sizeof(CanCapture_header_t) == 128, "CanCapture_header_t is 128 bytes on disk");
+static_assert(sizeof(CanCapture_block_t) == 72, "CanCapture_block_t is 72 bytes on disk");
+static_assert(sizeof(CanCapture_record_t) == 16, "CanCapture_record_t is 16 bytes on disk");
+static_assert(sizeof(CanCapture_index_t) == 64, "CanCapture_index_t is 64 bytes on disk");
+static_assert(sizeof(CanCapture_trailer_t) == 32, "CanCapture_trailer_t is 32 bytes on disk");
+
+/* a record and its padded payload */
+static inline uint32_t canCaptureRecordSize(uint8_t len) {
+  return sizeof(CanCapture_record_t) + ((len + 7U) & ~7U);
+}
+
+/* bloom key: the ID with the frame type on top, so STD 0x123 and EXT 0x123 differ */
+static inline uint32_t canCaptureKey(uint32_t id, bool extended) {
+  return ( extended ) ? (id | 0x80000000UL) : id;
+}
+
+static inline void canCaptureBloomBits(uint32_t key, uint8_t &a, uint8_t &b) {
+  uint32_t h = key * 0x9E3779B1UL;
+  h ^= h >> 15;
+  h *= 0x85EBCA77UL;
+  a = (uint8_t)(h >> 24);
+  b = (uint8_t)(h >> 8);
+}
+
+static inline void canCaptureBloomAdd(uint8_t *bloom, uint32_t key) {
+  uint8_t a, b;
+  canCaptureBloomBits(key, a, b);
+  bloom[a >> 3] |= (uint8_t)(1U << (a & 7));
+  bloom[b >> 3] |= (uint8_t)(1U << (b & 7));
+}
+
+static inline bool canCaptureBloomHas(const uint8_t *bloom, uint32_t key) {
+  uint8_t a, b;
+  canCaptureBloomBits(key, a, b);
+  return (bloom[a >> 3] & (1U << (a & 7))) && (bloom[b >> 3] & (1U << (b & 7)));
+}
+
+/* CRC-32 (IEEE, reflected 0xEDB88320), a nibble at a time so the table is 64 bytes */
+static inline uint32_t canCaptureCrc32(uint32_t crc, const uint8_t *data, size_t len) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  crc = ~crc;
+  while ( len-- ) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ table[crc & 0xF];
+    crc = (crc >> 4) ^ table[crc & 0xF];
+  }
+  return ~crc;
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+  CanDB.h
+  -------
+  Support code for the headers written by host/candb_gen.cpp from a .candb
+  message database (see minirob.candb for the format).
+
+  Every signal becomes a CANDB_signal<start, length, byte order, sign>
+  whose position is a template argument, so get()/set() unroll into the
+  exact byte loads, shifts and masks for that field. Nothing is parsed or
+  looked up at run time:
+
+      CAN_message_t msg;
+      VESC_SET_DUTY::init(msg, 1);                 // id, IDE flag, len
+      VESC_SET_DUTY::duty::encode(msg.buf, 0.18f); // 4 byte stores
+      int32_t raw = VESC_SET_DUTY::duty::raw(0.18f); // 18000, the value on the wire
+      ...
+      if ( VESC_STATUS_1::match(msg) ) erpm = VESC_STATUS_1::erpm::decode(msg.buf);
+
+  Bit numbering:
+    little endian: start is the LSB, bit 0 = byte 0 bit 0, bit 8 = byte 1 bit 0
+    big endian:    start is the MSB, bit 0 = byte 0 bit 7, bit 8 = byte 1 bit 7
+  so a 32-bit value in bytes 0..3 is start 0, length 32 in either byte order.
+*/
+
+#if !defined(_CAN_DB_H_)
+#define _CAN_DB_H_
+
+#include <stdint.h>
+#include <type_traits>
+#include "FlexCAN_T4.h"
+
+#define CANDB_LITTLE 0
+#define CANDB_BIG 1
+#define CANDB_UNSIGNED 0
+#define CANDB_SIGNED 1
+
+typedef struct CANDB_filter_t {
+  uint32_t id;
+  uint32_t mask;     /* bits that must match, node bits cleared for per-node messages */
+  bool extended;
+} CANDB_filter_t;
+
+template<uint8_t _start, uint8_t _length, uint8_t _order, uint8_t _sign> struct CANDB_signal {
+  static_assert(_length >= 1 && _length <= 32, "CANDB signals are 1..32 bits");
+  static constexpr uint8_t first = _start >> 3;
+  static constexpr uint8_t last = (_start + _length - 1) >> 3;
+  static constexpr uint8_t shift = ( _order == CANDB_BIG ) ? (7 - ((_start + _length - 1) & 7)) : (_start & 7);
+  static constexpr uint64_t mask = (((uint64_t)1) << _length) - 1;
+  typedef typename std::conditional<_sign == CANDB_SIGNED, int32_t, uint32_t>::type raw_t;
+
+  static constexpr raw_t get(const uint8_t *buf) {
+    uint64_t v = 0;
+    for ( uint8_t i = first; i <= last; i++ ) {
+      if ( _order == CANDB_BIG ) v = (v << 8) | buf[i];
+      else v |= ((uint64_t)buf[i]) << ((i - first) << 3);
+    }
+    v = (v >> shift) & mask;
+    if ( _sign == CANDB_SIGNED && _length < 32 && (v >> (_length - 1)) ) v |= ~mask; /* sign extend */
+    return (raw_t)v;
+  }
+
+  static inline void set(uint8_t *buf, raw_t raw) {
+    uint64_t v = (((uint64_t)(uint32_t)raw) & mask) << shift;
+    uint64_t m = mask << shift;
+    for ( uint8_t i = first; i <= last; i++ ) {
+      uint8_t bits = ( _order == CANDB_BIG ) ? ((last - i) << 3) : ((i - first) << 3);
+      buf[i] = (uint8_t)((buf[i] & ~(m >> bits)) | (v >> bits));
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,431 @@
+/*
+  Generated by host/candb_gen.cpp from minirob.candb, do not edit.
+*/
+
+#if !defined(_MINIROB_DB_H_)
+#define _MINIROB_DB_H_
+
+#include "CanDB.h"
+
+struct VESC_SET_DUTY {
+  static constexpr uint32_t ID = 0x0;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct duty : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1e-05f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+05f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_SET_CURRENT {
+  static constexpr uint32_t ID = 0x100;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct current : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* A */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_SET_CURRENT_BRAKE {
+  static constexpr uint32_t ID = 0x200;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct current : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* A */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_SET_RPM {
+  static constexpr uint32_t ID = 0x300;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct erpm : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* rpm */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1.0f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1.0f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_SET_POS {
+  static constexpr uint32_t ID = 0x400;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct pos : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* deg */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1e-06f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+06f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_SET_CURRENT_REL {
+  static constexpr uint32_t ID = 0xA00;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct current_rel : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1e-05f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+05f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_STATUS_1 {
+  static constexpr uint32_t ID = 0x900;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct erpm : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* rpm */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1.0f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1.0f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct current : CANDB_signal<32, 16, CANDB_BIG, CANDB_SIGNED> { /* A */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.1f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct duty : CANDB_signal<48, 16, CANDB_BIG, CANDB_SIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_STATUS_2 {
+  static constexpr uint32_t ID = 0xE00;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct amp_hours : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* Ah */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.0001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+04f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct amp_hours_charged : CANDB_signal<32, 32, CANDB_BIG, CANDB_SIGNED> { /* Ah */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.0001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+04f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_STATUS_3 {
+  static constexpr uint32_t ID = 0xF00;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct watt_hours : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> { /* Wh */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.0001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+04f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct watt_hours_charged : CANDB_signal<32, 32, CANDB_BIG, CANDB_SIGNED> { /* Wh */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.0001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+04f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_STATUS_4 {
+  static constexpr uint32_t ID = 0x1000;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct temp_fet : CANDB_signal<0, 16, CANDB_BIG, CANDB_SIGNED> { /* C */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.1f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct temp_motor : CANDB_signal<16, 16, CANDB_BIG, CANDB_SIGNED> { /* C */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.1f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct current_in : CANDB_signal<32, 16, CANDB_BIG, CANDB_SIGNED> { /* A */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.1f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct pid_pos : CANDB_signal<48, 16, CANDB_BIG, CANDB_SIGNED> { /* deg */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.02f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 5e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_STATUS_5 {
+  static constexpr uint32_t ID = 0x1B00;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct tachometer : CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1.0f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1.0f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct v_in : CANDB_signal<32, 16, CANDB_BIG, CANDB_SIGNED> { /* V */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.1f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_STATUS_6 {
+  static constexpr uint32_t ID = 0x3A00;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct adc1 : CANDB_signal<0, 16, CANDB_BIG, CANDB_SIGNED> { /* V */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct adc2 : CANDB_signal<16, 16, CANDB_BIG, CANDB_SIGNED> { /* V */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct adc3 : CANDB_signal<32, 16, CANDB_BIG, CANDB_SIGNED> { /* V */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct ppm : CANDB_signal<48, 16, CANDB_BIG, CANDB_SIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.001f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+03f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_PING {
+  static constexpr uint32_t ID = 0x1100;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 1;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct sender : CANDB_signal<0, 8, CANDB_LITTLE, CANDB_UNSIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1.0f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1.0f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct VESC_PONG {
+  static constexpr uint32_t ID = 0x1200;
+  static constexpr uint32_t NODE_MASK = 0xFF;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 2;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct controller_id : CANDB_signal<0, 8, CANDB_LITTLE, CANDB_UNSIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1.0f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1.0f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+  struct hw_type : CANDB_signal<8, 8, CANDB_LITTLE, CANDB_UNSIGNED> {
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 1.0f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1.0f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct BENCH_FET_TEMP {
+  static constexpr uint32_t ID = 0x871;
+  static constexpr uint32_t NODE_MASK = 0x0;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 4;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+  struct temp_fet : CANDB_signal<0, 32, CANDB_LITTLE, CANDB_SIGNED> { /* C */
+    static constexpr float decode(const uint8_t *buf) { return get(buf) * 0.1f; }
+    static constexpr raw_t raw(float value) { return (raw_t)(value * 1e+01f); }
+    static inline void encode(uint8_t *buf, float value) { set(buf, raw(value)); }
+  };
+};
+
+struct BENCH_REPLY {
+  static constexpr uint32_t ID = 0x872;
+  static constexpr uint32_t NODE_MASK = 0x0;
+  static constexpr bool EXTENDED = 1;
+  static constexpr uint8_t DLC = 8;
+  static constexpr uint32_t id(uint8_t node = 0) { return ID | (node & NODE_MASK); }
+  static constexpr uint8_t node(uint32_t id) { return (uint8_t)(id & NODE_MASK); }
+  static constexpr bool match(uint32_t id, bool extended) { return extended == EXTENDED && (id & ~NODE_MASK) == ID; }
+  static constexpr bool match(const CAN_message_t &msg) { return match(msg.id, msg.flags.extended) && msg.len >= DLC; }
+  static inline void init(CAN_message_t &msg, uint8_t node = 0) {
+    msg = CAN_message_t();
+    msg.id = id(node);
+    msg.flags.extended = EXTENDED;
+    msg.len = DLC;
+  }
+};
+
+/* receive filters, node bits masked out */
+#define MINIROB_RX_FILTER_COUNT 9
+static const CANDB_filter_t MINIROB_RX_FILTERS[MINIROB_RX_FILTER_COUNT] = {
+  { 0x900, 0x1FFFFF00, 1 }, /* VESC_STATUS_1 */
+  { 0xE00, 0x1FFFFF00, 1 }, /* VESC_STATUS_2 */
+  { 0xF00, 0x1FFFFF00, 1 }, /* VESC_STATUS_3 */
+  { 0x1000, 0x1FFFFF00, 1 }, /* VESC_STATUS_4 */
+  { 0x1B00, 0x1FFFFF00, 1 }, /* VESC_STATUS_5 */
+  { 0x3A00, 0x1FFFFF00, 1 }, /* VESC_STATUS_6 */
+  { 0x1200, 0x1FFFFF00, 1 }, /* VESC_PONG */
+  { 0x871, 0x1FFFFFFF, 1 }, /* BENCH_FET_TEMP */
+  { 0x872, 0x1FFFFFFF, 1 }, /* BENCH_REPLY */
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+  CanDeadline.cpp
+  ---------------
+  See CanDeadline.h.
+*/
+
+#include "CanDeadline.h"
+
+CanDeadline canDeadline;
+
+bool CanDeadline::watch(CanDeadline_t &d, uint32_t id, uint32_t period_us, uint32_t tolerance_us, bool extended) {
+  if ( !period_us ) return 0;
+  unwatch(d);
+  d.id = id;
+  d.extended = extended;
+  d.period_us = period_us;
+  d.tolerance_us = tolerance_us;
+  d.frames = 0;
+  d.stale = 1;
+  d.consecutive = 0;
+  d.misses = 0;
+  d.max_gap_us = 0;
+  d.last_us = micros(); /* the first deadline is counted from here */
+  d.timer.callback = expired;
+  d.timer.arg = this;
+  __disable_irq();
+  watched.pushFront(d);
+  counters.watched++;
+  __enable_irq();
+  canScheduler.startTimer(d.timer, period_us + tolerance_us);
+  return 1;
+}
+
+void CanDeadline::unwatch(CanDeadline_t &d) {
+  canScheduler.stopTimer(d.timer);
+  __disable_irq();
+  if ( watched.remove(d) ) counters.watched--;
+  __enable_irq();
+}
+
+bool CanDeadline::process(const CAN_message_t &msg) {
+  CanDeadline_t *d = watched.first(msg.id, msg.flags.extended); /* not locked, see CanIdTable.h */
+  if ( !d ) return 0; /* nothing watched on this bucket, the usual case */
+  uint32_t now = micros();
+  for ( ; d; d = d->next ) {
+    if ( d->id != msg.id || d->extended != msg.flags.extended ) continue;
+    if ( d->frames ) {
+      uint32_t gap = now - d->last_us;
+      if ( gap > d->max_gap_us ) d->max_gap_us = gap;
+    }
+    d->last_us = now;
+    d->frames++;
+    if ( d->stale ) {
+      if ( d->consecutive ) counters.recoveries++; /* not for the first frame after watch() */
+      d->stale = 0;
+      d->consecutive = 0;
+    }
+    counters.frames++;
+    return 1;
+  }
+  return 0;
+}
+
+void CanDeadline::expired(TimerWheel_timer_t *timer, void *arg) {
+  CanDeadline &self = *(CanDeadline*)arg;
+  CanDeadline_t &d = TIMER_WHEEL_OWNER(CanDeadline_t, timer, timer);
+  self.counters.checks++;
+  uint32_t limit = d.period_us + d.tolerance_us;
+  uint32_t age = micros() - d.last_us;
+  if ( age <= limit ) { /* a frame came in since, or the tick ran a little early */
+    canScheduler.startTimer(d.timer, limit - age + 1);
+    return;
+  }
+  if ( d.frames && age > d.max_gap_us ) d.max_gap_us = age;
+  d.misses++;
+  d.consecutive++;
+  d.stale = 1;
+  self.counters.misses++;
+  canScheduler.startTimer(d.timer, d.period_us); /* before the callback, it may unwatch */
+  if ( d.callback ) d.callback(d);
+}
+
+void CanDeadline::resetStats() {
+  __disable_irq();
+  uint32_t watched = counters.watched;
+  counters = CanDeadline_stats_t();
+  counters.watched = watched;
+  __enable_irq();
+}
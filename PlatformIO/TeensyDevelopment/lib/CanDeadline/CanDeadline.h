@@ -0,0 +1,95 @@
+/*
+  CanDeadline.h
+  -------------
+  Staleness monitor for periodic CAN traffic. The old sketches waited on
+  read() and, when nothing came, did nothing (CAN_VESC.ino has the "No
+  message received" print commented out), so the safety logic never knew
+  a VESC had gone quiet. Here every ID that is supposed to keep coming is
+  watched with its period and a tolerance, and a miss is reported as soon
+  as period + tolerance has gone by without a frame:
+
+      CanDeadline_t status1;
+      void canRx(const CAN_message_t &msg) { canDeadline.process(msg); }
+      void setup() {
+        ... can1.onReceive(canRx); canScheduler.begin();   // the checks run on its wheel
+        canDeadline.watch(status1, VESC_CAN_ID(CAN_PACKET_STATUS, 1), 20000, 30000); // 50 ms without one is a miss
+      }
+      void step() { if ( !canDeadline.fresh(status1) ) ... stop ... }
+
+  process() only timestamps: a 64 bucket hash of the watched IDs
+  (CanIdTable.h), then a time and a count are stored, it never touches
+  the wheel. Each watched ID has one timer on canScheduler's wheel
+  (lib/CanScheduler), set to the deadline of the newest frame it knew
+  of. When it fires it looks at the timestamp: a newer frame moves the
+  deadline on and the timer goes back on the wheel, otherwise it is a
+  miss. So the cost is about one timer expiry per period per ID, not one
+  per frame, and the wheel keeps it O(1) for any number of IDs. One
+  CanDeadline_t per ID, watch() again to change it.
+
+  A miss counts, marks the ID stale and calls its callback (in the tick
+  interrupt), then the next check is one period later: a silent ID misses
+  once per period, consecutive says for how long. The first frame after
+  that clears stale. fresh() is the cheap test for a control loop, from
+  the timestamp and micros(), no lock and no tick granularity. As for
+  CanRequest, the interrupt priorities in CanScheduler.h apply.
+*/
+
+#if !defined(_CAN_DEADLINE_H_)
+#define _CAN_DEADLINE_H_
+
+#include "Arduino.h"
+#include "FlexCAN_T4.h"
+#include "TimerWheel.h"
+#include "CanScheduler.h"
+
+struct CanDeadline_t;
+typedef void (*_deadline_ptr)(CanDeadline_t &d); /* missed, tick interrupt */
+
+typedef struct CanDeadline_t {
+  _deadline_ptr callback = nullptr;
+  void *arg = nullptr;
+  uint32_t id = 0;
+  bool extended = 1;
+  uint32_t period_us = 0;
+  uint32_t tolerance_us = 0;       /* late allowed on top of the period */
+  volatile uint32_t last_us = 0;   /* micros() of the newest frame */
+  volatile uint32_t frames = 0;
+  volatile bool stale = 1;         /* nothing yet, or missed and not back */
+  volatile uint32_t consecutive = 0; /* periods missed since the last frame */
+  uint32_t misses = 0;
+  uint32_t max_gap_us = 0;         /* longest between frames, or since the last one while silent */
+  TimerWheel_timer_t timer;
+  CanDeadline_t *next = nullptr;   /* bucket chain */
+} CanDeadline_t;
+
+typedef struct CanDeadline_stats_t {
+  uint32_t watched = 0;
+  uint32_t frames = 0;             /* frames on watched IDs */
+  uint32_t checks = 0;             /* timer expiries */
+  uint32_t misses = 0;
+  uint32_t recoveries = 0;         /* stale IDs that came back */
+} CanDeadline_stats_t;
+
+class CanDeadline {
+  public:
+    bool watch(CanDeadline_t &d, uint32_t id, uint32_t period_us, uint32_t tolerance_us, bool extended = 1); /* first deadline counted from now */
+    void unwatch(CanDeadline_t &d);
+    bool process(const CAN_message_t &msg); /* call from the receive callback, 1 if the ID is watched */
+    static bool fresh(const CanDeadline_t &d) { /* a frame within period + tolerance */
+      uint32_t last = d.last_us;
+      return d.frames && micros() - last <= d.period_us + d.tolerance_us;
+    }
+    static uint32_t ageUs(const CanDeadline_t &d) { return micros() - d.last_us; } /* since the newest frame */
+    const CanDeadline_stats_t& stats() const { return counters; }
+    void resetStats();
+
+  private:
+    static void expired(TimerWheel_timer_t *timer, void *arg);
+
+    CanIdTable<CanDeadline_t> watched;
+    CanDeadline_stats_t counters;
+};
+
+extern CanDeadline canDeadline;
+
+#endif
@@ -0,0 +1,274 @@
+/*
+  CanDiscovery.h
+  --------------
+  Finds what is on a CAN bus in a fraction of a second, instead of stepping
+  a transmit ID every 200 ms and waiting for a reply.
+
+  Two phases, both fed by the receive interrupt:
+    passive: the controller is put in listen-only mode (no ACKs, no error
+             frames) and every ID heard is fingerprinted: frame count,
+             DLCs, first/last arrival and min/max period.
+    active:  CAN_PACKET_PING goes to VESC controller IDs 0..255. The pings
+             are pushed as fast as the mailboxes and TX queue accept them,
+             so a large part of the sweep is outstanding at once, and every
+             CAN_PACKET_PONG is matched to its target in the ISR by ID.
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+      CAN_discovery<FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16>> discovery(can1);
+      void canRx(const CAN_message_t &msg) { discovery.process(msg); }
+      ...
+      can1.enableFIFO(); can1.enableFIFOInterrupt(); can1.onReceive(canRx);
+      discovery.begin(250000);           // 200 ms passive, then the sweep
+      while ( !discovery.update() ) can1.events();
+      discovery.printMap();
+
+  The ISR only touches the node table while a phase is running; once
+  update() returns 1 the results can be read without locking.
+*/
+
+#if !defined(_CAN_DISCOVERY_H_)
+#define _CAN_DISCOVERY_H_
+
+#include "Arduino.h"
+#include "VescCAN.h"
+
+typedef enum CAN_DISCOVERY_STATE {
+  DISCOVERY_IDLE = 0,
+  DISCOVERY_PASSIVE,
+  DISCOVERY_ACTIVE,
+  DISCOVERY_DONE
+} CAN_DISCOVERY_STATE;
+
+typedef enum CAN_DEVICE_TYPE {
+  CAN_DEVICE_UNKNOWN = 0,
+  CAN_DEVICE_VESC,          /* extended ID with a VESC status/pong packet number */
+  CAN_DEVICE_VESC_COMMAND   /* extended ID with a VESC command packet number, another master */
+} CAN_DEVICE_TYPE;
+
+typedef struct CAN_node_t {
+  uint32_t id = 0;
+  bool extended = 0;
+  uint16_t dlc_mask = 0;         /* bit n set if a frame with len n was seen */
+  uint32_t frames = 0;
+  uint32_t first_us = 0;
+  uint32_t last_us = 0;
+  uint32_t min_period_us = 0;
+  uint32_t max_period_us = 0;
+  CAN_DEVICE_TYPE type = CAN_DEVICE_UNKNOWN;
+} CAN_node_t;
+
+typedef struct CAN_vesc_node_t {
+  uint8_t controller_id = 0;
+  uint8_t hw_type = 0xFF;        /* from the pong payload on newer firmware, 0xFF if not sent */
+  uint32_t rtt_us = 0;           /* ping queued to pong received */
+} CAN_vesc_node_t;
+
+#define CAN_DISCOVERY_CLASS template<typename _busType, uint16_t _maxNodes = 64>
+#define CAN_DISCOVERY_FUNC template<typename _busType, uint16_t _maxNodes>
+#define CAN_DISCOVERY_OPT CAN_discovery<_busType, _maxNodes>
+
+CAN_DISCOVERY_CLASS class CAN_discovery {
+  public:
+    CAN_discovery(_busType &bus, uint8_t own_id = 254) : can(bus), ownID(own_id) { ; }
+    void begin(uint32_t bitrate, uint32_t passive_ms = 200, uint32_t reply_timeout_ms = 20);
+    bool update(); /* call from loop(), returns 1 once the map is complete */
+    void process(const CAN_message_t &msg); /* call from the receive interrupt */
+    CAN_DISCOVERY_STATE state() const { return phase; }
+
+    uint16_t nodes() const { return used; }
+    const CAN_node_t& node(uint16_t index) const { return table[index]; }
+    uint32_t rateHz(const CAN_node_t &n) const;
+    uint16_t vescs(CAN_vesc_node_t *out, uint16_t count) const;
+    uint32_t dropped() const { return overflow; } /* IDs that did not fit in the table */
+    uint32_t elapsedUs() const { return finishedUs - startUs; }
+    void printMap(Stream &port = Serial) const;
+
+  private:
+    CAN_node_t* lookup(uint32_t id, bool extended);
+    void startActive();
+    _busType &can;
+    uint8_t ownID;
+    uint32_t bitrate = 0;
+    uint32_t passiveUs = 0;
+    uint32_t timeoutUs = 0;
+    uint32_t startUs = 0;
+    uint32_t phaseUs = 0;
+    uint32_t lastPingUs = 0;
+    uint32_t finishedUs = 0;
+    uint16_t nextTarget = 0;
+    volatile CAN_DISCOVERY_STATE phase = DISCOVERY_IDLE;
+    CAN_node_t table[_maxNodes];
+    uint16_t slot[_maxNodes * 2]; /* open addressing hash, index + 1 into table, 0 empty */
+    volatile uint16_t used = 0;
+    volatile uint32_t overflow = 0;
+    uint32_t pingUs[256];
+    uint32_t pongUs[256];
+    uint8_t hwType[256];
+    uint32_t ponged[8]; /* bitmap of controller ids that answered */
+};
+
+CAN_DISCOVERY_FUNC void CAN_DISCOVERY_OPT::begin(uint32_t baud, uint32_t passive_ms, uint32_t reply_timeout_ms) {
+  phase = DISCOVERY_IDLE;
+  for ( uint16_t i = 0; i < _maxNodes; i++ ) table[i] = CAN_node_t();
+  memset(slot, 0, sizeof(slot));
+  memset(ponged, 0, sizeof(ponged));
+  memset(pingUs, 0, sizeof(pingUs));
+  memset(hwType, 0xFF, sizeof(hwType));
+  used = 0;
+  overflow = 0;
+  nextTarget = 0;
+  bitrate = baud;
+  passiveUs = passive_ms * 1000;
+  timeoutUs = reply_timeout_ms * 1000;
+  can.setBaudRate(bitrate, LISTEN_ONLY);
+  startUs = phaseUs = micros();
+  phase = DISCOVERY_PASSIVE;
+}
+
+CAN_DISCOVERY_FUNC void CAN_DISCOVERY_OPT::startActive() {
+  can.setBaudRate(bitrate, TX);
+  phaseUs = lastPingUs = micros();
+  phase = DISCOVERY_ACTIVE;
+}
+
+CAN_DISCOVERY_FUNC bool CAN_DISCOVERY_OPT::update() {
+  switch ( phase ) {
+    case DISCOVERY_PASSIVE:
+      if ( micros() - phaseUs >= passiveUs ) startActive();
+      return 0;
+    case DISCOVERY_ACTIVE: {
+      /* keep the mailboxes and TX queue full, write() returns 0 once both are (-2 when bus off) */
+      CAN_message_t ping;
+      ping.flags.extended = 1;
+      ping.len = 1;
+      ping.buf[0] = ownID;
+      while ( nextTarget < 256 ) {
+        if ( nextTarget == ownID ) {
+          nextTarget++;
+          continue;
+        }
+        ping.id = VESC_CAN_ID(CAN_PACKET_PING, nextTarget);
+        uint32_t now = micros();
+        pingUs[nextTarget] = now;
+        if ( can.write(ping) <= 0 ) break;
+        lastPingUs = now;
+        nextTarget++;
+      }
+      if ( nextTarget < 256 || micros() - lastPingUs < timeoutUs ) return 0;
+      finishedUs = micros();
+      phase = DISCOVERY_DONE;
+      return 1;
+    }
+    case DISCOVERY_DONE:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+CAN_DISCOVERY_FUNC CAN_node_t* CAN_DISCOVERY_OPT::lookup(uint32_t id, bool extended) {
+  uint32_t key = id | ((uint32_t)extended << 31);
+  uint16_t h = (uint16_t)((key * 2654435761UL) >> 16) % (_maxNodes * 2);
+  for ( uint16_t probe = 0; probe < _maxNodes * 2; probe++ ) {
+    uint16_t s = slot[h];
+    if ( !s ) {
+      if ( used >= _maxNodes ) return nullptr;
+      CAN_node_t &n = table[used];
+      n.id = id;
+      n.extended = extended;
+      slot[h] = ++used;
+      return &n;
+    }
+    CAN_node_t &n = table[s - 1];
+    if ( n.id == id && n.extended == extended ) return &n;
+    if ( ++h >= _maxNodes * 2 ) h = 0;
+  }
+  return nullptr;
+}
+
+CAN_DISCOVERY_FUNC void CAN_DISCOVERY_OPT::process(const CAN_message_t &msg) {
+  if ( phase != DISCOVERY_PASSIVE && phase != DISCOVERY_ACTIVE ) return;
+  uint32_t now = micros();
+
+  if ( phase == DISCOVERY_ACTIVE && msg.flags.extended && VESC_CAN_PACKET(msg.id) == CAN_PACKET_PONG && VESC_CAN_CONTROLLER(msg.id) == ownID && msg.len ) {
+    uint8_t from = msg.buf[0];
+    if ( !(ponged[from >> 5] & (1UL << (from & 31))) ) {
+      ponged[from >> 5] |= (1UL << (from & 31));
+      pongUs[from] = now;
+      if ( msg.len > 1 ) hwType[from] = msg.buf[1];
+    }
+    return; /* replies to our own pings are not bus traffic */
+  }
+
+  CAN_node_t *n = lookup(msg.id, msg.flags.extended);
+  if ( !n ) {
+    overflow++;
+    return;
+  }
+  if ( n->frames ) {
+    uint32_t period = now - n->last_us;
+    if ( !n->min_period_us || period < n->min_period_us ) n->min_period_us = period;
+    if ( period > n->max_period_us ) n->max_period_us = period;
+  }
+  else {
+    n->first_us = now;
+    if ( msg.flags.extended ) {
+      uint8_t packet = VESC_CAN_PACKET(msg.id);
+      if ( packet == CAN_PACKET_STATUS || packet == CAN_PACKET_STATUS_2 || packet == CAN_PACKET_STATUS_3 ||
+           packet == CAN_PACKET_STATUS_4 || packet == CAN_PACKET_STATUS_5 || packet == CAN_PACKET_STATUS_6 ||
+           packet == CAN_PACKET_PONG ) n->type = CAN_DEVICE_VESC;
+      else if ( packet <= CAN_PACKET_SET_POS || packet == CAN_PACKET_SET_CURRENT_REL || packet == CAN_PACKET_PING ) n->type = CAN_DEVICE_VESC_COMMAND;
+    }
+  }
+  n->last_us = now;
+  n->dlc_mask |= (1U << (msg.len & 0xF));
+  n->frames++;
+}
+
+CAN_DISCOVERY_FUNC uint32_t CAN_DISCOVERY_OPT::rateHz(const CAN_node_t &n) const {
+  if ( n.frames < 2 || n.last_us == n.first_us ) return 0;
+  return (uint32_t)(((uint64_t)(n.frames - 1) * 1000000UL) / (n.last_us - n.first_us));
+}
+
+CAN_DISCOVERY_FUNC uint16_t CAN_DISCOVERY_OPT::vescs(CAN_vesc_node_t *out, uint16_t count) const {
+  uint16_t found = 0;
+  for ( uint16_t id = 0; id < 256 && found < count; id++ ) {
+    if ( !(ponged[id >> 5] & (1UL << (id & 31))) ) continue;
+    out[found].controller_id = id;
+    out[found].hw_type = hwType[id];
+    out[found].rtt_us = pongUs[id] - pingUs[id];
+    found++;
+  }
+  return found;
+}
+
+CAN_DISCOVERY_FUNC void CAN_DISCOVERY_OPT::printMap(Stream &port) const {
+  static const char *types[] = { "unknown", "VESC", "VESC command (other master)" };
+  port.print("Discovery took "); port.print(elapsedUs() / 1000); port.print(" ms, ");
+  port.print(used); port.print(" IDs heard");
+  if ( overflow ) { port.print(", "); port.print(overflow); port.print(" frames from IDs that did not fit"); }
+  port.println();
+  for ( uint16_t i = 0; i < used; i++ ) {
+    const CAN_node_t &n = table[i];
+    port.print(( n.extended ) ? "  EXT 0x" : "  STD 0x"); port.print(n.id, HEX);
+    port.print("  frames "); port.print(n.frames);
+    port.print("  rate Hz "); port.print(rateHz(n));
+    port.print("  period us "); port.print(n.min_period_us); port.print(".."); port.print(n.max_period_us);
+    port.print("  DLC");
+    for ( uint8_t len = 0; len < 16; len++ ) if ( n.dlc_mask & (1U << len) ) { port.print(" "); port.print(len); }
+    port.print("  "); port.print(types[n.type]);
+    if ( n.type != CAN_DEVICE_UNKNOWN ) { port.print(" id "); port.print(VESC_CAN_CONTROLLER(n.id)); }
+    port.println();
+  }
+  CAN_vesc_node_t v[16];
+  uint16_t count = vescs(v, 16);
+  port.print(count); port.println(" VESC(s) answered ping");
+  for ( uint16_t i = 0; i < count; i++ ) {
+    port.print("  controller "); port.print(v[i].controller_id);
+    port.print("  rtt us "); port.print(v[i].rtt_us);
+    if ( v[i].hw_type != 0xFF ) { port.print("  hw type "); port.print(v[i].hw_type); }
+    port.println();
+  }
+}
+
+#endif
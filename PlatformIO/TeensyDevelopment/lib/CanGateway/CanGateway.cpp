@@ -0,0 +1,348 @@
+/*
+  CanGateway.cpp
+  --------------
+  See CanGateway.h.
+*/
+
+#include "CanGateway.h"
+
+CanGateway canGateway;
+
+#define GVRET_BUILD 343          /* firmware build reported to SavvyCAN */
+#define GVRET_FRAME_MAX 20       /* 0xF1 0x00 stamp id len/bus 8 data checksum */
+#define SLCAN_FRAME_MAX 31       /* T + 8 id + len + 16 data + 4 stamp + \r */
+
+static const uint32_t slcanBitrates[9] = { 10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000 };
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static inline void putLE32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t getLE32(const uint8_t *p) {
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int8_t hexValue(uint8_t c) {
+  if ( c >= '0' && c <= '9' ) return c - '0';
+  if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+  if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+  return -1;
+}
+
+/* n hex digits from p, -1 if any is not hex */
+static int64_t parseHex(const uint8_t *p, uint8_t n) {
+  int64_t v = 0;
+  for ( uint8_t i = 0; i < n; i++ ) {
+    int8_t d = hexValue(p[i]);
+    if ( d < 0 ) return -1;
+    v = (v << 4) | d;
+  }
+  return v;
+}
+
+void CanGateway::begin(Stream &port) {
+  this->port = &port;
+  protocol = GATEWAY_IDLE;
+  __atomic_store_n(&tail, head, __ATOMIC_RELEASE);
+}
+
+void CanGateway::configureBus(uint8_t bus, uint32_t bitrate, bool enabled, bool listen_only) {
+  bus_t &b = buses[bus - 1];
+  if ( !b.can ) return;
+  if ( bitrate ) b.bitrate = bitrate;
+  if ( enabled && b.bitrate && (bitrate || listen_only != b.listenOnly || !b.enabled) ) b.setBitrate(b.can, b.bitrate, listen_only);
+  b.listenOnly = listen_only;
+  b.enabled = enabled;
+}
+
+bool CanGateway::transmit(uint8_t bus, const CAN_message_t &msg) {
+  if ( bus < 1 || bus > CAN_GATEWAY_BUSES ) return 0;
+  bus_t &b = buses[bus - 1];
+  if ( !b.can || !b.enabled || b.listenOnly || b.write(b.can, msg) <= 0 ) {
+    counters.tx_failed++;
+    return 0;
+  }
+  counters.tx_frames++;
+  return 1;
+}
+
+void CanGateway::reply(const uint8_t *data, uint16_t len) {
+  port->write(data, len);
+}
+
+void CanGateway::update() {
+  if ( !port ) return;
+  readHost();
+  drain();
+}
+
+void CanGateway::readHost() {
+  int avail = port->available();
+  while ( avail-- > 0 ) {
+    int c = port->read();
+    if ( c < 0 ) break;
+    if ( gvretStart || gvretCmd >= 0 ) {
+      gvretByte((uint8_t)c);
+      continue;
+    }
+    if ( c == 0xE7 ) {
+      protocol = GATEWAY_GVRET;
+      continue;
+    }
+    if ( c == 0xF1 ) {
+      gvretStart = 1;
+      cmdLen = 0;
+      continue;
+    }
+    if ( c == '\r' ) {
+      if ( cmdLen ) slcanCommand();
+      cmdLen = 0;
+    }
+    else if ( c == '\n' ) continue;
+    else if ( cmdLen < CAN_GATEWAY_LINE ) cmd[cmdLen++] = (uint8_t)c;
+  }
+}
+
+void CanGateway::gvretByte(uint8_t c) {
+  if ( gvretStart ) {
+    gvretStart = 0;
+    gvretCmd = c;
+    cmdLen = 0;
+    switch ( c ) {
+      case GVRET_BUILD_CAN_FRAME:
+      case GVRET_ECHO_CAN_FRAME: gvretNeed = 6; break; /* id, bus, len; grows once len is known */
+      case GVRET_SET_DIG_OUTPUTS:
+      case GVRET_SET_SINGLEWIRE_MODE:
+      case GVRET_SET_SYSTEM_TYPE: gvretNeed = 1; break;
+      case GVRET_SETUP_CANBUS: gvretNeed = 8; break;
+      case GVRET_SET_EXT_BUSES: gvretNeed = 12; break;
+      default: gvretNeed = 0; break;
+    }
+    if ( !gvretNeed ) gvretCommand();
+    return;
+  }
+  cmd[cmdLen++] = c;
+  if ( (gvretCmd == GVRET_BUILD_CAN_FRAME || gvretCmd == GVRET_ECHO_CAN_FRAME) && cmdLen == 6 ) {
+    uint8_t len = cmd[5] & 0x0F;
+    gvretNeed = 6 + (( len > 8 ) ? 8 : len) + 1; /* data and a checksum byte nobody checks */
+  }
+  if ( cmdLen >= gvretNeed ) gvretCommand();
+}
+
+void CanGateway::gvretSetup(uint8_t bus, uint32_t value) {
+  if ( value & 0x80000000UL ) configureBus(bus, value & 0xFFFFF, value & 0x40000000UL, value & 0x20000000UL);
+  else configureBus(bus, value, value != 0, 0);
+}
+
+void CanGateway::gvretCommand() {
+  protocol = GATEWAY_GVRET;
+  uint8_t r[32] = { 0xF1, (uint8_t)gvretCmd };
+  switch ( gvretCmd ) {
+    case GVRET_BUILD_CAN_FRAME:
+    case GVRET_ECHO_CAN_FRAME: {
+      CAN_message_t msg;
+      uint32_t id = getLE32(cmd);
+      msg.flags.extended = ( id & 0x80000000UL ) ? 1 : 0;
+      msg.id = id & 0x1FFFFFFF;
+      msg.bus = (cmd[4] & 3) + 1;
+      msg.len = cmd[5] & 0x0F;
+      if ( msg.len > 8 ) msg.len = 8;
+      memcpy(msg.buf, cmd + 6, msg.len);
+      if ( gvretCmd == GVRET_BUILD_CAN_FRAME ) transmit(msg.bus, msg);
+      else capture(msg);
+      break;
+    }
+    case GVRET_TIME_SYNC:
+      putLE32(r + 2, micros());
+      reply(r, 6);
+      break;
+    case GVRET_GET_DIG_INPUTS:
+      reply(r, 4);
+      break;
+    case GVRET_GET_ANALOG_INPUTS:
+      reply(r, 17);
+      break;
+    case GVRET_SETUP_CANBUS:
+      gvretSetup(1, getLE32(cmd));
+      gvretSetup(2, getLE32(cmd + 4));
+      break;
+    case GVRET_GET_CANBUS_PARAMS:
+      for ( uint8_t i = 0; i < 2; i++ ) {
+        r[2 + i * 5] = buses[i].enabled | (buses[i].listenOnly << 4);
+        putLE32(r + 3 + i * 5, buses[i].bitrate);
+      }
+      reply(r, 12);
+      break;
+    case GVRET_GET_DEVICE_INFO:
+      r[2] = (uint8_t)GVRET_BUILD;
+      r[3] = (uint8_t)(GVRET_BUILD >> 8);
+      r[4] = 0x20; /* eeprom version */
+      reply(r, 8);
+      break;
+    case GVRET_KEEPALIVE:
+      r[2] = 0xDE;
+      r[3] = 0xAD;
+      reply(r, 4);
+      break;
+    case GVRET_GET_NUM_BUSES:
+      r[2] = CAN_GATEWAY_BUSES;
+      reply(r, 3);
+      break;
+    case GVRET_GET_EXT_BUSES:
+      r[2] = buses[2].enabled | (buses[2].listenOnly << 4); /* CAN3 in the single wire slot, LIN slots unused */
+      putLE32(r + 3, buses[2].bitrate);
+      reply(r, 17);
+      break;
+    case GVRET_SET_EXT_BUSES:
+      gvretSetup(3, getLE32(cmd));
+      break;
+    case GVRET_GATEWAY_STATS: {
+      uint8_t s[2 + sizeof(CanGateway_stats_t)] = { 0xF1, GVRET_GATEWAY_STATS };
+      CanGateway_stats_t copy = counters;
+      copy.ring_dropped = __atomic_load_n(&counters.ring_dropped, __ATOMIC_RELAXED);
+      memcpy(s + 2, &copy, sizeof(copy));
+      reply(s, sizeof(s));
+      break;
+    }
+    default: /* SET_DIG_OUTPUTS, SET_SINGLEWIRE_MODE, SET_SYSTEM_TYPE and unknown: nothing to do */
+      break;
+  }
+  gvretCmd = -1;
+  cmdLen = 0;
+}
+
+void CanGateway::slcanCommand() {
+  static const uint8_t ok[] = { '\r' }, error[] = { '\a' };
+  protocol = GATEWAY_SLCAN;
+  bool good = 1;
+  switch ( cmd[0] ) {
+    case 'O':
+    case 'L':
+      configureBus(slcanBus, 0, 1, cmd[0] == 'L');
+      slcanOpen = 1;
+      break;
+    case 'C':
+      slcanOpen = 0;
+      break;
+    case 'S':
+      if ( cmdLen != 2 || cmd[1] < '0' || cmd[1] > '8' ) good = 0;
+      else configureBus(slcanBus, slcanBitrates[cmd[1] - '0'], buses[slcanBus - 1].enabled, buses[slcanBus - 1].listenOnly);
+      break;
+    case 'Z':
+      slcanStamps = ( cmdLen > 1 && cmd[1] == '1' );
+      break;
+    case 'V':
+    case 'v':
+      reply((const uint8_t*)( cmd[0] == 'V' ? "V1013\r" : "v1013\r" ), 6);
+      return;
+    case 'N':
+      reply((const uint8_t*)"NT4GW\r", 6);
+      return;
+    case 'F': {
+      uint32_t dropped = __atomic_load_n(&counters.ring_dropped, __ATOMIC_RELAXED);
+      uint8_t flags = ( dropped != slcanDropped ) ? 0x08 : 0; /* data overrun */
+      slcanDropped = dropped;
+      uint8_t r[4] = { 'F', (uint8_t)hexDigits[flags >> 4], (uint8_t)hexDigits[flags & 15], '\r' };
+      reply(r, 4);
+      return;
+    }
+    case 't':
+    case 'T':
+    case 'r':
+    case 'R': {
+      bool extended = ( cmd[0] == 'T' || cmd[0] == 'R' ), remote = ( cmd[0] == 'r' || cmd[0] == 'R' );
+      uint8_t idLen = ( extended ) ? 8 : 3;
+      if ( !slcanOpen || cmdLen < idLen + 2 ) {
+        good = 0;
+        break;
+      }
+      int64_t id = parseHex(cmd + 1, idLen);
+      int8_t len = hexValue(cmd[1 + idLen]);
+      if ( id < 0 || id > (( extended ) ? 0x1FFFFFFF : 0x7FF) || len < 0 || len > 8 ||
+           (!remote && cmdLen < 2 + idLen + 2 * len) ) {
+        good = 0;
+        break;
+      }
+      CAN_message_t msg;
+      msg.id = (uint32_t)id;
+      msg.flags.extended = extended;
+      msg.flags.remote = remote;
+      msg.len = len;
+      for ( int8_t i = 0; i < len && !remote; i++ ) {
+        int64_t b = parseHex(cmd + 2 + idLen + 2 * i, 2);
+        if ( b < 0 ) {
+          good = 0;
+          break;
+        }
+        msg.buf[i] = (uint8_t)b;
+      }
+      if ( !good || !transmit(slcanBus, msg) ) {
+        good = 0;
+        break;
+      }
+      reply((const uint8_t*)( extended ? "Z\r" : "z\r" ), 2);
+      return;
+    }
+    default:
+      good = 0;
+      break;
+  }
+  reply(good ? ok : error, 1);
+}
+
+uint16_t CanGateway::encodeGvret(const CanGateway_frame_t &f, uint8_t *p) {
+  p[0] = 0xF1;
+  p[1] = GVRET_BUILD_CAN_FRAME;
+  putLE32(p + 2, f.stamp_us);
+  putLE32(p + 6, f.id | (( f.flags & 1 ) ? 0x80000000UL : 0));
+  p[10] = f.len | ((f.bus - 1) << 4);
+  memcpy(p + 11, f.buf, f.len);
+  p[11 + f.len] = 0;
+  return 12 + f.len;
+}
+
+uint16_t CanGateway::encodeSlcan(const CanGateway_frame_t &f, uint8_t *p) {
+  bool extended = f.flags & 1, remote = f.flags & 2;
+  uint8_t n = 0, idLen = ( extended ) ? 8 : 3;
+  p[n++] = ( remote ) ? (extended ? 'R' : 'r') : (extended ? 'T' : 't');
+  for ( int8_t i = idLen - 1; i >= 0; i-- ) p[n++] = hexDigits[(f.id >> (i * 4)) & 15];
+  p[n++] = hexDigits[f.len];
+  for ( uint8_t i = 0; i < f.len && !remote; i++ ) {
+    p[n++] = hexDigits[f.buf[i] >> 4];
+    p[n++] = hexDigits[f.buf[i] & 15];
+  }
+  if ( slcanStamps ) {
+    uint16_t ms = (f.stamp_us / 1000) % 60000;
+    for ( int8_t i = 3; i >= 0; i-- ) p[n++] = hexDigits[(ms >> (i * 4)) & 15];
+  }
+  p[n++] = '\r';
+  return n;
+}
+
+void CanGateway::drain() {
+  uint32_t t = tail, h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  if ( h - t > counters.ring_peak ) counters.ring_peak = h - t;
+  if ( protocol == GATEWAY_IDLE || (protocol == GATEWAY_SLCAN && !slcanOpen) ) {
+    __atomic_store_n(&tail, h, __ATOMIC_RELEASE); /* nobody listening */
+    return;
+  }
+  int room = port->availableForWrite();
+  if ( room > CAN_GATEWAY_BATCH ) room = CAN_GATEWAY_BATCH;
+  uint16_t max = ( protocol == GATEWAY_GVRET ) ? GVRET_FRAME_MAX : SLCAN_FRAME_MAX;
+  int used = 0;
+  while ( t != h && used + max <= room ) {
+    const CanGateway_frame_t &f = ring[t & (CAN_GATEWAY_RING_SIZE - 1)];
+    if ( protocol == GATEWAY_GVRET ) used += encodeGvret(f, out + used);
+    else if ( f.bus == slcanBus ) used += encodeSlcan(f, out + used);
+    t++;
+  }
+  __atomic_store_n(&tail, t, __ATOMIC_RELEASE);
+  if ( !used ) return;
+  port->write(out, used);
+  counters.usb_writes++;
+  counters.usb_bytes += used;
+}
@@ -0,0 +1,161 @@
+/*
+  CanGateway.h
+  ------------
+  USB gateway for up to three FlexCAN buses, for SavvyCAN and other PC
+  tools, instead of printing every frame as text.
+
+  Frames are captured in the FlexCAN receive interrupt with a micros()
+  stamp into one RAM ring shared by all buses. update() runs from loop():
+  it answers host commands, sends host frames out on the buses, and packs
+  every frame waiting in the ring into one buffer that goes to USB in a
+  single write() (dozens of frames per 512 byte USB packet):
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+      ...
+      void canRx(const CAN_message_t &msg) { canGateway.capture(msg); }
+      void setup() {
+        can1.begin(); can1.enableFIFO(); can1.enableFIFOInterrupt(); can1.onReceive(canRx);
+        canGateway.addBus(1, can1, 500000);   // sets the bitrate
+        canGateway.begin();
+      }
+      void loop() { canGateway.update(); }
+
+  The host protocol is picked by the first bytes it sends:
+    - GVRET binary (SavvyCAN "GVRET" connection): 0xE7 switches it on,
+      0xF1 starts a command. All three buses are streamed, GVRET bus
+      0..2 = CAN1..CAN3; CAN3's bitrate is the "single wire" slot of
+      SET_EXT_BUSES. Command 0xF1 0x20 (not part of GVRET) returns
+      CanGateway_stats_t.
+    - slcan / Lawicel ASCII (O, L, C, S0-S8, t, T, r, R, V, N, F, Z),
+      for slcand and can-utils. slcan has no bus number, it serves the bus
+      picked with setSlcanBus() (CAN1 by default).
+
+  When the ring is full new frames are dropped and counted, capture()
+  never blocks. capture() is safe from all three CAN interrupts and any
+  other priority; everything else runs from loop() only.
+*/
+
+#if !defined(_CAN_GATEWAY_H_)
+#define _CAN_GATEWAY_H_
+
+#include "Arduino.h"
+#include "FlexCAN_T4.h"
+#include "CanGatewayFormat.h"
+
+#if !defined(CAN_GATEWAY_RING_SIZE)
+#define CAN_GATEWAY_RING_SIZE 4096 /* frames, power of two: 80 KB of RAM */
+#endif
+#define CAN_GATEWAY_BATCH 4096      /* bytes encoded per USB write */
+#define CAN_GATEWAY_LINE 40         /* longest slcan command, "T" + 8 id + len + 16 data + '\r' */
+
+static_assert((CAN_GATEWAY_RING_SIZE & (CAN_GATEWAY_RING_SIZE - 1)) == 0, "CAN_GATEWAY_RING_SIZE must be a power of two");
+
+typedef enum CAN_GATEWAY_MODE {
+  GATEWAY_IDLE = 0,   /* nothing sent to the host until it picks a protocol */
+  GATEWAY_GVRET,
+  GATEWAY_SLCAN
+} CAN_GATEWAY_MODE;
+
+typedef struct CanGateway_frame_t {
+  uint32_t stamp_us;
+  uint32_t id;
+  uint8_t bus;         /* 1..3 */
+  uint8_t flags;       /* bit 0 extended, bit 1 remote */
+  uint8_t len;
+  uint8_t reserved;
+  uint8_t buf[8];
+} CanGateway_frame_t;
+
+typedef int (*_gateway_write_ptr)(void *bus, const CAN_message_t &msg);
+typedef void (*_gateway_bitrate_ptr)(void *bus, uint32_t bitrate, bool listen_only);
+
+class CanGateway {
+  public:
+    template<typename _busType> void addBus(uint8_t bus, _busType &can, uint32_t bitrate, bool listen_only = 0);
+    void begin(Stream &port = Serial);
+    inline void capture(const CAN_message_t &msg);
+    void update();
+    void setSlcanBus(uint8_t bus) { if ( bus >= 1 && bus <= CAN_GATEWAY_BUSES ) slcanBus = bus; }
+    CAN_GATEWAY_MODE mode() const { return protocol; }
+    uint32_t pending() const { return head - tail; }
+    const CanGateway_stats_t& stats() const { return counters; }
+
+  private:
+    struct bus_t {
+      void *can = nullptr;
+      _gateway_write_ptr write = nullptr;
+      _gateway_bitrate_ptr setBitrate = nullptr;
+      uint32_t bitrate = 0;
+      bool enabled = 0;
+      bool listenOnly = 0;
+    };
+    template<typename _busType> static int writeThunk(void *can, const CAN_message_t &msg) { return ((_busType*)can)->write(msg); }
+    template<typename _busType> static void bitrateThunk(void *can, uint32_t bitrate, bool listen_only) {
+      ((_busType*)can)->setBaudRate(bitrate, ( listen_only ) ? LISTEN_ONLY : TX);
+    }
+    void configureBus(uint8_t bus, uint32_t bitrate, bool enabled, bool listen_only);
+    bool transmit(uint8_t bus, const CAN_message_t &msg);
+    void readHost();
+    void gvretByte(uint8_t c);
+    void gvretCommand();
+    void gvretSetup(uint8_t bus, uint32_t value);
+    void slcanCommand();
+    void reply(const uint8_t *data, uint16_t len);
+    uint16_t encodeGvret(const CanGateway_frame_t &f, uint8_t *out);
+    uint16_t encodeSlcan(const CanGateway_frame_t &f, uint8_t *out);
+    void drain();
+
+    Stream *port = nullptr;
+    bus_t buses[CAN_GATEWAY_BUSES];
+    CAN_GATEWAY_MODE protocol = GATEWAY_IDLE;
+    uint8_t slcanBus = 1;
+    bool slcanOpen = 0;
+    bool slcanStamps = 0;
+
+    CanGateway_frame_t ring[CAN_GATEWAY_RING_SIZE];
+    volatile uint32_t head = 0;  /* next slot to reserve, written by capture() */
+    volatile uint32_t tail = 0;  /* next frame to send, written by update() */
+    uint8_t out[CAN_GATEWAY_BATCH];
+
+    uint8_t cmd[CAN_GATEWAY_LINE];   /* GVRET command arguments or slcan line being assembled */
+    uint8_t cmdLen = 0;
+    bool gvretStart = 0;             /* 0xF1 seen, the command byte is next */
+    int16_t gvretCmd = -1;           /* GVRET command collecting arguments, -1 = none */
+    uint8_t gvretNeed = 0;           /* argument bytes it needs */
+    uint32_t slcanDropped = 0;       /* ring_dropped at the last slcan F command */
+    CanGateway_stats_t counters;
+};
+
+extern CanGateway canGateway;
+
+template<typename _busType> void CanGateway::addBus(uint8_t bus, _busType &can, uint32_t bitrate, bool listen_only) {
+  if ( bus < 1 || bus > CAN_GATEWAY_BUSES ) return;
+  bus_t &b = buses[bus - 1];
+  b.can = &can;
+  b.write = writeThunk<_busType>;
+  b.setBitrate = bitrateThunk<_busType>;
+  configureBus(bus, bitrate, 1, listen_only);
+}
+
+inline void CanGateway::capture(const CAN_message_t &msg) {
+  uint32_t stamp = micros();
+  uint8_t bus = msg.bus;
+  if ( bus < 1 || bus > CAN_GATEWAY_BUSES || !buses[bus - 1].enabled ) return;
+  uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+  do {
+    if ( h - tail >= CAN_GATEWAY_RING_SIZE ) {
+      __atomic_fetch_add(&counters.ring_dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  } while ( !__atomic_compare_exchange_n(&head, &h, h + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) );
+  CanGateway_frame_t &f = ring[h & (CAN_GATEWAY_RING_SIZE - 1)];
+  f.stamp_us = stamp;
+  f.id = msg.id;
+  f.bus = bus;
+  f.flags = ( msg.flags.extended ? 1 : 0 ) | ( msg.flags.remote ? 2 : 0 );
+  f.len = ( msg.len > 8 ) ? 8 : msg.len;
+  memcpy(f.buf, msg.buf, 8);
+  counters.rx_frames[bus - 1]++;
+}
+
+#endif
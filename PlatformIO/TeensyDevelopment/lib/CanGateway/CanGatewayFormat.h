@@ -0,0 +1,49 @@
+/*
+  CanGatewayFormat.h
+  ------------------
+  GVRET command bytes and the gateway's statistics record, shared by
+  lib/CanGateway and host/gateway_rate_test.cpp. Everything on the wire is
+  little-endian.
+
+  Frame to the host (GVRET):
+      0xF1 0x00 stamp_us(4) id(4, bit 31 = extended) len | bus << 4  data[len] 0x00
+*/
+
+#if !defined(_CAN_GATEWAY_FORMAT_H_)
+#define _CAN_GATEWAY_FORMAT_H_
+
+#include <stdint.h>
+
+#define CAN_GATEWAY_BUSES 3
+
+/* GVRET commands, after 0xF1 */
+#define GVRET_BUILD_CAN_FRAME 0x00
+#define GVRET_TIME_SYNC 0x01
+#define GVRET_GET_DIG_INPUTS 0x02
+#define GVRET_GET_ANALOG_INPUTS 0x03
+#define GVRET_SET_DIG_OUTPUTS 0x04
+#define GVRET_SETUP_CANBUS 0x05
+#define GVRET_GET_CANBUS_PARAMS 0x06
+#define GVRET_GET_DEVICE_INFO 0x07
+#define GVRET_SET_SINGLEWIRE_MODE 0x08
+#define GVRET_KEEPALIVE 0x09
+#define GVRET_SET_SYSTEM_TYPE 0x0A
+#define GVRET_ECHO_CAN_FRAME 0x0B
+#define GVRET_GET_NUM_BUSES 0x0C
+#define GVRET_GET_EXT_BUSES 0x0D
+#define GVRET_SET_EXT_BUSES 0x0E
+#define GVRET_GATEWAY_STATS 0x20 /* ours, not in GVRET */
+
+typedef struct CanGateway_stats_t {
+  uint32_t rx_frames[CAN_GATEWAY_BUSES] = { 0 };
+  uint32_t ring_dropped = 0;   /* ring full, frame lost before reaching USB */
+  uint32_t ring_peak = 0;      /* deepest the ring has been */
+  uint32_t tx_frames = 0;      /* host frames written to a bus */
+  uint32_t tx_failed = 0;      /* bus TX queue full or bus disabled */
+  uint32_t usb_writes = 0;
+  uint32_t usb_bytes = 0;
+} CanGateway_stats_t;
+
+static_assert(sizeof(CanGateway_stats_t) == 36, "CanGateway_stats_t must stay 36 bytes");
+
+#endif
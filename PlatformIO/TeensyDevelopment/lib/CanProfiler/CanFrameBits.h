@@ -0,0 +1,81 @@
+/*
+  CanFrameBits.h
+  --------------
+  Length on the wire of a classic CAN frame, in bit times: SOF to the end
+  of the 3 bit interframe space, stuff bits included. Plain C++, used by
+  lib/CanProfiler on the Teensy and by host/gateway_rate_test.cpp.
+
+      canFrameBits(msg.id, msg.flags.extended, msg.flags.remote, msg.len, msg.buf);  // what this frame took
+      canFrameBitsWorst(msg.flags.extended, msg.flags.remote, msg.len);            // the most it could take
+
+  canFrameBits() walks the stuffed part of the frame (SOF to the end of the
+  CRC) once, working out the CRC-15 and counting stuff bits as it goes, no
+  bit buffer. A stuff bit goes in after five equal bits and counts as the
+  first bit of the next run. canFrameBitsWorst() is the usual bound of one
+  stuff bit per four bits after the first, the figure to plan a schedule
+  against since the payload decides the real one.
+*/
+
+#if !defined(_CAN_FRAME_BITS_H_)
+#define _CAN_FRAME_BITS_H_
+
+#include <stdint.h>
+
+#define CAN_FRAME_TAIL_BITS 13 /* CRC delimiter, ACK slot and delimiter, EOF, interframe space: never stuffed */
+
+typedef struct CanFrameBits_walk_t {
+  uint16_t crc = 0;
+  uint16_t bits = 0;
+  uint16_t stuffed = 0;
+  uint8_t last = 2;
+  uint8_t run = 0;
+
+  void stuff(uint8_t bit) {
+    run = ( bit == last ) ? run + 1 : 1;
+    last = bit;
+    bits++;
+    if ( run == 5 ) {
+      stuffed++;
+      last = !bit;
+      run = 1;
+    }
+  }
+  void put(uint32_t value, uint8_t count) { /* MSB first, into the CRC and the stuff count */
+    while ( count-- ) {
+      uint8_t bit = (value >> count) & 1;
+      bool next = bit ^ ((crc >> 14) & 1);
+      crc = (uint16_t)((crc << 1) & 0x7FFF);
+      if ( next ) crc ^= 0x4599;
+      stuff(bit);
+    }
+  }
+} CanFrameBits_walk_t;
+
+static inline uint16_t canFrameBits(uint32_t id, bool extended, bool remote, uint8_t len, const uint8_t *data) {
+  CanFrameBits_walk_t w;
+  w.put(0, 1);                                 /* SOF */
+  if ( extended ) {
+    w.put(id >> 18, 11);
+    w.put(3, 2);                               /* SRR IDE */
+    w.put(id & 0x3FFFF, 18);
+    w.put(remote, 1);
+    w.put(0, 2);                               /* r1 r0 */
+  }
+  else {
+    w.put(id, 11);
+    w.put(remote, 1);
+    w.put(0, 2);                               /* IDE r0 */
+  }
+  w.put(len, 4);
+  if ( !remote ) for ( uint8_t i = 0; i < len && i < 8; i++ ) w.put(data[i], 8);
+  uint16_t crc = w.crc;
+  for ( int8_t i = 14; i >= 0; i-- ) w.stuff((crc >> i) & 1);
+  return w.bits + w.stuffed + CAN_FRAME_TAIL_BITS;
+}
+
+static inline uint16_t canFrameBitsWorst(bool extended, bool remote, uint8_t len) {
+  uint16_t stuffable = ( extended ? 54 : 34 ) + ( remote ? 0 : 8 * ( len > 8 ? 8 : len ) ); /* SOF to the end of the CRC */
+  return stuffable + (stuffable - 1) / 4 + CAN_FRAME_TAIL_BITS;
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*
+  CanProfiler.cpp
+  ---------------
+  See CanProfiler.h.
+*/
+
+#include "CanProfiler.h"
+
+CanProfiler canProfiler;
+
+void CanProfiler::begin(uint32_t window_ms) {
+  __disable_irq();
+  running = 0;
+  __enable_irq();
+  uint32_t now = micros();
+  bucketUs = ( window_ms ? window_ms : 1 ) * 1000 / CAN_PROFILER_BUCKETS;
+  if ( !bucketUs ) bucketUs = 1;
+  for ( uint8_t i = 0; i < CAN_PROFILER_BUSES; i++ ) {
+    uint32_t bitrate = buses[i].bitrate;
+    memset(&buses[i], 0, sizeof(buses[i]));
+    buses[i].bitrate = bitrate;
+    buses[i].bucketStart = now;
+  }
+  for ( uint16_t i = 0; i < CAN_PROFILER_IDS; i++ ) table[i] = CanProfiler_id_t();
+  memset(slot, 0, sizeof(slot));
+  used = 0;
+  overflow = 0;
+  __disable_irq();
+  running = 1;
+  __enable_irq();
+}
+
+void CanProfiler::setBitrate(uint8_t bus, uint32_t bitrate) {
+  if ( bus >= CAN_PROFILER_BUSES ) return;
+  __disable_irq();
+  buses[bus].bitrate = bitrate;
+  buses[bus].peak = 0;
+  __enable_irq();
+}
+
+uint16_t CanProfiler::cpct(uint32_t bits, uint32_t bitrate, uint32_t us) const {
+  if ( !bitrate || !us ) return 0;
+  uint64_t load = (uint64_t)bits * 10000ULL * 1000000ULL / ((uint64_t)bitrate * us);
+  return ( load > 0xFFFF ) ? 0xFFFF : (uint16_t)load;
+}
+
+/* interrupts masked or in the CAN interrupt; closes every bucket that has run out */
+void CanProfiler::advance(bus_t &b, uint32_t now) {
+  uint32_t elapsed = now - b.bucketStart;
+  if ( elapsed < bucketUs ) return;
+  if ( elapsed >= bucketUs * (CAN_PROFILER_BUCKETS + 1) ) { /* quiet for a whole window, only the last bucket had traffic */
+    uint16_t load = cpct(b.buckets[b.current].bits, b.bitrate, bucketUs);
+    if ( load > b.peak ) b.peak = load;
+    memset(b.buckets, 0, sizeof(b.buckets));
+    b.current = 0;
+    b.bucketStart = now - elapsed % bucketUs;
+    return;
+  }
+  while ( now - b.bucketStart >= bucketUs ) {
+    uint16_t load = cpct(b.buckets[b.current].bits, b.bitrate, bucketUs);
+    if ( load > b.peak ) b.peak = load;
+    if ( ++b.current > CAN_PROFILER_BUCKETS ) b.current = 0;
+    memset(&b.buckets[b.current], 0, sizeof(bucket_t));
+    b.bucketStart += bucketUs;
+  }
+}
+
+CanProfiler_id_t* CanProfiler::lookup(uint32_t id, bool extended, uint8_t bus) {
+  uint32_t key = id | ((uint32_t)extended << 31) | ((uint32_t)bus << 29); /* bits 29 and 30 are free in any CAN ID */
+  uint16_t h = (uint16_t)((uint32_t)(key * 2654435761UL) >> 16) % (CAN_PROFILER_IDS * 2);
+  for ( uint16_t probe = 0; probe < CAN_PROFILER_IDS * 2; probe++ ) {
+    uint16_t s = slot[h];
+    if ( !s ) {
+      if ( used >= CAN_PROFILER_IDS ) return nullptr;
+      CanProfiler_id_t &n = table[used];
+      n.id = id;
+      n.extended = extended;
+      n.bus = bus;
+      slot[h] = ++used;
+      return &n;
+    }
+    CanProfiler_id_t &n = table[s - 1];
+    if ( n.id == id && n.extended == extended && n.bus == bus ) return &n;
+    if ( ++h >= CAN_PROFILER_IDS * 2 ) h = 0;
+  }
+  return nullptr;
+}
+
+void CanProfiler::process(const CAN_message_t &msg, bool tx) {
+  if ( !running || msg.bus >= CAN_PROFILER_BUSES ) return;
+  uint32_t now = micros();
+  uint16_t bits = canFrameBits(msg.id, msg.flags.extended, msg.flags.remote, msg.len, msg.buf);
+
+  bus_t &b = buses[msg.bus];
+  advance(b, now);
+  bucket_t &bucket = b.buckets[b.current];
+  bucket.bits += bits;
+  bucket.worst += canFrameBitsWorst(msg.flags.extended, msg.flags.remote, msg.len);
+  bucket.frames++;
+  b.frames++;
+  if ( tx ) b.tx++;
+
+  CanProfiler_id_t *n = lookup(msg.id, msg.flags.extended, msg.bus);
+  if ( !n ) {
+    overflow++;
+    return;
+  }
+  if ( n->frames ) {
+    uint32_t period = now - n->last_us;
+    if ( !n->min_period_us || period < n->min_period_us ) n->min_period_us = period;
+    if ( period > n->max_period_us ) n->max_period_us = period;
+    if ( n->frames == 1 ) n->period_us = period;
+    else {
+      int32_t error = (int32_t)(period - n->period_us);
+      n->period_us += error / 8;
+      n->jitter_us += ((int32_t)abs(error) - (int32_t)n->jitter_us) / 8;
+    }
+  }
+  else n->first_us = now;
+  n->last_us = now;
+  n->dlc_mask |= (1U << (msg.len & 0xF));
+  n->frames++;
+  n->bits += bits;
+  if ( tx ) n->tx++;
+}
+
+bool CanProfiler::load(uint8_t bus, CanProfiler_load_t &out) {
+  out = CanProfiler_load_t();
+  if ( bus >= CAN_PROFILER_BUSES ) return 0;
+  bus_t &b = buses[bus];
+  __disable_irq();
+  advance(b, micros());
+  for ( uint8_t i = 0; i <= CAN_PROFILER_BUCKETS; i++ ) {
+    if ( i == b.current ) continue; /* still filling */
+    out.frames += b.buckets[i].frames;
+    out.bits += b.buckets[i].bits;
+    out.worst_bits += b.buckets[i].worst;
+  }
+  out.bitrate = b.bitrate;
+  out.peak_cpct = b.peak;
+  out.total_frames = b.frames;
+  out.tx_frames = b.tx;
+  __enable_irq();
+  out.window_us = bucketUs * CAN_PROFILER_BUCKETS;
+  out.load_cpct = cpct(out.bits, out.bitrate, out.window_us);
+  out.worst_cpct = cpct(out.worst_bits, out.bitrate, out.window_us);
+  return out.bitrate != 0;
+}
+
+bool CanProfiler::id(uint16_t index, CanProfiler_id_t &out) const {
+  if ( index >= used ) return 0;
+  __disable_irq();
+  out = table[index];
+  __enable_irq();
+  return 1;
+}
+
+uint32_t CanProfiler::rateMilliHz(const CanProfiler_id_t &n) {
+  if ( n.frames < 2 || n.last_us == n.first_us ) return 0;
+  return (uint32_t)(((uint64_t)(n.frames - 1) * 1000000000ULL) / (n.last_us - n.first_us));
+}
+
+void CanProfiler::printSummary(Stream &port) {
+  for ( uint8_t bus = 0; bus < CAN_PROFILER_BUSES; bus++ ) {
+    CanProfiler_load_t l;
+    if ( !load(bus, l) ) continue;
+    port.printf("CAN%u %lu bit/s  load %u.%02u %% (worst case stuffing %u.%02u %%)  peak %u.%02u %%  %lu frames/s, %lu sent of %lu\n",
+                bus, l.bitrate, l.load_cpct / 100, l.load_cpct % 100, l.worst_cpct / 100, l.worst_cpct % 100,
+                l.peak_cpct / 100, l.peak_cpct % 100, (uint32_t)((uint64_t)l.frames * 1000000UL / l.window_us),
+                l.tx_frames, l.total_frames);
+  }
+  for ( uint16_t i = 0; i < used; i++ ) {
+    CanProfiler_id_t n;
+    if ( !id(i, n) ) break;
+    uint32_t rate = rateMilliHz(n);
+    port.printf("  CAN%u %s 0x%lX  frames %lu  rate %lu.%03lu Hz  period us %lu +-%lu (%lu..%lu)  %lu bit/s  DLC",
+                n.bus, ( n.extended ) ? "EXT" : "STD", n.id, n.frames, rate / 1000, rate % 1000, n.period_us, n.jitter_us,
+                n.min_period_us, n.max_period_us, (uint32_t)((uint64_t)rate * (n.bits / n.frames) / 1000));
+    for ( uint8_t len = 0; len < 16; len++ ) if ( n.dlc_mask & (1U << len) ) port.printf(" %u", len);
+    if ( n.tx ) port.print("  sent here");
+    port.println();
+  }
+  if ( overflow ) port.printf("  %lu frames from IDs that did not fit\n", overflow);
+}
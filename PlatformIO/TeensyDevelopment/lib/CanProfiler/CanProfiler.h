@@ -0,0 +1,123 @@
+/*
+  CanProfiler.h
+  -------------
+  Bus load and per-ID traffic figures, from the frames this node receives
+  and sends. setBaudRate() keeps the bitrate, this is what turns it into a
+  utilisation: every frame is measured to the bit with CanFrameBits.h
+  (stuff bits as they were on the wire, and the worst case for the same
+  ID and length), and the bits add up in a sliding window.
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+      void canFrame(const CAN_message_t &msg) { canProfiler.process(msg); }
+      void canSent(const CAN_message_t &msg) { canProfiler.process(msg, 1); }
+      void setup() {
+        can1.begin(); can1.setBaudRate(250000);
+        can1.enableFIFO(); can1.enableFIFOInterrupt();
+        can1.onReceive(canFrame); can1.onTransmit(canSent);
+        canProfiler.begin();                        // 1 s window
+        canProfiler.setBitrate(1, can1.getBaudRate());
+      }
+      void loop() { ... canProfiler.printSummary(); ... }
+
+  Bus load: the window is CAN_PROFILER_BUCKETS buckets, the figures cover
+  the last full ones, so they move one bucket (100 ms by default) at a
+  time and never count a partly filled bucket. The peak is the busiest
+  single bucket since begin(). Frames sent by this node only reach the
+  profiler through onTransmit() (self reception is off), so both
+  callbacks have to be set for the load to be right.
+
+  Per ID (and bus): frame count, rate, DLCs seen, min/max period and a
+  smoothed period with its jitter, each new period weighted 1/8 like TCP's
+  round trip estimate. IDs beyond CAN_PROFILER_IDS are only counted in
+  the bus load and in dropped().
+
+  process() runs in the CAN interrupt, costs one pass over the frame's
+  bits and a hash lookup. All CAN interrupts have to share one priority
+  (the default) since the ID table is common to every bus. Readers copy
+  under __disable_irq().
+*/
+
+#if !defined(_CAN_PROFILER_H_)
+#define _CAN_PROFILER_H_
+
+#include "Arduino.h"
+#include "FlexCAN_T4.h"
+#include "CanFrameBits.h"
+
+#define CAN_PROFILER_BUSES 4     /* msg.bus: 1..3 on a Teensy 4, 0..1 on a 3.x */
+#define CAN_PROFILER_BUCKETS 10
+#define CAN_PROFILER_IDS 128
+
+typedef struct CanProfiler_id_t {
+  uint32_t id = 0;
+  bool extended = 0;
+  uint8_t bus = 0;
+  uint16_t dlc_mask = 0;         /* bit n set if a frame with len n was seen */
+  uint32_t frames = 0;
+  uint32_t tx = 0;               /* of those, sent by this node */
+  uint32_t bits = 0;             /* on the wire, all frames */
+  uint32_t first_us = 0;
+  uint32_t last_us = 0;
+  uint32_t min_period_us = 0;
+  uint32_t max_period_us = 0;
+  uint32_t period_us = 0;        /* smoothed */
+  uint32_t jitter_us = 0;        /* smoothed |period - period_us| */
+} CanProfiler_id_t;
+
+typedef struct CanProfiler_load_t {
+  uint32_t bitrate = 0;
+  uint32_t window_us = 0;
+  uint32_t frames = 0;           /* in the window */
+  uint32_t bits = 0;
+  uint32_t worst_bits = 0;
+  uint16_t load_cpct = 0;        /* 0.01 % */
+  uint16_t worst_cpct = 0;
+  uint16_t peak_cpct = 0;        /* busiest bucket since begin() */
+  uint32_t total_frames = 0;
+  uint32_t tx_frames = 0;
+} CanProfiler_load_t;
+
+class CanProfiler {
+  public:
+    void begin(uint32_t window_ms = 1000); /* clears everything */
+    void setBitrate(uint8_t bus, uint32_t bitrate); /* msg.bus numbering */
+    void process(const CAN_message_t &msg, bool tx = 0); /* from onReceive() and onTransmit() */
+    bool load(uint8_t bus, CanProfiler_load_t &out); /* 0 if the bus has no bitrate */
+    uint16_t ids() const { return used; }
+    bool id(uint16_t index, CanProfiler_id_t &out) const; /* copy of table entry index */
+    static uint32_t rateMilliHz(const CanProfiler_id_t &n);
+    uint32_t dropped() const { return overflow; }
+    void printSummary(Stream &port = Serial);
+
+  private:
+    typedef struct bucket_t {
+      uint32_t bits;
+      uint32_t worst;
+      uint32_t frames;
+    } bucket_t;
+    typedef struct bus_t {
+      uint32_t bitrate;
+      uint32_t bucketStart;
+      uint8_t current;
+      uint16_t peak;
+      uint32_t frames;
+      uint32_t tx;
+      bucket_t buckets[CAN_PROFILER_BUCKETS + 1]; /* the full ones and the one filling */
+    } bus_t;
+
+    void advance(bus_t &b, uint32_t now);
+    uint16_t cpct(uint32_t bits, uint32_t bitrate, uint32_t us) const;
+    CanProfiler_id_t* lookup(uint32_t id, bool extended, uint8_t bus);
+
+    volatile bool running = 0;
+    uint32_t bucketUs = 100000;
+    bus_t buses[CAN_PROFILER_BUSES];
+    CanProfiler_id_t table[CAN_PROFILER_IDS];
+    uint16_t slot[CAN_PROFILER_IDS * 2]; /* open addressing hash, index + 1 into table, 0 empty */
+    volatile uint16_t used = 0;
+    volatile uint32_t overflow = 0;
+};
+
+extern CanProfiler canProfiler;
+
+#endif
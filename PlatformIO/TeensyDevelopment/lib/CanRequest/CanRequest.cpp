@@ -0,0 +1,92 @@
+/*
+  CanRequest.cpp
+  --------------
+  See CanRequest.h.
+*/
+
+#include "CanRequest.h"
+
+CanRequest canRequest;
+
+bool CanRequest::expect(CanRequest_t &req, uint32_t response_id, uint32_t timeout_us, bool extended) {
+  if ( req.state == CAN_REQUEST_PENDING ) return 0;
+  req.id = response_id;
+  req.extended = extended;
+  req.rtt_us = 0;
+  req.next = nullptr;
+  req.timer.callback = expired;
+  req.timer.arg = this;
+  req.sentUs = micros();
+  __disable_irq();
+  waiting.pushBack(req); /* answers come back in order */
+  req.state = CAN_REQUEST_PENDING;
+  counters.sent++;
+  counters.pending++;
+  __enable_irq();
+  canScheduler.startTimer(req.timer, timeout_us);
+  return 1;
+}
+
+void CanRequest::cancel(CanRequest_t &req) {
+  __disable_irq();
+  bool removed = waiting.remove(req);
+  if ( removed ) counters.pending--;
+  __enable_irq();
+  if ( !removed ) return;
+  canScheduler.stopTimer(req.timer);
+  req.state = CAN_REQUEST_IDLE;
+}
+
+void CanRequest::finish(CanRequest_t &req, CAN_REQUEST_STATE state) {
+  canScheduler.stopTimer(req.timer);
+  __disable_irq();
+  counters.pending--;
+  if ( state == CAN_REQUEST_DONE ) {
+    counters.answered++;
+    if ( req.rtt_us > counters.max_rtt_us ) counters.max_rtt_us = req.rtt_us;
+  }
+  else if ( state == CAN_REQUEST_TIMEOUT ) counters.timeouts++;
+  else counters.failed++;
+  __enable_irq();
+  req.state = state; /* last, loop() may be polling it */
+  if ( req.callback ) req.callback(req);
+}
+
+bool CanRequest::process(const CAN_message_t &msg) {
+  if ( !waiting.first(msg.id, msg.flags.extended) ) return 0; /* nothing waiting on this bucket, the usual case */
+  uint32_t now = micros();
+  CanRequest_t *found = nullptr;
+  __disable_irq();
+  for ( CanRequest_t **p = waiting.chain(msg.id, msg.flags.extended); *p; p = &(*p)->next ) {
+    CanRequest_t &req = **p;
+    if ( req.id != msg.id || req.extended != msg.flags.extended ) continue;
+    if ( req.match && !req.match(req, msg) ) continue;
+    *p = req.next;
+    req.next = nullptr;
+    found = &req;
+    break;
+  }
+  __enable_irq();
+  if ( !found ) return 0;
+  found->response = msg;
+  found->rtt_us = now - found->sentUs;
+  finish(*found, CAN_REQUEST_DONE);
+  return 1;
+}
+
+void CanRequest::expired(TimerWheel_timer_t *timer, void *arg) {
+  CanRequest &self = *(CanRequest*)arg;
+  CanRequest_t &req = TIMER_WHEEL_OWNER(CanRequest_t, timer, timer);
+  __disable_irq();
+  bool removed = self.waiting.remove(req);
+  __enable_irq();
+  if ( removed ) self.finish(req, CAN_REQUEST_TIMEOUT); /* else the answer got there first */
+}
+
+void CanRequest::resetStats() {
+  __disable_irq();
+  uint32_t pending = counters.pending;
+  counters = CanRequest_stats_t();
+  counters.pending = pending;
+  __enable_irq();
+}
@@ -0,0 +1,116 @@
+/*
+  CanRequest.h
+  ------------
+  Request/response over CAN without waiting for the reply. The old way
+  was write() and then spin up to 100 ms on read(), one device at a time,
+  throwing away whatever else arrived meanwhile. Here a request is
+  registered with the ID its answer comes back on and a timeout, and
+  loop() goes on; any number can be outstanding across devices:
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+      CanRequest_t ping[4];
+      void canRx(const CAN_message_t &msg) { canRequest.process(msg); }
+      void setup() {
+        can1.begin(); can1.setBaudRate(250000);
+        can1.enableFIFO(); can1.enableFIFOInterrupt(); can1.onReceive(canRx);
+        canScheduler.begin();                              // the timeouts run on its wheel
+      }
+      void loop() {
+        ...
+        canRequest.send(can1, pingMsg, ping[0], VESC_CAN_ID(CAN_PACKET_PONG, 254), 10000);
+        ...
+        if ( ping[0].state == CAN_REQUEST_DONE ) ... ping[0].response, ping[0].rtt_us
+      }
+
+  A CanRequest_t is owned by the caller and can be reused once it is no
+  longer CAN_REQUEST_PENDING. Set its callback to be told instead of
+  polling (it runs in the receive or the scheduler tick interrupt), and
+  match to tell apart answers that share an ID (every VESC pong comes
+  back on the pinging node's ID, the sender is in the payload).
+
+  Matching: pending requests hang off a 64 bucket hash of the response
+  ID (CanIdTable.h), process() only walks the requests waiting on that
+  bucket, so it costs the same with one or a hundred outstanding.
+  Requests on the same ID are answered in the order they were sent.
+
+  Timeouts are timers on canScheduler's wheel (lib/CanScheduler), the
+  scheduler has to be running, with its interrupt priority left above the
+  CAN one (see CanScheduler.h).
+*/
+
+#if !defined(_CAN_REQUEST_H_)
+#define _CAN_REQUEST_H_
+
+#include "Arduino.h"
+#include "FlexCAN_T4.h"
+#include "TimerWheel.h"
+#include "CanScheduler.h"
+
+typedef enum CAN_REQUEST_STATE {
+  CAN_REQUEST_IDLE = 0,
+  CAN_REQUEST_PENDING,
+  CAN_REQUEST_DONE,
+  CAN_REQUEST_TIMEOUT,
+  CAN_REQUEST_FAILED             /* write() refused the request frame */
+} CAN_REQUEST_STATE;
+
+struct CanRequest_t;
+typedef bool (*_request_match_ptr)(const CanRequest_t &req, const CAN_message_t &msg); /* 1: this is the answer */
+typedef void (*_request_ptr)(CanRequest_t &req); /* answered or timed out, interrupt context */
+
+typedef struct CanRequest_t {
+  _request_ptr callback = nullptr;
+  _request_match_ptr match = nullptr; /* nullptr: any frame on the response ID */
+  void *arg = nullptr;
+  volatile CAN_REQUEST_STATE state = CAN_REQUEST_IDLE;
+  CAN_message_t response;
+  uint32_t rtt_us = 0;             /* sent to answered */
+  uint32_t id = 0;                 /* response ID */
+  bool extended = 1;
+  uint32_t sentUs = 0;
+  TimerWheel_timer_t timer;
+  CanRequest_t *next = nullptr;    /* bucket chain */
+} CanRequest_t;
+
+typedef struct CanRequest_stats_t {
+  uint32_t sent = 0;
+  uint32_t answered = 0;
+  uint32_t timeouts = 0;
+  uint32_t failed = 0;
+  uint32_t pending = 0;
+  uint32_t max_rtt_us = 0;
+} CanRequest_stats_t;
+
+class CanRequest {
+  public:
+    /* registers req, then writes msg; the answer is on response_id, extended if msg is */
+    template<typename _busType>
+    bool send(_busType &can, const CAN_message_t &msg, CanRequest_t &req, uint32_t response_id, uint32_t timeout_us);
+    bool expect(CanRequest_t &req, uint32_t response_id, uint32_t timeout_us, bool extended = 1); /* the request goes out some other way */
+    void cancel(CanRequest_t &req); /* back to CAN_REQUEST_IDLE, no callback */
+    bool process(const CAN_message_t &msg); /* call from the receive callback, 1 if it answered a request */
+    const CanRequest_stats_t& stats() const { return counters; }
+    void resetStats();
+
+  private:
+    static void expired(TimerWheel_timer_t *timer, void *arg);
+    void finish(CanRequest_t &req, CAN_REQUEST_STATE state);
+
+    CanIdTable<CanRequest_t> waiting; /* whoever takes a request off it completes it */
+    CanRequest_stats_t counters;
+};
+
+extern CanRequest canRequest;
+
+template<typename _busType>
+bool CanRequest::send(_busType &can, const CAN_message_t &msg, CanRequest_t &req, uint32_t response_id, uint32_t timeout_us) {
+  if ( !expect(req, response_id, timeout_us, msg.flags.extended) ) return 0; /* before write(), the answer can beat it back */
+  if ( can.write(msg) > 0 ) return 1; /* 0 queue full, -2 bus off */
+  __disable_irq();
+  bool removed = waiting.remove(req);
+  __enable_irq();
+  if ( removed ) finish(req, CAN_REQUEST_FAILED);
+  return 0;
+}
+
+#endif
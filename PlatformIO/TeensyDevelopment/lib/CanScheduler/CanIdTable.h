@@ -0,0 +1,59 @@
+/*
+  CanIdTable.h
+  ------------
+  The CAN ID lookup behind CanRequest and CanDeadline: caller owned
+  records hang off a 64 bucket hash of the ID, chained through their own
+  next pointer, so there is nothing to allocate and a receive callback
+  only walks the few records on its bucket.
+
+      struct Watch { uint32_t id; bool extended; Watch *next = nullptr; ... };
+      CanIdTable<Watch> table;
+      __disable_irq(); table.pushBack(w); __enable_irq();
+      for ( Watch *w = table.first(msg.id, msg.flags.extended); w; w = w->next ) ...
+
+  The chains only change with interrupts masked, so the receive interrupt
+  can walk them as they are. A record's id and extended must not change
+  while it is on the table.
+*/
+
+#if !defined(_CAN_ID_TABLE_H_)
+#define _CAN_ID_TABLE_H_
+
+#include <stdint.h>
+
+#define CAN_ID_TABLE_BUCKETS 64
+
+template<typename T>
+class CanIdTable {
+  public:
+    static uint8_t bucket(uint32_t id, bool extended) { return (uint8_t)((uint32_t)((id | ((uint32_t)extended << 31)) * 2654435761UL) >> 26); }
+    T* first(uint32_t id, bool extended) const { return buckets[bucket(id, extended)]; }
+    T** chain(uint32_t id, bool extended) { return &buckets[bucket(id, extended)]; } /* to unlink while walking, interrupts masked */
+
+    /* interrupts masked */
+    void pushFront(T &t) {
+      T **head = chain(t.id, t.extended);
+      t.next = *head;
+      *head = &t;
+    }
+    void pushBack(T &t) { /* behind the others on its bucket */
+      T **tail = chain(t.id, t.extended);
+      while ( *tail ) tail = &(*tail)->next;
+      t.next = nullptr;
+      *tail = &t;
+    }
+    bool remove(T &t) { /* 0 if it was not on the table */
+      for ( T **p = chain(t.id, t.extended); *p; p = &(*p)->next ) {
+        if ( *p != &t ) continue;
+        *p = t.next;
+        t.next = nullptr;
+        return 1;
+      }
+      return 0;
+    }
+
+  private:
+    T *buckets[CAN_ID_TABLE_BUCKETS] = { nullptr };
+};
+
+#endif
@@ -0,0 +1,257 @@
+/*
+  CanScheduler.cpp
+  ----------------
+  See CanScheduler.h.
+*/
+
+#include "CanScheduler.h"
+
+CanScheduler canScheduler;
+
+bool CanScheduler::begin(uint32_t tick_us, uint8_t priority) {
+  if ( !tick_us || (IntervalTimerOwner<CanScheduler>::owner && IntervalTimerOwner<CanScheduler>::owner != this) ) return 0;
+  cyclesPerUs = cycleCounterBegin();
+  if ( running ) end();
+  tickUs = tick_us;
+  IntervalTimerOwner<CanScheduler>::owner = this;
+  for ( int16_t i = 0; i < CAN_SCHEDULER_ENTRIES; i++ ) if ( entries[i].used ) arm(entries[i]);
+  running = 1;
+  timer.priority(priority);
+  if ( !timer.begin(isr, tickUs) ) {
+    end();
+    return 0;
+  }
+  return 1;
+}
+
+void CanScheduler::end() {
+  timer.end();
+  running = 0;
+  for ( int16_t i = 0; i < CAN_SCHEDULER_ENTRIES; i++ ) if ( entries[i].used ) disarm(entries[i]);
+  IntervalTimerOwner<CanScheduler>::owner = nullptr;
+}
+
+int16_t CanScheduler::add(uint8_t bus, const CAN_message_t &msg, uint32_t period_us, int32_t phase_us) {
+  return add(bus, &msg, nullptr, nullptr, period_us, phase_us);
+}
+
+int16_t CanScheduler::add(uint8_t bus, _scheduler_gen_ptr gen, void *arg, uint32_t period_us, int32_t phase_us) {
+  if ( !gen ) return -1;
+  return add(bus, nullptr, gen, arg, period_us, phase_us);
+}
+
+int16_t CanScheduler::add(uint8_t bus, const CAN_message_t *msg, _scheduler_gen_ptr gen, void *arg, uint32_t period_us, int32_t phase_us) {
+  if ( bus < 1 || bus > CAN_SCHEDULER_BUSES || !buses[bus - 1].mbCount || !period_us ) return -1;
+  int16_t handle = 0;
+  while ( handle < CAN_SCHEDULER_ENTRIES && entries[handle].used ) handle++;
+  if ( handle == CAN_SCHEDULER_ENTRIES ) return -1;
+  entry_t &e = entries[handle];
+  e.timer.callback = expired;
+  e.timer.arg = &e;
+  e.msg = ( msg ) ? *msg : CAN_message_t();
+  e.gen = gen;
+  e.arg = arg;
+  e.periodUs = period_us;
+  e.phaseUs = phase_us;
+  e.bus = bus;
+  e.enabled = 1;
+  e.waiting = 0;
+  e.counters = CanScheduler_entry_stats_t();
+  e.used = 1;
+  if ( running ) arm(e);
+  return handle;
+}
+
+/* ticks, phase and bus load; starts the timer if enabled */
+void CanScheduler::arm(entry_t &e) {
+  e.period = (e.periodUs + tickUs / 2) / tickUs;
+  if ( !e.period ) e.period = 1;
+  if ( e.phaseUs == CAN_SCHEDULER_AUTO ) e.phase = stagger(buses[e.bus - 1], e.period); /* outside the lock, only loop() changes the load */
+  else e.phase = (uint32_t)e.phaseUs / tickUs;
+  markLoad(e, 1);
+  e.armed = 1;
+  if ( !e.enabled ) return;
+  __disable_irq();
+  e.due = firstDue(e);
+  wheel.startAt(e.timer, e.due);
+  __enable_irq();
+}
+
+void CanScheduler::disarm(entry_t &e) {
+  __disable_irq();
+  wheel.stop(e.timer);
+  unwait(e);
+  __enable_irq();
+  if ( e.armed ) markLoad(e, -1);
+  e.armed = 0;
+}
+
+/* the offset into the period whose ticks have the fewest frames due, then the fewest in total */
+uint32_t CanScheduler::stagger(const bus_t &b, uint32_t period) const {
+  uint32_t best = 0, bestMax = UINT32_MAX, bestSum = UINT32_MAX;
+  uint32_t candidates = ( period < CAN_SCHEDULER_WINDOW ) ? period : CAN_SCHEDULER_WINDOW;
+  for ( uint32_t phase = 0; phase < candidates; phase++ ) {
+    uint32_t most = 0, sum = 0;
+    for ( uint32_t t = phase; t < CAN_SCHEDULER_WINDOW; t += period ) {
+      if ( b.load[t] > most ) most = b.load[t];
+      sum += b.load[t];
+    }
+    if ( most < bestMax || (most == bestMax && sum < bestSum) ) {
+      best = phase;
+      bestMax = most;
+      bestSum = sum;
+    }
+  }
+  return best;
+}
+
+void CanScheduler::markLoad(const entry_t &e, int8_t delta) {
+  uint8_t *load = buses[e.bus - 1].load;
+  for ( uint32_t t = e.phase; t < CAN_SCHEDULER_WINDOW; t += e.period ) {
+    if ( delta > 0 && load[t] < 255 ) load[t]++;
+    else if ( delta < 0 && load[t] ) load[t]--;
+  }
+}
+
+/* next tick on phase + k * period */
+uint32_t CanScheduler::firstDue(const entry_t &e) const {
+  uint32_t now = wheel.now();
+  if ( (int32_t)(e.phase - now) > 0 ) return e.phase;
+  return e.phase + ((now - e.phase) / e.period + 1) * e.period;
+}
+
+bool CanScheduler::update(int16_t handle, const CAN_message_t &msg) {
+  if ( handle < 0 || handle >= CAN_SCHEDULER_ENTRIES || !entries[handle].used || entries[handle].gen ) return 0;
+  __disable_irq();
+  entries[handle].msg = msg;
+  __enable_irq();
+  return 1;
+}
+
+void CanScheduler::enable(int16_t handle, bool state) {
+  if ( handle < 0 || handle >= CAN_SCHEDULER_ENTRIES || !entries[handle].used ) return;
+  entry_t &e = entries[handle];
+  __disable_irq();
+  if ( state && !e.enabled && e.armed ) {
+    e.due = firstDue(e);
+    wheel.startAt(e.timer, e.due);
+  }
+  else if ( !state ) {
+    wheel.stop(e.timer);
+    unwait(e);
+  }
+  e.enabled = state;
+  __enable_irq();
+}
+
+void CanScheduler::remove(int16_t handle) {
+  if ( handle < 0 || handle >= CAN_SCHEDULER_ENTRIES || !entries[handle].used ) return;
+  disarm(entries[handle]);
+  entries[handle].used = 0;
+}
+
+void CanScheduler::resetStats() {
+  __disable_irq();
+  counters = CanScheduler_stats_t();
+  for ( int16_t i = 0; i < CAN_SCHEDULER_ENTRIES; i++ ) entries[i].counters = CanScheduler_entry_stats_t();
+  __enable_irq();
+}
+
+void CanScheduler::startTimer(TimerWheel_timer_t &t, uint32_t delay_us) {
+  uint32_t ticks = (delay_us + tickUs - 1) / tickUs;
+  __disable_irq();
+  wheel.start(t, ticks);
+  __enable_irq();
+}
+
+void CanScheduler::stopTimer(TimerWheel_timer_t &t) {
+  __disable_irq();
+  wheel.stop(t);
+  __enable_irq();
+}
+
+/* interrupts masked */
+void CanScheduler::unwait(entry_t &e) {
+  if ( !e.waiting ) return;
+  bus_t &b = buses[e.bus - 1];
+  int16_t self = &e - entries, prev = -1;
+  for ( int16_t i = b.waitHead; i >= 0; prev = i, i = entries[i].nextWaiting ) {
+    if ( i != self ) continue;
+    if ( prev < 0 ) b.waitHead = e.nextWaiting;
+    else entries[prev].nextWaiting = e.nextWaiting;
+    if ( b.waitTail == self ) b.waitTail = prev;
+    break;
+  }
+  e.nextWaiting = -1;
+  e.waiting = 0;
+}
+
+void CanScheduler::isr() {
+  if ( IntervalTimerOwner<CanScheduler>::owner ) IntervalTimerOwner<CanScheduler>::owner->tick();
+}
+
+void CanScheduler::tick() {
+  uint32_t start = ARM_DWT_CYCCNT;
+  counters.ticks++;
+  wheel.tick(); /* frames due now queue behind any still waiting */
+  for ( uint8_t i = 0; i < CAN_SCHEDULER_BUSES; i++ ) if ( buses[i].waitHead >= 0 ) drainWaiting(buses[i]);
+  uint32_t exec_us = (ARM_DWT_CYCCNT - start) / cyclesPerUs;
+  if ( exec_us > counters.max_tick_us ) counters.max_tick_us = exec_us;
+}
+
+void CanScheduler::expired(TimerWheel_timer_t *timer, void *arg) {
+  if ( IntervalTimerOwner<CanScheduler>::owner ) IntervalTimerOwner<CanScheduler>::owner->due(*(entry_t*)arg);
+}
+
+void CanScheduler::due(entry_t &e) {
+  wheel.startAt(e.timer, e.timer.expires + e.period); /* on the grid, no drift */
+  if ( e.waiting ) { /* the last one never got a mailbox, this one replaces it */
+    e.counters.missed++;
+    counters.missed++;
+    e.due = wheel.now();
+    return;
+  }
+  e.due = wheel.now();
+  bus_t &b = buses[e.bus - 1];
+  if ( b.waitHead < 0 && transmit(e) ) return;
+  counters.no_mailbox++;
+  e.waiting = 1;
+  e.nextWaiting = -1;
+  if ( b.waitTail >= 0 ) entries[b.waitTail].nextWaiting = &e - entries;
+  else b.waitHead = &e - entries;
+  b.waitTail = &e - entries;
+}
+
+void CanScheduler::drainWaiting(bus_t &b) {
+  while ( b.waitHead >= 0 ) {
+    entry_t &e = entries[b.waitHead];
+    if ( !transmit(e) ) return;
+    b.waitHead = e.nextWaiting;
+    if ( b.waitHead < 0 ) b.waitTail = -1;
+    e.nextWaiting = -1;
+    e.waiting = 0;
+  }
+}
+
+/* 0 if every scheduler mailbox on the bus is still sending */
+bool CanScheduler::transmit(entry_t &e) {
+  bus_t &b = buses[e.bus - 1];
+  for ( uint8_t i = 0; i < b.mbCount; i++ ) {
+    if ( !b.idle(b.can, b.mb[i]) ) continue;
+    CAN_message_t msg = e.msg;
+    if ( e.gen && !e.gen(msg, e.arg) ) return 1; /* nothing to send this time */
+    if ( !b.send(b.can, b.mb[i], msg) ) continue;
+    e.counters.sent++;
+    counters.sent++;
+    uint32_t late = wheel.now() - e.due;
+    if ( late ) {
+      uint32_t late_us = late * tickUs;
+      e.counters.late++;
+      counters.late++;
+      if ( late_us > e.counters.max_late_us ) e.counters.max_late_us = late_us;
+      if ( late_us > counters.max_late_us ) counters.max_late_us = late_us;
+    }
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+  CanScheduler.h
+  --------------
+  Periodic CAN transmissions without application code. VESCs drop to
+  zero output when their command stream stops, heartbeats and status
+  frames have to keep going whatever loop() is doing; each is registered
+  once with a period and goes out from an IntervalTimer:
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+      VESC_controller left(1);
+      int16_t duty;
+      bool heartbeat(CAN_message_t &msg, void *arg) { msg.buf[0]++; return 1; } // filled when it is due
+      void setup() {
+        can1.begin(); can1.setBaudRate(250000);
+        canScheduler.addBus(can1);                            // reserves 4 TX mailboxes
+        duty = canScheduler.add(1, left.setDuty(0), 10000);   // every 10 ms
+        canScheduler.add(1, heartbeat, nullptr, 100000);      // every 100 ms
+        canScheduler.begin();                                 // 1 ms tick
+      }
+      void loop() { canScheduler.update(duty, left.setDuty(0.1f)); }
+
+  Timing: entries sit on a hierarchical timer wheel (lib/TimerWheel), so a
+  tick costs O(1) per frame that is due, not per frame registered. A frame
+  is due on ticks phase + k * period. Without a phase (CAN_SCHEDULER_AUTO)
+  add() picks the offset in the period where the bus has the fewest frames
+  already due, over a 1 s window, so 50 frames at 10 ms spread over the
+  10 ticks instead of all going on the first. Periods that divide 1 s
+  (1, 2, 5, 10, 20, 50, 100 ... ms) stay staggered exactly.
+
+  Frames go into TX mailboxes reserved for the scheduler on each bus, so
+  they never queue behind write() traffic and write() from loop() stays
+  safe. When all of them are still busy, the frame waits for the next tick
+  (late). If it is still waiting when its next period comes, that instance
+  is lost (missed) and the newer one takes its place; stats() and
+  entryStats() count both.
+
+  The wheel is shared: other CAN timeouts (requests, deadlines) use
+  startTimer()/stopTimer(), their callbacks run in the tick interrupt.
+  Those that look up by CAN ID (CanIdTable.h) share their table with the
+  receive interrupt, so the tick interrupt must not be preempted by the
+  CAN interrupt: the default priorities (64 against 128) see to that.
+*/
+
+#if !defined(_CAN_SCHEDULER_H_)
+#define _CAN_SCHEDULER_H_
+
+#include "Arduino.h"
+#include "CycleCounter.h"
+#include "IntervalTimer.h"
+#include "FlexCAN_T4.h"
+#include "TimerWheel.h"
+#include "CanIdTable.h"
+
+#define CAN_SCHEDULER_BUSES 3
+#if !defined(CAN_SCHEDULER_ENTRIES)
+#define CAN_SCHEDULER_ENTRIES 128
+#endif
+#define CAN_SCHEDULER_TX_MB_MAX 8
+#define CAN_SCHEDULER_WINDOW 1000   /* ticks the stagger looks at */
+#define CAN_SCHEDULER_AUTO -1       /* phase: pick the least loaded */
+
+typedef bool (*_scheduler_gen_ptr)(CAN_message_t &msg, void *arg); /* fill msg when due, false: nothing this period */
+typedef bool (*_scheduler_send_ptr)(void *bus, uint8_t mb_num, const CAN_message_t &msg);
+typedef bool (*_scheduler_idle_ptr)(void *bus, uint8_t mb_num);
+
+typedef struct CanScheduler_entry_stats_t {
+  uint32_t sent = 0;
+  uint32_t late = 0;               /* went out on a later tick than due */
+  uint32_t missed = 0;             /* a whole period without a mailbox, instance dropped */
+  uint32_t max_late_us = 0;
+} CanScheduler_entry_stats_t;
+
+typedef struct CanScheduler_stats_t {
+  uint32_t ticks = 0;
+  uint32_t sent = 0;
+  uint32_t late = 0;
+  uint32_t missed = 0;
+  uint32_t no_mailbox = 0;         /* frames that found the mailboxes busy or others waiting */
+  uint32_t max_late_us = 0;
+  uint32_t max_tick_us = 0;        /* longest tick interrupt, timer callbacks included */
+} CanScheduler_stats_t;
+
+class CanScheduler {
+  public:
+    template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize, FLEXCAN_TXQUEUE_TABLE _txSize>
+    void addBus(FlexCAN_T4<_bus, _rxSize, _txSize> &can, uint8_t tx_mailboxes = 4); /* highest free mailboxes, after can.begin() */
+    bool begin(uint32_t tick_us = 1000, uint8_t priority = 64);
+    void end();
+    int16_t add(uint8_t bus, const CAN_message_t &msg, uint32_t period_us, int32_t phase_us = CAN_SCHEDULER_AUTO); /* handle, -1 if full */
+    int16_t add(uint8_t bus, _scheduler_gen_ptr gen, void *arg, uint32_t period_us, int32_t phase_us = CAN_SCHEDULER_AUTO);
+    bool update(int16_t handle, const CAN_message_t &msg); /* new ID/payload from the next send on */
+    void enable(int16_t handle, bool state = 1); /* a disabled entry keeps its slot and phase */
+    void disable(int16_t handle) { enable(handle, 0); }
+    void remove(int16_t handle);
+    uint32_t getTickUs() const { return tickUs; }
+    const CanScheduler_entry_stats_t& entryStats(int16_t handle) const { return entries[( handle >= 0 && handle < CAN_SCHEDULER_ENTRIES ) ? handle : 0].counters; }
+    const CanScheduler_stats_t& stats() const { return counters; }
+    void resetStats();
+
+    /* the tick's timer wheel, for other timeouts; callbacks run in the tick interrupt */
+    void startTimer(TimerWheel_timer_t &timer, uint32_t delay_us);
+    void stopTimer(TimerWheel_timer_t &timer);
+    uint32_t ticks() const { return wheel.now(); }
+
+  private:
+    struct entry_t {
+      TimerWheel_timer_t timer;
+      CAN_message_t msg;
+      _scheduler_gen_ptr gen = nullptr;
+      void *arg = nullptr;
+      uint32_t periodUs = 0;
+      int32_t phaseUs = CAN_SCHEDULER_AUTO;
+      uint32_t period = 0;         /* ticks, set when armed */
+      uint32_t phase = 0;          /* ticks, first due tick of the schedule */
+      uint32_t due = 0;            /* tick of the instance not sent yet */
+      int16_t nextWaiting = -1;
+      uint8_t bus = 0;
+      bool used = 0;
+      bool enabled = 0;
+      bool waiting = 0;            /* due, no mailbox yet */
+      bool armed = 0;              /* period/phase in ticks, counted in the bus load */
+      CanScheduler_entry_stats_t counters;
+    };
+    struct bus_t {
+      void *can = nullptr;
+      _scheduler_send_ptr send = nullptr;
+      _scheduler_idle_ptr idle = nullptr;
+      uint8_t mbCount = 0;
+      uint8_t mb[CAN_SCHEDULER_TX_MB_MAX];
+      int16_t waitHead = -1, waitTail = -1;
+      uint8_t load[CAN_SCHEDULER_WINDOW] = { 0 }; /* frames due on each tick of the window */
+    };
+    template<typename _busType> static bool sendThunk(void *can, uint8_t mb_num, const CAN_message_t &msg) {
+      if ( !((_busType*)can)->stageTxMB((FLEXCAN_MAILBOX)mb_num, msg) ) return 0; /* still sending */
+      ((_busType*)can)->releaseTxMB(1ULL << mb_num);
+      return 1;
+    }
+    template<typename _busType> static bool idleThunk(void *can, uint8_t mb_num) { return ((_busType*)can)->isTxMBIdle((FLEXCAN_MAILBOX)mb_num); }
+    static void isr();
+    static void expired(TimerWheel_timer_t *timer, void *arg);
+    int16_t add(uint8_t bus, const CAN_message_t *msg, _scheduler_gen_ptr gen, void *arg, uint32_t period_us, int32_t phase_us);
+    void arm(entry_t &e);
+    void disarm(entry_t &e);
+    uint32_t stagger(const bus_t &b, uint32_t period) const;
+    void markLoad(const entry_t &e, int8_t delta);
+    void unwait(entry_t &e);
+    void tick();
+    void due(entry_t &e);
+    bool transmit(entry_t &e);
+    void drainWaiting(bus_t &b);
+    uint32_t firstDue(const entry_t &e) const;
+
+    IntervalTimer timer;
+    TimerWheel wheel;
+    entry_t entries[CAN_SCHEDULER_ENTRIES];
+    bus_t buses[CAN_SCHEDULER_BUSES];
+    uint32_t tickUs = 1000;
+    uint32_t cyclesPerUs = 1;
+    volatile bool running = 0;
+    CanScheduler_stats_t counters;
+};
+
+extern CanScheduler canScheduler;
+
+template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize, FLEXCAN_TXQUEUE_TABLE _txSize>
+void CanScheduler::addBus(FlexCAN_T4<_bus, _rxSize, _txSize> &can, uint8_t tx_mailboxes) {
+  static_assert(_bus == CAN1 || _bus == CAN2 || _bus == CAN3, "CanScheduler runs on the Teensy 4.x buses");
+  if ( running ) return;
+  bus_t &b = buses[( _bus == CAN1 ) ? 0 : ( _bus == CAN2 ) ? 1 : 2];
+  b.can = &can;
+  b.send = sendThunk<FlexCAN_T4<_bus, _rxSize, _txSize>>;
+  b.idle = idleThunk<FlexCAN_T4<_bus, _rxSize, _txSize>>;
+  for ( uint8_t i = 0; i < b.mbCount; i++ ) can.reserveTxMB((FLEXCAN_MAILBOX)b.mb[i], 0);
+  if ( tx_mailboxes > CAN_SCHEDULER_TX_MB_MAX ) tx_mailboxes = CAN_SCHEDULER_TX_MB_MAX;
+  b.mbCount = can.reserveTxMBs(b.mb, tx_mailboxes);
+}
+
+#endif
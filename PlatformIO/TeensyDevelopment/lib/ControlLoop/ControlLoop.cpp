@@ -0,0 +1,96 @@
+/*
+  ControlLoop.cpp
+  ---------------
+  See ControlLoop.h.
+*/
+
+#include "ControlLoop.h"
+
+bool ControlLoop::begin(_control_step_ptr step, uint32_t rate_hz, uint8_t priority) {
+  if ( !step || !rate_hz || (IntervalTimerOwner<ControlLoop>::owner && IntervalTimerOwner<ControlLoop>::owner != this) ) return 0;
+  cyclesPerUs = cycleCounterBegin();
+  stepFunc = step;
+  IntervalTimerOwner<ControlLoop>::owner = this;
+  resetStats();
+  if ( !setRate(rate_hz) ) return 0;
+  timer.priority(priority);
+  if ( !timer.begin(isr, periodUs) ) return 0;
+  running = 1;
+  return 1;
+}
+
+void ControlLoop::end() {
+  running = 0;
+  timer.end();
+  IntervalTimerOwner<ControlLoop>::owner = nullptr;
+}
+
+bool ControlLoop::setRate(uint32_t rate_hz) {
+  if ( !rate_hz || rate_hz > 100000 ) return 0;
+  uint32_t period = 1000000UL / rate_hz;
+  __disable_irq(); /* tick() uses the period */
+  rateHz = rate_hz;
+  periodUs = period;
+  periodCycles = period * cyclesPerUs;
+  lastStart = 0;
+  __enable_irq();
+  if ( running ) timer.update(period); /* takes effect after the current period, the timer keeps running */
+  return 1;
+}
+
+void ControlLoop::isr() {
+  if ( IntervalTimerOwner<ControlLoop>::owner ) IntervalTimerOwner<ControlLoop>::owner->tick();
+}
+
+void ControlLoop::tick() {
+  uint32_t start = ARM_DWT_CYCCNT;
+  if ( lastStart ) {
+    uint32_t interval = start - lastStart;
+    uint32_t jitter = ( interval > periodCycles ) ? (interval - periodCycles) : (periodCycles - interval);
+    uint32_t jitter_us = jitter / cyclesPerUs;
+    if ( interval > (periodCycles << 1) ) counters.missed += (interval / periodCycles) - 1;
+    counters.jitter_hist[bucket(jitter_us)]++;
+    if ( jitter_us > counters.max_jitter_us ) counters.max_jitter_us = jitter_us;
+  }
+  lastStart = start;
+
+  stepFunc();
+
+  uint32_t exec = ARM_DWT_CYCCNT - start;
+  uint32_t exec_us = exec / cyclesPerUs;
+  if ( exec > periodCycles ) counters.overruns++;
+  counters.exec_hist[bucket(exec_us)]++;
+  counters.last_exec_us = exec_us;
+  if ( exec_us > counters.max_exec_us ) counters.max_exec_us = exec_us;
+  counters.ticks++;
+}
+
+void ControlLoop::stats(ControlLoop_stats_t &out) {
+  __disable_irq();
+  out = counters;
+  __enable_irq();
+}
+
+void ControlLoop::resetStats() {
+  __disable_irq();
+  counters = ControlLoop_stats_t();
+  lastStart = 0;
+  __enable_irq();
+}
+
+void ControlLoop::printStats(Stream &port) {
+  ControlLoop_stats_t s;
+  stats(s);
+  port.print("Rate: "); port.print(rateHz);
+  port.print(" Hz  Ticks: "); port.print(s.ticks);
+  port.print("  Overruns: "); port.print(s.overruns);
+  port.print("  Missed: "); port.print(s.missed);
+  port.print("  Max jitter us: "); port.print(s.max_jitter_us);
+  port.print("  Max exec us: "); port.println(s.max_exec_us);
+  port.print("Jitter us hist: ");
+  for ( uint8_t i = 0; i < CONTROL_LOOP_HIST_SIZE; i++ ) { port.print(s.jitter_hist[i]); port.print(" "); }
+  port.println();
+  port.print("Exec us hist:   ");
+  for ( uint8_t i = 0; i < CONTROL_LOOP_HIST_SIZE; i++ ) { port.print(s.exec_hist[i]); port.print(" "); }
+  port.println();
+}
@@ -0,0 +1,72 @@
+/*
+  ControlLoop.h
+  -------------
+  Fixed-rate control loop driven by an IntervalTimer.
+
+  The registered step function runs from the timer interrupt at a fixed
+  rate, so its timing does not depend on Serial output or anything else in
+  loop(). loop() is left free to service CAN with events() between ticks:
+
+      ControlLoop control;
+      void step() { ... one control update ... }
+      void setup() { control.begin(step, 1000); }       // 1 kHz
+      void loop() { can1.events(); }
+
+  Every tick is timed with the cycle counter. The loop records:
+    - jitter: how far each tick started from its nominal time
+    - exec:   how long the step function ran
+    - overruns: ticks where the step ran longer than the period, and
+      ticks that were skipped because the previous one was late
+  Jitter and exec times go into power-of-two microsecond histograms
+  (bucket n counts values in [2^(n-1), 2^n) us, bucket 0 counts < 1 us).
+*/
+
+#if !defined(_CONTROL_LOOP_H_)
+#define _CONTROL_LOOP_H_
+
+#include "Arduino.h"
+#include "CycleCounter.h"
+#include "IntervalTimer.h"
+
+#define CONTROL_LOOP_HIST_SIZE 16
+
+typedef void (*_control_step_ptr)();
+
+typedef struct ControlLoop_stats_t {
+  uint32_t ticks = 0;
+  uint32_t overruns = 0;          /* step took longer than one period */
+  uint32_t missed = 0;            /* ticks that started more than a period late */
+  uint32_t max_jitter_us = 0;
+  uint32_t max_exec_us = 0;
+  uint32_t last_exec_us = 0;
+  uint32_t jitter_hist[CONTROL_LOOP_HIST_SIZE] = { 0 };
+  uint32_t exec_hist[CONTROL_LOOP_HIST_SIZE] = { 0 };
+} ControlLoop_stats_t;
+
+class ControlLoop {
+  public:
+    bool begin(_control_step_ptr step, uint32_t rate_hz, uint8_t priority = 64);
+    void end();
+    bool setRate(uint32_t rate_hz); /* while running, from the next period on */
+    uint32_t getRate() const { return rateHz; }
+    uint32_t getPeriodUs() const { return periodUs; }
+    void stats(ControlLoop_stats_t &out); /* consistent copy, briefly masks interrupts */
+    void resetStats();
+    void printStats(Stream &port = Serial);
+
+  private:
+    static void isr();
+    void tick();
+    static uint8_t bucket(uint32_t us) { return ( us ) ? min((uint32_t)(32 - __builtin_clz(us)), (uint32_t)(CONTROL_LOOP_HIST_SIZE - 1)) : 0; }
+    IntervalTimer timer;
+    _control_step_ptr stepFunc = nullptr;
+    uint32_t rateHz = 0;
+    uint32_t periodUs = 0;
+    uint32_t periodCycles = 0;
+    uint32_t cyclesPerUs = 1;
+    uint32_t lastStart = 0;
+    volatile bool running = 0;
+    ControlLoop_stats_t counters;
+};
+
+#endif
@@ -0,0 +1,37 @@
+/*
+  CycleCounter.h
+  --------------
+  The bits of timing setup that ControlLoop, TraceLog and CanScheduler
+  all need.
+
+      uint32_t cyclesPerUs = cycleCounterBegin();   // ARM_DWT_CYCCNT runs from here on
+      ...
+      uint32_t us = (ARM_DWT_CYCCNT - start) / cyclesPerUs;
+
+  IntervalTimer callbacks take no argument, so a class driven by one keeps
+  the instance that owns the timer in IntervalTimerOwner<Class>::owner and
+  its static isr() forwards to it.
+*/
+
+#if !defined(_CYCLE_COUNTER_H_)
+#define _CYCLE_COUNTER_H_
+
+#include "Arduino.h"
+
+/* starts the DWT cycle counter (on by default on Teensy 4, not on 3.x), returns CPU cycles per microsecond */
+static inline uint32_t cycleCounterBegin() {
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#if defined(__IMXRT1062__)
+  return F_CPU_ACTUAL / 1000000;
+#else
+  return F_CPU / 1000000;
+#endif
+}
+
+template<typename T> struct IntervalTimerOwner {
+  static T *owner;
+};
+template<typename T> T *IntervalTimerOwner<T>::owner = nullptr;
+
+#endif
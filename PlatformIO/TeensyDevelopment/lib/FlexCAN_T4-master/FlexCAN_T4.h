@@ -320,6 +320,48 @@ class CANListener {
     bool generalCallbackActive = 0;
 };
 
+class CANBridgeHook { /* lib/CanBridge, forwards frames from inside the interrupt */
+  public:
+    virtual bool rxMailbox(uint8_t bus, volatile uint32_t *mbxAddr) = 0; /* raw RX mailbox or FIFO output, still locked; 1: consumed, skip the RX queue and callbacks */
+    virtual void txMailboxDone(uint8_t, uint8_t) { ; } /* a reserved TX mailbox finished */
+};
+
+#if !defined(FLEXCAN_TX_CONFIRM_SLOTS)
+#define FLEXCAN_TX_CONFIRM_SLOTS 16 /* confirmed frames that can wait in the TX queue at once */
+#endif
+
+typedef enum CAN_TX_STATE {
+  CAN_TX_IDLE = 0,
+  CAN_TX_QUEUED,    /* in the TX queue, all mailboxes busy */
+  CAN_TX_MAILBOX,   /* loaded, waiting for the bus */
+  CAN_TX_SENT,
+  CAN_TX_FAILED     /* queue or confirm slots full, nothing sent */
+} CAN_TX_STATE;
+
+struct CAN_tx_confirm_t;
+typedef void (*_TXC_ptr)(const CAN_tx_confirm_t &confirm); /* transmit confirmation, from the interrupt */
+
+/* owned by the caller, filled in by write(msg, confirm) and the transmit interrupt,
+   poll state or set callback. Needs the TX mailbox interrupts, which enableFIFO()
+   and begin() turn on. Reusable once it is no longer CAN_TX_QUEUED or CAN_TX_MAILBOX. */
+typedef struct CAN_tx_confirm_t {
+  _TXC_ptr callback = nullptr;
+  void *arg = nullptr;
+  volatile CAN_TX_STATE state = CAN_TX_IDLE;
+  uint32_t write_us = 0;     /* write() called */
+  uint32_t mailbox_us = 0;   /* loaded into a mailbox */
+  uint32_t wire_us = 0;      /* went on the bus, from the hardware timestamp */
+  uint32_t done_us = 0;      /* transmit interrupt */
+  uint16_t timestamp = 0;    /* FlexCAN timer at transmission, bit times like CAN_message_t::timestamp */
+  uint8_t mb = 0;
+  uint8_t frames_ahead = 0;  /* approximate, saturates: frames this controller's interrupt handled (RX that passed
+                                the filters, its own TX) while it waited in the mailbox. Filtered traffic is not
+                                seen and FlexCAN keeps no arbitration-loss count, so it is not one */
+  uint32_t busFrames = 0;    /* frame count when loaded */
+  uint32_t queueUs() const { return mailbox_us - write_us; }
+  uint32_t latencyUs() const { return wire_us - write_us; } /* write() to the wire */
+} CAN_tx_confirm_t;
+
 class FlexCAN_T4_Base {
   public:
     virtual void flexcan_interrupt() = 0;
@@ -483,6 +525,7 @@ FCTP_CLASS class FlexCAN_T4 : public FlexCAN_T4_Base {
     int write(const CAN_message_t &msg); /* use any available mailbox for transmitting */
     int write(const CANFD_message_t &msg) { return 0; } /* to satisfy base class for external pointers */
     int write(FLEXCAN_MAILBOX mb_num, const CAN_message_t &msg); /* use a single mailbox for transmitting */
+    int write(const CAN_message_t &msg, CAN_tx_confirm_t &confirm); /* as write(msg), confirm is completed when it is sent */
     uint64_t events();
     uint8_t setRFFN(FLEXCAN_RFFN_TABLE rffn = RFFN_8); /* Number Of Rx FIFO Filters (0 == 8 filters, 1 == 16 filters, etc.. */
     uint8_t setRFFN(uint8_t rffn) { return setRFFN((FLEXCAN_RFFN_TABLE)constrain(rffn, 0, 15)); }
@@ -499,7 +542,7 @@ FCTP_CLASS class FlexCAN_T4 : public FlexCAN_T4_Base {
     bool setFIFOFilter(uint8_t filter, uint32_t id1, const FLEXCAN_IDE &ide1, const FLEXCAN_IDE &remote1, uint32_t id2, const FLEXCAN_IDE &ide2, const FLEXCAN_IDE &remote2); /* TableB 2 ID / filter */
     bool setFIFOFilter(uint8_t filter, uint32_t id1, uint32_t id2, const FLEXCAN_IDE &ide1, const FLEXCAN_IDE &remote1, uint32_t id3, uint32_t id4, const FLEXCAN_IDE &ide2, const FLEXCAN_IDE &remote2); /* TableB 4 minimum ID / filter */
     bool setFIFOFilterRange(uint8_t filter, uint32_t id1, uint32_t id2, const FLEXCAN_IDE &ide1, const FLEXCAN_IDE &remote1, uint32_t id3, uint32_t id4, const FLEXCAN_IDE &ide2, const FLEXCAN_IDE &remote2); /* TableB dual range based IDs */
-    bool struct2queueTx(const CAN_message_t &msg);
+    int struct2queueTx(const CAN_message_t &msg, uint8_t confirm_tag = 0); /* 1 queued, 0 queue full, -2 bus off */
     void struct2queueRx(const CAN_message_t &msg);
 #if defined(__IMXRT1062__)
     void setClock(FLEXCAN_CLOCK clock = CLK_24MHz);
@@ -514,10 +557,20 @@ FCTP_CLASS class FlexCAN_T4 : public FlexCAN_T4_Base {
     bool error(CAN_error_t &error, bool printDetails);
     uint32_t getRXQueueCount() { return rxBuffer.size(); }
     uint32_t getTXQueueCount() { return txBuffer.size(); }
+    void reserveTxMB(const FLEXCAN_MAILBOX &mb_num, bool state = 1); /* keep a TX mailbox out of write() and queue rotation */
+    uint8_t reserveTxMBs(uint8_t *mb_nums, uint8_t count); /* reserve up to count of the highest free TX mailboxes, their numbers into mb_nums, returns how many */
+    bool stageTxMB(const FLEXCAN_MAILBOX &mb_num, const CAN_message_t &msg); /* load a reserved TX mailbox without transmitting */
+    void releaseTxMB(uint64_t mask); /* start all staged mailboxes in mask back to back, safe from interrupts and masked code */
+    bool isTxMBReserved(const FLEXCAN_MAILBOX &mb_num) { return reservedTxMB & (1ULL << mb_num); }
+    bool isTxMBIdle(const FLEXCAN_MAILBOX &mb_num) { return FLEXCAN_get_code(FLEXCANb_MBn_CS(_bus, mb_num)) == FLEXCAN_MB_CODE_TX_INACTIVE; }
+    uint16_t getMBTimestamp(const FLEXCAN_MAILBOX &mb_num) { return FLEXCANb_MBn_CS(_bus, mb_num) & FLEXCAN_MB_CS_TIMESTAMP_MASK; } /* bit time of last RX/TX */
+    void attachBridge(CANBridgeHook *hook) { bridgeHook = hook; } /* nullptr detaches */
 
   private:
     void setMBFilterProcessing(FLEXCAN_MAILBOX mb_num, uint32_t filter_id, uint32_t calculated_mask);
-    void writeTxMailbox(uint8_t mb_num, const CAN_message_t &msg);
+    void writeTxMailbox(uint8_t mb_num, const CAN_message_t &msg, CAN_tx_confirm_t *confirm = nullptr);
+    CAN_tx_confirm_t* takeTxConfirm(const CAN_message_t &queued);
+    void txConfirmDone(uint8_t mb_num, uint32_t code);
     uint64_t readIMASK();// { return (((uint64_t)FLEXCANb_IMASK2(_bus) << 32) | FLEXCANb_IMASK1(_bus)); }
     void flexcan_interrupt();
     void flexcanFD_interrupt() { ; } // dummy placeholder to satisfy base class
@@ -555,6 +608,11 @@ FCTP_CLASS class FlexCAN_T4 : public FlexCAN_T4_Base {
     uint32_t currentBitrate = 0UL;
     uint8_t mailbox_reader_increment = 0;
     uint8_t busNumber;
+    uint64_t reservedTxMB = 0; /* mailboxes owned by stageTxMB()/releaseTxMB() */
+    CANBridgeHook *bridgeHook = nullptr;
+    CAN_tx_confirm_t *txConfirmMB[64] = { nullptr }; /* confirmation of the frame in each TX mailbox */
+    CAN_tx_confirm_t *txConfirmQueued[FLEXCAN_TX_CONFIRM_SLOTS] = { nullptr }; /* the TX queue copy carries slot + 1 in idhit */
+    volatile uint32_t busFrames = 0; /* frames received or sent, counted in the interrupt */
     void mbCallbacks(const FLEXCAN_MAILBOX &mb_num, const CAN_message_t &msg);
 };
 
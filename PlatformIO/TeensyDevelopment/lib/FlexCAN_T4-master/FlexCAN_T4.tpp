@@ -423,7 +423,15 @@ FCTP_FUNC void FCTP_OPT::writeIMASKBit(uint8_t mb_num, bool set) {
   else (( set ) ? FLEXCANb_IMASK2(_bus) |= (1UL << (mb_num - 32)) : FLEXCANb_IMASK2(_bus) &= ~(1UL << (mb_num - 32)));
 }
 
-FCTP_FUNC void FCTP_OPT::writeTxMailbox(uint8_t mb_num, const CAN_message_t &msg) {
+FCTP_FUNC void FCTP_OPT::writeTxMailbox(uint8_t mb_num, const CAN_message_t &msg, CAN_tx_confirm_t *confirm) {
+  if ( txConfirmMB[mb_num] ) txConfirmDone(mb_num, FLEXCANb_MBn_CS(_bus, mb_num)); /* sent, but its interrupt has not run yet */
+  txConfirmMB[mb_num] = confirm; /* before the request, the interrupt may come straight away */
+  if ( confirm ) {
+    confirm->mb = mb_num;
+    confirm->mailbox_us = micros();
+    confirm->busFrames = busFrames;
+    confirm->state = CAN_TX_MAILBOX;
+  }
   writeIFLAGBit(mb_num);
   uint32_t code = 0;
   volatile uint32_t *mbxAddr = &(*(volatile uint32_t*)(_bus + 0x80 + (mb_num * 0x10)));
@@ -436,6 +444,53 @@ FCTP_FUNC void FCTP_OPT::writeTxMailbox(uint8_t mb_num, const CAN_message_t &msg
   mbxAddr[0] = code | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_ONCE);
 }
 
+FCTP_FUNC void FCTP_OPT::reserveTxMB(const FLEXCAN_MAILBOX &mb_num, bool state) {
+  if ( mb_num < mailboxOffset() ) return; /* FIFO doesn't transmit */
+  if ( state ) {
+    setMB(mb_num, TX);
+    reservedTxMB |= (1ULL << mb_num);
+  }
+  else reservedTxMB &= ~(1ULL << mb_num);
+}
+
+FCTP_FUNC uint8_t FCTP_OPT::reserveTxMBs(uint8_t *mb_nums, uint8_t count) {
+  uint8_t found = 0;
+  for ( uint8_t mb = FLEXCANb_MAXMB_SIZE(_bus); found < count && mb-- > mailboxOffset(); ) {
+    if ( reservedTxMB & (1ULL << mb) ) continue; /* CanScheduler, CanBridge, VESC_burst, ... */
+    reserveTxMB((FLEXCAN_MAILBOX)mb);
+    mb_nums[found++] = mb;
+  }
+  return found;
+}
+
+FCTP_FUNC bool FCTP_OPT::stageTxMB(const FLEXCAN_MAILBOX &mb_num, const CAN_message_t &msg) {
+  if ( !(reservedTxMB & (1ULL << mb_num)) ) return 0; /* only reserved mailboxes can be staged */
+  volatile uint32_t *mbxAddr = &(*(volatile uint32_t*)(_bus + 0x80 + (mb_num * 0x10)));
+  if ( FLEXCAN_get_code(mbxAddr[0]) != FLEXCAN_MB_CODE_TX_INACTIVE ) return 0; /* previous frame still pending */
+  uint32_t code = 0;
+  mbxAddr[1] = (( msg.flags.extended ) ? ( msg.id & FLEXCAN_MB_ID_EXT_MASK ) : FLEXCAN_MB_ID_IDSTD(msg.id));
+  if ( msg.flags.remote ) code |= (1UL << 20);
+  if ( msg.flags.extended ) code |= (3UL << 21);
+  for ( uint8_t i = 0; i < (8 >> 2); i++ ) mbxAddr[2 + i] = (msg.buf[0 + i * 4] << 24) | (msg.buf[1 + i * 4] << 16) | (msg.buf[2 + i * 4] << 8) | msg.buf[3 + i * 4];
+  code |= msg.len << 16;
+  mbxAddr[0] = code | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_INACTIVE); /* loaded, not yet requested */
+  return 1;
+}
+
+FCTP_FUNC void FCTP_OPT::releaseTxMB(uint64_t mask) {
+  mask &= reservedTxMB;
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask" : "=r" (primask) :: "memory"); /* callers may already be masked or in an interrupt */
+  __disable_irq(); /* nothing may land between the requests */
+  while ( mask ) {
+    uint8_t mb_num = __builtin_ctzll(mask);
+    mask &= mask - 1;
+    writeIFLAGBit(mb_num);
+    FLEXCANb_MBn_CS(_bus, mb_num) = (FLEXCANb_MBn_CS(_bus, mb_num) & ~FLEXCAN_MB_CS_CODE_MASK) | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_ONCE);
+  }
+  __asm__ volatile("msr primask, %0" :: "r" (primask) : "memory");
+}
+
 FCTP_FUNC uint8_t FCTP_OPT::mailboxOffset() {
   if ( !(FLEXCANb_MCR(_bus) & FLEXCAN_MCR_FEN ) ) return 0; /* return offset 0 since FIFO is disabled */
   uint32_t remaining_mailboxes = FLEXCANb_MAXMB_SIZE(_bus) - 6 /* MAXMB - FIFO */ - ((((FLEXCANb_CTRL2(_bus) >> FLEXCAN_CTRL2_RFFN_BIT_NO) & 0xF) + 1) * 2);
@@ -945,6 +1000,7 @@ FCTP_FUNC int FCTP_OPT::readFIFO(CAN_message_t &msg) {
 
 FCTP_FUNC int FCTP_OPT::getFirstTxBox() {
   for (uint8_t i = mailboxOffset(); i < FLEXCANb_MAXMB_SIZE(_bus); i++) {
+    if ( reservedTxMB & (1ULL << i) ) continue;
     if ( (FLEXCAN_get_code(FLEXCANb_MBn_CS(_bus, i)) >> 3) ) return i; // if TX
   }
   return -1;
@@ -999,13 +1055,14 @@ FCTP_FUNC int FCTP_OPT::readMB(CAN_message_t &msg) {
   return 0; /* no messages available */
 }
 
-FCTP_FUNC bool FCTP_OPT::struct2queueTx(const CAN_message_t &msg) {
-  if (FLEXCANb_ESR1(_bus) & 0x20) return -2;
+FCTP_FUNC int FCTP_OPT::struct2queueTx(const CAN_message_t &msg, uint8_t confirm_tag) {
+  if (FLEXCANb_ESR1(_bus) & 0x20) return -2; /* bus off */
   if ( txBuffer.size() == txBuffer.capacity() ) return 0; /* no queues available */
   uint8_t buf[sizeof(CAN_message_t)];
   memmove(buf, &msg, sizeof(msg));
+  ((CAN_message_t*)buf)->idhit = confirm_tag; /* idhit is an RX field, a forwarded frame may still carry one */
   txBuffer.push_back(buf, sizeof(CAN_message_t));
-  return -1; /* transmit entry failed, no mailboxes available, queued */
+  return 1; /* no mailboxes available, queued */
 }
 
 FCTP_FUNC int FCTP_OPT::write(FLEXCAN_MAILBOX mb_num, const CAN_message_t &msg) {
@@ -1047,6 +1104,7 @@ FCTP_FUNC int FCTP_OPT::write(const CAN_message_t &msg) {
     }
   }
   for (uint8_t i = mailboxOffset(); i < FLEXCANb_MAXMB_SIZE(_bus); i++) {
+    if ( reservedTxMB & (1ULL << i) ) continue;
     if ( FLEXCAN_get_code(FLEXCANb_MBn_CS(_bus, i)) == FLEXCAN_MB_CODE_TX_INACTIVE ) {
       writeTxMailbox(i, msg);
       return 1; /* transmit entry accepted */
@@ -1057,6 +1115,67 @@ FCTP_FUNC int FCTP_OPT::write(const CAN_message_t &msg) {
   return struct2queueTx(msg_copy); /* queue if no mailboxes found */
 }
 
+FCTP_FUNC int FCTP_OPT::write(const CAN_message_t &msg, CAN_tx_confirm_t &confirm) {
+  if ( confirm.state == CAN_TX_QUEUED || confirm.state == CAN_TX_MAILBOX ) return 0; /* still in use */
+  confirm.write_us = micros();
+  confirm.mailbox_us = confirm.wire_us = confirm.done_us = 0;
+  confirm.frames_ahead = 0;
+  NVIC_DISABLE_IRQ(nvicIrq); /* the TX interrupt refills and completes the same mailboxes and slots */
+  for (uint8_t i = mailboxOffset(); i < FLEXCANb_MAXMB_SIZE(_bus); i++) {
+    if ( reservedTxMB & (1ULL << i) ) continue;
+    if ( FLEXCAN_get_code(FLEXCANb_MBn_CS(_bus, i)) == FLEXCAN_MB_CODE_TX_INACTIVE ) {
+      writeTxMailbox(i, msg, &confirm);
+      NVIC_ENABLE_IRQ(nvicIrq);
+      return 1; /* transmit entry accepted */
+    }
+  }
+  uint8_t slot = 0;
+  while ( slot < FLEXCAN_TX_CONFIRM_SLOTS && txConfirmQueued[slot] ) slot++;
+  int queued = 0;
+  if ( slot < FLEXCAN_TX_CONFIRM_SLOTS ) {
+    CAN_message_t msg_copy = msg;
+    msg_copy.mb = -1;
+    msg_copy.seq = 0;
+    confirm.state = CAN_TX_QUEUED;
+    txConfirmQueued[slot] = &confirm;
+    queued = struct2queueTx(msg_copy, slot + 1);
+    if ( queued <= 0 ) txConfirmQueued[slot] = nullptr; /* queue full or bus off */
+  }
+  if ( queued <= 0 ) confirm.state = CAN_TX_FAILED;
+  NVIC_ENABLE_IRQ(nvicIrq);
+  return queued;
+}
+
+/* the confirmation a queued frame carries, its slot is free again */
+FCTP_FUNC CAN_tx_confirm_t* FCTP_OPT::takeTxConfirm(const CAN_message_t &queued) {
+  if ( !queued.idhit || queued.idhit > FLEXCAN_TX_CONFIRM_SLOTS ) return nullptr;
+  CAN_tx_confirm_t *confirm = txConfirmQueued[queued.idhit - 1];
+  txConfirmQueued[queued.idhit - 1] = nullptr;
+  return confirm;
+}
+
+/* TX interrupt (or writeTxMailbox() reusing the mailbox first), the frame is out: code is its CS word, the timestamp is when it went on the bus */
+FCTP_FUNC void FCTP_OPT::txConfirmDone(uint8_t mb_num, uint32_t code) {
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask" : "=r" (primask) :: "memory"); /* thread context (writeTxMailbox) or the TX interrupt */
+  __disable_irq();
+  CAN_tx_confirm_t *confirm = txConfirmMB[mb_num];
+  txConfirmMB[mb_num] = nullptr;
+  __asm__ volatile("msr primask, %0" :: "r" (primask) : "memory");
+  if ( !confirm ) return; /* the other side completed it first */
+  uint32_t now = micros();
+  uint16_t bits = (uint16_t)(FLEXCANb_TIMER(_bus) - (code & FLEXCAN_MB_CS_TIMESTAMP_MASK));
+  uint32_t ago = ( currentBitrate >= 1000 ) ? ((uint32_t)bits * 1000UL) / (currentBitrate / 1000) : 0;
+  if ( ago > now - confirm->mailbox_us ) ago = now - confirm->mailbox_us; /* timer wrapped */
+  uint32_t others = busFrames - confirm->busFrames;
+  confirm->timestamp = code & FLEXCAN_MB_CS_TIMESTAMP_MASK;
+  confirm->done_us = now;
+  confirm->wire_us = now - ago;
+  confirm->frames_ahead = ( others > 255 ) ? 255 : others;
+  confirm->state = CAN_TX_SENT;
+  if ( confirm->callback ) confirm->callback(*confirm);
+}
+
 FCTP_FUNC void FCTP_OPT::onReceive(const FLEXCAN_MAILBOX &mb_num, _MB_ptr handler) {
   if ( FIFO == mb_num ) {
     _mbHandlers[0] = handler;
@@ -1098,16 +1217,18 @@ FCTP_FUNC uint64_t FCTP_OPT::events() {
     memmove(&frame, buf, sizeof(frame));
     if ( frame.mb == -1 ) {
       for (uint8_t i = mailboxOffset(); i < FLEXCANb_MAXMB_SIZE(_bus); i++) {
+        if ( reservedTxMB & (1ULL << i) ) continue;
         if ( FLEXCAN_get_code(FLEXCANb_MBn_CS(_bus, i)) == FLEXCAN_MB_CODE_TX_INACTIVE ) {
           //Serial.print("DBG NORM: "); Serial.println(frame.mb);
-          writeTxMailbox(i, frame);
+          writeTxMailbox(i, frame, takeTxConfirm(frame));
           txBuffer.pop_front();
+          break;
         }
       }
     }
     else if ( FLEXCAN_get_code(FLEXCANb_MBn_CS(_bus, frame.mb)) == FLEXCAN_MB_CODE_TX_INACTIVE ) {
       //Serial.print("DBG SEQ: "); Serial.println(frame.mb);
-      writeTxMailbox(frame.mb, frame);
+      writeTxMailbox(frame.mb, frame, takeTxConfirm(frame));
       txBuffer.pop_front();
     }
   }
@@ -1189,15 +1310,17 @@ FCTP_FUNC void FCTP_OPT::flexcan_interrupt() {
       for ( uint8_t i = 0; i < (8 >> 2); i++ ) for ( int8_t d = 0; d < 4 ; d++ ) msg.buf[(4 * i) + 3 - d] = (uint8_t)(mbxAddr[2 + i] >> (8 * d));
       msg.bus = busNumber;
       msg.mb = FIFO; /* store the mailbox the message came from (for callback reference) */
+      busFrames++;
+      bool bridged = ( bridgeHook && bridgeHook->rxMailbox(busNumber, mbxAddr) ); /* before the FIFO pops */
       (void)FLEXCANb_TIMER(_bus);
       writeIFLAGBit(5); /* clear FIFO bit only! */
       if ( iflag & FLEXCAN_IFLAG1_BUF6I ) writeIFLAGBit(6); /* clear FIFO bit only! */
       if ( iflag & FLEXCAN_IFLAG1_BUF7I ) writeIFLAGBit(7); /* clear FIFO bit only! */
-      frame_distribution(msg);
+      if ( !bridged ) frame_distribution(msg);
       ext_output1(msg);
       ext_output2(msg);
       ext_output3(msg);
-      if (fifo_filter_match(msg.id)) struct2queueRx(msg);
+      if ( !bridged && fifo_filter_match(msg.id) ) struct2queueRx(msg);
     }
   }
 
@@ -1218,11 +1341,13 @@ FCTP_FUNC void FCTP_OPT::flexcan_interrupt() {
       msg.timestamp = code & 0xFFFF;
       msg.bus = busNumber;
       for ( uint8_t i = 0; i < (8 >> 2); i++ ) for ( int8_t d = 0; d < 4 ; d++ ) msg.buf[(4 * i) + 3 - d] = (uint8_t)(mbxAddr[2 + i] >> (8 * d));
+      busFrames++;
+      bool bridged = ( bridgeHook && bridgeHook->rxMailbox(busNumber, mbxAddr) ); /* while the mailbox is locked */
       mbxAddr[0] = FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_RX_EMPTY) | ((msg.flags.extended) ? (FLEXCAN_MB_CS_SRR | FLEXCAN_MB_CS_IDE) : 0);
       (void)FLEXCANb_TIMER(_bus);
       writeIFLAGBit(mb_num);
-      if ( filter_match((FLEXCAN_MAILBOX)mb_num, msg.id) ) struct2queueRx(msg); /* store frame in queue */
-      frame_distribution(msg);
+      if ( !bridged && filter_match((FLEXCAN_MAILBOX)mb_num, msg.id) ) struct2queueRx(msg); /* store frame in queue */
+      if ( !bridged ) frame_distribution(msg);
       ext_output1(msg);
       ext_output2(msg);
       ext_output3(msg);
@@ -1250,17 +1375,24 @@ FCTP_FUNC void FCTP_OPT::flexcan_interrupt() {
         if ( _mainTxHandler ) _mainTxHandler(msg);
       }
 
-      if ( txBuffer.size() ) {
+      if ( txConfirmMB[mb_num] ) txConfirmDone(mb_num, code);
+      busFrames++;
+      if ( reservedTxMB & (1ULL << mb_num) ) {
+        writeIFLAGBit(mb_num); /* staged mailboxes are only refilled by stageTxMB() */
+        mbxAddr[0] = (code & FLEXCAN_MB_CS_TIMESTAMP_MASK) | FLEXCAN_MB_CS_CODE(FLEXCAN_MB_CODE_TX_INACTIVE); /* keep the TX timestamp for getMBTimestamp() */
+        if ( bridgeHook ) bridgeHook->txMailboxDone(busNumber, mb_num);
+      }
+      else if ( txBuffer.size() ) {
         CAN_message_t frame;
         uint8_t buf[sizeof(CAN_message_t)];
         txBuffer.peek_front(buf, sizeof(CAN_message_t));
         memmove(&frame, buf, sizeof(frame));
         if ( frame.mb == -1 ) {
-          writeTxMailbox(mb_num, frame);
+          writeTxMailbox(mb_num, frame, takeTxConfirm(frame));
           txBuffer.pop_front();
         }
         else if ( frame.mb == mb_num ) {
-          writeTxMailbox(frame.mb, frame);
+          writeTxMailbox(frame.mb, frame, takeTxConfirm(frame));
           txBuffer.pop_front();
         }
       }
@@ -1288,17 +1420,23 @@ FCTP_FUNC void FCTP_OPT::flexcan_interrupt() {
         if ( _mainTxHandler ) _mainTxHandler(msg);
       }
 
-      if ( txBuffer.size() ) {
+      if ( txConfirmMB[mb_num] ) txConfirmDone(mb_num, code);
+      busFrames++;
+      if ( reservedTxMB & (1ULL << mb_num) ) {
+        writeIFLAGBit(mb_num); /* staged mailboxes are only refilled by stageTxMB(), CS keeps the TX timestamp */
+        if ( bridgeHook ) bridgeHook->txMailboxDone(busNumber, mb_num);
+      }
+      else if ( txBuffer.size() ) {
         CAN_message_t frame;
         uint8_t buf[sizeof(CAN_message_t)];
         txBuffer.peek_front(buf, sizeof(CAN_message_t));
         memmove(&frame, buf, sizeof(frame));
         if ( frame.mb == -1 ) {
-          writeTxMailbox(mb_num, frame);
+          writeTxMailbox(mb_num, frame, takeTxConfirm(frame));
           txBuffer.pop_front();
         }
         else if ( frame.mb == mb_num ) {
-          writeTxMailbox(frame.mb, frame);
+          writeTxMailbox(frame.mb, frame, takeTxConfirm(frame));
           txBuffer.pop_front();
         }
       }
@@ -0,0 +1,148 @@
+/*
+  HostLink.cpp
+  ------------
+  See HostLink.h.
+*/
+
+#include "HostLink.h"
+
+#define HOSTLINK_CRC_SIZE 2
+
+void HostLink::begin(Stream &port) {
+  this->port = &port;
+  memset(&counters, 0, sizeof(counters));
+  txLen = 0;
+  txFrameLen = 0;
+  rxLen = 0;
+  rxOverflow = 0;
+  rxSynced = 0;
+}
+
+void HostLink::startBatch() {
+  HostLink_header_t h;
+  h.version = HOSTLINK_VERSION;
+  h.flags = 0;
+  h.seq = txSeq++;
+  memcpy(txPayload, &h, sizeof(h));
+  txLen = sizeof(h);
+}
+
+void HostLink::encodeBatch() {
+  if ( txFrameLen ) counters.tx_dropped++; /* USB never had room for it, the newer batch replaces it */
+  uint16_t crc = hostLinkCrc16(txPayload, txLen);
+  txPayload[txLen++] = (uint8_t)crc;
+  txPayload[txLen++] = (uint8_t)(crc >> 8);
+  txFrameLen = hostLinkCobsEncode(txPayload, txLen, txFrame);
+  txFrame[txFrameLen++] = 0;
+  txLen = 0;
+}
+
+bool HostLink::send(uint8_t type, const void *data, uint8_t len) {
+  if ( sizeof(HostLink_header_t) + 2 + len + HOSTLINK_CRC_SIZE > HOSTLINK_MAX_PAYLOAD ) return 0;
+  if ( txLen && txLen + 2 + len + HOSTLINK_CRC_SIZE > HOSTLINK_MAX_PAYLOAD ) {
+    flush();
+    if ( txLen ) encodeBatch(); /* flush() had no room for the older frame */
+  }
+  if ( !txLen ) startBatch();
+  txPayload[txLen++] = type;
+  txPayload[txLen++] = len;
+  memcpy(txPayload + txLen, data, len);
+  txLen += len;
+  return 1;
+}
+
+uint16_t HostLink::flush() {
+  if ( !port ) return 0;
+  uint16_t written = 0;
+  if ( txFrameLen ) {
+    /* an older frame goes first so frames stay in order */
+    if ( port->availableForWrite() < txFrameLen ) return 0;
+    port->write(txFrame, txFrameLen);
+    counters.tx_frames++;
+    written = txFrameLen;
+    txFrameLen = 0;
+  }
+  if ( !txLen ) return written;
+  encodeBatch();
+  if ( port->availableForWrite() < txFrameLen ) return written;
+  port->write(txFrame, txFrameLen);
+  counters.tx_frames++;
+  written += txFrameLen;
+  txFrameLen = 0;
+  return written;
+}
+
+bool HostLink::sendStatus() {
+  counters.stamp_us = micros();
+  return send(HOSTLINK_STATUS, counters);
+}
+
+uint16_t HostLink::update() {
+  if ( !port ) return 0;
+  rxRecords = 0;
+  int avail = port->available();
+  while ( avail-- > 0 ) {
+    int c = port->read();
+    if ( c < 0 ) break;
+    if ( c == 0 ) {
+      if ( rxOverflow ) counters.framing_errors++;
+      else if ( rxLen ) handleFrame();
+      rxLen = 0;
+      rxOverflow = 0;
+      continue;
+    }
+    if ( rxOverflow ) continue;
+    if ( rxLen >= sizeof(rxFrame) ) {
+      rxOverflow = 1;
+      continue;
+    }
+    rxFrame[rxLen++] = (uint8_t)c;
+  }
+  return rxRecords;
+}
+
+void HostLink::handleFrame() {
+  uint8_t payload[HOSTLINK_FRAME_SIZE];
+  size_t len = hostLinkCobsDecode(rxFrame, rxLen, payload);
+  if ( len < sizeof(HostLink_header_t) + HOSTLINK_CRC_SIZE || len > HOSTLINK_MAX_PAYLOAD ) {
+    counters.framing_errors++;
+    return;
+  }
+  len -= HOSTLINK_CRC_SIZE;
+  uint16_t crc = payload[len] | ((uint16_t)payload[len + 1] << 8);
+  if ( crc != hostLinkCrc16(payload, len) ) {
+    counters.crc_errors++;
+    return;
+  }
+  HostLink_header_t h;
+  memcpy(&h, payload, sizeof(h));
+  if ( h.version != HOSTLINK_VERSION ) {
+    counters.framing_errors++;
+    return;
+  }
+  if ( rxSynced ) counters.rx_lost += (uint16_t)(h.seq - rxSeq - 1);
+  rxSeq = h.seq;
+  rxSynced = 1;
+  counters.rx_frames++;
+
+  size_t i = sizeof(h);
+  while ( i + 2 <= len ) {
+    uint8_t type = payload[i], size = payload[i + 1];
+    i += 2;
+    if ( i + size > len ) {
+      counters.framing_errors++;
+      return;
+    }
+    const uint8_t *data = payload + i;
+    i += size;
+    rxRecords++;
+    if ( type == HOSTLINK_PING && size >= sizeof(HostLink_ping_t) ) {
+      HostLink_ping_t pong;
+      memcpy(&pong, data, sizeof(pong));
+      pong.teensy_us = micros();
+      send(HOSTLINK_PONG, pong);
+      continue;
+    }
+    if ( handlerFunc ) handlerFunc(type, data, size);
+  }
+}
@@ -0,0 +1,72 @@
+/*
+  HostLink.h
+  ----------
+  Binary link to the companion computer over the Teensy USB serial port,
+  instead of Serial.print() text. Wire format in HostLinkFormat.h, the PC
+  side is host/HostLinkPort.
+
+  Records are batched: send() only appends to the current frame, and
+  flush() COBS encodes the frame and writes it when the USB transmit
+  buffer has room for all of it, so neither call ever waits for the host.
+  One frame carries up to HOSTLINK_MAX_PAYLOAD bytes, e.g. 15 telemetry
+  records or 20 CAN frames, and fits one 512 byte high speed USB packet:
+
+      HostLink hostLink;
+      void onHost(uint8_t type, const uint8_t *data, uint8_t len) { ... }
+      void setup() { hostLink.begin(); hostLink.onMessage(onHost); }
+      void loop() {
+        hostLink.update();                        // read, check, dispatch
+        hostLink.send(HOSTLINK_TELEMETRY, t);     // any number per pass
+        hostLink.flush();                         // once per pass
+      }
+
+  PINGs are answered inside update() without reaching the handler, so the
+  host can measure the round trip. If a new frame has to be started while
+  the previous one is still waiting for USB room, the waiting frame is
+  dropped and counted (newest data wins). All of it runs from loop(),
+  none of it is interrupt safe.
+*/
+
+#if !defined(_HOST_LINK_H_)
+#define _HOST_LINK_H_
+
+#include "Arduino.h"
+#include "HostLinkFormat.h"
+
+typedef void (*_hostlink_handler_ptr)(uint8_t type, const uint8_t *data, uint8_t len);
+
+class HostLink {
+  public:
+    void begin(Stream &port = Serial);
+    void onMessage(_hostlink_handler_ptr handler) { handlerFunc = handler; }
+    bool send(uint8_t type, const void *data, uint8_t len); /* 0 if the record can never fit */
+    template<typename T> bool send(uint8_t type, const T &record) {
+      static_assert(sizeof(T) <= 255, "HostLink records are at most 255 bytes");
+      return send(type, &record, sizeof(T));
+    }
+    uint16_t flush();         /* bytes written to USB, 0 if nothing to send or no room yet */
+    uint16_t update();        /* records received and handled */
+    bool sendStatus();
+    const HostLink_status_t& stats() const { return counters; }
+
+  private:
+    void startBatch();
+    void encodeBatch();
+    void handleFrame();
+    Stream *port = nullptr;
+    _hostlink_handler_ptr handlerFunc = nullptr;
+    uint8_t txPayload[HOSTLINK_MAX_PAYLOAD];
+    uint16_t txLen = 0;        /* header + records so far, 0 when no batch is open */
+    uint16_t txSeq = 0;
+    uint8_t txFrame[HOSTLINK_FRAME_SIZE];
+    uint16_t txFrameLen = 0;   /* encoded frame waiting for USB room */
+    uint8_t rxFrame[HOSTLINK_FRAME_SIZE];
+    uint16_t rxLen = 0;
+    bool rxOverflow = 0;       /* discard until the next delimiter */
+    uint16_t rxSeq = 0;
+    bool rxSynced = 0;
+    uint16_t rxRecords = 0;
+    HostLink_status_t counters;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*
+  HostLinkFormat.h
+  ----------------
+  Wire format of the binary USB serial link between the Teensy and the
+  companion computer, shared by lib/HostLink and host/HostLinkPort.
+
+  A frame is a batch of records, COBS encoded and ended by a 0x00 byte:
+
+      COBS( HostLink_header_t | record | record | ... | crc16 ) 0x00
+      record = type (1 byte) | length (1 byte) | length bytes of payload
+
+  COBS leaves no zero byte inside the frame, so a reader that starts mid
+  stream or loses bytes resynchronises at the next 0x00. The CRC is
+  CRC-16/CCITT-FALSE over everything before it. A frame is at most
+  HOSTLINK_FRAME_SIZE bytes on the wire, so one fits in one 512 byte
+  high speed USB packet. All fields are little-endian (native on the
+  Teensy and on x86/ARM hosts).
+*/
+
+#if !defined(_HOST_LINK_FORMAT_H_)
+#define _HOST_LINK_FORMAT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOSTLINK_VERSION 1
+#define HOSTLINK_MAX_PAYLOAD 480  /* header + records + crc, before COBS */
+#define HOSTLINK_FRAME_SIZE (HOSTLINK_MAX_PAYLOAD + HOSTLINK_MAX_PAYLOAD / 254 + 2) /* COBS overhead + delimiter */
+
+typedef enum HOSTLINK_TYPE {
+  HOSTLINK_PING = 1,        /* host -> teensy, HostLink_ping_t, answered with a PONG right away */
+  HOSTLINK_PONG = 2,        /* teensy -> host, HostLink_ping_t */
+  HOSTLINK_SETPOINT = 3,    /* host -> teensy, HostLink_setpoint_t */
+  HOSTLINK_TELEMETRY = 4,   /* teensy -> host, HostLink_telemetry_t */
+  HOSTLINK_CAN_FRAME = 5,   /* either way, HostLink_can_t */
+  HOSTLINK_STATUS = 6,      /* teensy -> host, HostLink_status_t */
+  HOSTLINK_BUS_LOAD = 7,    /* teensy -> host, HostLink_bus_load_t; host -> teensy with no payload asks for a profiler report */
+  HOSTLINK_ID_STATS = 8,    /* teensy -> host, HostLink_id_stats_t */
+} HOSTLINK_TYPE;
+
+typedef struct HostLink_header_t {
+  uint8_t version;
+  uint8_t flags;            /* reserved, 0 */
+  uint16_t seq;             /* per frame, a gap means frames were lost */
+} HostLink_header_t;
+
+typedef struct HostLink_ping_t {
+  uint32_t token;           /* echoed back */
+  uint32_t teensy_us;       /* micros() when the PONG was queued, 0 in a PING */
+} HostLink_ping_t;
+
+typedef struct HostLink_setpoint_t {
+  uint8_t controller;       /* VESC controller id */
+  uint8_t command;          /* VESC_COMMAND from VescCAN.h */
+  uint16_t reserved;
+  int32_t value;            /* wire scale: duty 100000 = 100%, current in mA, erpm, pos * 1000000 */
+} HostLink_setpoint_t;
+
+typedef struct HostLink_telemetry_t {
+  uint32_t stamp_us;        /* micros() of the newest STATUS_1 */
+  uint8_t controller;
+  uint8_t reserved[3];
+  int32_t erpm;
+  int32_t tachometer;
+  int16_t current_da;       /* motor current, 0.1 A */
+  int16_t duty_permille;
+  int16_t current_in_da;    /* input current, 0.1 A */
+  int16_t v_in_dv;          /* 0.1 V */
+  int16_t temp_fet_dc;      /* 0.1 C */
+  int16_t temp_motor_dc;    /* 0.1 C */
+} HostLink_telemetry_t;
+
+#define HOSTLINK_CAN_EXTENDED 0x01
+#define HOSTLINK_CAN_REMOTE 0x02
+
+typedef struct HostLink_can_t {
+  uint32_t stamp_us;        /* micros() at receive, 0 for frames from the host */
+  uint32_t id;
+  uint8_t bus;              /* 1..3 = CAN1..CAN3 */
+  uint8_t flags;            /* HOSTLINK_CAN_EXTENDED | HOSTLINK_CAN_REMOTE */
+  uint8_t len;
+  uint8_t reserved;
+  uint8_t buf[8];
+} HostLink_can_t;
+
+typedef struct HostLink_status_t {
+  uint32_t stamp_us;
+  uint32_t rx_frames;       /* good frames from the host */
+  uint32_t rx_lost;         /* gaps in the host's frame seq */
+  uint32_t crc_errors;
+  uint32_t framing_errors;  /* bad COBS, too long, bad header */
+  uint32_t tx_frames;
+  uint32_t tx_dropped;      /* batches replaced before USB had room for them */
+} HostLink_status_t;
+
+typedef struct HostLink_bus_load_t {
+  uint32_t stamp_us;
+  uint8_t bus;              /* 1..3 = CAN1..CAN3 */
+  uint8_t reserved;
+  uint16_t load_cpct;       /* 0.01 %, over the window, stuff bits as sent */
+  uint16_t worst_cpct;      /* same frames with worst case stuffing */
+  uint16_t peak_cpct;       /* busiest bucket since the profiler started */
+  uint32_t bitrate;
+  uint32_t frames;          /* in the window */
+  uint32_t window_us;
+} HostLink_bus_load_t;
+
+#define HOSTLINK_ID_TX 0x04       /* we sent at least one of them */
+
+typedef struct HostLink_id_stats_t {
+  uint32_t id;
+  uint8_t bus;
+  uint8_t flags;            /* HOSTLINK_CAN_EXTENDED | HOSTLINK_ID_TX */
+  uint16_t dlc_mask;        /* bit n set if a frame with len n was seen */
+  uint32_t frames;
+  uint32_t rate_mhz;        /* frames per 1000 s */
+  uint32_t period_us;       /* smoothed */
+  uint32_t jitter_us;       /* smoothed deviation from period_us */
+  uint32_t min_period_us;
+  uint32_t max_period_us;
+  uint32_t bits;            /* on the wire, all frames */
+} HostLink_id_stats_t;
+
+static_assert(sizeof(HostLink_header_t) == 4, "HostLink_header_t must stay 4 bytes");
+static_assert(sizeof(HostLink_ping_t) == 8, "HostLink_ping_t must stay 8 bytes");
+static_assert(sizeof(HostLink_setpoint_t) == 8, "HostLink_setpoint_t must stay 8 bytes");
+static_assert(sizeof(HostLink_telemetry_t) == 28, "HostLink_telemetry_t must stay 28 bytes");
+static_assert(sizeof(HostLink_can_t) == 20, "HostLink_can_t must stay 20 bytes");
+static_assert(sizeof(HostLink_status_t) == 28, "HostLink_status_t must stay 28 bytes");
+static_assert(sizeof(HostLink_bus_load_t) == 24, "HostLink_bus_load_t must stay 24 bytes");
+static_assert(sizeof(HostLink_id_stats_t) == 36, "HostLink_id_stats_t must stay 36 bytes");
+
+static inline uint16_t hostLinkCrc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  while ( len-- ) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for ( uint8_t i = 0; i < 8; i++ ) crc = ( crc & 0x8000 ) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+/* COBS encode len bytes into out (room for len + len / 254 + 1), returns the encoded length, no delimiter */
+static inline size_t hostLinkCobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t code = 0, o = 1;
+  uint8_t run = 1;
+  for ( size_t i = 0; i < len; i++ ) {
+    if ( in[i] ) {
+      out[o++] = in[i];
+      run++;
+    }
+    if ( !in[i] || run == 0xFF ) {
+      out[code] = run;
+      code = o++;
+      run = 1;
+    }
+  }
+  out[code] = run;
+  return o;
+}
+
+/* COBS decode len bytes (delimiter removed) into out, returns the decoded length or 0 if malformed */
+static inline size_t hostLinkCobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0, o = 0;
+  while ( i < len ) {
+    uint8_t code = in[i++];
+    if ( !code || i + code - 1 > len ) return 0;
+    for ( uint8_t j = 1; j < code; j++ ) out[o++] = in[i++];
+    if ( code != 0xFF && i < len ) out[o++] = 0;
+  }
+  return o;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+  TimerWheel.cpp
+  --------------
+  See TimerWheel.h.
+*/
+
+#include "TimerWheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+TimerWheel::TimerWheel() {
+  for ( uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++ ) {
+    for ( uint8_t i = 0; i < TIMER_WHEEL_SLOTS; i++ ) slots[level][i].next = slots[level][i].prev = &slots[level][i];
+  }
+}
+
+void TimerWheel::link(TimerWheel_timer_t &head, TimerWheel_timer_t &timer) {
+  timer.next = &head;
+  timer.prev = head.prev;
+  head.prev->next = &timer;
+  head.prev = &timer;
+}
+
+void TimerWheel::unlink(TimerWheel_timer_t &timer) {
+  timer.prev->next = timer.next;
+  timer.next->prev = timer.prev;
+  timer.next = timer.prev = nullptr;
+}
+
+/* level n holds timers less than 64^(n+1) ticks away, in the slot of their
+   expiry's n-th digit; they move down when the lower digits roll over */
+void TimerWheel::insert(TimerWheel_timer_t &timer) {
+  uint32_t delay = timer.expires - current; /* 0 only while cascading, the slot fires right after */
+  if ( delay > TIMER_WHEEL_MAX_DELAY ) {
+    timer.expires = current + TIMER_WHEEL_MAX_DELAY;
+    delay = TIMER_WHEEL_MAX_DELAY;
+  }
+  uint8_t level = 0;
+  while ( level < TIMER_WHEEL_LEVELS - 1 && delay >= (1UL << (TIMER_WHEEL_BITS * (level + 1))) ) level++;
+  link(slots[level][(timer.expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK], timer);
+}
+
+void TimerWheel::start(TimerWheel_timer_t &timer, uint32_t delay) {
+  startAt(timer, current + delay);
+}
+
+void TimerWheel::startAt(TimerWheel_timer_t &timer, uint32_t tick) {
+  if ( running(timer) ) unlink(timer);
+  timer.expires = ( (int32_t)(tick - current) > 0 ) ? tick : current + 1; /* this tick already ran */
+  insert(timer);
+}
+
+void TimerWheel::stop(TimerWheel_timer_t &timer) {
+  if ( running(timer) ) unlink(timer);
+}
+
+void TimerWheel::cascade(uint8_t level) {
+  TimerWheel_timer_t &head = slots[level][(current >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+  while ( head.next != &head ) {
+    TimerWheel_timer_t &timer = *head.next;
+    unlink(timer);
+    insert(timer);
+    counters.cascaded++;
+  }
+}
+
+uint32_t TimerWheel::tick() {
+  current++;
+  counters.ticks++;
+  /* top level first, what comes down may land in a slot that cascades on this same tick */
+  for ( uint8_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level-- ) {
+    if ( !(current & ((1UL << (TIMER_WHEEL_BITS * level)) - 1)) ) cascade(level);
+  }
+
+  TimerWheel_timer_t &head = slots[0][current & SLOT_MASK];
+  TimerWheel_timer_t due;
+  due.next = due.prev = &due;
+  while ( head.next != &head ) { /* move them off the wheel first, callbacks may start timers on this slot */
+    TimerWheel_timer_t &timer = *head.next;
+    unlink(timer);
+    link(due, timer);
+  }
+  uint32_t fired = 0;
+  while ( due.next != &due ) { /* a callback may also stop one that is still waiting here */
+    TimerWheel_timer_t &timer = *due.next;
+    unlink(timer);
+    fired++;
+    if ( timer.callback ) timer.callback(&timer, timer.arg);
+  }
+  counters.fired += fired;
+  if ( fired > counters.max_fired ) counters.max_fired = fired;
+  return fired;
+}
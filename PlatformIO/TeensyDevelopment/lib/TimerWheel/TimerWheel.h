@@ -0,0 +1,76 @@
+/*
+  TimerWheel.h
+  ------------
+  Hierarchical timing wheel: any number of one-shot timers, O(1) to start,
+  stop and expire, whatever their delay. Four levels of 64 slots cover
+  2^24 ticks (4.6 hours at 1 ms); longer delays are clamped.
+
+  The wheel has no clock of its own, something calls tick() once per tick
+  (lib/CanScheduler does it from its IntervalTimer and lends the wheel to
+  the other CAN timeouts). A timer is a TimerWheel_timer_t owned by the
+  caller, usually a member of whatever it times; the callback can restart
+  it (periodic) or start others:
+
+      void expired(TimerWheel_timer_t *t, void *arg) { ... wheel.start(*t, 10); }
+      TimerWheel_timer_t t = { expired, nullptr };
+      wheel.start(t, 10);   // on the 10th tick from now
+
+  TIMER_WHEEL_OWNER() gets from the timer back to the struct it is in.
+
+  Not locked: tick(), start() and stop() must not interrupt each other,
+  mask the ticking interrupt around start()/stop() from elsewhere.
+*/
+
+#if !defined(_TIMER_WHEEL_H_)
+#define _TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_MAX_DELAY ((1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+#define TIMER_WHEEL_OWNER(type, member, timer) (*(type*)((uint8_t*)(timer) - offsetof(type, member)))
+
+struct TimerWheel_timer_t;
+typedef void (*_timer_wheel_ptr)(TimerWheel_timer_t *timer, void *arg);
+
+typedef struct TimerWheel_timer_t {
+  _timer_wheel_ptr callback;
+  void *arg;
+  uint32_t expires = 0;            /* tick it fires on */
+  TimerWheel_timer_t *next = nullptr;
+  TimerWheel_timer_t *prev = nullptr; /* nullptr: not running */
+} TimerWheel_timer_t;
+
+typedef struct TimerWheel_stats_t {
+  uint32_t ticks = 0;
+  uint32_t fired = 0;
+  uint32_t cascaded = 0;           /* timers moved down a level */
+  uint32_t max_fired = 0;          /* most timers expired on one tick */
+} TimerWheel_stats_t;
+
+class TimerWheel {
+  public:
+    TimerWheel();
+    void start(TimerWheel_timer_t &timer, uint32_t delay); /* fires on tick now() + delay, 0 or 1 is the next tick */
+    void startAt(TimerWheel_timer_t &timer, uint32_t tick); /* a tick that already passed fires on the next one */
+    void stop(TimerWheel_timer_t &timer);
+    static bool running(const TimerWheel_timer_t &timer) { return timer.prev != nullptr; }
+    uint32_t now() const { return current; }
+    uint32_t tick(); /* advance one tick and run what expired, returns how many */
+    const TimerWheel_stats_t& stats() const { return counters; }
+
+  private:
+    void insert(TimerWheel_timer_t &timer);
+    void cascade(uint8_t level);
+    static void link(TimerWheel_timer_t &head, TimerWheel_timer_t &timer);
+    static void unlink(TimerWheel_timer_t &timer);
+
+    TimerWheel_timer_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; /* list heads, circular */
+    uint32_t current = 0;
+    TimerWheel_stats_t counters;
+};
+
+#endif
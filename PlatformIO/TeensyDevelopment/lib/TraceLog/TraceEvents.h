@@ -0,0 +1,26 @@
+/*
+  TraceEvents.h
+  -------------
+  Event list shared by the firmware (TraceLog.h) and the host decoder
+  (host/trace_decode.cpp). Add new events at the end so IDs in old
+  captures keep their meaning.
+
+  TRACE_EVENT(name, format)  format is printf-style for (arg16, arg0, arg1)
+*/
+
+#define TRACE_EVENT_LIST \
+  TRACE_EVENT(TRACE_MARK,            "mark %u %lu %lu") \
+  TRACE_EVENT(TRACE_CAN_TX,          "can tx bus %u id 0x%lx data 0x%08lx") \
+  TRACE_EVENT(TRACE_CAN_TX_FAIL,     "can tx failed bus %u id 0x%lx result %ld") \
+  TRACE_EVENT(TRACE_CAN_RX,          "can rx bus %u id 0x%lx data 0x%08lx") \
+  TRACE_EVENT(TRACE_VESC_DUTY,       "vesc %u duty %ld x1e-5") \
+  TRACE_EVENT(TRACE_VESC_STATUS,     "vesc %u erpm %ld current %ld x0.1A") \
+  TRACE_EVENT(TRACE_BURST_RELEASE,   "burst %u frames stage us %lu spread us %lu") \
+  TRACE_EVENT(TRACE_CONTROL_OVERRUN, "control overrun %u exec us %lu period us %lu")
+
+#define TRACE_EVENT(name, format) name,
+typedef enum TRACE_EVENT_ID {
+  TRACE_EVENT_LIST
+  TRACE_EVENT_COUNT
+} TRACE_EVENT_ID;
+#undef TRACE_EVENT
@@ -0,0 +1,36 @@
+/*
+  TraceFormat.h
+  -------------
+  Wire format of the TraceLog stream, shared with host/trace_decode.cpp.
+
+  The firmware writes batches: one TraceLog_batch_t header followed by
+  `count` TraceLog_record_t records, all little-endian (native on both the
+  Teensy and x86). A host that joins mid-stream resynchronises on magic.
+*/
+
+#if !defined(_TRACE_FORMAT_H_)
+#define _TRACE_FORMAT_H_
+
+#include <stdint.h>
+
+#define TRACE_MAGIC 0x4C54 /* "TL" */
+
+typedef struct TraceLog_record_t {
+  uint32_t stamp;      /* cycle counter when the event was logged */
+  uint16_t event;      /* TRACE_EVENT_ID */
+  uint16_t arg16;
+  uint32_t arg0;
+  uint32_t arg1;
+} TraceLog_record_t;
+
+typedef struct TraceLog_batch_t {
+  uint16_t magic;
+  uint16_t count;           /* records that follow */
+  uint32_t cycles_per_us;   /* to turn stamps into time */
+  uint32_t dropped;         /* records lost to a full ring since boot */
+} TraceLog_batch_t;
+
+static_assert(sizeof(TraceLog_record_t) == 16, "TraceLog record must stay 16 bytes");
+static_assert(sizeof(TraceLog_batch_t) == 12, "TraceLog batch header must stay 12 bytes");
+
+#endif
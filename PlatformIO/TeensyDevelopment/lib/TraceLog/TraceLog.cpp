@@ -0,0 +1,37 @@
+/*
+  TraceLog.cpp
+  ------------
+  See TraceLog.h.
+*/
+
+#include "TraceLog.h"
+
+TraceLog traceLog;
+
+void TraceLog::begin() {
+  cyclesPerUs = cycleCounterBegin();
+}
+
+uint16_t TraceLog::drain(Stream &port) {
+  uint32_t t = tail;
+  uint32_t avail = head - t;
+  if ( !avail ) return 0;
+  int room = port.availableForWrite() - (int)sizeof(TraceLog_batch_t);
+  if ( room < (int)sizeof(TraceLog_record_t) ) return 0;
+
+  /* one contiguous run: never more than fits, never past the end of the ring */
+  uint32_t index = t & (TRACE_LOG_SIZE - 1);
+  uint32_t count = room / sizeof(TraceLog_record_t);
+  if ( count > avail ) count = avail;
+  if ( count > TRACE_LOG_SIZE - index ) count = TRACE_LOG_SIZE - index;
+
+  TraceLog_batch_t batch;
+  batch.magic = TRACE_MAGIC;
+  batch.count = count;
+  batch.cycles_per_us = cyclesPerUs;
+  batch.dropped = lost;
+  port.write((const uint8_t*)&batch, sizeof(batch));
+  port.write((const uint8_t*)&ring[index], count * sizeof(TraceLog_record_t));
+  __atomic_store_n(&tail, t + count, __ATOMIC_RELEASE);
+  return count;
+}
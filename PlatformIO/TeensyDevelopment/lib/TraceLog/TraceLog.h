@@ -0,0 +1,76 @@
+/*
+  TraceLog.h
+  ----------
+  Binary deferred trace log for code that cannot afford Serial.print().
+
+  A call site stores one fixed 16 byte record (cycle counter stamp, event
+  id, three argument slots) into a RAM ring and returns; nothing is
+  formatted and nothing waits for USB:
+
+      TRACE(TRACE_CAN_TX, 1, msg.id, vesc_get_int32(msg.buf));
+
+  loop() calls traceLog.drain(), which copies whatever fits in the USB
+  serial transmit buffer as one binary batch and returns at once. The host
+  tool host/trace_decode.cpp turns the stream back into text using the
+  format strings in TraceEvents.h, so the printf work happens on the PC.
+
+  Slots are reserved with a compare-and-swap on the head index, so TRACE()
+  is safe from any interrupt priority and from loop() at the same time.
+  When the ring is full the record is dropped and counted; a call site
+  never blocks. drain() must run from loop() (thread context): every writer
+  that could be half way through a record then has priority over it and
+  has already finished.
+*/
+
+#if !defined(_TRACE_LOG_H_)
+#define _TRACE_LOG_H_
+
+#include "Arduino.h"
+#include "CycleCounter.h"
+#include "TraceFormat.h"
+#include "TraceEvents.h"
+
+#if !defined(TRACE_LOG_SIZE)
+#define TRACE_LOG_SIZE 1024 /* records, power of two: 16 KB of RAM */
+#endif
+
+static_assert((TRACE_LOG_SIZE & (TRACE_LOG_SIZE - 1)) == 0, "TRACE_LOG_SIZE must be a power of two");
+
+class TraceLog {
+  public:
+    void begin();
+    inline void log(uint16_t event, uint16_t arg16 = 0, uint32_t arg0 = 0, uint32_t arg1 = 0);
+    uint16_t drain(Stream &port = Serial); /* records written, 0 if empty or no room */
+    uint32_t pending() const { return head - tail; }
+    uint32_t dropped() const { return lost; }
+
+  private:
+    TraceLog_record_t ring[TRACE_LOG_SIZE];
+    volatile uint32_t head = 0;  /* next slot to reserve, written by TRACE() */
+    volatile uint32_t tail = 0;  /* next slot to send, written by drain() */
+    volatile uint32_t lost = 0;
+    uint32_t cyclesPerUs = 1;
+};
+
+extern TraceLog traceLog;
+
+#define TRACE(event, ...) traceLog.log((event), ##__VA_ARGS__)
+
+inline void TraceLog::log(uint16_t event, uint16_t arg16, uint32_t arg0, uint32_t arg1) {
+  uint32_t stamp = ARM_DWT_CYCCNT;
+  uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+  do {
+    if ( h - tail >= TRACE_LOG_SIZE ) {
+      __atomic_fetch_add(&lost, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  } while ( !__atomic_compare_exchange_n(&head, &h, h + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) );
+  TraceLog_record_t &r = ring[h & (TRACE_LOG_SIZE - 1)];
+  r.stamp = stamp;
+  r.event = event;
+  r.arg16 = arg16;
+  r.arg0 = arg0;
+  r.arg1 = arg1;
+}
+
+#endif
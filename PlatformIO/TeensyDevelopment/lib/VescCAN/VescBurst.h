@@ -0,0 +1,124 @@
+/*
+  VescBurst.h
+  -----------
+  One-burst-per-tick command release for several VESCs.
+
+  Each controller gets its own reserved FlexCAN TX mailbox. During a control
+  tick the setpoints are collected with set(), then release() loads every
+  mailbox and requests them all with interrupts masked, so the frames enter
+  arbitration together instead of being spread out by whatever code runs
+  between individual write() calls.
+
+      FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+      VESC_controller left(1), right(2), steer(3);
+      VESC_burst<FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16>, 3> burst(can1, MB10);
+
+      burst.begin();                       // after can1.begin()/setBaudRate()
+      ...
+      burst.set(0, left.setCurrent(4.0f)); // once per tick
+      burst.set(1, right.setCurrent(4.0f));
+      burst.set(2, steer.setPos(12.5f));
+      burst.release();
+
+  When the previous burst has left the bus, stats() turns the mailbox TX
+  timestamps (FlexCAN bit-time timer) into the spread between the first and
+  last frame on the wire.
+*/
+
+#if !defined(_VESC_BURST_H_)
+#define _VESC_BURST_H_
+
+#include "VescCAN.h"
+
+typedef struct VESC_burst_stats_t {
+  uint32_t ticks = 0;          /* bursts released */
+  uint32_t frames = 0;         /* frames released */
+  uint32_t overruns = 0;       /* slot mailbox still busy with the previous tick's frame */
+  uint32_t spread_us = 0;      /* first to last frame on the wire, last completed burst */
+  uint32_t max_spread_us = 0;
+  uint32_t stage_us = 0;       /* CPU time to stage and release the last burst */
+} VESC_burst_stats_t;
+
+#define VESC_BURST_CLASS template<typename _busType, uint8_t _slots = 4>
+#define VESC_BURST_FUNC template<typename _busType, uint8_t _slots>
+#define VESC_BURST_OPT VESC_burst<_busType, _slots>
+
+VESC_BURST_CLASS class VESC_burst {
+  public:
+    VESC_burst(_busType &bus, FLEXCAN_MAILBOX first_mb) : can(bus), firstMB(first_mb) { ; }
+    void begin();
+    void set(uint8_t slot, const CAN_message_t &frame);
+    void clear() { pending = 0; }
+    uint8_t release();
+    const VESC_burst_stats_t& stats();
+
+  private:
+    _busType &can;
+    FLEXCAN_MAILBOX firstMB;
+    CAN_message_t frames[_slots];
+    uint64_t pending = 0;   /* slots set this tick */
+    uint64_t inFlight = 0;  /* mailboxes of the last release, not yet measured */
+    VESC_burst_stats_t counters;
+};
+
+VESC_BURST_FUNC void VESC_BURST_OPT::begin() {
+  for ( uint8_t i = 0; i < _slots; i++ ) can.reserveTxMB((FLEXCAN_MAILBOX)(firstMB + i));
+}
+
+VESC_BURST_FUNC void VESC_BURST_OPT::set(uint8_t slot, const CAN_message_t &frame) {
+  if ( slot >= _slots ) return;
+  frames[slot] = frame;
+  pending |= (1ULL << slot);
+}
+
+VESC_BURST_FUNC uint8_t VESC_BURST_OPT::release() {
+  stats(); /* measure the previous burst before its timestamps are overwritten */
+  uint32_t start = micros();
+  uint64_t mask = 0;
+  uint8_t count = 0;
+  for ( uint8_t i = 0; i < _slots; i++ ) {
+    if ( !(pending & (1ULL << i)) ) continue;
+    FLEXCAN_MAILBOX mb = (FLEXCAN_MAILBOX)(firstMB + i);
+    if ( !can.stageTxMB(mb, frames[i]) ) {
+      counters.overruns++;
+      continue;
+    }
+    mask |= (1ULL << mb);
+    count++;
+  }
+  can.releaseTxMB(mask);
+  counters.stage_us = micros() - start;
+  counters.ticks++;
+  counters.frames += count;
+  inFlight = mask;
+  pending = 0;
+  return count;
+}
+
+VESC_BURST_FUNC const VESC_burst_stats_t& VESC_BURST_OPT::stats() {
+  if ( !inFlight ) return counters;
+  uint64_t mask = inFlight;
+  while ( mask ) {
+    if ( !can.isTxMBIdle((FLEXCAN_MAILBOX)__builtin_ctzll(mask)) ) return counters; /* still on the bus */
+    mask &= mask - 1;
+  }
+  /* 16-bit timer: measure against the first mailbox so wrap-around cancels out */
+  mask = inFlight;
+  uint16_t ref = can.getMBTimestamp((FLEXCAN_MAILBOX)__builtin_ctzll(mask));
+  int32_t lo = 0, hi = 0;
+  while ( mask ) {
+    int16_t delta = (int16_t)(can.getMBTimestamp((FLEXCAN_MAILBOX)__builtin_ctzll(mask)) - ref);
+    if ( delta < lo ) lo = delta;
+    if ( delta > hi ) hi = delta;
+    mask &= mask - 1;
+  }
+  uint32_t bitrate = can.getBaudRate();
+  if ( bitrate ) {
+    counters.spread_us = (uint32_t)(((uint64_t)(hi - lo) * 1000000UL) / bitrate);
+    if ( counters.spread_us > counters.max_spread_us ) counters.max_spread_us = counters.spread_us;
+  }
+  inFlight = 0;
+  return counters;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+  VescCAN.h
+  ---------
+  VESC CAN bus protocol: command encoders and STATUS_1..6 broadcast decoders.
+
+  The VESC uses extended (29-bit) identifiers built as:
+      id = (packet_id << 8) | controller_id
+  with the command value in the payload as a big-endian signed integer scaled
+  by a fixed factor (duty * 100000, current * 1000, ...). The older sketches
+  put a command byte in the payload or sent a host-endian int32, neither of
+  which the VESC understands.
+
+  A VESC_controller keeps one pre-built CAN_message_t per command (ID, IDE
+  flag and length filled in once by setControllerID()), so sending a setpoint
+  is a multiply and four byte stores:
+
+      VESC_controller left(1);
+      can1.write(left.setDuty(0.18f));
+
+  IDs, scaling and field positions all come from lib/CanDB/MiniRobDB.h,
+  generated from minirob.candb, so the firmware and the host tools read
+  the same definitions. Change a message there, not here.
+
+  Nothing in here touches the hardware, so the same header builds on the
+  host (see host/include/FlexCAN_T4.h) for checking frames against logs.
+*/
+
+#if !defined(_VESC_CAN_H_)
+#define _VESC_CAN_H_
+
+#if defined(ARDUINO)
+#include "Arduino.h"
+#endif
+#include <stdint.h>
+#include <string.h>
+#include "FlexCAN_T4.h"
+#include "MiniRobDB.h"
+
+typedef enum VESC_CAN_PACKET_ID {
+  CAN_PACKET_SET_DUTY = VESC_SET_DUTY::ID >> 8,
+  CAN_PACKET_SET_CURRENT = VESC_SET_CURRENT::ID >> 8,
+  CAN_PACKET_SET_CURRENT_BRAKE = VESC_SET_CURRENT_BRAKE::ID >> 8,
+  CAN_PACKET_SET_RPM = VESC_SET_RPM::ID >> 8,
+  CAN_PACKET_SET_POS = VESC_SET_POS::ID >> 8,
+  CAN_PACKET_STATUS = VESC_STATUS_1::ID >> 8,
+  CAN_PACKET_SET_CURRENT_REL = VESC_SET_CURRENT_REL::ID >> 8,
+  CAN_PACKET_STATUS_2 = VESC_STATUS_2::ID >> 8,
+  CAN_PACKET_STATUS_3 = VESC_STATUS_3::ID >> 8,
+  CAN_PACKET_STATUS_4 = VESC_STATUS_4::ID >> 8,
+  CAN_PACKET_PING = VESC_PING::ID >> 8,
+  CAN_PACKET_PONG = VESC_PONG::ID >> 8,
+  CAN_PACKET_STATUS_5 = VESC_STATUS_5::ID >> 8,
+  CAN_PACKET_STATUS_6 = VESC_STATUS_6::ID >> 8
+} VESC_CAN_PACKET_ID;
+
+typedef enum VESC_COMMAND {
+  VESC_CMD_DUTY = 0,
+  VESC_CMD_CURRENT,
+  VESC_CMD_CURRENT_BRAKE,
+  VESC_CMD_RPM,
+  VESC_CMD_POS,
+  VESC_CMD_CURRENT_REL,
+  VESC_CMD_COUNT
+} VESC_COMMAND;
+
+#define VESC_CAN_ID(packet, controller) ((((uint32_t)(packet)) << 8) | (uint8_t)(controller))
+#define VESC_CAN_PACKET(id) ((uint8_t)(((id) >> 8) & 0xFF))
+#define VESC_CAN_CONTROLLER(id) ((uint8_t)((id) & 0xFF))
+
+/* every command payload is one big-endian int32 in bytes 0..3 */
+typedef CANDB_signal<0, 32, CANDB_BIG, CANDB_SIGNED> VESC_command_value;
+
+static inline void vesc_put_int32(uint8_t *buf, int32_t value) { VESC_command_value::set(buf, value); }
+static inline int32_t vesc_get_int32(const uint8_t *buf) { return VESC_command_value::get(buf); }
+
+typedef struct VESC_status_t {
+  uint8_t controller_id = 0;
+  int32_t erpm = 0;                /* STATUS_1 */
+  float current = 0;               /* STATUS_1, motor current (A) */
+  float duty = 0;                  /* STATUS_1, -1.0 .. 1.0 */
+  float amp_hours = 0;             /* STATUS_2 */
+  float amp_hours_charged = 0;     /* STATUS_2 */
+  float watt_hours = 0;            /* STATUS_3 */
+  float watt_hours_charged = 0;    /* STATUS_3 */
+  float temp_fet = 0;              /* STATUS_4 (C) */
+  float temp_motor = 0;            /* STATUS_4 (C) */
+  float current_in = 0;            /* STATUS_4, input current (A) */
+  float pid_pos = 0;               /* STATUS_4 (deg) */
+  int32_t tachometer = 0;          /* STATUS_5 */
+  float v_in = 0;                  /* STATUS_5, input voltage (V) */
+  float adc1 = 0;                  /* STATUS_6 (V) */
+  float adc2 = 0;                  /* STATUS_6 (V) */
+  float adc3 = 0;                  /* STATUS_6 (V) */
+  float ppm = 0;                   /* STATUS_6, -1.0 .. 1.0 */
+} VESC_status_t;
+
+/*
+  Decodes one STATUS_1..6 broadcast into the matching fields of status.
+  Returns the packet id that was decoded, or -1 if msg is not a VESC status
+  frame. Scaling uses multiplies by the reciprocal, never a division.
+*/
+static inline int vescDecodeStatus(const CAN_message_t &msg, VESC_status_t &status) {
+  if ( !msg.flags.extended || msg.len < 8 ) return -1;
+  const uint8_t *b = msg.buf;
+  uint8_t packet = VESC_CAN_PACKET(msg.id);
+  switch ( packet ) {
+    case CAN_PACKET_STATUS:
+      status.erpm = VESC_STATUS_1::erpm::get(b);
+      status.current = VESC_STATUS_1::current::decode(b);
+      status.duty = VESC_STATUS_1::duty::decode(b);
+      break;
+    case CAN_PACKET_STATUS_2:
+      status.amp_hours = VESC_STATUS_2::amp_hours::decode(b);
+      status.amp_hours_charged = VESC_STATUS_2::amp_hours_charged::decode(b);
+      break;
+    case CAN_PACKET_STATUS_3:
+      status.watt_hours = VESC_STATUS_3::watt_hours::decode(b);
+      status.watt_hours_charged = VESC_STATUS_3::watt_hours_charged::decode(b);
+      break;
+    case CAN_PACKET_STATUS_4:
+      status.temp_fet = VESC_STATUS_4::temp_fet::decode(b);
+      status.temp_motor = VESC_STATUS_4::temp_motor::decode(b);
+      status.current_in = VESC_STATUS_4::current_in::decode(b);
+      status.pid_pos = VESC_STATUS_4::pid_pos::decode(b);
+      break;
+    case CAN_PACKET_STATUS_5:
+      status.tachometer = VESC_STATUS_5::tachometer::get(b);
+      status.v_in = VESC_STATUS_5::v_in::decode(b);
+      break;
+    case CAN_PACKET_STATUS_6:
+      status.adc1 = VESC_STATUS_6::adc1::decode(b);
+      status.adc2 = VESC_STATUS_6::adc2::decode(b);
+      status.adc3 = VESC_STATUS_6::adc3::decode(b);
+      status.ppm = VESC_STATUS_6::ppm::decode(b);
+      break;
+    default:
+      return -1;
+  }
+  status.controller_id = VESC_CAN_CONTROLLER(msg.id);
+  return packet;
+}
+
+class VESC_controller {
+  public:
+    VESC_controller(uint8_t controller_id = 0) { setControllerID(controller_id); }
+    void setControllerID(uint8_t controller_id);
+    uint8_t getControllerID() const { return controllerID; }
+
+    /* setpoints in engineering units, scaled with a single multiply */
+    const CAN_message_t& setDuty(float duty) { return encode(VESC_CMD_DUTY, VESC_SET_DUTY::duty::raw(duty)); }
+    const CAN_message_t& setCurrent(float amps) { return encode(VESC_CMD_CURRENT, VESC_SET_CURRENT::current::raw(amps)); }
+    const CAN_message_t& setCurrentBrake(float amps) { return encode(VESC_CMD_CURRENT_BRAKE, VESC_SET_CURRENT_BRAKE::current::raw(amps)); }
+    const CAN_message_t& setRPM(int32_t erpm) { return encode(VESC_CMD_RPM, erpm); }
+    const CAN_message_t& setPos(float degrees) { return encode(VESC_CMD_POS, VESC_SET_POS::pos::raw(degrees)); }
+    const CAN_message_t& setCurrentRel(float fraction) { return encode(VESC_CMD_CURRENT_REL, VESC_SET_CURRENT_REL::current_rel::raw(fraction)); }
+
+    /* setpoints already in the wire scale (duty 100000 == 100%, current in mA, ...) */
+    const CAN_message_t& encode(VESC_COMMAND cmd, int32_t raw) {
+      VESC_command_value::set(frames[cmd].buf, raw);
+      return frames[cmd];
+    }
+    const CAN_message_t& frame(VESC_COMMAND cmd) const { return frames[cmd]; }
+
+  private:
+    uint8_t controllerID = 0;
+    CAN_message_t frames[VESC_CMD_COUNT];
+};
+
+inline void VESC_controller::setControllerID(uint8_t controller_id) {
+  controllerID = controller_id;
+  VESC_SET_DUTY::init(frames[VESC_CMD_DUTY], controller_id);
+  VESC_SET_CURRENT::init(frames[VESC_CMD_CURRENT], controller_id);
+  VESC_SET_CURRENT_BRAKE::init(frames[VESC_CMD_CURRENT_BRAKE], controller_id);
+  VESC_SET_RPM::init(frames[VESC_CMD_RPM], controller_id);
+  VESC_SET_POS::init(frames[VESC_CMD_POS], controller_id);
+  VESC_SET_CURRENT_REL::init(frames[VESC_CMD_CURRENT_REL], controller_id);
+}
+
+#endif
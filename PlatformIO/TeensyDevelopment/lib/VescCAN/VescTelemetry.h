@@ -0,0 +1,168 @@
+/*
+  VescTelemetry.h
+  ---------------
+  Latest-value cache for VESC STATUS_1..6 broadcasts.
+
+  process() is meant to be called from the CAN receive interrupt (an
+  onReceive() callback with FIFO/mailbox interrupts enabled). It decodes the
+  frame straight into the controller's slot and publishes it through a
+  seqlock: the sequence counter is odd while the ISR is writing, so a reader
+  copies the slot and retries only if the counter moved underneath it.
+  The control loop never blocks on the bus and never disables interrupts
+  (only add() does, briefly, since the ISR may be adding a slot too):
+
+      VESC_telemetry<4> telemetry;
+      void canRx(const CAN_message_t &msg) { telemetry.process(msg); }
+      ...
+      VESC_telemetry_t left;
+      if ( telemetry.read(1, left) && telemetry.age(left, STATUS_1) < 50000 ) ...
+
+  Each slot also keeps the arrival time of every status type and a smoothed
+  period (1/8 exponential average), so callers can see how fresh and how
+  fast the data is. age() of a status type that never arrived is
+  UINT32_MAX, so it always reads as stale.
+*/
+
+#if !defined(_VESC_TELEMETRY_H_)
+#define _VESC_TELEMETRY_H_
+
+#include "VescCAN.h"
+
+typedef enum VESC_STATUS_INDEX {
+  STATUS_1 = 0,
+  STATUS_2,
+  STATUS_3,
+  STATUS_4,
+  STATUS_5,
+  STATUS_6,
+  STATUS_COUNT
+} VESC_STATUS_INDEX;
+
+typedef struct VESC_telemetry_t {
+  VESC_status_t status;
+  uint32_t stamp_us[STATUS_COUNT] = { 0 };   /* micros() when each status type last arrived */
+  uint32_t period_us[STATUS_COUNT] = { 0 };  /* smoothed interval between arrivals, 0 until two seen */
+  uint32_t frames = 0;                       /* status frames decoded for this controller */
+  uint8_t seen = 0;                          /* bit n set once status type n has arrived */
+} VESC_telemetry_t;
+
+static inline int8_t vescStatusIndex(uint8_t packet) {
+  switch ( packet ) {
+    case CAN_PACKET_STATUS: return STATUS_1;
+    case CAN_PACKET_STATUS_2: return STATUS_2;
+    case CAN_PACKET_STATUS_3: return STATUS_3;
+    case CAN_PACKET_STATUS_4: return STATUS_4;
+    case CAN_PACKET_STATUS_5: return STATUS_5;
+    case CAN_PACKET_STATUS_6: return STATUS_6;
+  }
+  return -1;
+}
+
+#define VESC_TELEMETRY_CLASS template<uint8_t _maxControllers = 4>
+#define VESC_TELEMETRY_FUNC template<uint8_t _maxControllers>
+#define VESC_TELEMETRY_OPT VESC_telemetry<_maxControllers>
+
+VESC_TELEMETRY_CLASS class VESC_telemetry {
+  public:
+    VESC_telemetry() { memset(slotOf, 0, sizeof(slotOf)); }
+    bool add(uint8_t controller_id); /* reserve a slot up front; unknown IDs are otherwise added on first frame */
+#if defined(ARDUINO)
+    bool process(const CAN_message_t &msg) { return process(msg, micros()); }
+#endif
+    bool process(const CAN_message_t &msg, uint32_t now_us);
+    bool read(uint8_t controller_id, VESC_telemetry_t &out) const;
+    uint8_t snapshot(VESC_telemetry_t *out, uint8_t count) const; /* all slots in registration order */
+    uint8_t size() const { return used; }
+    uint32_t age(const VESC_telemetry_t &t, VESC_STATUS_INDEX index, uint32_t now_us) const {
+      return ( t.seen & (1U << index) ) ? now_us - t.stamp_us[index] : UINT32_MAX;
+    }
+#if defined(ARDUINO)
+    uint32_t age(const VESC_telemetry_t &t, VESC_STATUS_INDEX index) const { return age(t, index, micros()); }
+#endif
+    uint32_t dropped() const { return overflow; } /* status frames from controllers that did not fit */
+
+  private:
+    struct slot_t {
+      volatile uint32_t seq = 0;
+      VESC_telemetry_t data;
+    };
+    bool insert(uint8_t controller_id);
+    void copySlot(const slot_t &s, VESC_telemetry_t &out) const;
+    slot_t slots[_maxControllers];
+    uint8_t slotOf[256]; /* controller id -> slot + 1, 0 when unassigned */
+    volatile uint8_t used = 0;
+    volatile uint32_t overflow = 0;
+};
+
+VESC_TELEMETRY_FUNC bool VESC_TELEMETRY_OPT::add(uint8_t controller_id) {
+#if defined(ARDUINO)
+  __disable_irq(); /* process() adds unknown IDs from the receive interrupt */
+#endif
+  bool added = insert(controller_id);
+#if defined(ARDUINO)
+  __enable_irq();
+#endif
+  return added;
+}
+
+VESC_TELEMETRY_FUNC bool VESC_TELEMETRY_OPT::insert(uint8_t controller_id) {
+  if ( slotOf[controller_id] ) return 1;
+  if ( used >= _maxControllers ) return 0;
+  slots[used].data.status.controller_id = controller_id;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slotOf[controller_id] = ++used;
+  return 1;
+}
+
+VESC_TELEMETRY_FUNC bool VESC_TELEMETRY_OPT::process(const CAN_message_t &msg, uint32_t now_us) {
+  if ( !msg.flags.extended || msg.len < 8 ) return 0;
+  int8_t index = vescStatusIndex(VESC_CAN_PACKET(msg.id));
+  if ( index < 0 ) return 0;
+  uint8_t id = VESC_CAN_CONTROLLER(msg.id);
+  if ( !slotOf[id] && !insert(id) ) {
+    overflow++;
+    return 0;
+  }
+  slot_t &s = slots[slotOf[id] - 1];
+
+  s.seq++; /* odd: write in progress */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  VESC_telemetry_t &t = s.data;
+  vescDecodeStatus(msg, t.status);
+  if ( t.seen & (1U << index) ) {
+    uint32_t interval = now_us - t.stamp_us[index];
+    t.period_us[index] = ( t.period_us[index] ) ? (t.period_us[index] - (t.period_us[index] >> 3) + (interval >> 3)) : interval;
+  }
+  t.stamp_us[index] = now_us;
+  t.seen |= (1U << index);
+  t.frames++;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  s.seq++; /* even: consistent */
+  return 1;
+}
+
+VESC_TELEMETRY_FUNC void VESC_TELEMETRY_OPT::copySlot(const slot_t &s, VESC_telemetry_t &out) const {
+  uint32_t before, after;
+  do {
+    while ( (before = s.seq) & 1 ); /* ISR is mid-update, it finishes before we run again */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    memcpy((void*)&out, (const void*)&s.data, sizeof(out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = s.seq;
+  } while ( before != after );
+}
+
+VESC_TELEMETRY_FUNC bool VESC_TELEMETRY_OPT::read(uint8_t controller_id, VESC_telemetry_t &out) const {
+  uint8_t slot = slotOf[controller_id];
+  if ( !slot ) return 0;
+  copySlot(slots[slot - 1], out);
+  return 1;
+}
+
+VESC_TELEMETRY_FUNC uint8_t VESC_TELEMETRY_OPT::snapshot(VESC_telemetry_t *out, uint8_t count) const {
+  uint8_t n = ( count < used ) ? count : used;
+  for ( uint8_t i = 0; i < n; i++ ) copySlot(slots[i], out[i]);
+  return n;
+}
+
+#endif
@@ -26,13 +26,50 @@
 #define spi_readwrite mcpSPI->transfer
 #define spi_read() spi_readwrite(0x00)
 
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+/* in an interrupt or with interrupts masked, where the DMA completion interrupt may never get to run */
+static inline bool mcp2515_cannotWait(void)
+{
+    uint32_t ipsr, primask;
+    __asm__ volatile("mrs %0, ipsr" : "=r" (ipsr));
+    __asm__ volatile("mrs %0, primask" : "=r" (primask));
+    return ipsr || primask;
+}
+#endif
+
+/*********************************************************************************************************
+** Function name:           mcp2515_spiBlock
+** Descriptions:            Clocks a whole instruction buffer in one chip-select window. The buffer is
+**                          overwritten with the bytes shifted in by the MCP2515. Fails (buffer
+**                          zeroed) when a DMA frame load is in flight and this cannot wait for it.
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_spiBlock(INT8U buf[], const INT8U n)
+{
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+    if (m_asyncBusy && mcp2515_cannotWait())
+    {
+        memset(buf, 0, n);
+        return MCP2515_FAIL;
+    }
+    while (m_asyncBusy) ;                                               /* let a DMA frame load finish  */
+    if (m_asyncPending && !mcp2515_cannotWait())
+        mcp2515_asyncPoll();                                            /* its RTS goes first           */
+#endif
+    mcpSPI->beginTransaction(mcpSPISettings);
+    MCP2515_SELECT();
+    mcpSPI->transfer(buf, n);
+    MCP2515_UNSELECT();
+    mcpSPI->endTransaction();
+    return MCP2515_OK;
+}
+
 /*********************************************************************************************************
 ** Function name:           mcp2515_reset
 ** Descriptions:            Performs a software reset
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_reset(void)                                      
 {
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
+    mcpSPI->beginTransaction(mcpSPISettings);
     MCP2515_SELECT();
     spi_readwrite(MCP_RESET);
     MCP2515_UNSELECT();
@@ -46,36 +83,30 @@ void MCP_CAN::mcp2515_reset(void)
 *********************************************************************************************************/
 INT8U MCP_CAN::mcp2515_readRegister(const INT8U address)                                                                     
 {
-    INT8U ret;
+    INT8U buf[3] = { MCP_READ, address, 0x00 };
 
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
-    MCP2515_SELECT();
-    spi_readwrite(MCP_READ);
-    spi_readwrite(address);
-    ret = spi_read();
-    MCP2515_UNSELECT();
-    mcpSPI->endTransaction();
+    mcp2515_spiBlock(buf, 3);
 
-    return ret;
+    return buf[2];
 }
 
 /*********************************************************************************************************
 ** Function name:           mcp2515_readRegisterS
-** Descriptions:            Reads successive data registers
+** Descriptions:            Reads successive data registers, at most MCP_SPI_BURST_MAX
 *********************************************************************************************************/
-void MCP_CAN::mcp2515_readRegisterS(const INT8U address, INT8U values[], const INT8U n)
+INT8U MCP_CAN::mcp2515_readRegisterS(const INT8U address, INT8U values[], const INT8U n)
 {
-    INT8U i;
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
-    MCP2515_SELECT();
-    spi_readwrite(MCP_READ);
-    spi_readwrite(address);
-    // mcp2515 has auto-increment of address-pointer
-    for (i=0; i<n; i++) 
-        values[i] = spi_read();
+    INT8U buf[2 + MCP_SPI_BURST_MAX];
 
-    MCP2515_UNSELECT();
-    mcpSPI->endTransaction();
+    if (n > MCP_SPI_BURST_MAX)
+        return MCP2515_FAIL;
+    buf[0] = MCP_READ;
+    buf[1] = address;
+    memset(&buf[2], 0, n);
+    // mcp2515 has auto-increment of address-pointer
+    INT8U res = mcp2515_spiBlock(buf, n + 2);
+    memcpy(values, &buf[2], n);
+    return res;
 }
 
 /*********************************************************************************************************
@@ -84,32 +115,25 @@ void MCP_CAN::mcp2515_readRegisterS(const INT8U address, INT8U values[], const I
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_setRegister(const INT8U address, const INT8U value)
 {
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
-    MCP2515_SELECT();
-    spi_readwrite(MCP_WRITE);
-    spi_readwrite(address);
-    spi_readwrite(value);
-    MCP2515_UNSELECT();
-    mcpSPI->endTransaction();
+    INT8U buf[3] = { MCP_WRITE, address, value };
+
+    mcp2515_spiBlock(buf, 3);
 }
 
 /*********************************************************************************************************
 ** Function name:           mcp2515_setRegisterS
-** Descriptions:            Sets successive data registers
+** Descriptions:            Sets successive data registers, at most MCP_SPI_BURST_MAX
 *********************************************************************************************************/
-void MCP_CAN::mcp2515_setRegisterS(const INT8U address, const INT8U values[], const INT8U n)
+INT8U MCP_CAN::mcp2515_setRegisterS(const INT8U address, const INT8U values[], const INT8U n)
 {
-    INT8U i;
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
-    MCP2515_SELECT();
-    spi_readwrite(MCP_WRITE);
-    spi_readwrite(address);
-       
-    for (i=0; i<n; i++) 
-        spi_readwrite(values[i]);
-	
-    MCP2515_UNSELECT();
-    mcpSPI->endTransaction();
+    INT8U buf[2 + MCP_SPI_BURST_MAX];
+
+    if (n > MCP_SPI_BURST_MAX)
+        return MCP2515_FAIL;
+    buf[0] = MCP_WRITE;
+    buf[1] = address;
+    memcpy(&buf[2], values, n);
+    return mcp2515_spiBlock(buf, n + 2);
 }
 
 /*********************************************************************************************************
@@ -118,14 +142,9 @@ void MCP_CAN::mcp2515_setRegisterS(const INT8U address, const INT8U values[], co
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_modifyRegister(const INT8U address, const INT8U mask, const INT8U data)
 {
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
-    MCP2515_SELECT();
-    spi_readwrite(MCP_BITMOD);
-    spi_readwrite(address);
-    spi_readwrite(mask);
-    spi_readwrite(data);
-    MCP2515_UNSELECT();
-    mcpSPI->endTransaction();
+    INT8U buf[4] = { MCP_BITMOD, address, mask, data };
+
+    mcp2515_spiBlock(buf, 4);
 }
 
 /*********************************************************************************************************
@@ -134,14 +153,23 @@ void MCP_CAN::mcp2515_modifyRegister(const INT8U address, const INT8U mask, cons
 *********************************************************************************************************/
 INT8U MCP_CAN::mcp2515_readStatus(void)                             
 {
-    INT8U i;
-    mcpSPI->beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
-    MCP2515_SELECT();
-    spi_readwrite(MCP_READ_STATUS);
-    i = spi_read();
-    MCP2515_UNSELECT();
-    mcpSPI->endTransaction();
-    return i;
+    INT8U buf[2] = { MCP_READ_STATUS, 0x00 };
+
+    mcp2515_spiBlock(buf, 2);
+
+    return buf[1];
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_requestToSend
+** Descriptions:            Starts transmission of a loaded TX buffer with the one byte RTS instruction
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_requestToSend(const INT8U buffer_sidh_addr)
+{
+    const INT8U rts[MCP_N_TXBUFFERS] = { MCP_RTS_TX0, MCP_RTS_TX1, MCP_RTS_TX2 };
+    INT8U buf[1] = { rts[(buffer_sidh_addr - MCP_TXB0CTRL - 1) >> 4] };
+
+    mcp2515_spiBlock(buf, 1);
 }
 
 /*********************************************************************************************************
@@ -506,7 +534,7 @@ INT8U MCP_CAN::mcp2515_configRate(const INT8U canSpeed, const INT8U canClock)
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_initCANBuffers(void)
 {
-    INT8U i, a1, a2, a3;
+    INT8U zeros[MCP_SPI_BURST_MAX] = { 0 };
     
     INT8U std = 0;               
     INT8U ext = 1;
@@ -527,17 +555,9 @@ void MCP_CAN::mcp2515_initCANBuffers(void)
                                                                         /* Clear, deactivate the three  */
                                                                         /* transmit buffers             */
                                                                         /* TXBnCTRL -> TXBnD7           */
-    a1 = MCP_TXB0CTRL;
-    a2 = MCP_TXB1CTRL;
-    a3 = MCP_TXB2CTRL;
-    for (i = 0; i < 14; i++) {                                          /* in-buffer loop               */
-        mcp2515_setRegister(a1, 0);
-        mcp2515_setRegister(a2, 0);
-        mcp2515_setRegister(a3, 0);
-        a1++;
-        a2++;
-        a3++;
-    }
+    mcp2515_setRegisterS(MCP_TXB0CTRL, zeros, MCP_SPI_BURST_MAX);
+    mcp2515_setRegisterS(MCP_TXB1CTRL, zeros, MCP_SPI_BURST_MAX);
+    mcp2515_setRegisterS(MCP_TXB2CTRL, zeros, MCP_SPI_BURST_MAX);
     mcp2515_setRegister(MCP_RXB0CTRL, 0);
     mcp2515_setRegister(MCP_RXB1CTRL, 0);
 }
@@ -655,9 +675,20 @@ INT8U MCP_CAN::mcp2515_init(const INT8U canIDMode, const INT8U canSpeed, const I
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_write_id( const INT8U mcp_addr, const INT8U ext, const INT32U id )
 {
-    uint16_t canid;
     INT8U tbufdata[4];
 
+    mcp2515_pack_id(ext, id, tbufdata);
+    mcp2515_setRegisterS( mcp_addr, tbufdata, 4 );
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_pack_id
+** Descriptions:            Encode a CAN ID into the SIDH, SIDL, EID8, EID0 register layout
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_pack_id( const INT8U ext, const INT32U id, INT8U tbufdata[] )
+{
+    uint16_t canid;
+
     canid = (uint16_t)(id & 0x0FFFF);
 
     if ( ext == 1) 
@@ -677,8 +708,6 @@ void MCP_CAN::mcp2515_write_id( const INT8U mcp_addr, const INT8U ext, const INT
         tbufdata[MCP_EID0] = 0;
         tbufdata[MCP_EID8] = 0;
     }
-    
-    mcp2515_setRegisterS( mcp_addr, tbufdata, 4 );
 }
 
 /*********************************************************************************************************
@@ -722,11 +751,17 @@ void MCP_CAN::mcp2515_read_id( const INT8U mcp_addr, INT8U* ext, INT32U* id )
 {
     INT8U tbufdata[4];
 
-    *ext = 0;
-    *id = 0;
-
     mcp2515_readRegisterS( mcp_addr, tbufdata, 4 );
+    mcp2515_unpack_id( tbufdata, ext, id );
+}
 
+/*********************************************************************************************************
+** Function name:           mcp2515_unpack_id
+** Descriptions:            Decode a CAN ID from the SIDH, SIDL, EID8, EID0 register layout
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_unpack_id( const INT8U tbufdata[], INT8U* ext, INT32U* id )
+{
+    *ext = 0;
     *id = (tbufdata[MCP_SIDH]<<3) + (tbufdata[MCP_SIDL]>>5);
 
     if ( (tbufdata[MCP_SIDL] & MCP_TXB_EXIDE_M) ==  MCP_TXB_EXIDE_M ) 
@@ -745,16 +780,29 @@ void MCP_CAN::mcp2515_read_id( const INT8U mcp_addr, INT8U* ext, INT32U* id )
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_write_canMsg( const INT8U buffer_sidh_addr)
 {
-    INT8U mcp_addr;
-    mcp_addr = buffer_sidh_addr;
-    mcp2515_setRegisterS(mcp_addr+5, m_nDta, m_nDlc );                  /* write data bytes             */
-	
-    if ( m_nRtr == 1)                                                   /* if RTR set bit in byte       */
-        m_nDlc |= MCP_RTR_MASK;  
+    INT8U buf[2 + MCP_FRAME_LEN];
 
-    mcp2515_setRegister((mcp_addr+4), m_nDlc );                         /* write the RTR and DLC        */
-    mcp2515_write_id(mcp_addr, m_nExtFlg, m_nID );                      /* write CAN id                 */
+    mcp2515_spiBlock(buf, mcp2515_build_canMsg(buffer_sidh_addr, buf));
+}
 
+/*********************************************************************************************************
+** Function name:           mcp2515_build_canMsg
+** Descriptions:            Build the WRITE instruction that loads SIDH, SIDL, EID8, EID0, DLC and data
+**                          in one auto-increment burst. Returns the number of bytes to clock out.
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_build_canMsg( const INT8U buffer_sidh_addr, INT8U buf[] )
+{
+    INT8U dlc = (m_nDlc > MAX_CHAR_IN_MESSAGE) ? MAX_CHAR_IN_MESSAGE : m_nDlc;
+
+    buf[0] = MCP_WRITE;
+    buf[1] = buffer_sidh_addr;
+    mcp2515_pack_id(m_nExtFlg, m_nID, &buf[2]);
+    buf[6] = dlc;
+    if ( m_nRtr == 1)                                                   /* if RTR set bit in byte       */
+        buf[6] |= MCP_RTR_MASK;
+    memcpy(&buf[7], m_nDta, dlc);
+
+    return 7 + dlc;
 }
 
 /*********************************************************************************************************
@@ -763,22 +811,20 @@ void MCP_CAN::mcp2515_write_canMsg( const INT8U buffer_sidh_addr)
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_read_canMsg( const INT8U buffer_sidh_addr)        /* read can msg                 */
 {
-    INT8U mcp_addr, ctrl;
+    INT8U buf[MCP_SPI_BURST_MAX];                                       /* CTRL, SIDH..EID0, DLC, D0..D7*/
 
-    mcp_addr = buffer_sidh_addr;
+    mcp2515_readRegisterS( buffer_sidh_addr-1, buf, MCP_SPI_BURST_MAX );
+    mcp2515_unpack_id( &buf[1], &m_nExtFlg, &m_nID );
 
-    mcp2515_read_id( mcp_addr, &m_nExtFlg,&m_nID );
-
-    ctrl = mcp2515_readRegister( mcp_addr-1 );
-    m_nDlc = mcp2515_readRegister( mcp_addr+4 );
-
-    if (ctrl & 0x08)
+    if (buf[0] & 0x08)
         m_nRtr = 1;
     else
         m_nRtr = 0;
 
-    m_nDlc &= MCP_DLC_MASK;
-    mcp2515_readRegisterS( mcp_addr+5, &(m_nDta[0]), m_nDlc );
+    m_nDlc = buf[5] & MCP_DLC_MASK;
+    if (m_nDlc > MAX_CHAR_IN_MESSAGE)
+        m_nDlc = MAX_CHAR_IN_MESSAGE;
+    memcpy(m_nDta, &buf[6], m_nDlc);
 }
 
 /*********************************************************************************************************
@@ -787,23 +833,20 @@ void MCP_CAN::mcp2515_read_canMsg( const INT8U buffer_sidh_addr)        /* read
 *********************************************************************************************************/
 INT8U MCP_CAN::mcp2515_getNextFreeTXBuf(INT8U *txbuf_n)                 /* get Next free txbuf          */
 {
-    INT8U res, i, ctrlval;
-    INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+    INT8U i, stat;
+    const INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
 
-    res = MCP_ALLTXBUSY;
     *txbuf_n = 0x00;
 
-                                                                        /* check all 3 TX-Buffers       */
+                                                                        /* READ STATUS carries TXnREQ   */
+    stat = mcp2515_readStatus();                                        /* in bits 2, 4 and 6           */
     for (i=0; i<MCP_N_TXBUFFERS; i++) {
-        ctrlval = mcp2515_readRegister( ctrlregs[i] );
-        if ( (ctrlval & MCP_TXB_TXREQ_M) == 0 ) {
+        if ( (stat & (0x04 << (i * 2))) == 0 ) {
             *txbuf_n = ctrlregs[i]+1;                                   /* return SIDH-address of Buffer*/
-            
-            res = MCP2515_OK;
-            return res;                                                 /* ! function exit              */
+            return MCP2515_OK;                                          /* ! function exit              */
         }
     }
-    return res;
+    return MCP_ALLTXBUSY;
 }
 
 /*********************************************************************************************************
@@ -816,6 +859,7 @@ MCP_CAN::MCP_CAN(INT8U _CS)
     MCP2515_UNSELECT();
     pinMode(MCPCS, OUTPUT);
     mcpSPI = &SPI;
+    mcpSPISettings = SPISettings(MCP_SPI_CLOCK, MSBFIRST, SPI_MODE0);
 }
 
 /*********************************************************************************************************
@@ -828,6 +872,7 @@ MCP_CAN::MCP_CAN(SPIClass *_SPI, INT8U _CS)
     MCP2515_UNSELECT();
     pinMode(MCPCS, OUTPUT);
     mcpSPI = _SPI;
+    mcpSPISettings = SPISettings(MCP_SPI_CLOCK, MSBFIRST, SPI_MODE0);
 }
 
 /*********************************************************************************************************
@@ -1110,6 +1155,10 @@ INT8U MCP_CAN::sendMsg()
     INT8U res, res1, txbuf_n;
     uint32_t uiTimeOut, temp;
 
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+    if ((m_asyncBusy || m_asyncPending) && mcp2515_cannotWait())
+        return CAN_FAILTX;                                              /* its TX buffer still looks free */
+#endif
     temp = micros();
     // 24 * 4 microseconds typical
     do {
@@ -1123,7 +1172,7 @@ INT8U MCP_CAN::sendMsg()
     }
     uiTimeOut = 0;
     mcp2515_write_canMsg( txbuf_n);
-    mcp2515_modifyRegister( txbuf_n-1 , MCP_TXB_TXREQ_M, MCP_TXB_TXREQ_M );
+    mcp2515_requestToSend( txbuf_n );
     
     temp = micros();
     do
@@ -1174,6 +1223,92 @@ INT8U MCP_CAN::sendMsgBuf(INT32U id, INT8U len, INT8U *buf)
     return res;
 }
 
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+/*********************************************************************************************************
+** Function name:           sendMsgBufAsync
+** Descriptions:            Loads a free TX buffer with a DMA SPI transfer and returns immediately. The
+**                          DMA completion interrupt only releases the bus; the RTS instruction and
+**                          callback(CAN_OK) follow in thread context, from yield() or from the next
+**                          driver call, whichever comes first. No blocking SPI transfer runs in the
+**                          interrupt, so other devices on the bus are safe. Does not wait for a TX
+**                          buffer or for the frame to leave the controller; returns
+**                          CAN_GETTXBFTIMEOUT if all three are busy.
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBufAsync(INT32U id, INT8U ext, INT8U len, INT8U *buf, mcpAsyncCallback callback)
+{
+    INT8U txbuf_n, n;
+
+    if (m_asyncBusy || (m_asyncPending && mcp2515_cannotWait()))
+        return CAN_FAILTX;
+
+    if (mcp2515_getNextFreeTXBuf(&txbuf_n) != MCP2515_OK)
+        return CAN_GETTXBFTIMEOUT;
+
+    setMsg(id, 0, ext, len, buf);
+    n = mcp2515_build_canMsg(txbuf_n, m_asyncFrame);
+
+    m_asyncBusy = 1;
+    m_asyncTxBuf = txbuf_n;
+    m_asyncCallback = callback;
+    m_asyncEvent.setContext(this);
+    m_asyncEvent.attachImmediate(&MCP_CAN::mcp2515_asyncDone);
+    m_asyncRtsEvent.setContext(this);
+    m_asyncRtsEvent.attach(&MCP_CAN::mcp2515_asyncRts);
+
+    mcpSPI->beginTransaction(mcpSPISettings);
+    MCP2515_SELECT();
+    if (!mcpSPI->transfer(m_asyncFrame, nullptr, n, m_asyncEvent))
+    {
+        MCP2515_UNSELECT();
+        mcpSPI->endTransaction();
+        m_asyncBusy = 0;
+        return CAN_FAILTX;
+    }
+
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_asyncDone
+** Descriptions:            DMA completion handler for sendMsgBufAsync, interrupt. Releases the bus and
+**                          leaves the RTS to mcp2515_asyncPoll.
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_asyncDone(EventResponderRef event)
+{
+    MCP_CAN *can = (MCP_CAN *)event.getContext();
+
+    digitalWrite(can->MCPCS, HIGH);
+    can->mcpSPI->endTransaction();
+    can->m_asyncPending = 1;
+    can->m_asyncBusy = 0;
+    can->m_asyncRtsEvent.triggerEvent();
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_asyncRts
+** Descriptions:            Runs mcp2515_asyncPoll from yield()
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_asyncRts(EventResponderRef event)
+{
+    ((MCP_CAN *)event.getContext())->mcp2515_asyncPoll();
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_asyncPoll
+** Descriptions:            Thread context: issues the RTS for a finished DMA load and runs its callback
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_asyncPoll(void)
+{
+    if (!m_asyncPending)
+        return;
+    m_asyncPending = 0;
+    mcp2515_requestToSend(m_asyncTxBuf);
+
+    if (m_asyncCallback)
+        m_asyncCallback(CAN_OK);
+}
+#endif
+
 /*********************************************************************************************************
 ** Function name:           readMsg
 ** Descriptions:            Read message
@@ -41,6 +41,16 @@ class MCP_CAN
     SPIClass *mcpSPI;                                                       // The SPI-Device used
     INT8U   MCPCS;                                                      // Chip Select pin number
     INT8U   mcpMode;                                                    // Mode to return to after configurations are performed.
+    SPISettings mcpSPISettings;                                         // Cached so every transfer does not rebuild it
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+    EventResponder m_asyncEvent;                                        // DMA completion event
+    INT8U   m_asyncFrame[2 + MCP_FRAME_LEN];                            // Must outlive the DMA transfer
+    INT8U   m_asyncTxBuf;                                               // TX buffer the DMA transfer is loading
+    EventResponder m_asyncRtsEvent;                                     // RTS after the load, from yield()
+    volatile INT8U m_asyncBusy = 0;                                     // DMA load holds the SPI bus
+    volatile INT8U m_asyncPending = 0;                                  // loaded, RTS not issued yet
+    void    (*m_asyncCallback)(INT8U res) = nullptr;
+#endif
     
 
 /*********************************************************************************************************
@@ -49,20 +59,22 @@ class MCP_CAN
    // private:
    private:
 
+    INT8U mcp2515_spiBlock(INT8U buf[], const INT8U n);                 // One chip-select block transfer
+
     void mcp2515_reset(void);                                           // Soft Reset MCP2515
 
     INT8U mcp2515_readRegister(const INT8U address);                    // Read MCP2515 register
     
-    void mcp2515_readRegisterS(const INT8U address,                     // Read MCP2515 successive registers
-                                     INT8U values[], 
-                               const INT8U n);
+    INT8U mcp2515_readRegisterS(const INT8U address,                    // Read MCP2515 successive registers
+                                      INT8U values[], 
+                                const INT8U n);
 
     void mcp2515_setRegister(const INT8U address,                       // Set MCP2515 register
                              const INT8U value);
 
-    void mcp2515_setRegisterS(const INT8U address,                      // Set MCP2515 successive registers
-                              const INT8U values[],
-                              const INT8U n);
+    INT8U mcp2515_setRegisterS(const INT8U address,                     // Set MCP2515 successive registers
+                               const INT8U values[],
+                               const INT8U n);
 
     void mcp2515_initCANBuffers(void);
 
@@ -71,6 +83,7 @@ class MCP_CAN
                                 const INT8U data);
 
     INT8U mcp2515_readStatus(void);                                     // Read MCP2515 Status
+    void mcp2515_requestToSend(const INT8U buffer_sidh_addr);           // RTS instruction for a TX buffer
     INT8U mcp2515_setCANCTRL_Mode(const INT8U newmode);                 // Set mode
     INT8U mcp2515_requestNewMode(const INT8U newmode);                  // Set mode
     INT8U mcp2515_configRate(const INT8U canSpeed,                      // Set baudrate
@@ -93,9 +106,24 @@ class MCP_CAN
       INT8U* ext,
                                 INT32U* id );
 
+    void mcp2515_pack_id( const INT8U ext,                              // Encode CAN ID registers
+                          const INT32U id,
+                          INT8U tbufdata[] );
+
+    void mcp2515_unpack_id( const INT8U tbufdata[],                     // Decode CAN ID registers
+                            INT8U* ext,
+                            INT32U* id );
+
     void mcp2515_write_canMsg( const INT8U buffer_sidh_addr );          // Write CAN message
+    INT8U mcp2515_build_canMsg( const INT8U buffer_sidh_addr,           // Build TX buffer load burst
+                                INT8U buf[] );
     void mcp2515_read_canMsg( const INT8U buffer_sidh_addr);            // Read CAN message
     INT8U mcp2515_getNextFreeTXBuf(INT8U *txbuf_n);                     // Find empty transmit buffer
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+    static void mcp2515_asyncDone(EventResponderRef event);             // DMA completion handler
+    static void mcp2515_asyncRts(EventResponderRef event);              // yield() handler, runs asyncPoll
+    void mcp2515_asyncPoll(void);                                       // RTS of a finished load
+#endif
 
 /*********************************************************************************************************
  *  CAN operator function
@@ -118,6 +146,12 @@ public:
     INT8U setMode(INT8U opMode);                                        // Set operational mode
     INT8U sendMsgBuf(INT32U id, INT8U ext, INT8U len, INT8U *buf);      // Send message to transmit buffer
     INT8U sendMsgBuf(INT32U id, INT8U len, INT8U *buf);                 // Send message to transmit buffer
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+    typedef void (*mcpAsyncCallback)(INT8U res);
+    INT8U sendMsgBufAsync(INT32U id, INT8U ext, INT8U len, INT8U *buf,  // Load transmit buffer by DMA
+                          mcpAsyncCallback callback = nullptr);
+    bool  asyncBusy(void) { return m_asyncBusy || m_asyncPending; }     // DMA load or its RTS still pending
+#endif
     INT8U readMsgBuf(INT32U *id, INT8U *ext, INT8U *len, INT8U *buf);   // Read message from receive buffer
     INT8U readMsgBuf(INT32U *id, INT8U *len, INT8U *buf);               // Read message from receive buffer
     INT8U checkReceive(void);                                           // Check for received data
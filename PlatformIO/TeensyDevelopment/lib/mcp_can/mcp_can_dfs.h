@@ -412,6 +412,10 @@
 #define MCP2515_SELECT()   digitalWrite(MCPCS, LOW)
 #define MCP2515_UNSELECT() digitalWrite(MCPCS, HIGH)
 
+#define MCP_SPI_CLOCK      10000000                                     /* SCK, MCP2515 max is 10MHz    */
+#define MCP_SPI_BURST_MAX  (14)                                         /* CTRL + SIDH..EID0 + DLC + D7 */
+#define MCP_FRAME_LEN      (13)                                         /* SIDH..EID0 + DLC + 8 data    */
+
 #define MCP2515_OK         (0)
 #define MCP2515_FAIL       (1)
 #define MCP_ALLTXBUSY      (2)
@@ -1,69 +1,50 @@
+// CANBUS_discovery.cpp
+/*
+  Maps the CAN bus instead of brute forcing the transmit ID.
+  200 ms of listen-only fingerprinting, then a CAN_PACKET_PING sweep of
+  VESC controller IDs 0..255. Prints every ID heard (rate, period range,
+  DLCs, likely device) and every VESC that answered, then repeats when
+  'd' is sent over serial.
+*/
+
 #include <FlexCAN_T4.h>
+#include <CanDiscovery.h>
+
+typedef FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> CanBusType;
+CanBusType can1;
+CAN_discovery<CanBusType> discovery(can1);
 
-FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+const uint32_t bitrate = 500000;
 
-int count = 0;
+// runs in the CAN interrupt
+void canRx(const CAN_message_t &msg) {
+  discovery.process(msg);
+}
 
 void setup() {
- Serial.begin(9600);
- while (!Serial);
+  Serial.begin(9600);
+  while (!Serial);
 
- can1.begin();
- can1.setBaudRate(500000); 
+  can1.begin();
+  can1.setBaudRate(bitrate);
+  can1.enableFIFO();
+  can1.enableFIFOInterrupt();
+  can1.onReceive(canRx);
 
+  discovery.begin(bitrate);
 }
 
 void loop() {
-CAN_message_t msgTransmit, msgReceive;
- 
-// adress of receiving device
-// this iterates the transmit id each loop to brute force the intended id
-  count ++;
-  msgTransmit.id = count;
-  Serial.print("CAN Message #: ");
-  Serial.println(count);
-  Serial.print("Transmit id: 0x");
-  Serial.println(count, HEX);
-
-
+  can1.events();
 
-  
- // this is the length (bytes) of can message
- msgTransmit.len = 4; 
-
- //example hex values (may set vesc motor current amps to 5)
- msgTransmit.buf[0] = 0x00;
- msgTransmit.buf[1] = 0x00; 
- msgTransmit.buf[2] = 0x13; 
- msgTransmit.buf[3] = 0x88;
- 
- // writes message over can
- can1.write(msgTransmit);
- Serial.println("----------------------- teensy transmited data");
- 
- // reads can
- can1.read(msgReceive);
-
-// msgRecieve.id is the adress for the intended recipient
-// this is set by sender (see msgTransmit.id) 
-// this is checking to handle messages with this (teensy) device adress
- if(msgReceive.id == 0x871 || msgReceive.id == 0x872){
-  Serial.println("======================================================================================");
-  Serial.println("This message is for me! \nData: ");
-  // print message
-  for (int byte : msgReceive.buf){
-    Serial.print(byte);
+  static bool printed = false;
+  if (discovery.update() && !printed) {
+    discovery.printMap();
+    printed = true;
   }
-  Serial.println();
-  Serial.println("======================================================================================");
- }else if (msgReceive.id != 0){
-    Serial.print("Unexpected message: ");
-    Serial.print(msgReceive.id,HEX);
-
-    Serial.println();
- }
 
- // this code works with no delay (goes really fuckin fast)
- // delay of 1 - 10 minimum recommended to keep can2usb software from crashing / freezing
- delay(200);
-}
\ No newline at end of file
+  if (Serial.available() && Serial.read() == 'd') {
+    discovery.begin(bitrate);
+    printed = false;
+  }
+}